@@ -10,14 +10,15 @@
  *
  * @tparam Key   The type of the cache key.
  * @tparam Value The type of the cache value.
+ * @tparam Lock  The lock strategy guarding each component (see LockPolicy.h).
  */
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Lock = std::mutex>
 class Arc : public Cache<Key, Value> {
 private:
     int capacity; ///< The maximum number of items the cache can hold.
     int promotionThreshold; ///< The frequency threshold for promotion.
-    std::unique_ptr<ArcLru<Key, Value>> lruCache; ///< LRU component of ARC.
-    std::unique_ptr<ArcLfu<Key, Value>> lfuCache; ///< LFU component of ARC.
+    std::unique_ptr<ArcLru<Key, Value, Lock>> lruCache; ///< LRU component of ARC.
+    std::unique_ptr<ArcLfu<Key, Value, Lock>> lfuCache; ///< LFU component of ARC.
 
     /**
      * @brief Check if a key exists in the ghost lists and adjust capacities.
@@ -43,8 +44,8 @@ public:
      * @param promotionThreshold The frequency threshold for promotion.
      */
     Arc(int capacity, int promotionThreshold = 2) : capacity(capacity), promotionThreshold(promotionThreshold) {
-        lruCache = std::make_unique<ArcLru<Key, Value>>(capacity, promotionThreshold);
-        lfuCache = std::make_unique<ArcLfu<Key, Value>>(capacity, promotionThreshold);
+        lruCache = std::make_unique<ArcLru<Key, Value, Lock>>(capacity, promotionThreshold);
+        lfuCache = std::make_unique<ArcLfu<Key, Value, Lock>>(capacity, promotionThreshold);
     }
 
     /**
@@ -60,7 +61,7 @@ public:
             bool flag = false;
             lruCache->put(key, value, flag);
             if(flag){
-                lfuCache->put(key, value);
+                lfuCache->put(key, value, false);
             }
         }
     }
@@ -71,15 +72,67 @@ public:
      * @return The value associated with the key, or a default value if not found.
      */
     Value get(const Key key) override {
-        checkGhost(key);
         Value value{};
+        get(key, value);
+        return value;
+    }
+
+    /**
+     * @brief Retrieve a value from the cache, reporting whether it was present.
+     * @param key   The key to look up.
+     * @param value Output parameter for the value.
+     * @return True on a hit, false otherwise.
+     */
+    bool get(const Key key, Value& value) override {
+        checkGhost(key);
         bool flag = false;
-        if(lruCache->get(key,value, flag)){
+        if(lruCache->get(key, value, flag)){
             if(flag){
-                lfuCache->put(key, value);
-            }   
-            return value;
+                lfuCache->put(key, value, false);
+            }
+            return true;
+        }
+        return lfuCache->get(key, value);
+    }
+
+    /**
+     * @brief Remove a key from both components and their ghost lists.
+     * @param key The key to remove.
+     */
+    void remove(const Key key) override {
+        lruCache->remove(key);
+        lfuCache->remove(key);
+    }
+
+    /**
+     * @brief Number of entries in both components.
+     */
+    size_t size() override {
+        return lruCache->size() + lfuCache->size();
+    }
+
+    /**
+     * @brief Evict one entry from the larger component.
+     * @return True if an entry was evicted, false if both were empty.
+     */
+    bool evict() override {
+        if (lruCache->size() >= lfuCache->size()) {
+            return lruCache->evict() || lfuCache->evict();
         }
-        return lfuCache->get(key);
+        return lfuCache->evict() || lruCache->evict();
+    }
+
+    /**
+     * @brief Report removals from both components.
+     *
+     * A promoted key is held by both components, and each reports its copy
+     * when it leaves.
+     *
+     * @param listener The listener, not owned.
+     */
+    void setRemovalListener(RemovalListener<Key, Value>* listener) override {
+        Cache<Key, Value>::setRemovalListener(listener);
+        lruCache->setRemovalListener(listener);
+        lfuCache->setRemovalListener(listener);
     }
 };
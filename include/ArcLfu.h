@@ -1,15 +1,19 @@
 #pragma once
+#include "Cache.h"
 #include "LinkedList.h"
+#include "LockPolicy.h"
 #include <unordered_map>
 #include <mutex>
+#include <climits>
 
 /**
  * @brief LFU component for ARC cache, with ghost list support.
  *
  * @tparam Key   The type of the cache key.
  * @tparam Value The type of the cache value.
+ * @tparam Lock  The lock strategy guarding the component (see LockPolicy.h).
  */
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Lock = std::mutex>
 class ArcLfu {
 private:
     int capacity; ///< The maximum number of items the cache can hold.
@@ -18,8 +22,9 @@ private:
     std::unordered_map<Key, std::shared_ptr<Node<Key, Value>>> ghostMap; ///< Map for quick access to ghost list nodes.
     std::shared_ptr<LinkedList<Key, Value>> ghostlist; ///< The ghost list for tracking evicted items.
     std::unordered_map<int, std::unique_ptr<LinkedList<Key, Value>>> freqList; ///< Frequency-list mapping for LFU.
-    std::mutex mutex_; ///< Mutex for thread safety.
+    Lock mutex_; ///< Lock guarding the component.
     int minFreq; ///< The current minimum frequency in the cache.
+    RemovalListener<Key, Value>* removalListener = nullptr; ///< Receives entries leaving the main cache, or null.
 
     /**
      * @brief Update the minimum frequency in the frequency list.
@@ -69,6 +74,11 @@ private:
         auto node = freqList[minFreq]->removeFront();
         if(node == nullptr) return; // No node to evict
         cacheMap.erase(node->getKey());
+        // A ghost keeps the key only, so evicting frees the value's memory.
+        Value value = node->takeValue();
+        if (removalListener) {
+            notifyRemoval(removalListener, node->getKey(), value, RemovalCause::SIZE);
+        }
         if(ghostlist->getSize() > capacity) {
             removeOldestGhost();
         }
@@ -118,7 +128,7 @@ public:
      * @brief Increase the cache capacity by one.
      */
     void increaseCapacity() {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Lock> lock(mutex_);
         capacity++;
     }
 
@@ -127,7 +137,7 @@ public:
      * @return True if the capacity was decreased, false otherwise.
      */
     bool decreaseCapacity() {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Lock> lock(mutex_);
         // if capacity reach 0, we can't decrease it anymore
         if(capacity > 1) {
             capacity--;
@@ -161,7 +171,7 @@ public:
      * @return True if the key was found and removed, false otherwise.
      */
     bool checkGhost(const Key& key){
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Lock> lock(mutex_);
         if(ghostMap.find(key) != ghostMap.end()) {
             auto node = ghostMap[key];
             removeGhost(node);
@@ -177,7 +187,7 @@ public:
      * @return True if the key was found, false otherwise.
      */
     bool get(const Key& key, Value& value) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Lock> lock(mutex_);
         if(cacheMap.find(key) != cacheMap.end()) {
             auto node = cacheMap[key];
             value = node->getValue();
@@ -186,11 +196,6 @@ public:
                 updateMinFreq();
             }
             return true;
-        } else if(ghostMap.find(key) != ghostMap.end()) {
-            auto node = ghostMap[key];
-            value = node->getValue();
-            removeGhost(node);
-            insertNewMain(key, value);
         }
         return false;
     }
@@ -199,11 +204,15 @@ public:
      * @brief Insert or update a value in the cache.
      * @param key   The key to insert or update.
      * @param value The value to associate with the key.
+     * @param replacing Whether overwriting a value is reported (false for a copy promoted from the LRU part).
      */
-    void put(const Key key, const Value value)  {
-        std::lock_guard<std::mutex> lock(mutex_);
+    void put(const Key key, const Value value, bool replacing = true)  {
+        std::lock_guard<Lock> lock(mutex_);
         if(cacheMap.find(key) != cacheMap.end()) {
             auto node = cacheMap[key];
+            if (replacing) {
+                notifyRemoval(removalListener, key, node->takeValue(), RemovalCause::REPLACED);
+            }
             node->setValue(value);
             updateNode(node);
             if(node->getFrequency() - 1 == minFreq && freqList[minFreq]->isEmpty()) {
@@ -218,4 +227,55 @@ public:
         }
         insertNewMain(key, value);
     }
+
+    /**
+     * @brief Remove a key from the main cache and the ghost list.
+     * @param key The key to remove.
+     */
+    void remove(const Key key) {
+        std::lock_guard<Lock> lock(mutex_);
+        auto it = cacheMap.find(key);
+        if (it != cacheMap.end()) {
+            auto node = it->second;
+            freqList[node->getFrequency()]->remove(node);
+            cacheMap.erase(it);
+            if (node->getFrequency() == minFreq && freqList[minFreq]->isEmpty()) {
+                updateMinFreq();
+            }
+            notifyRemoval(removalListener, key, node->takeValue(), RemovalCause::EXPLICIT);
+        }
+        auto ghost = ghostMap.find(key);
+        if (ghost != ghostMap.end()) {
+            auto node = ghost->second;
+            removeGhost(node);
+        }
+    }
+
+    /**
+     * @brief Number of entries in the main cache.
+     */
+    size_t size() {
+        std::lock_guard<Lock> lock(mutex_);
+        return cacheMap.size();
+    }
+
+    /**
+     * @brief Report entries leaving the main cache (the ghost list keeps keys only for adaptation).
+     * @param listener The listener, not owned.
+     */
+    void setRemovalListener(RemovalListener<Key, Value>* listener) {
+        std::lock_guard<Lock> lock(mutex_);
+        removalListener = listener;
+    }
+
+    /**
+     * @brief Evict one entry from the main cache into the ghost list.
+     * @return True if an entry was evicted, false if the main cache was empty.
+     */
+    bool evict() {
+        std::lock_guard<Lock> lock(mutex_);
+        if (cacheMap.empty()) return false;
+        evictMain();
+        return true;
+    }
 };
\ No newline at end of file
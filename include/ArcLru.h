@@ -1,5 +1,7 @@
 #pragma once
+#include "Cache.h"
 #include "LinkedList.h"
+#include "LockPolicy.h"
 #include <unordered_map>
 #include <mutex>
 
@@ -8,8 +10,9 @@
  *
  * @tparam Key   The type of the cache key.
  * @tparam Value The type of the cache value.
+ * @tparam Lock  The lock strategy guarding the component (see LockPolicy.h).
  */
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Lock = std::mutex>
 class ArcLru {
 private:
     int capacity; ///< The maximum number of items the cache can hold.
@@ -18,7 +21,8 @@ private:
     std::unordered_map<Key, std::shared_ptr<Node<Key, Value>>> cacheMap; ///< Map for quick access to main cache nodes.
     std::shared_ptr<LinkedList<Key, Value>> ghostlist; ///< The ghost list for tracking evicted items.
     std::unordered_map<Key, std::shared_ptr<Node<Key, Value>>> ghostMap; ///< Map for quick access to ghost list nodes.
-    std::mutex mutex_; ///< Mutex for thread safety.
+    Lock mutex_; ///< Lock guarding the component.
+    RemovalListener<Key, Value>* removalListener = nullptr; ///< Receives entries leaving the main list, or null.
 
     /**
      * @brief Update a node's value and frequency, and check promotion.
@@ -75,6 +79,11 @@ private:
 
         if(node == nullptr) return; // No node to evict
         cacheMap.erase(node->getKey());
+        // A ghost keeps the key only, so evicting frees the value's memory.
+        Value value = node->takeValue();
+        if (removalListener) {
+            notifyRemoval(removalListener, node->getKey(), value, RemovalCause::SIZE);
+        }
         if(ghostlist->getSize() >= capacity) {
             removeOldestGhost();
         }
@@ -126,7 +135,7 @@ public:
      * @return True if the key was found and removed, false otherwise.
      */
     bool checkGhost(const Key key) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Lock> lock(mutex_);
         if(ghostMap.find(key) != ghostMap.end()) {
             auto node = ghostMap[key];
             removeGhost(node);
@@ -139,7 +148,7 @@ public:
      * @brief Increase the cache capacity by one.
      */
     void increaseCapacity(){
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Lock> lock(mutex_);
         capacity++;
     }
 
@@ -148,7 +157,7 @@ public:
      * @return True if the capacity was decreased, false otherwise.
      */
     bool decreaseCapacity(){
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Lock> lock(mutex_);
         if(capacity > 1) {
             capacity--;
             if(list->getSize() > capacity) {
@@ -170,11 +179,15 @@ public:
      * @param flag  Output flag indicating if the node was promoted.
      */
     void put(const Key key, const Value value, bool& flag)  {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Lock> lock(mutex_);
         if(cacheMap.find(key) != cacheMap.end()) {
+            if (removalListener) {
+                notifyRemoval(removalListener, key, cacheMap[key]->getValue(), RemovalCause::REPLACED);
+            }
             flag = updateNodeValue(cacheMap[key], value);
+            return;
         }
-        else if(ghostMap.find(key) != ghostMap.end()) {
+        if(ghostMap.find(key) != ghostMap.end()) {
             auto node = ghostMap[key];
             removeGhost(node);
         }
@@ -189,20 +202,61 @@ public:
      * @return True if the key was found, false otherwise.
      */
     bool get(const Key key, Value& value, bool& flag ) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<Lock> lock(mutex_);
         if(cacheMap.find(key) != cacheMap.end()) {
             auto node = cacheMap[key];
             value = node->getValue();
             flag = updateNodeValue(node, value);
             return true;
         }
-        else if(ghostMap.find(key) != ghostMap.end()) {
-            auto node = ghostMap[key];
-            value = node->getValue();
+        return false;
+    }
+
+
+    /**
+     * @brief Remove a key from the main cache and the ghost list.
+     * @param key The key to remove.
+     */
+    void remove(const Key key) {
+        std::lock_guard<Lock> lock(mutex_);
+        auto it = cacheMap.find(key);
+        if (it != cacheMap.end()) {
+            auto node = it->second;
+            removeMain(node);
+            notifyRemoval(removalListener, key, node->takeValue(), RemovalCause::EXPLICIT);
+        }
+        auto ghost = ghostMap.find(key);
+        if (ghost != ghostMap.end()) {
+            auto node = ghost->second;
             removeGhost(node);
-            insertNewMain(key, value);
         }
-        return false;
     }
 
+    /**
+     * @brief Number of entries in the main cache.
+     */
+    size_t size() {
+        std::lock_guard<Lock> lock(mutex_);
+        return cacheMap.size();
+    }
+
+    /**
+     * @brief Report entries leaving the main list (the ghost list keeps keys only for adaptation).
+     * @param listener The listener, not owned.
+     */
+    void setRemovalListener(RemovalListener<Key, Value>* listener) {
+        std::lock_guard<Lock> lock(mutex_);
+        removalListener = listener;
+    }
+
+    /**
+     * @brief Evict one entry from the main cache into the ghost list.
+     * @return True if an entry was evicted, false if the main cache was empty.
+     */
+    bool evict() {
+        std::lock_guard<Lock> lock(mutex_);
+        if (cacheMap.empty()) return false;
+        evictMain();
+        return true;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define BATCHHASH_X86 1
+#endif
+
+/**
+ * Short-key hashing with a scalar reference and AVX2/AVX-512 batch paths.
+ *
+ * The hash is Murmur3-style over 4-byte little-endian words, with the last
+ * word zero-padded and the length mixed into the finalizer. Because every
+ * word goes through the same block step, 8 (AVX2) or 16 (AVX-512) keys can be
+ * hashed in lockstep, one key per 32-bit lane. All paths produce identical
+ * values, so a key hashes the same whether it is routed alone or in a batch.
+ *
+ * The SIMD paths are compiled with target attributes and selected at run time,
+ * so the binary needs no special -m flags and still runs on older CPUs.
+ */
+namespace batchhash {
+
+constexpr size_t kMaxShortKey = 64; ///< Longer keys are hashed by the scalar path even inside a batch.
+constexpr uint32_t kSeed = 0x9747b28cu;
+constexpr uint32_t kC1 = 0xcc9e2d51u;
+constexpr uint32_t kC2 = 0x1b873593u;
+
+/**
+ * @brief Load word `i` of a key, zero-padding past the end.
+ */
+inline uint32_t loadWord(const char* data, size_t len, size_t i) {
+    uint32_t w = 0;
+    size_t off = i * 4;
+    if (off < len) {
+        size_t n = len - off < 4 ? len - off : 4;
+        std::memcpy(&w, data + off, n);
+    }
+    return w;
+}
+
+inline uint32_t rotl(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+inline uint32_t fmix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief Hash one key (scalar reference implementation).
+ * @param data Pointer to the key bytes.
+ * @param len Key length in bytes.
+ * @return The 32-bit hash.
+ */
+inline uint32_t hash32(const char* data, size_t len) {
+    uint32_t h = kSeed;
+    size_t words = (len + 3) / 4;
+    for (size_t i = 0; i < words; ++i) {
+        uint32_t k = loadWord(data, len, i) * kC1;
+        k = rotl(k, 15) * kC2;
+        h ^= k;
+        h = rotl(h, 13) * 5 + 0xe6546b64u;
+    }
+    return fmix(h ^ static_cast<uint32_t>(len));
+}
+
+inline uint32_t hash32(const std::string& key) { return hash32(key.data(), key.size()); }
+
+/**
+ * @brief Hash keys one at a time (fallback and reference for the batch paths).
+ */
+inline void hashBatchScalar(const std::string* keys, size_t n, uint32_t* out) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = hash32(keys[i]);
+    }
+}
+
+#ifdef BATCHHASH_X86
+
+/**
+ * @brief Hash keys 8 at a time with AVX2, one key per 32-bit lane.
+ */
+__attribute__((target("avx2")))
+inline void hashBatchAvx2(const std::string* keys, size_t n, uint32_t* out) {
+    const __m256i c1 = _mm256_set1_epi32(static_cast<int>(kC1));
+    const __m256i c2 = _mm256_set1_epi32(static_cast<int>(kC2));
+    const __m256i c3 = _mm256_set1_epi32(static_cast<int>(0xe6546b64u));
+    const __m256i five = _mm256_set1_epi32(5);
+    size_t base = 0;
+    for (; base + 8 <= n; base += 8) {
+        alignas(32) uint32_t words[8];
+        alignas(32) int32_t lens[8];
+        size_t maxWords = 0;
+        for (int l = 0; l < 8; ++l) {
+            size_t len = keys[base + l].size();
+            lens[l] = static_cast<int32_t>(len > kMaxShortKey ? 0 : (len + 3) / 4);
+            if (static_cast<size_t>(lens[l]) > maxWords) maxWords = lens[l];
+        }
+        const __m256i wordCount = _mm256_load_si256(reinterpret_cast<const __m256i*>(lens));
+        __m256i h = _mm256_set1_epi32(static_cast<int>(kSeed));
+        for (size_t i = 0; i < maxWords; ++i) {
+            for (int l = 0; l < 8; ++l) {
+                const std::string& key = keys[base + l];
+                words[l] = loadWord(key.data(), key.size(), i);
+            }
+            __m256i k = _mm256_mullo_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(words)), c1);
+            k = _mm256_or_si256(_mm256_slli_epi32(k, 15), _mm256_srli_epi32(k, 17));
+            k = _mm256_mullo_epi32(k, c2);
+            __m256i next = _mm256_xor_si256(h, k);
+            next = _mm256_or_si256(_mm256_slli_epi32(next, 13), _mm256_srli_epi32(next, 19));
+            next = _mm256_add_epi32(_mm256_mullo_epi32(next, five), c3);
+            // Lanes whose key has no word i keep their hash.
+            __m256i active = _mm256_cmpgt_epi32(wordCount, _mm256_set1_epi32(static_cast<int>(i)));
+            h = _mm256_blendv_epi8(h, next, active);
+        }
+        alignas(32) int32_t lengths[8];
+        for (int l = 0; l < 8; ++l) lengths[l] = static_cast<int32_t>(keys[base + l].size());
+        h = _mm256_xor_si256(h, _mm256_load_si256(reinterpret_cast<const __m256i*>(lengths)));
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+        h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<int>(0x85ebca6bu)));
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+        h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<int>(0xc2b2ae35u)));
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + base), h);
+        for (int l = 0; l < 8; ++l) {
+            if (keys[base + l].size() > kMaxShortKey) out[base + l] = hash32(keys[base + l]);
+        }
+    }
+    hashBatchScalar(keys + base, n - base, out + base);
+}
+
+/**
+ * @brief Hash keys 16 at a time with AVX-512, one key per 32-bit lane.
+ */
+__attribute__((target("avx512f")))
+inline void hashBatchAvx512(const std::string* keys, size_t n, uint32_t* out) {
+    const __m512i c1 = _mm512_set1_epi32(static_cast<int>(kC1));
+    const __m512i c2 = _mm512_set1_epi32(static_cast<int>(kC2));
+    const __m512i c3 = _mm512_set1_epi32(static_cast<int>(0xe6546b64u));
+    const __m512i five = _mm512_set1_epi32(5);
+    size_t base = 0;
+    for (; base + 16 <= n; base += 16) {
+        alignas(64) uint32_t words[16];
+        alignas(64) int32_t lens[16];
+        size_t maxWords = 0;
+        for (int l = 0; l < 16; ++l) {
+            size_t len = keys[base + l].size();
+            lens[l] = static_cast<int32_t>(len > kMaxShortKey ? 0 : (len + 3) / 4);
+            if (static_cast<size_t>(lens[l]) > maxWords) maxWords = lens[l];
+        }
+        const __m512i wordCount = _mm512_load_si512(lens);
+        __m512i h = _mm512_set1_epi32(static_cast<int>(kSeed));
+        for (size_t i = 0; i < maxWords; ++i) {
+            for (int l = 0; l < 16; ++l) {
+                const std::string& key = keys[base + l];
+                words[l] = loadWord(key.data(), key.size(), i);
+            }
+            __m512i k = _mm512_mullo_epi32(_mm512_load_si512(words), c1);
+            k = _mm512_mullo_epi32(_mm512_rol_epi32(k, 15), c2);
+            __m512i next = _mm512_rol_epi32(_mm512_xor_si512(h, k), 13);
+            next = _mm512_add_epi32(_mm512_mullo_epi32(next, five), c3);
+            __mmask16 active = _mm512_cmpgt_epi32_mask(wordCount, _mm512_set1_epi32(static_cast<int>(i)));
+            h = _mm512_mask_mov_epi32(h, active, next);
+        }
+        alignas(64) int32_t lengths[16];
+        for (int l = 0; l < 16; ++l) lengths[l] = static_cast<int32_t>(keys[base + l].size());
+        h = _mm512_xor_si512(h, _mm512_load_si512(lengths));
+        h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+        h = _mm512_mullo_epi32(h, _mm512_set1_epi32(static_cast<int>(0x85ebca6bu)));
+        h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 13));
+        h = _mm512_mullo_epi32(h, _mm512_set1_epi32(static_cast<int>(0xc2b2ae35u)));
+        h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+        _mm512_storeu_si512(out + base, h);
+        for (int l = 0; l < 16; ++l) {
+            if (keys[base + l].size() > kMaxShortKey) out[base + l] = hash32(keys[base + l]);
+        }
+    }
+    hashBatchAvx2(keys + base, n - base, out + base);
+}
+
+#endif // BATCHHASH_X86
+
+/**
+ * @brief Hash a batch of keys with the widest instruction set available.
+ * @param keys Pointer to the first key.
+ * @param n Number of keys.
+ * @param out Output array of n hashes; out[i] == hash32(keys[i]).
+ */
+inline void hashBatch(const std::string* keys, size_t n, uint32_t* out) {
+#ifdef BATCHHASH_X86
+    static const int level = __builtin_cpu_supports("avx512f") ? 2 : (__builtin_cpu_supports("avx2") ? 1 : 0);
+    if (level == 2) {
+        hashBatchAvx512(keys, n, out);
+        return;
+    }
+    if (level == 1) {
+        hashBatchAvx2(keys, n, out);
+        return;
+    }
+#endif
+    hashBatchScalar(keys, n, out);
+}
+
+} // namespace batchhash
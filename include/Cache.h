@@ -1,5 +1,53 @@
 #pragma once
 
+#include <cstddef>
+#include <utility>
+
+/**
+ * @brief Why an entry left a cache.
+ */
+enum class RemovalCause {
+    SIZE,      ///< Evicted by the policy (capacity or an explicit evict()).
+    EXPIRED,   ///< Its time-to-live had passed.
+    EXPLICIT,  ///< Removed by remove().
+    REPLACED   ///< Its value was overwritten by put(); the key stays cached.
+};
+
+/**
+ * @brief Receives entries removed from a cache.
+ *
+ * onRemoval() runs on the thread that removed the entry, under the cache's
+ * lock: it must be cheap and must not call back into the cache. Listeners
+ * that do real work queue the entry and process it elsewhere.
+ *
+ * @tparam Key   The type of the cache key.
+ * @tparam Value The type of the cache value.
+ */
+template<typename Key, typename Value>
+class RemovalListener {
+public:
+    virtual ~RemovalListener() = default;
+    /**
+     * @brief Take a removed entry.
+     * @param key   The removed key.
+     * @param value The removed value, handed over to the listener.
+     * @param cause Why the entry was removed.
+     */
+    virtual void onRemoval(const Key& key, Value&& value, RemovalCause cause) = 0;
+};
+
+/**
+ * @brief Hand a removed value to a listener, if there is one.
+ *
+ * An lvalue is copied only when a listener is set.
+ */
+template<typename Key, typename Value, typename V>
+inline void notifyRemoval(RemovalListener<Key, Value>* listener, const Key& key, V&& value, RemovalCause cause) {
+    if (listener) {
+        listener->onRemoval(key, Value(std::forward<V>(value)), cause);
+    }
+}
+
 /**
  * @brief Abstract base class for cache policies.
  *
@@ -31,4 +79,41 @@ public:
      * @return The value associated with the key, or a default value if not found.
      */
     virtual Value get(const Key key) = 0;
+    /**
+     * @brief Retrieve a value from the cache, reporting whether it was present.
+     *
+     * @param key   The key to look up.
+     * @param value Output parameter for the value.
+     * @return True on a hit, false otherwise.
+     */
+    virtual bool get(const Key key, Value& value) = 0;
+    /**
+     * @brief Remove a key from the cache.
+     *
+     * @param key The key to remove.
+     */
+    virtual void remove(const Key key) = 0;
+    /**
+     * @brief Number of entries currently held.
+     */
+    virtual size_t size() = 0;
+    /**
+     * @brief Evict one entry, chosen by the policy's own eviction order.
+     *
+     * Used to shrink a cache below its capacity (e.g. under memory pressure).
+     *
+     * @return True if an entry was evicted, false if the cache was empty.
+     */
+    virtual bool evict() = 0;
+    /**
+     * @brief Report removed entries to a listener.
+     *
+     * Set before the cache is shared between threads; nullptr turns
+     * reporting off. Composite policies pass the listener to their parts.
+     *
+     * @param listener The listener, not owned; must outlive the cache.
+     */
+    virtual void setRemovalListener(RemovalListener<Key, Value>* listener) { removalListener = listener; }
+protected:
+    RemovalListener<Key, Value>* removalListener = nullptr; ///< Receives removed entries, or null.
 };
\ No newline at end of file
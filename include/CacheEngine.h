@@ -0,0 +1,547 @@
+#pragma once
+
+#include "Cache.h"
+#include "LockPolicy.h"
+#include "SwissIndex.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Key index backed by std::unordered_map.
+ *
+ * @tparam Key  The type of the cache key.
+ * @tparam Node The engine node type the index points to.
+ */
+template<typename Key, typename Node>
+class HashIndex {
+public:
+    /**
+     * @brief Find the node stored for a key.
+     * @param key The key to look up.
+     * @return The node, or nullptr if the key is not indexed.
+     */
+    Node* find(const Key& key) {
+        auto it = map.find(key);
+        return it == map.end() ? nullptr : it->second;
+    }
+
+    /**
+     * @brief Index a node under a key.
+     * @param key The key to index.
+     * @param node The node to associate with the key.
+     */
+    void insert(const Key& key, Node* node) { map[key] = node; }
+
+    /**
+     * @brief Remove a key from the index.
+     * @param key The key to remove.
+     */
+    void erase(const Key& key) { map.erase(key); }
+
+    /**
+     * @brief Reserve room for a number of keys.
+     * @param n The expected number of keys.
+     */
+    void reserve(size_t n) { map.reserve(n); }
+
+    /**
+     * @brief Number of indexed keys.
+     */
+    size_t size() const { return map.size(); }
+
+private:
+    std::unordered_map<Key, Node*> map; ///< Key-node mapping.
+};
+
+/**
+ * @brief Key index backed by SwissIndex (SIMD tag matching, open addressing).
+ *
+ * Stays flat at high load factors and supports prefetching a key's bucket,
+ * which CacheEngine::getBatch uses to overlap lookups.
+ *
+ * @tparam Key  The type of the cache key.
+ * @tparam Node The engine node type the index points to.
+ */
+template<typename Key, typename Node>
+class SwissHashIndex {
+public:
+    Node* find(const Key& key) {
+        Node** node = map.find(key);
+        return node ? *node : nullptr;
+    }
+    void insert(const Key& key, Node* node) { map.insert(key, node); }
+    void erase(const Key& key) { map.erase(key); }
+    void reserve(size_t n) { map.reserve(n); }
+    void prefetch(const Key& key) const { map.prefetch(key); }
+    size_t size() const { return map.size(); }
+
+private:
+    SwissIndex<Key, Node*> map; ///< Key-node mapping.
+};
+
+/**
+ * @brief Detects whether an index can prefetch the bucket of a key.
+ */
+template<typename Index, typename Key, typename = void>
+struct HasPrefetch : std::false_type {};
+
+template<typename Index, typename Key>
+struct HasPrefetch<Index, Key, std::void_t<decltype(std::declval<const Index&>().prefetch(std::declval<const Key&>()))>> : std::true_type {};
+
+/**
+ * @brief Least-recently-used eviction order.
+ *
+ * The engine node derives from Hook, so the recency list is intrusive and an
+ * access is two pointer splices with no allocation.
+ */
+struct LruEviction {
+    static constexpr bool reordersOnAccess = true; ///< Reads move the node, so they need the writer lock.
+
+    /**
+     * @brief Per-node state: links in the recency list.
+     */
+    template<typename Node>
+    struct Hook {
+        Node* prev = nullptr; ///< Previous (older) node.
+        Node* next = nullptr; ///< Next (newer) node.
+    };
+
+    /**
+     * @brief Per-engine state: an intrusive doubly linked list, oldest first.
+     */
+    template<typename Node>
+    class State {
+    public:
+        void onInsert(Node* node) { pushBack(node); }
+        void onAccess(Node* node) {
+            if (node == tail) return;
+            unlink(node);
+            pushBack(node);
+        }
+        void onErase(Node* node) { unlink(node); }
+        Node* victim() const { return head; }
+
+    private:
+        Node* head = nullptr; ///< Least recently used node.
+        Node* tail = nullptr; ///< Most recently used node.
+
+        void pushBack(Node* node) {
+            node->prev = tail;
+            node->next = nullptr;
+            if (tail) tail->next = node; else head = node;
+            tail = node;
+        }
+        void unlink(Node* node) {
+            if (node->prev) node->prev->next = node->next; else head = node->next;
+            if (node->next) node->next->prev = node->prev; else tail = node->prev;
+            node->prev = node->next = nullptr;
+        }
+    };
+};
+
+/**
+ * @brief First-in-first-out eviction order.
+ *
+ * Accesses do not touch the order, so reads never modify shared state.
+ */
+struct FifoEviction {
+    static constexpr bool reordersOnAccess = false; ///< Reads leave the order untouched.
+
+    template<typename Node>
+    using Hook = LruEviction::Hook<Node>;
+
+    template<typename Node>
+    class State : public LruEviction::State<Node> {
+    public:
+        void onAccess(Node*) {}
+    };
+};
+
+/**
+ * @brief Admission policy that admits every key.
+ */
+struct AlwaysAdmit {
+    static constexpr bool enabled = false; ///< Compiled out of the engine.
+
+    template<typename Key>
+    struct State {
+        explicit State(size_t) {}
+        bool admit(const Key&) { return true; }
+    };
+};
+
+/**
+ * @brief Admit a key into a full cache only after it has been seen K times.
+ *
+ * Sightings are counted in a small array of saturating counters indexed by key
+ * hash, halved periodically so old popularity fades. This is the scan
+ * resistance of LruK without a second cache holding cold values.
+ *
+ * @tparam K Number of sightings needed before a key is admitted.
+ */
+template<int K = 2>
+struct KHitAdmission {
+    static constexpr bool enabled = true;
+
+    template<typename Key>
+    class State {
+    public:
+        /**
+         * @brief Size the counter array for a cache capacity.
+         * @param capacity The capacity of the owning engine.
+         */
+        explicit State(size_t capacity) {
+            size_t n = 16;
+            while (n < capacity * 4) n <<= 1;
+            counters.assign(n, 0);
+            mask = n - 1;
+            resetInterval = capacity * 10 + 16;
+        }
+
+        /**
+         * @brief Record a sighting and decide whether to admit the key.
+         * @param key The key being inserted.
+         * @return True if the key has been seen at least K times.
+         */
+        bool admit(const Key& key) {
+            uint8_t& c = counters[std::hash<Key>()(key) & mask];
+            if (c < UINT8_MAX) ++c;
+            if (++sightings >= resetInterval) age();
+            return c >= K;
+        }
+
+    private:
+        std::vector<uint8_t> counters; ///< Saturating sighting counters.
+        size_t mask = 0;               ///< Counter array index mask.
+        size_t sightings = 0;          ///< Sightings since the last aging pass.
+        size_t resetInterval = 0;      ///< Sightings between aging passes.
+
+        void age() {
+            for (auto& c : counters) c >>= 1;
+            sightings = 0;
+        }
+    };
+};
+
+/**
+ * @brief Expiry policy for caches whose entries never expire.
+ */
+struct NoExpiry {
+    static constexpr bool enabled = false; ///< Compiled out of the engine.
+
+    struct Hook {};
+
+    struct State {
+        explicit State(std::chrono::milliseconds = std::chrono::milliseconds(0)) {}
+    };
+};
+
+/**
+ * @brief Expiry policy with a fixed time-to-live per engine.
+ */
+struct TtlExpiry {
+    static constexpr bool enabled = true;
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Per-node state: the absolute expiry deadline.
+     */
+    struct Hook {
+        Clock::time_point deadline{}; ///< When the entry stops being served.
+    };
+
+    /**
+     * @brief Per-engine state: the time-to-live applied on every write.
+     */
+    struct State {
+        explicit State(std::chrono::milliseconds ttl = std::chrono::seconds(60)) : ttl(ttl) {}
+        void stamp(Hook& hook) const { hook.deadline = Clock::now() + ttl; }
+        bool expired(const Hook& hook) const { return Clock::now() >= hook.deadline; }
+        std::chrono::milliseconds ttl; ///< Time-to-live of new and updated entries.
+    };
+};
+
+/**
+ * @brief Cache engine composed from compile-time policies.
+ *
+ * Every policy is a template parameter, so the hot path is resolved at
+ * compile time and inlined; features that are turned off (admission, expiry)
+ * are removed with `if constexpr` and cost neither code nor node space.
+ *
+ * @tparam Key       The type of the cache key.
+ * @tparam Value     The type of the cache value.
+ * @tparam Index     Key index template, instantiated as Index<Key, Node>.
+ * @tparam Eviction  Eviction order (LruEviction, FifoEviction).
+ * @tparam Admission Admission policy (AlwaysAdmit, KHitAdmission<K>).
+ * @tparam Expiry    Expiry policy (NoExpiry, TtlExpiry).
+ * @tparam Lock      Lock type guarding the engine (std::mutex, NoLock, ...).
+ */
+template<typename Key,
+         typename Value,
+         template<typename, typename> class Index = HashIndex,
+         typename Eviction = LruEviction,
+         typename Admission = AlwaysAdmit,
+         typename Expiry = NoExpiry,
+         typename Lock = std::mutex>
+class CacheEngine {
+public:
+    /**
+     * @brief Engine node: key, value and the state each policy keeps per entry.
+     */
+    struct Node : Eviction::template Hook<Node>, Expiry::Hook {
+        Node(const Key& k, const Value& v) : key(k), value(v) {}
+        Key key;     ///< The key stored in the node.
+        Value value; ///< The value stored in the node.
+    };
+
+    /**
+     * @brief Construct an engine with a given capacity.
+     * @param cap The maximum number of items the engine can hold.
+     * @param ttl Time-to-live of entries (ignored unless Expiry is enabled).
+     */
+    explicit CacheEngine(size_t cap, std::chrono::milliseconds ttl = std::chrono::seconds(60))
+        : capacity(cap), admission(cap), expiry(ttl) {
+        index.reserve(cap);
+    }
+
+    ~CacheEngine() { clear(); }
+
+    CacheEngine(const CacheEngine&) = delete;
+    CacheEngine& operator=(const CacheEngine&) = delete;
+
+    /**
+     * @brief Insert or update a value in the cache.
+     * @param key   The key to insert or update.
+     * @param value The value to associate with the key.
+     */
+    void put(const Key& key, const Value& value) {
+        if (capacity == 0) return;
+        std::lock_guard<Lock> lock(mutex_);
+        if (Node* node = index.find(key)) {
+            notifyRemoval(removalListener, key, std::move(node->value), RemovalCause::REPLACED);
+            node->value = value;
+            if constexpr (Expiry::enabled) expiry.stamp(*node);
+            eviction.onAccess(node);
+            return;
+        }
+        if (index.size() >= capacity) {
+            if constexpr (Admission::enabled) {
+                if (!admission.admit(key)) return;
+            }
+            evict();
+        }
+        Node* node = new Node(key, value);
+        if constexpr (Expiry::enabled) expiry.stamp(*node);
+        index.insert(key, node);
+        eviction.onInsert(node);
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Retrieve a value from the cache.
+     * @param key   The key to look up.
+     * @param value Output parameter for the value.
+     * @return True if the key was found (and not expired), false otherwise.
+     */
+    bool get(const Key& key, Value& value) {
+        if constexpr (!Eviction::reordersOnAccess && !Expiry::enabled) {
+            ReadGuard<Lock> lock(mutex_);
+            Node* node = index.find(key);
+            if (!node) return false;
+            value = node->value;
+            return true;
+        }
+        std::lock_guard<Lock> lock(mutex_);
+        return lookup(key, value);
+    }
+
+    /**
+     * @brief Retrieve a batch of values under a single lock acquisition.
+     *
+     * With an index that supports prefetching, the bucket of the key a few
+     * positions ahead is prefetched so consecutive lookups overlap their misses.
+     *
+     * @param keys   The keys to look up.
+     * @param values Output vector receiving one value per key (default value on a miss).
+     * @return The number of hits.
+     */
+    size_t getBatch(const std::vector<Key>& keys, std::vector<Value>& values) {
+        constexpr size_t kAhead = 4;
+        values.assign(keys.size(), Value{});
+        size_t hits = 0;
+        std::lock_guard<Lock> lock(mutex_);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if constexpr (HasPrefetch<Index<Key, Node>, Key>::value) {
+                if (i + kAhead < keys.size()) index.prefetch(keys[i + kAhead]);
+            }
+            if (lookup(keys[i], values[i])) ++hits;
+        }
+        return hits;
+    }
+
+    /**
+     * @brief Retrieve a value from the cache.
+     * @param key The key to look up.
+     * @return The value associated with the key, or a default value if not found.
+     */
+    Value get(const Key& key) {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    /**
+     * @brief Remove a key from the cache.
+     * @param key The key to remove.
+     * @return True if the key was present.
+     */
+    bool remove(const Key& key) {
+        std::lock_guard<Lock> lock(mutex_);
+        Node* node = index.find(key);
+        if (!node) return false;
+        release(node, RemovalCause::EXPLICIT);
+        return true;
+    }
+
+    /**
+     * @brief Number of entries currently held.
+     */
+    size_t size() {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Evict the victim chosen by the eviction policy, if any.
+     * @return True if an entry was evicted.
+     */
+    bool evictOne() {
+        std::lock_guard<Lock> lock(mutex_);
+        if (index.size() == 0) return false;
+        evict();
+        return true;
+    }
+
+    /**
+     * @brief Report removed entries to a listener (see RemovalListener).
+     *
+     * Set before the engine is shared between threads; clear() and the
+     * destructor do not report.
+     *
+     * @param listener The listener, not owned; nullptr turns reporting off.
+     */
+    void setRemovalListener(RemovalListener<Key, Value>* listener) {
+        std::lock_guard<Lock> lock(mutex_);
+        removalListener = listener;
+    }
+
+    /**
+     * @brief Remove every entry.
+     */
+    void clear() {
+        std::lock_guard<Lock> lock(mutex_);
+        while (Node* node = eviction.victim()) {
+            erase(node);
+        }
+    }
+
+private:
+    size_t capacity; ///< The maximum number of items the engine can hold.
+    Index<Key, Node> index; ///< Key-node mapping for fast lookup.
+    typename Eviction::template State<Node> eviction; ///< Eviction order state.
+    typename Admission::template State<Key> admission; ///< Admission filter state.
+    typename Expiry::State expiry; ///< Expiry state.
+    Lock mutex_; ///< Lock guarding the engine.
+    std::atomic<size_t> count{0}; ///< Entries held; written under mutex_, read without it by size().
+    RemovalListener<Key, Value>* removalListener = nullptr; ///< Receives removed entries, or null.
+
+    /**
+     * @brief Look a key up and apply the access to every policy; mutex_ must be held.
+     */
+    bool lookup(const Key& key, Value& value) {
+        Node* node = index.find(key);
+        if (!node) return false;
+        if constexpr (Expiry::enabled) {
+            if (expiry.expired(*node)) {
+                release(node, RemovalCause::EXPIRED);
+                return false;
+            }
+        }
+        if constexpr (Eviction::reordersOnAccess) eviction.onAccess(node);
+        value = node->value;
+        return true;
+    }
+
+    /**
+     * @brief Evict the victim chosen by the eviction policy.
+     */
+    void evict() {
+        if (Node* node = eviction.victim()) {
+            release(node, RemovalCause::SIZE);
+        }
+    }
+
+    /**
+     * @brief Report a node to the removal listener, then erase it.
+     * @param node The node to remove.
+     * @param cause Why it is removed.
+     */
+    void release(Node* node, RemovalCause cause) {
+        notifyRemoval(removalListener, node->key, std::move(node->value), cause);
+        erase(node);
+    }
+
+    /**
+     * @brief Unlink a node from every policy and free it.
+     * @param node The node to erase.
+     */
+    void erase(Node* node) {
+        eviction.onErase(node);
+        index.erase(node->key);
+        delete node;
+        count.store(count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Adapter exposing a CacheEngine through the virtual Cache interface.
+ *
+ * Lets an engine be plugged wherever a Cache<Key, Value> is expected; code that
+ * knows the concrete engine type should call it directly to keep calls inlined.
+ *
+ * @tparam Engine A CacheEngine instantiation.
+ * @tparam Key    The type of the cache key.
+ * @tparam Value  The type of the cache value.
+ */
+template<typename Engine, typename Key, typename Value>
+class CacheAdapter : public Cache<Key, Value> {
+public:
+    template<typename... Args>
+    explicit CacheAdapter(Args&&... args) : engine(std::forward<Args>(args)...) {}
+
+    void put(const Key key, const Value value) override { engine.put(key, value); }
+    Value get(const Key key) override { return engine.get(key); }
+    bool get(const Key key, Value& value) override { return engine.get(key, value); }
+    void remove(const Key key) override { engine.remove(key); }
+    size_t size() override { return engine.size(); }
+    bool evict() override { return engine.evictOne(); }
+    void setRemovalListener(RemovalListener<Key, Value>* listener) override {
+        Cache<Key, Value>::setRemovalListener(listener);
+        engine.setRemovalListener(listener);
+    }
+
+    /**
+     * @brief Access the wrapped engine.
+     */
+    Engine& getEngine() { return engine; }
+
+private:
+    Engine engine; ///< The wrapped engine.
+};
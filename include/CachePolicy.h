@@ -0,0 +1,551 @@
+#pragma once
+
+#include "Cache.h"
+#include "Lru.h"
+#include "Lfu.h"
+#include "Arc.h"
+#include "LockPolicy.h"
+#include "MpscQueue.h"
+#include "ShardsSampler.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Replacement policies a cache can be built with at run time.
+ */
+enum class PolicyKind {
+    LRU,             ///< Lru.
+    LRU_K,           ///< LruK: a cold window admits keys seen k times into the main LRU.
+    SHARDED_LRU_K,   ///< HashLruK: LRU_K split into independently locked shards.
+    LFU,             ///< Lfu.
+    AVG_LFU,         ///< AvgLfu: LFU with frequencies aged once their average exceeds a bound.
+    SHARDED_AVG_LFU, ///< HashAvgLfu: AVG_LFU split into independently locked shards.
+    ARC              ///< Arc.
+};
+
+/**
+ * @brief A replacement policy together with its parameters.
+ *
+ * Every policy built from a spec holds at most `capacity` entries in total:
+ * LruK's cold window and Arc's two components are carved out of the
+ * capacity instead of being added to it, so specs of different kinds can be
+ * compared at equal memory.
+ *
+ * The text form, accepted by parsePolicySpec() and produced by toString(),
+ * is `kind[:key=value[,key=value]...]`, e.g. `arc:threshold=3` or
+ * `sharded-lru-k:capacity=1000000,shards=32,k=2`. Kinds are lru, lru-k,
+ * sharded-lru-k, lfu, avg-lfu, sharded-avg-lfu and arc; keys are capacity,
+ * shards, k, window, max-freq and threshold. Omitted keys keep their defaults.
+ */
+struct PolicySpec {
+    PolicyKind kind = PolicyKind::LRU; ///< The policy.
+    size_t capacity = 0;               ///< Total entries held.
+    int shards = 16;                   ///< SHARDED_*: number of shards.
+    int k = 2;                         ///< LRU_K: accesses in the cold window before promotion.
+    double window = 0.25;              ///< LRU_K: fraction of the capacity used as the cold window.
+    int maxAverageFreq = 10;           ///< AVG_LFU: average frequency that triggers aging.
+    int promotionThreshold = 2;        ///< ARC: accesses before an entry moves to the LFU side.
+
+    /**
+     * @brief Policy and parameters without the capacity, e.g. "lru-k:k=2,window=0.25".
+     *
+     * Two specs with the same name behave the same at equal capacity.
+     */
+    std::string name() const {
+        return format(false);
+    }
+
+    /**
+     * @brief Full text form, including the capacity.
+     */
+    std::string toString() const {
+        return format(true);
+    }
+
+    /**
+     * @brief The same policy at another capacity.
+     * @param cap The new capacity.
+     */
+    PolicySpec withCapacity(size_t cap) const {
+        PolicySpec spec = *this;
+        spec.capacity = cap;
+        return spec;
+    }
+
+    /**
+     * @brief Text name of a policy kind.
+     */
+    static const char* kindName(PolicyKind kind) {
+        switch (kind) {
+            case PolicyKind::LRU: return "lru";
+            case PolicyKind::LRU_K: return "lru-k";
+            case PolicyKind::SHARDED_LRU_K: return "sharded-lru-k";
+            case PolicyKind::LFU: return "lfu";
+            case PolicyKind::AVG_LFU: return "avg-lfu";
+            case PolicyKind::SHARDED_AVG_LFU: return "sharded-avg-lfu";
+            case PolicyKind::ARC: return "arc";
+        }
+        return "unknown";
+    }
+
+    /**
+     * @brief Whether the kind is one of the sharded variants.
+     */
+    bool sharded() const {
+        return kind == PolicyKind::SHARDED_LRU_K || kind == PolicyKind::SHARDED_AVG_LFU;
+    }
+
+private:
+    std::string format(bool withCapacity) const {
+        std::vector<std::string> params;
+        if (withCapacity && capacity > 0) params.push_back("capacity=" + std::to_string(capacity));
+        if (sharded()) params.push_back("shards=" + std::to_string(shards));
+        if (kind == PolicyKind::LRU_K || kind == PolicyKind::SHARDED_LRU_K) {
+            std::ostringstream w;
+            w << window;
+            params.push_back("k=" + std::to_string(k));
+            params.push_back("window=" + w.str());
+        }
+        if (kind == PolicyKind::AVG_LFU || kind == PolicyKind::SHARDED_AVG_LFU) {
+            params.push_back("max-freq=" + std::to_string(maxAverageFreq));
+        }
+        if (kind == PolicyKind::ARC) params.push_back("threshold=" + std::to_string(promotionThreshold));
+        std::string out = kindName(kind);
+        for (size_t i = 0; i < params.size(); ++i) {
+            out += (i == 0 ? ":" : ",") + params[i];
+        }
+        return out;
+    }
+};
+
+/**
+ * @brief Parse the text form of a policy spec.
+ *
+ * @param text The spec, e.g. "lru-k:capacity=100000,k=3".
+ * @param defaults Values of keys the text omits.
+ * @return The parsed spec.
+ * @throws std::invalid_argument On an unknown kind or key, a key that does not
+ *         apply to the kind, or a value out of range.
+ */
+inline PolicySpec parsePolicySpec(const std::string& text, const PolicySpec& defaults = PolicySpec()) {
+    PolicySpec spec = defaults;
+    std::string kind = text.substr(0, text.find(':'));
+    static const PolicyKind kinds[] = {PolicyKind::LRU, PolicyKind::LRU_K, PolicyKind::SHARDED_LRU_K, PolicyKind::LFU,
+                                       PolicyKind::AVG_LFU, PolicyKind::SHARDED_AVG_LFU, PolicyKind::ARC};
+    bool known = false;
+    for (PolicyKind candidate : kinds) {
+        if (kind == PolicySpec::kindName(candidate)) {
+            spec.kind = candidate;
+            known = true;
+        }
+    }
+    if (!known) {
+        throw std::invalid_argument("unknown cache policy '" + kind + "' in '" + text + "'");
+    }
+    if (kind.size() == text.size()) {
+        return spec;
+    }
+
+    bool lruK = spec.kind == PolicyKind::LRU_K || spec.kind == PolicyKind::SHARDED_LRU_K;
+    bool avgLfu = spec.kind == PolicyKind::AVG_LFU || spec.kind == PolicyKind::SHARDED_AVG_LFU;
+    std::istringstream params(text.substr(kind.size() + 1));
+    std::string param;
+    while (std::getline(params, param, ',')) {
+        size_t eq = param.find('=');
+        std::string key = param.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : param.substr(eq + 1);
+        auto fail = [&](const std::string& why) {
+            return std::invalid_argument("cache policy '" + text + "': " + key + " " + why);
+        };
+        double number = 0;
+        try {
+            size_t used = 0;
+            number = std::stod(value, &used);
+            if (used != value.size()) throw std::invalid_argument(value);
+        } catch (const std::exception&) {
+            throw fail("needs a numeric value");
+        }
+        if (key == "capacity") {
+            if (number < 1) throw fail("must be at least 1");
+            spec.capacity = static_cast<size_t>(number);
+        } else if (key == "shards" && spec.sharded()) {
+            if (number < 1) throw fail("must be at least 1");
+            spec.shards = static_cast<int>(number);
+        } else if (key == "k" && lruK) {
+            if (number < 1) throw fail("must be at least 1");
+            spec.k = static_cast<int>(number);
+        } else if (key == "window" && lruK) {
+            if (number <= 0 || number >= 1) throw fail("must be between 0 and 1");
+            spec.window = number;
+        } else if (key == "max-freq" && avgLfu) {
+            if (number < 1) throw fail("must be at least 1");
+            spec.maxAverageFreq = static_cast<int>(number);
+        } else if (key == "threshold" && spec.kind == PolicyKind::ARC) {
+            if (number < 1) throw fail("must be at least 1");
+            spec.promotionThreshold = static_cast<int>(number);
+        } else {
+            throw fail(std::string("does not apply to ") + PolicySpec::kindName(spec.kind));
+        }
+    }
+    return spec;
+}
+
+/**
+ * @brief Build a cache from a policy spec.
+ *
+ * Sharded kinds use at most one shard per entry, so tiny capacities still
+ * give every shard room.
+ *
+ * @tparam Key   The type of the cache key.
+ * @tparam Value The type of the cache value.
+ * @tparam Lock  The lock strategy guarding the cache (see LockPolicy.h).
+ * @param spec The policy and its parameters.
+ * @return The new cache.
+ */
+template<typename Key, typename Value, typename Lock = std::mutex>
+std::unique_ptr<Cache<Key, Value>> makeCache(const PolicySpec& spec) {
+    int cap = static_cast<int>(std::max<size_t>(1, spec.capacity));
+    int shards = std::max(1, std::min(spec.shards, cap));
+    int cold = std::max(1, static_cast<int>(cap * spec.window));
+    switch (spec.kind) {
+        case PolicyKind::LRU_K:
+            return std::make_unique<LruK<Key, Value, Lock>>(std::max(1, cap - cold), cold, spec.k);
+        case PolicyKind::SHARDED_LRU_K:
+            return std::make_unique<HashLruK<Key, Value, Lock>>(std::max(shards, cap - cold), shards,
+                                                                std::max(1, cold / shards), spec.k);
+        case PolicyKind::LFU:
+            return std::make_unique<Lfu<Key, Value, Lock>>(cap);
+        case PolicyKind::AVG_LFU:
+            return std::make_unique<AvgLfu<Key, Value, Lock>>(cap, spec.maxAverageFreq);
+        case PolicyKind::SHARDED_AVG_LFU:
+            return std::make_unique<HashAvgLfu<Key, Value, Lock>>(cap, shards, spec.maxAverageFreq);
+        case PolicyKind::ARC:
+            return std::make_unique<Arc<Key, Value, Lock>>(std::max(1, cap / 2), spec.promotionThreshold);
+        case PolicyKind::LRU:
+        default:
+            return std::make_unique<Lru<Key, Value, Lock>>(cap);
+    }
+}
+
+/**
+ * @brief Parameters of a PolicyTuner.
+ */
+struct TunerOptions {
+    size_t ghostEntries = 2048;   ///< Target capacity of each simulator; sets the sampling rate.
+    double minRate = 0.001;       ///< Lower bound on the sampling rate.
+    double maxRate = 0.01;        ///< Upper bound on the sampling rate; bounds the simulation cost per access.
+    size_t window = 2048;         ///< Sampled accesses per scoring window.
+    double margin = 0.02;         ///< Hit-ratio lead a candidate needs in a window.
+    int patience = 3;             ///< Consecutive winning windows before a switch.
+    int cooldown = 5;             ///< Windows after a switch during which no switch is proposed.
+    size_t drainBatch = 256;      ///< Queued samples that make record() ask for a drain().
+    size_t maxQueued = 1 << 16;   ///< Samples queued beyond this, while drains fall behind, are dropped.
+};
+
+/**
+ * @brief Online policy selection by shadow ("ghost") simulation.
+ *
+ * A spatially sampled subset of keys (the same hash as ShardsSampler) is fed
+ * to a small simulator of every candidate policy, each scaled to capacity * R
+ * where R is the sampling rate. Miniature simulations of a sampled key
+ * stream track the hit ratio of the full-size policy closely, so candidates
+ * are compared without touching the live cache. The live policy is simulated
+ * too, which makes the comparison independent of writes and peer traffic the
+ * live cache also sees.
+ *
+ * The simulation runs off the request path. record() costs one hash and a
+ * compare; a sampled key's hash is queued (one allocation and one atomic
+ * exchange) and the simulators catch up in drain(), which the caller runs
+ * on a background thread once a batch is queued. R never exceeds
+ * `maxRate`, and simulators are keyed by the 64-bit sampling hash rather
+ * than by a copy of the key.
+ *
+ * Simulators are scored over fixed windows of sampled accesses. A switch is
+ * recommended only when the same candidate beats the live policy by at least
+ * `margin` for `patience` consecutive windows, and no further switch is
+ * considered for `cooldown` windows afterwards.
+ */
+class PolicyTuner {
+public:
+    /**
+     * @brief Hit ratio of one simulated policy over the last complete window.
+     */
+    struct Score {
+        PolicySpec spec;  ///< The simulated policy (at full capacity).
+        double hitRatio;  ///< Hit ratio in the last window.
+    };
+
+    /**
+     * @brief Construct a tuner.
+     * @param live The policy the live cache currently runs.
+     * @param candidates Alternative policies; empty selects defaultCandidates().
+     * @param options Tuning parameters.
+     */
+    explicit PolicyTuner(const PolicySpec& live, std::vector<PolicySpec> candidates = {}, TunerOptions options = TunerOptions())
+        : options(options) {
+        rate = std::min({1.0, options.maxRate, std::max(options.minRate, static_cast<double>(options.ghostEntries) /
+                                                                             std::max<size_t>(1, live.capacity))});
+        threshold = rate >= 1.0 ? UINT64_MAX : static_cast<uint64_t>(std::ldexp(rate, 64));
+        if (candidates.empty()) {
+            candidates = defaultCandidates(live.capacity);
+        }
+        addGhost(live);
+        for (const auto& spec : candidates) {
+            if (spec.name() != live.name()) addGhost(spec.withCapacity(live.capacity));
+        }
+        liveIndex = 0;
+        cooldownLeft = 1; // the first window only warms the simulators up
+    }
+
+    /**
+     * @brief Candidate set covering recency, frequency and adaptive policies.
+     * @param capacity Capacity of the live cache.
+     */
+    static std::vector<PolicySpec> defaultCandidates(size_t capacity) {
+        std::vector<PolicySpec> specs;
+        PolicySpec spec;
+        spec.capacity = capacity;
+        spec.kind = PolicyKind::LRU;
+        specs.push_back(spec);
+        spec.kind = PolicyKind::LRU_K;
+        for (double window : {0.1, 0.25, 0.5}) {
+            spec.k = 2;
+            spec.window = window;
+            specs.push_back(spec);
+        }
+        spec.k = 3;
+        spec.window = 0.25;
+        specs.push_back(spec);
+        spec.kind = PolicyKind::LFU;
+        specs.push_back(spec);
+        spec.kind = PolicyKind::AVG_LFU;
+        for (int maxFreq : {5, 20}) {
+            spec.maxAverageFreq = maxFreq;
+            specs.push_back(spec);
+        }
+        spec.kind = PolicyKind::ARC;
+        for (int threshold : {2, 3}) {
+            spec.promotionThreshold = threshold;
+            specs.push_back(spec);
+        }
+        return specs;
+    }
+
+    /**
+     * @brief Record one access of the live cache, to be simulated by drain().
+     *
+     * @param key The key accessed.
+     * @return True if the caller should run drain(): a batch is queued and no drain is due yet.
+     */
+    bool record(const std::string& key) {
+        return record(ShardsSampler::sampleHash(key));
+    }
+
+    /**
+     * @brief record() of a key whose ShardsSampler::sampleHash() the caller already has.
+     */
+    bool record(uint64_t hash) {
+        if (hash >= threshold) return false;
+        if (queued.fetch_add(1, std::memory_order_relaxed) >= options.maxQueued) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        samples.push(hash);
+        return queued.load(std::memory_order_relaxed) >= options.drainBatch &&
+               !drainDue.exchange(true, std::memory_order_acq_rel);
+    }
+
+    /**
+     * @brief Record a batch of accesses of the live cache.
+     *
+     * @param keys Accessed keys, in order; keys sampled() rejects are skipped.
+     * @return True if the caller should run drain().
+     */
+    bool record(const std::vector<std::string>& keys) {
+        bool drain = false;
+        for (const auto& key : keys) {
+            drain = record(key) || drain;
+        }
+        return drain;
+    }
+
+    /**
+     * @brief Feed the queued accesses to every simulator; one drain runs at a time.
+     *
+     * @return True if they completed a window that produced a recommendation.
+     */
+    bool drain() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Cleared before popping: a record() that queues after the last pop
+        // sees false and asks for the next drain.
+        drainDue.store(false, std::memory_order_release);
+        bool recommended = false;
+        uint64_t hash = 0;
+        while (samples.pop(hash)) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            recommended = simulate(hash) || recommended;
+        }
+        return recommended;
+    }
+
+    /**
+     * @brief Whether accesses to a key are simulated; takes no lock.
+     */
+    bool sampled(const std::string& key) const {
+        return ShardsSampler::sampleHash(key) < threshold;
+    }
+
+    /**
+     * @brief Take the pending recommendation, if any.
+     * @param spec Output parameter for the recommended policy (at full capacity).
+     * @return True if a switch is recommended.
+     */
+    bool recommendation(PolicySpec& spec) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!pending) return false;
+        spec = ghosts[leader].spec;
+        return true;
+    }
+
+    /**
+     * @brief Tell the tuner the live cache now runs a policy.
+     *
+     * Clears any pending recommendation and starts the cooldown. A policy that
+     * is not among the simulated ones is added as a new simulator.
+     *
+     * @param spec The policy now live.
+     */
+    void switched(const PolicySpec& spec) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        liveIndex = ghosts.size();
+        for (size_t i = 0; i < ghosts.size(); ++i) {
+            if (ghosts[i].spec.name() == spec.name()) {
+                liveIndex = i;
+                break;
+            }
+        }
+        if (liveIndex == ghosts.size()) {
+            addGhost(spec);
+        }
+        pending = false;
+        streak = 0;
+        cooldownLeft = options.cooldown;
+    }
+
+    /**
+     * @brief The policy the tuner believes is live.
+     */
+    PolicySpec live() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ghosts[liveIndex].spec;
+    }
+
+    /**
+     * @brief Per-policy hit ratios over the last complete window, live policy first.
+     */
+    std::vector<Score> scores() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<Score> out;
+        out.push_back(Score{ghosts[liveIndex].spec, ghosts[liveIndex].lastRatio});
+        for (size_t i = 0; i < ghosts.size(); ++i) {
+            if (i != liveIndex) out.push_back(Score{ghosts[i].spec, ghosts[i].lastRatio});
+        }
+        return out;
+    }
+
+    /**
+     * @brief Fraction of keys simulated.
+     */
+    double sampleRate() const { return rate; }
+
+private:
+    /**
+     * @brief One simulated policy.
+     */
+    struct Ghost {
+        PolicySpec spec;                                 ///< Policy at full capacity.
+        std::unique_ptr<Cache<uint64_t, uint8_t>> cache;    ///< Scaled-down simulator, keyed by sampling hash.
+        size_t hits = 0;                                 ///< Hits in the current window.
+        double lastRatio = 0;                            ///< Hit ratio in the last complete window.
+    };
+
+    TunerOptions options;            ///< Tuning parameters.
+    double rate = 1.0;               ///< Sampling rate R.
+    uint64_t threshold = UINT64_MAX; ///< Keys with sampleHash below this are simulated.
+    MpscQueue<uint64_t> samples;     ///< Sampled accesses awaiting drain(); popped under mutex_.
+    std::atomic<size_t> queued{0};   ///< Length of `samples`.
+    std::atomic<bool> drainDue{false}; ///< A drain was asked for and has not started popping.
+    std::mutex mutex_;               ///< Guards everything below.
+    std::vector<Ghost> ghosts;       ///< Simulators, including the live policy's.
+    size_t liveIndex = 0;            ///< Simulator of the live policy.
+    size_t accesses = 0;             ///< Sampled accesses in the current window.
+    size_t leader = 0;               ///< Candidate on a winning streak.
+    int streak = 0;                  ///< Consecutive windows won by `leader`.
+    int cooldownLeft = 0;            ///< Windows left before switches are considered again.
+    bool pending = false;            ///< Whether `leader` is recommended.
+
+    void addGhost(const PolicySpec& spec) {
+        size_t scaled = std::max<size_t>(16, static_cast<size_t>(std::llround(spec.capacity * rate)));
+        Ghost ghost;
+        ghost.spec = spec;
+        // Sharding barely moves the hit ratio but would leave tiny shards at this scale.
+        PolicySpec simulated = spec.withCapacity(scaled);
+        if (spec.kind == PolicyKind::SHARDED_LRU_K) simulated.kind = PolicyKind::LRU_K;
+        if (spec.kind == PolicyKind::SHARDED_AVG_LFU) simulated.kind = PolicyKind::AVG_LFU;
+        ghost.cache = makeCache<uint64_t, uint8_t, NoLock>(simulated);
+        ghosts.push_back(std::move(ghost));
+    }
+
+    /**
+     * @brief Feed a sampled access, identified by its key's sampling hash, to every simulator; caller holds mutex_.
+     * @return True if it completed a window that produced a recommendation.
+     */
+    bool simulate(uint64_t key) {
+        uint8_t value = 0;
+        for (auto& ghost : ghosts) {
+            if (ghost.cache->get(key, value)) {
+                ++ghost.hits;
+            } else {
+                ghost.cache->put(key, 1);
+            }
+        }
+        if (++accesses < options.window) return false;
+        return closeWindow();
+    }
+
+    /**
+     * @brief Score the window and update the winning streak.
+     * @return True if the window produced a new recommendation.
+     */
+    bool closeWindow() {
+        size_t best = liveIndex;
+        for (size_t i = 0; i < ghosts.size(); ++i) {
+            ghosts[i].lastRatio = static_cast<double>(ghosts[i].hits) / accesses;
+            ghosts[i].hits = 0;
+            if (ghosts[i].lastRatio > ghosts[best].lastRatio) best = i;
+        }
+        accesses = 0;
+        if (cooldownLeft > 0) {
+            --cooldownLeft;
+            return false;
+        }
+        if (best == liveIndex || ghosts[best].lastRatio - ghosts[liveIndex].lastRatio < options.margin) {
+            streak = 0;
+            return false;
+        }
+        streak = best == leader ? streak + 1 : 1;
+        leader = best;
+        if (streak < options.patience || pending) return false;
+        pending = true;
+        return true;
+    }
+};
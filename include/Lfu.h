@@ -3,25 +3,37 @@
 #include "Cache.h"
 #include "Node.h"
 #include "LinkedList.h"
+#include "LockPolicy.h"
+#include "BatchHash.h"
+#include <map>
 #include <unordered_map>
 #include <mutex>
 #include <iostream>
 #include <vector>
 #include <algorithm> // for std::min
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <type_traits>
 
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Lock>
 class AvgLfu; // Forward declaration
 
-template<typename Key, typename Value>
+/**
+ * @brief Least Frequently Used (LFU) cache implementation.
+ *
+ * @tparam Key   The type of the cache key.
+ * @tparam Value The type of the cache value.
+ * @tparam Lock  The lock strategy guarding the cache (see LockPolicy.h).
+ */
+template<typename Key, typename Value, typename Lock = std::mutex>
 class Lfu : public Cache<Key, Value> {
 public:
     /**
      * @brief Construct an LFU cache with a given capacity.
      * @param capacity The maximum number of items the cache can hold.
      */
-    Lfu(int capacity) : size(0), minFreq(1), cap(capacity) {
-        freqList[minFreq] = std::make_unique<LinkedList<Key, Value>>();
-    }
+    Lfu(int capacity) : count(0), minFreq(1), cap(capacity) {}
 
     /**
      * @brief Insert or update a value in the cache.
@@ -30,21 +42,24 @@ public:
      */
     void put(const Key key, const Value value) override {
         if (cap <= 0) return;
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (mp.find(key) != mp.end()) {
-            updateNode(mp[key]);
-            mp[key]->setValue(value);
+        std::lock_guard<Lock> lock(mutex_);
+        auto it = mp.find(key);
+        if (it != mp.end()) {
+            notifyRemoval(this->removalListener, key, it->second->takeValue(), RemovalCause::REPLACED);
+            updateNode(it->second);
+            it->second->setValue(value);
             updateMinFreq();
             return;
         }
-        if (size == cap) {
+        if (count == cap) {
             removeLFU();
-            size--;
+            count--;
         }
         auto newNode = std::make_shared<Node<Key, Value>>(key, value);
+        newNode->setFrequency(newFreq());
         insertNewNode(newNode);
         mp[key] = newNode;
-        size++;
+        count++;
     }
 
     /**
@@ -53,16 +68,74 @@ public:
      * @return The value associated with the key, or a default value if not found.
      */
     Value get(const Key key) override {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (mp.find(key) == mp.end()) return Value();
-        auto node = mp[key];
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    /**
+     * @brief Retrieve a value from the cache, reporting whether it was present.
+     * @param key   The key to look up.
+     * @param value Output parameter for the value.
+     * @return True on a hit, false otherwise.
+     */
+    bool get(const Key key, Value& value) override {
+        std::lock_guard<Lock> lock(mutex_);
+        auto it = mp.find(key);
+        if (it == mp.end()) return false;
+        auto node = it->second;
         updateNode(node);
-        if (node->getFrequency() - 1 == minFreq && freqList[minFreq]->isEmpty()) {
-            minFreq++;
-        }
+        updateMinFreq();
+        value = node->getValue();
         //override the GetHook function in HashAvgLfu class
         GetHook();
-        return node->getValue();
+        return true;
+    }
+
+    /**
+     * @brief Remove a key from the cache.
+     * @param key The key to remove.
+     */
+    void remove(const Key key) override {
+        std::lock_guard<Lock> lock(mutex_);
+        auto it = mp.find(key);
+        if (it == mp.end()) return;
+        auto node = it->second;
+        removeNode(node);
+        removeLFUHook(node->getFrequency());
+        mp.erase(it);
+        count--;
+        updateMinFreq();
+        notifyRemoval(this->removalListener, key, node->takeValue(), RemovalCause::EXPLICIT);
+    }
+
+    /**
+     * @brief Number of entries currently held.
+     */
+    size_t size() override {
+        std::lock_guard<Lock> lock(mutex_);
+        return static_cast<size_t>(count);
+    }
+
+    /**
+     * @brief Evict the least frequently used entry.
+     * @return True if an entry was evicted, false if the cache was empty.
+     */
+    bool evict() override {
+        std::lock_guard<Lock> lock(mutex_);
+        if (mp.empty()) return false;
+        removeLFU();
+        count--;
+        return true;
+    }
+
+    /**
+     * @brief Nodes inserted into a frequency list so far (one per access, more while rebuilding lists).
+     *
+     * Read without the lock; for checking the per-access cost of aging.
+     */
+    uint64_t listMoves() const {
+        return moves;
     }
 protected:
     /**
@@ -74,13 +147,23 @@ protected:
      * @param fre The frequency of the removed node.
      */
     virtual void removeLFUHook(int fre){};
+    /**
+     * @brief Stored frequency of a newly inserted node (for derived classes).
+     */
+    virtual int newFreq() { return 1; }
+    /**
+     * @brief Stored frequency of a node after one more access (for derived classes).
+     * @param fre The node's current stored frequency.
+     */
+    virtual int nextFreq(int fre) { return fre + 1; }
 private:
-    int size; ///< The current number of items in the cache.
+    int count; ///< The current number of items in the cache.
     int minFreq; ///< The current minimum frequency in the cache.
     int cap; ///< The maximum capacity of the cache.
-    std::mutex mutex_; ///< Mutex for thread safety.
+    uint64_t moves = 0; ///< Frequency-list insertions, see listMoves().
+    Lock mutex_; ///< Lock guarding the cache.
     std::unordered_map<Key, std::shared_ptr<Node<Key, Value>>> mp; ///< Key-node mapping for fast lookup.
-    std::unordered_map<int, std::unique_ptr<LinkedList<Key, Value>>> freqList; ///< Frequency-list mapping for LFU.
+    std::map<int, std::unique_ptr<LinkedList<Key, Value>>> freqList; ///< Non-empty frequency lists, ordered by frequency.
 
     /**
      * @brief Update a node's frequency and move it to the correct list.
@@ -88,7 +171,7 @@ private:
      */
     void updateNode(std::shared_ptr<Node<Key, Value>>& node) {
         removeNode(node);
-        node->setFrequency(node->getFrequency() + 1);
+        node->setFrequency(nextFreq(node->getFrequency()));
         insertNode(node);
     }
 
@@ -96,18 +179,28 @@ private:
      * @brief Remove the least frequently used node from the cache.
      */
     void removeLFU() {
-        auto node = freqList[minFreq]->removeFront();
+        auto it = freqList.begin();
+        if (it == freqList.end()) return;
+        auto node = it->second->removeFront();
+        if (it->second->isEmpty()) {
+            freqList.erase(it);
+        }
         removeLFUHook(node->getFrequency());
         mp.erase(node->getKey());
+        updateMinFreq();
+        notifyRemoval(this->removalListener, node->getKey(), node->takeValue(), RemovalCause::SIZE);
     }
 
     /**
-     * @brief Remove a node from its frequency list.
+     * @brief Remove a node from its frequency list, dropping the list once empty.
      * @param node The node to remove.
      */
     void removeNode(std::shared_ptr<Node<Key, Value>>& node) {
-        int freq = node->getFrequency();
-        freqList[freq]->remove(node);
+        auto it = freqList.find(node->getFrequency());
+        it->second->remove(node);
+        if (it->second->isEmpty()) {
+            freqList.erase(it);
+        }
     }
 
     /**
@@ -115,10 +208,12 @@ private:
      * @param node The node to insert.
      */
     void insertNode(std::shared_ptr<Node<Key, Value>>& node) {
-        if (freqList.find(node->getFrequency()) == freqList.end()) {
-            freqList[node->getFrequency()] = std::make_unique<LinkedList<Key, Value>>();
+        auto& list = freqList[node->getFrequency()];
+        if (!list) {
+            list = std::make_unique<LinkedList<Key, Value>>();
         }
-        freqList[node->getFrequency()]->insertToEnd(node);
+        list->insertToEnd(node);
+        ++moves;
     }
 
     /**
@@ -126,52 +221,69 @@ private:
      * @param node The node to insert.
      */
     void insertNewNode(std::shared_ptr<Node<Key, Value>>& node) {
-        if (freqList.find(node->getFrequency()) == freqList.end()) {
-            freqList[node->getFrequency()] = std::make_unique<LinkedList<Key, Value>>();
-        }
-        freqList[node->getFrequency()]->insertToEnd(node);
-        minFreq = 1;
+        insertNode(node);
+        updateMinFreq();
     }
 
     /**
      * @brief Update the minimum frequency after node removal or modification.
      * 
-     * The minimum frequency might not be continuous, so we need to find 
-     * the actual minimum frequency in the frequency list and update it 
-     * when we remove the LFU node.
+     * Empty lists are dropped as soon as they empty out, so the minimum is
+     * the first key of the ordered frequency map.
      */
     void updateMinFreq() {
-        minFreq = INT_MAX;
-        for (auto it = freqList.begin(); it != freqList.end(); ++it) {
-            if (it->second->isEmpty()) {
-                continue;
-            }
-            minFreq = std::min(minFreq, it->first);
-        }
+        minFreq = freqList.empty() ? newFreq() : freqList.begin()->first;
     }
 
-    friend class AvgLfu<Key, Value>;
+    friend class AvgLfu<Key, Value, Lock>;
 };
 
 /**
  * @brief LFU cache with average frequency control for adaptive eviction.
  *
+ * When the average access frequency exceeds `maximumFreq`, every entry's
+ * frequency is lowered by `maximumFreq` (but not below 1). Instead of
+ * rewriting every node, the reduction is recorded in a global decay offset:
+ * a node's logical frequency is its stored frequency minus the offset, and
+ * the stored value is normalized only when the node is next touched. Aging
+ * is therefore O(1), and stored frequencies keep their order, so the
+ * frequency lists stay valid without being rebuilt.
+ *
+ * Nodes whose stored frequency is at or below the offset all count as
+ * logical frequency 1; among them, those last touched in older epochs are
+ * evicted first. The running frequency total is adjusted by the same
+ * estimate, ignoring the floor at 1, which makes aging slightly less eager
+ * than a full rescan would.
+ *
  * @tparam Key   The type of the cache key.
  * @tparam Value The type of the cache value.
+ * @tparam Lock  The lock strategy guarding the cache (see LockPolicy.h).
  */
-template<typename Key, typename Value>
-class AvgLfu : public Lfu<Key, Value> {
+template<typename Key, typename Value, typename Lock = std::mutex>
+class AvgLfu : public Lfu<Key, Value, Lock> {
 private: 
     int averageFreq;
     int totalFreq;
     int maximumFreq;
+    int decayOffset = 0; ///< Total aging applied so far; logical frequency = stored - decayOffset.
+    uint64_t agingCount = 0; ///< Times every entry was aged, see agings().
+
+    static constexpr int kRebaseOffset = 1 << 30; ///< Offset at which stored frequencies are rebased.
+
+    /**
+     * @brief Logical frequency of a stored frequency.
+     * @param stored The frequency stored in a node.
+     */
+    int logicalFreq(int stored) const {
+        return std::max(1, stored - decayOffset);
+    }
 
     /**
      * @brief Increase the total frequency and update the average frequency.
      */
     void increaseTotalFreq() {
         totalFreq++;
-        averageFreq = totalFreq / Lfu<Key, Value>::mp.size();
+        averageFreq = totalFreq / Lfu<Key, Value, Lock>::mp.size();
         if (averageFreq > maximumFreq) {
             handleFreq();
         }
@@ -183,23 +295,46 @@ private:
      */
     void decreaseTotalFreq(int num) {
         totalFreq -= num;
-        averageFreq = totalFreq / Lfu<Key, Value>::mp.size();
+        averageFreq = totalFreq / Lfu<Key, Value, Lock>::mp.size();
     }
 
     /**
-     * @brief Handle frequency adjustment when average frequency exceeds the maximum.
+     * @brief Age every entry by `maximumFreq` in O(1) by advancing the decay offset.
      */
     void handleFreq() {
-        totalFreq = 0;
-        for (auto it = Lfu<Key, Value>::mp.begin(); it != Lfu<Key, Value>::mp.end(); ++it) {
-            auto node = it->second;
-            Lfu<Key, Value>::removeNode(node);
-            node->setFrequency(std::max(1, node->getFrequency() - maximumFreq));
-            totalFreq += node->getFrequency();
-            Lfu<Key, Value>::insertNode(node);
+        int entries = static_cast<int>(Lfu<Key, Value, Lock>::mp.size());
+        ++agingCount;
+        decayOffset += maximumFreq;
+        totalFreq = std::max(entries, totalFreq - maximumFreq * entries);
+        averageFreq = totalFreq / entries;
+        if (decayOffset >= kRebaseOffset) {
+            rebase();
         }
-        averageFreq = totalFreq / Lfu<Key, Value>::mp.size();
-        Lfu<Key, Value>::updateMinFreq();
+    }
+
+    /**
+     * @brief Fold the decay offset back into the stored frequencies.
+     *
+     * Keeps stored frequencies far from overflow; runs once every
+     * kRebaseOffset / maximumFreq agings.
+     */
+    void rebase() {
+        std::vector<std::shared_ptr<Node<Key, Value>>> nodes;
+        nodes.reserve(Lfu<Key, Value, Lock>::mp.size());
+        for (auto& [key, node] : Lfu<Key, Value, Lock>::mp) {
+            Lfu<Key, Value, Lock>::removeNode(node);
+            nodes.push_back(node);
+        }
+        // Keep the epoch order among nodes that fold to frequency 1.
+        std::stable_sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) {
+            return a->getFrequency() < b->getFrequency();
+        });
+        for (auto& node : nodes) {
+            node->setFrequency(logicalFreq(node->getFrequency()));
+            Lfu<Key, Value, Lock>::insertNode(node);
+        }
+        decayOffset = 0;
+        Lfu<Key, Value, Lock>::updateMinFreq();
     }
         
 protected:
@@ -212,10 +347,25 @@ protected:
     
     /**
      * @brief Hook for custom logic on LFU removal (for derived classes).
-     * @param fre The frequency of the removed node.
+     * @param fre The stored frequency of the removed node.
      */
     virtual void removeLFUHook(int fre) override {
-        decreaseTotalFreq(fre);
+        decreaseTotalFreq(logicalFreq(fre));
+    }
+
+    /**
+     * @brief New nodes start at logical frequency 1 in the current epoch.
+     */
+    virtual int newFreq() override {
+        return decayOffset + 1;
+    }
+
+    /**
+     * @brief Normalize a node aged since its last touch, then count the access.
+     * @param fre The node's current stored frequency.
+     */
+    virtual int nextFreq(int fre) override {
+        return std::max(fre, decayOffset + 1) + 1;
     }
 
 public:
@@ -224,11 +374,20 @@ public:
      * @param cap The maximum number of items the cache can hold.
      * @param maxFreq The maximum average frequency threshold.
      */
-    AvgLfu(int cap, int maxFreq = 10) : Lfu<Key, Value>(cap), maximumFreq(maxFreq) {
+    AvgLfu(int cap, int maxFreq = 10) : Lfu<Key, Value, Lock>(cap), maximumFreq(maxFreq) {
         averageFreq = 0;
         totalFreq = 0;
     }
 
+    /**
+     * @brief Times the average frequency passed `maximumFreq` and every entry was aged.
+     *
+     * Read without the lock, like listMoves().
+     */
+    uint64_t agings() const {
+        return agingCount;
+    }
+
 };
 
 /**
@@ -236,14 +395,16 @@ public:
  *
  * @tparam Key   The type of the cache key.
  * @tparam Value The type of the cache value.
+ * @tparam Lock  The lock strategy guarding each shard (see LockPolicy.h).
  */
-template<typename Key, typename Value>
-class HashAvgLfu {
+template<typename Key, typename Value, typename Lock = std::mutex>
+class HashAvgLfu : public Cache<Key, Value> {
 private:
     int sliceNum;
     int sliceSize;
     int capacity;
-    std::vector<std::unique_ptr<AvgLfu<Key, Value>>> avgLfuShards;
+    std::vector<std::unique_ptr<AvgLfu<Key, Value, Lock>>> avgLfuShards;
+    std::atomic<size_t> evictCursor{0}; ///< Next shard evict() tries.
 
     /**
      * @brief Hash function to determine the shard index for a given key.
@@ -251,7 +412,11 @@ private:
      * @return The index of the shard.
      */
     size_t hash(const Key& key) {
-        return std::hash<Key>()(key) % sliceNum;
+        if constexpr (std::is_same_v<Key, std::string>) {
+            return batchhash::hash32(key) % sliceNum;
+        } else {
+            return std::hash<Key>()(key) % sliceNum;
+        }
     }
 public:
     /**
@@ -264,7 +429,7 @@ public:
         sliceSize = capacity / sliceNum;
         avgLfuShards.reserve(sliceNum);
         for (int i = 0; i < sliceNum; ++i) {
-            avgLfuShards.emplace_back(std::make_unique<AvgLfu<Key, Value>>(sliceSize,maximumAverageThreshold));
+            avgLfuShards.emplace_back(std::make_unique<AvgLfu<Key, Value, Lock>>(sliceSize,maximumAverageThreshold));
         }
     }
 
@@ -273,7 +438,7 @@ public:
      * @param key   The key to insert or update.
      * @param value The value to associate with the key.
      */
-    void put(const Key key, const Value value) {
+    void put(const Key key, const Value value) override {
         size_t idx = hash(key);
         avgLfuShards[idx]->put(key, value);
     }
@@ -283,8 +448,104 @@ public:
      * @param key The key to look up.
      * @return The value associated with the key, or a default value if not found.
      */
-    Value get(const Key key) {
+    Value get(const Key key) override {
         size_t idx = hash(key);
         return avgLfuShards[idx]->get(key);
     }
+
+    /**
+     * @brief Retrieve a value from the owning shard, reporting whether it was present.
+     * @param key   The key to look up.
+     * @param value Output parameter for the value.
+     * @return True on a hit, false otherwise.
+     */
+    bool get(const Key key, Value& value) override {
+        return avgLfuShards[hash(key)]->get(key, value);
+    }
+
+    /**
+     * @brief Remove a key from its shard.
+     * @param key The key to remove.
+     */
+    void remove(const Key key) override {
+        avgLfuShards[hash(key)]->remove(key);
+    }
+
+    /**
+     * @brief Number of entries across all shards.
+     */
+    size_t size() override {
+        size_t total = 0;
+        for (auto& shard : avgLfuShards) total += shard->size();
+        return total;
+    }
+
+    /**
+     * @brief Evict one entry from the next non-empty shard, round robin.
+     * @return True if an entry was evicted, false if every shard was empty.
+     */
+    bool evict() override {
+        for (int i = 0; i < sliceNum; ++i) {
+            size_t idx = evictCursor.fetch_add(1, std::memory_order_relaxed) % sliceNum;
+            if (avgLfuShards[idx]->evict()) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Report removals from every shard.
+     * @param listener The listener, not owned.
+     */
+    void setRemovalListener(RemovalListener<Key, Value>* listener) override {
+        Cache<Key, Value>::setRemovalListener(listener);
+        for (auto& shard : avgLfuShards) shard->setRemovalListener(listener);
+    }
+
+    /**
+     * @brief Shard index of a key.
+     * @param key The key to route.
+     * @return The index of the shard owning the key.
+     */
+    size_t shardOf(const Key& key) {
+        return hash(key);
+    }
+
+    /**
+     * @brief Shard indices of a batch of keys.
+     *
+     * String keys are hashed in SIMD batches; the result is identical to
+     * calling shardOf() per key.
+     *
+     * @param keys The keys to route.
+     * @param out Output vector receiving one shard index per key.
+     */
+    void shardsOf(const std::vector<Key>& keys, std::vector<size_t>& out) {
+        out.resize(keys.size());
+        if constexpr (std::is_same_v<Key, std::string>) {
+            std::vector<uint32_t> hashes(keys.size());
+            batchhash::hashBatch(keys.data(), keys.size(), hashes.data());
+            for (size_t i = 0; i < keys.size(); ++i) {
+                out[i] = hashes[i] % sliceNum;
+            }
+        } else {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                out[i] = hash(keys[i]);
+            }
+        }
+    }
+
+    /**
+     * @brief Retrieve a batch of values.
+     * @param keys The keys to look up.
+     * @return The value for each key (default value on a miss), in order.
+     */
+    std::vector<Value> getBatch(const std::vector<Key>& keys) {
+        std::vector<size_t> idx;
+        shardsOf(keys, idx);
+        std::vector<Value> values(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            values[i] = avgLfuShards[idx[i]]->get(keys[i]);
+        }
+        return values;
+    }
 };
\ No newline at end of file
@@ -1,11 +1,13 @@
 #pragma once
 #include "Node.h"
 #include <memory>
-#include <mutex>
 
 /**
  * @brief Doubly linked list for managing cache nodes.
  *
+ * Not synchronized: every list is owned by a cache policy and only touched
+ * while that policy holds its own lock.
+ *
  * @tparam Key   The type of the cache key.
  * @tparam Value The type of the cache value.
  */
@@ -16,8 +18,8 @@ public:
      * @brief Construct an empty linked list with dummy head and tail nodes.
      */
     LinkedList() {
-        head = std::make_shared<Node<Key, Value>>(-1, -1);
-        tail = std::make_shared<Node<Key, Value>>(-1, -1);
+        head = std::make_shared<Node<Key, Value>>();
+        tail = std::make_shared<Node<Key, Value>>();
         head->next = tail;
         tail->prev = head;
     }
@@ -27,7 +29,6 @@ public:
      * @param node The node to insert.
      */
     void insertToEnd(const std::shared_ptr<Node<Key, Value>>& node) {
-        std::lock_guard<std::mutex> lock(mutex_);
         auto last = tail->prev.lock();
         last->next = node;
         node->prev = last;
@@ -41,7 +42,6 @@ public:
      * @param node The node to remove.
      */
     void remove(std::shared_ptr<Node<Key, Value>>& node) {
-        std::lock_guard<std::mutex> lock(mutex_);
         auto prevNode = node->prev.lock();
         auto nextNode = node->next;
         prevNode->next = nextNode;
@@ -55,7 +55,6 @@ public:
      * @return The removed node, or nullptr if the list is empty.
      */
     std::shared_ptr<Node<Key, Value>> removeFront() {
-        std::lock_guard<std::mutex> lock(mutex_);
         auto first = head->next;
         if (first == tail) return nullptr;
         head->next = first->next;
@@ -78,7 +77,6 @@ public:
      * @return The size of the list.
      */
     int getSize() {
-        std::lock_guard<std::mutex> lock(mutex_);
         return size;
     }
 
@@ -86,5 +84,4 @@ private:
     int size = 0; ///< The number of nodes in the list (excluding dummy nodes).
     std::shared_ptr<Node<Key, Value>> head; ///< Dummy head node.
     std::shared_ptr<Node<Key, Value>> tail; ///< Dummy tail node.
-    std::mutex mutex_; ///< Mutex for thread-safe operations.
 };
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+
+/**
+ * Lock strategies a cache policy can be instantiated with.
+ *
+ * All of them model Lockable, so policies keep using std::lock_guard for
+ * writes. Read paths that do not reorder the policy's internal state go
+ * through ReadGuard, which takes the shared side when the strategy has one:
+ *
+ *  - NoLock             single-threaded shards, zero cost.
+ *  - SpinLock           short critical sections with moderate contention.
+ *  - std::mutex         the default; sleeps under heavy contention.
+ *  - std::shared_mutex  read-mostly groups whose reads do not reorder.
+ */
+
+/**
+ * @brief Lock strategy that does nothing.
+ *
+ * Meant for caches owned by a single thread (e.g. one shard per core), where
+ * the engine is never shared and locking would only cost cycles.
+ */
+struct NoLock {
+    void lock() {}
+    void unlock() {}
+    bool try_lock() { return true; }
+};
+
+/**
+ * @brief Test-and-test-and-set spinlock.
+ *
+ * Waiters spin on a plain load so the cache line stays shared until the owner
+ * releases it, and yield after a bounded number of spins.
+ */
+class SpinLock {
+public:
+    void lock() {
+        while (true) {
+            if (!locked.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            int spins = 0;
+            while (locked.load(std::memory_order_relaxed)) {
+                if (++spins >= 64) {
+                    std::this_thread::yield();
+                    spins = 0;
+                }
+            }
+        }
+    }
+
+    bool try_lock() {
+        return !locked.load(std::memory_order_relaxed) &&
+               !locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() { locked.store(false, std::memory_order_release); }
+
+private:
+    std::atomic<bool> locked{false}; ///< True while held.
+};
+
+/**
+ * @brief Detects whether a lock strategy has a shared (reader) side.
+ */
+template<typename Lock, typename = void>
+struct HasSharedLock : std::false_type {};
+
+template<typename Lock>
+struct HasSharedLock<Lock, std::void_t<decltype(std::declval<Lock&>().lock_shared())>> : std::true_type {};
+
+/**
+ * @brief RAII guard for read paths that do not modify the protected state.
+ *
+ * Takes the shared side of the lock when the strategy provides one, and the
+ * exclusive side otherwise.
+ */
+template<typename Lock>
+class ReadGuard {
+public:
+    explicit ReadGuard(Lock& l) : lockRef(l) {
+        if constexpr (HasSharedLock<Lock>::value) lockRef.lock_shared(); else lockRef.lock();
+    }
+    ~ReadGuard() {
+        if constexpr (HasSharedLock<Lock>::value) lockRef.unlock_shared(); else lockRef.unlock();
+    }
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+private:
+    Lock& lockRef; ///< The guarded lock.
+};
@@ -3,30 +3,35 @@
 #include "Cache.h"
 #include "Node.h"
 #include "LinkedList.h"
-#include <unordered_map>
+#include "LockPolicy.h"
+#include "BatchHash.h"
+#include "SwissIndex.h"
 #include <mutex>
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <type_traits>
 
 /**
  * @brief Least Recently Used (LRU) cache implementation.
  *
  * @tparam Key   The type of the cache key.
  * @tparam Value The type of the cache value.
+ * @tparam Lock  The lock strategy guarding the cache (see LockPolicy.h).
  */
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Lock = std::mutex>
 class Lru : public Cache<Key, Value> {
 public:
     using LruNode = Node<Key, Value>;
     using LruNodePtr = std::shared_ptr<LruNode>;
-    using LruMap = std::unordered_map<Key, LruNodePtr>;
+    using LruMap = SwissIndex<Key, LruNodePtr>;
 
     /**
      * @brief Construct an LRU cache with a given capacity.
      * @param cap The maximum number of items the cache can hold.
      */
-    Lru(int cap) : capacity(cap), size(0) {
+    Lru(int cap) : capacity(cap), count(0) {
         list = std::make_shared<LinkedList<Key, Value>>();
     }
     
@@ -36,12 +41,13 @@ public:
      * @param value The value to associate with the key.
      */
     virtual void put(const Key key, const Value value) override {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (cacheMap.find(key) != cacheMap.end()) {
-            auto node = cacheMap[key];
-            list->remove(node);
+        std::lock_guard<Lock> lock(mutex_);
+        if (auto found = cacheMap.find(key)) {
+            notifyRemoval(this->removalListener, key, (*found)->takeValue(), RemovalCause::REPLACED);
+            list->remove(*found);
+            --count;
         } else {
-            if (size >= capacity) {
+            if (count >= capacity) {
                 removelru();
             }
         }
@@ -54,37 +60,89 @@ public:
      * @return The value associated with the key, or a default value if not found.
      */
     virtual Value get(const Key key) override {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (cacheMap.find(key) != cacheMap.end()) {
-            auto node = cacheMap[key];
+        std::lock_guard<Lock> lock(mutex_);
+        if (auto found = cacheMap.find(key)) {
+            auto node = *found;
             Value res = node->getValue();
             list->remove(node);
-            insertBack(node);
+            list->insertToEnd(node);
             return res;
         }
         return Value();
     }
     
+    /**
+     * @brief Retrieve a value from the cache, reporting whether it was present.
+     * @param key   The key to look up.
+     * @param value Output parameter for the value.
+     * @return True on a hit, false otherwise.
+     */
+    virtual bool get(const Key key, Value& value) override {
+        std::lock_guard<Lock> lock(mutex_);
+        if (auto found = cacheMap.find(key)) {
+            auto node = *found;
+            value = node->getValue();
+            list->remove(node);
+            list->insertToEnd(node);
+            return true;
+        }
+        return false;
+    }
+
     /**
      * @brief Remove a key from the cache.
      * @param key The key to remove.
      */
-    void remove(const Key key) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (cacheMap.find(key) != cacheMap.end()) {
-            auto node = cacheMap[key];
-            list->remove(node);
+    virtual void remove(const Key key) override {
+        std::lock_guard<Lock> lock(mutex_);
+        if (auto found = cacheMap.find(key)) {
+            notifyRemoval(this->removalListener, key, (*found)->takeValue(), RemovalCause::EXPLICIT);
+            list->remove(*found);
+            cacheMap.erase(key);
+            --count;
+        }
+    }
+
+    /**
+     * @brief Remove a key without reporting it, because the entry moves to another cache.
+     * @param key The key to remove.
+     */
+    void discard(const Key key) {
+        std::lock_guard<Lock> lock(mutex_);
+        if (auto found = cacheMap.find(key)) {
+            list->remove(*found);
+            cacheMap.erase(key);
+            --count;
         }
     }
 
+    /**
+     * @brief Number of entries currently held.
+     */
+    virtual size_t size() override {
+        ReadGuard<Lock> lock(mutex_);
+        return static_cast<size_t>(count);
+    }
+
+    /**
+     * @brief Evict the least recently used entry.
+     * @return True if an entry was evicted, false if the cache was empty.
+     */
+    virtual bool evict() override {
+        std::lock_guard<Lock> lock(mutex_);
+        if (count == 0) return false;
+        removelru();
+        return true;
+    }
+
     /**
      * @brief Check if a key exists in the cache.
      * @param key The key to check.
      * @return True if the key exists, false otherwise.
      */
     bool contains(const Key key) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return cacheMap.find(key) != cacheMap.end();
+        ReadGuard<Lock> lock(mutex_);
+        return cacheMap.find(key) != nullptr;
     }
 
     /**
@@ -93,9 +151,9 @@ public:
      * @return The frequency of the key, or 0 if not found.
      */
     int getFrequency(const Key key) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (cacheMap.find(key) != cacheMap.end()) {
-            return cacheMap[key]->getFrequency();
+        ReadGuard<Lock> lock(mutex_);
+        if (auto found = cacheMap.find(key)) {
+            return (*found)->getFrequency();
         }
         return 0;
     }
@@ -106,17 +164,17 @@ public:
      * @param freq The new frequency value.
      */
     void setFrequency(const Key key, int freq) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (cacheMap.find(key) != cacheMap.end()) {
-            cacheMap[key]->setFrequency(freq);
+        std::lock_guard<Lock> lock(mutex_);
+        if (auto found = cacheMap.find(key)) {
+            (*found)->setFrequency(freq);
         }
     }
 private:
     std::shared_ptr<LinkedList<Key, Value>> list; ///< The main cache list.
-    int size; ///< The current number of items in the cache.
     int capacity; ///< The maximum capacity of the cache.
-    LruMap cacheMap; ///< Key-node mapping for fast lookup.
-    std::mutex mutex_; ///< Mutex for thread safety.
+    int count; ///< The current number of items in the cache.
+    LruMap cacheMap; ///< Key-node mapping; SIMD tag-matched, one or two cache lines per lookup.
+    Lock mutex_; ///< Lock guarding the cache.
     
     /**
      * @brief Insert a new node at the back of the list and update the cache map.
@@ -125,10 +183,10 @@ private:
      * @return The pointer to the new node.
      */
     LruNodePtr insertBack(const Key& key, const Value& value) {
-        ++size;
+        ++count;
         auto newNode = std::make_shared<LruNode>(key, value);
         list->insertToEnd(newNode);
-        cacheMap[key] = newNode;
+        cacheMap.insert(key, newNode);
         return newNode;
     }
     
@@ -137,9 +195,9 @@ private:
      * @param node The node to insert.
      */
     void insertBack(LruNodePtr node) {
-        ++size;
+        ++count;
         list->insertToEnd(node);
-        cacheMap[node->getKey()] = node;
+        cacheMap.insert(node->getKey(), node);
     }
 
     /**
@@ -147,13 +205,15 @@ private:
      */
     void removelru() {
         auto node = list->removeFront();
+        if (node == nullptr) return;
         cacheMap.erase(node->getKey());
-        --size;
+        --count;
+        notifyRemoval(this->removalListener, node->getKey(), node->takeValue(), RemovalCause::SIZE);
     }
 };
 
-template<typename Key, typename Value>
-class LruK : public Lru<Key, Value> {
+template<typename Key, typename Value, typename Lock = std::mutex>
+class LruK : public Lru<Key, Value, Lock> {
 public:
     /**
      * @brief Construct an LRU-K cache with a given capacity, cold cache size, and promotion threshold.
@@ -162,9 +222,9 @@ public:
      * @param kVal The promotion threshold for moving items from the cold cache to the main cache.
      */
     LruK(int cap, int coldCacheSize, int kVal = 1) 
-    : Lru<Key, Value>(cap), 
+    : Lru<Key, Value, Lock>(cap), 
     promotionThresholds(kVal), 
-    coldCache(std::make_unique<Lru<Key, Value>>(coldCacheSize)){} // store cold entries
+    coldCache(std::make_unique<Lru<Key, Value, Lock>>(coldCacheSize)){} // store cold entries
 
     /**
      * @brief Insert or update a value in the LRU-K cache.
@@ -172,14 +232,14 @@ public:
      * @param value The value to associate with the key.
      */
     void put(const Key key, const Value value) override {
-        if(Lru<Key, Value>::contains(key)){
-            Lru<Key, Value>::put(key, value);
+        if(Lru<Key, Value, Lock>::contains(key)){
+            Lru<Key, Value, Lock>::put(key, value);
             return;
         }
         int KeyFreq = coldCache->getFrequency(key);
         if(KeyFreq >= promotionThresholds){
-            coldCache->remove(key);
-            Lru<Key,Value>::put(key, value);
+            coldCache->discard(key);
+            Lru<Key, Value, Lock>::put(key, value);
         }
         else {
             coldCache->put(key, value);
@@ -193,31 +253,81 @@ public:
      * @return The value associated with the key, or a default value if not found.
      */
     Value get(const Key key) override {
-        if (Lru<Key, Value>::contains(key)) {
-            return Lru<Key, Value>::get(key);
-        } else if (coldCache->contains(key)) {
-            int keyFreq = coldCache->getFrequency(key);
-            Value val = coldCache->get(key);
-            if (keyFreq >= promotionThresholds) {
-                coldCache->remove(key);
-                Lru<Key, Value>::put(key, val);
-                return Lru<Key, Value>::get(key);
-            } else {
-                coldCache->setFrequency(key, keyFreq + 1);
-                return val;
-            }
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    /**
+     * @brief Retrieve a value from the LRU-K cache, reporting whether it was present.
+     *
+     * Entries still in the cold cache count as hits; reaching the promotion
+     * threshold moves them to the main cache.
+     *
+     * @param key   The key to look up.
+     * @param value Output parameter for the value.
+     * @return True on a hit, false otherwise.
+     */
+    bool get(const Key key, Value& value) override {
+        if (Lru<Key, Value, Lock>::get(key, value)) {
+            return true;
         }
-        return Value();
+        if (!coldCache->contains(key)) {
+            return false;
+        }
+        int keyFreq = coldCache->getFrequency(key);
+        if (!coldCache->get(key, value)) {
+            return false;
+        }
+        if (keyFreq >= promotionThresholds) {
+            coldCache->discard(key);
+            Lru<Key, Value, Lock>::put(key, value);
+        } else {
+            coldCache->setFrequency(key, keyFreq + 1);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Remove a key from both the main and the cold cache.
+     * @param key The key to remove.
+     */
+    void remove(const Key key) override {
+        Lru<Key, Value, Lock>::remove(key);
+        coldCache->remove(key);
+    }
+
+    /**
+     * @brief Number of entries in the main and the cold cache.
+     */
+    size_t size() override {
+        return Lru<Key, Value, Lock>::size() + coldCache->size();
+    }
+
+    /**
+     * @brief Evict from the cold cache first, then from the main cache.
+     * @return True if an entry was evicted, false if both were empty.
+     */
+    bool evict() override {
+        return coldCache->evict() || Lru<Key, Value, Lock>::evict();
+    }
+
+    /**
+     * @brief Report removals from the main and the cold cache; promotions are not removals.
+     * @param listener The listener, not owned.
+     */
+    void setRemovalListener(RemovalListener<Key, Value>* listener) override {
+        Lru<Key, Value, Lock>::setRemovalListener(listener);
+        coldCache->setRemovalListener(listener);
     }
-    
 
 private:
     int promotionThresholds; ///< The promotion threshold for moving items from the cold cache to the main cache.
-    std::unique_ptr<Lru<Key, Value>> coldCache; ///< The cold cache for storing less frequently accessed items.
+    std::unique_ptr<Lru<Key, Value, Lock>> coldCache; ///< The cold cache for storing less frequently accessed items.
 };
 
-template<typename Key, typename Value>
-class HashLruK {
+template<typename Key, typename Value, typename Lock = std::mutex>
+class HashLruK : public Cache<Key, Value> {
 public:
     /**
      * @brief Construct a Hash-based LRU-K cache with a given capacity, slice count, cold cache size, and promotion threshold.
@@ -227,12 +337,12 @@ public:
      * @param promotionThreshold The promotion threshold for moving items from the cold cache to the main cache.
      */
     HashLruK(int cap, int slice, int coldCacheSize, int promotionThreshold)
-      : sliceNum(slice), capacity(cap), promotionThreshold(promotionThreshold)
+      : capacity(cap), sliceNum(slice), promotionThreshold(promotionThreshold)
     {
         int sliceSize = capacity / sliceNum;
         lruKShards.reserve(sliceNum);
         for (int i = 0; i < sliceNum; ++i) {
-            lruKShards.emplace_back(std::make_unique<LruK<Key, Value>>(sliceSize, coldCacheSize, promotionThreshold));
+            lruKShards.emplace_back(std::make_unique<LruK<Key, Value, Lock>>(sliceSize, coldCacheSize, promotionThreshold));
         }
     }
     
@@ -241,7 +351,7 @@ public:
      * @param key   The key to insert or update.
      * @param value The value to associate with the key.
      */
-    void put(const Key key, const Value value) {
+    void put(const Key key, const Value value) override {
         size_t idx = hash(key);
         lruKShards[idx]->put(key, value);
     }
@@ -251,16 +361,113 @@ public:
      * @param key The key to look up.
      * @return The value associated with the key, or a default value if not found.
      */
-    Value get(const Key key) {
+    Value get(const Key key) override {
         size_t idx = hash(key);
         return lruKShards[idx]->get(key);
     }
+
+    /**
+     * @brief Retrieve a value from the owning shard, reporting whether it was present.
+     * @param key   The key to look up.
+     * @param value Output parameter for the value.
+     * @return True on a hit, false otherwise.
+     */
+    bool get(const Key key, Value& value) override {
+        return lruKShards[hash(key)]->get(key, value);
+    }
+
+    /**
+     * @brief Remove a key from its shard.
+     * @param key The key to remove.
+     */
+    void remove(const Key key) override {
+        lruKShards[hash(key)]->remove(key);
+    }
+
+    /**
+     * @brief Number of entries across all shards.
+     */
+    size_t size() override {
+        size_t total = 0;
+        for (auto& shard : lruKShards) total += shard->size();
+        return total;
+    }
+
+    /**
+     * @brief Evict one entry from the next non-empty shard, round robin.
+     * @return True if an entry was evicted, false if every shard was empty.
+     */
+    bool evict() override {
+        for (int i = 0; i < sliceNum; ++i) {
+            size_t idx = evictCursor.fetch_add(1, std::memory_order_relaxed) % sliceNum;
+            if (lruKShards[idx]->evict()) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Report removals from every shard.
+     * @param listener The listener, not owned.
+     */
+    void setRemovalListener(RemovalListener<Key, Value>* listener) override {
+        Cache<Key, Value>::setRemovalListener(listener);
+        for (auto& shard : lruKShards) shard->setRemovalListener(listener);
+    }
+
+    /**
+     * @brief Shard index of a key.
+     * @param key The key to route.
+     * @return The index of the shard owning the key.
+     */
+    size_t shardOf(const Key& key) {
+        return hash(key);
+    }
+
+    /**
+     * @brief Shard indices of a batch of keys.
+     *
+     * String keys are hashed in SIMD batches; the result is identical to
+     * calling shardOf() per key.
+     *
+     * @param keys The keys to route.
+     * @param out Output vector receiving one shard index per key.
+     */
+    void shardsOf(const std::vector<Key>& keys, std::vector<size_t>& out) {
+        out.resize(keys.size());
+        if constexpr (std::is_same_v<Key, std::string>) {
+            std::vector<uint32_t> hashes(keys.size());
+            batchhash::hashBatch(keys.data(), keys.size(), hashes.data());
+            for (size_t i = 0; i < keys.size(); ++i) {
+                out[i] = hashes[i] % sliceNum;
+            }
+        } else {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                out[i] = hash(keys[i]);
+            }
+        }
+    }
+
+    /**
+     * @brief Retrieve a batch of values.
+     * @param keys The keys to look up.
+     * @return The value for each key (default value on a miss), in order.
+     */
+    std::vector<Value> getBatch(const std::vector<Key>& keys) {
+        std::vector<size_t> idx;
+        shardsOf(keys, idx);
+        std::vector<Value> values(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            values[i] = lruKShards[idx[i]]->get(keys[i]);
+        }
+        return values;
+    }
     
 private:
     int capacity; ///< The maximum capacity of the cache.
     int sliceNum; ///< The number of slices in the cache.
     int promotionThreshold; ///< The promotion threshold for moving items from the cold cache to the main cache.
-    std::vector<std::unique_ptr<LruK<Key, Value>>> lruKShards; ///< The shards of the LRU-K cache.
+    std::vector<std::unique_ptr<LruK<Key, Value, Lock>>> lruKShards; ///< The shards of the LRU-K cache.
+    std::atomic<size_t> evictCursor{0}; ///< Next shard evict() tries.
     
     /**
      * @brief Hash function to determine the shard index for a given key.
@@ -268,6 +475,10 @@ private:
      * @return The index of the shard.
      */
     size_t hash(const Key& key) {
-        return std::hash<Key>()(key) % sliceNum;
+        if constexpr (std::is_same_v<Key, std::string>) {
+            return batchhash::hash32(key) % sliceNum;
+        } else {
+            return std::hash<Key>()(key) % sliceNum;
+        }
     }
 };
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+/**
+ * @brief Unbounded lock-free multi-producer single-consumer queue.
+ *
+ * Any number of threads may call push(); exactly one thread at a time may
+ * call pop(). push() is one allocation and one atomic exchange, so it never
+ * waits for another producer or for the consumer. A push that has exchanged
+ * the head but not yet linked its node is invisible to pop() until it does;
+ * pop() then reports an empty queue even if later pushes have completed.
+ *
+ * @tparam T The element type (default-constructible and movable).
+ */
+template<typename T>
+class MpscQueue {
+public:
+    MpscQueue() {
+        Node* stub = new Node();
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    ~MpscQueue() {
+        while (tail) {
+            Node* next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * @brief Append an element (any thread).
+     * @param item The element to append.
+     */
+    void push(T item) {
+        Node* node = new Node();
+        node->value = std::move(item);
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief Remove the oldest element (consumer side).
+     * @param item Output parameter for the element.
+     * @return False if the queue is empty.
+     */
+    bool pop(T& item) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        item = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    /**
+     * @brief Queue node; the node at `tail` is a consumed placeholder.
+     */
+    struct Node {
+        std::atomic<Node*> next{nullptr}; ///< Next (newer) node.
+        T value{};                        ///< The element, moved out when popped.
+    };
+
+    alignas(64) std::atomic<Node*> head{nullptr}; ///< Newest node (written by producers).
+    alignas(64) Node* tail = nullptr;             ///< Placeholder before the oldest element (consumer only).
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <utility>
 
 template<typename Key, typename Value>
 class LinkedList; // Forward declaration
@@ -35,6 +36,11 @@ public:
      * @return The value.
      */
     Value getValue() const { return val; }
+    /**
+     * @brief Move the value out of a node that is being discarded.
+     * @return The value.
+     */
+    Value takeValue() { return std::move(val); }
     /**
      * @brief Get the frequency counter.
      * @return The frequency.
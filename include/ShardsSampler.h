@@ -0,0 +1,323 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Working-set and miss-ratio-curve estimator based on SHARDS.
+ *
+ * Keys are sampled spatially: a key is tracked iff a hash of it falls below a
+ * threshold, so every access to a sampled key is seen and reuse distances
+ * among sampled keys are exact. A sampled reuse distance d stands for d / R
+ * distinct keys in the full stream, where R is the sampling rate.
+ *
+ * Reuse distances are computed with a Fenwick tree over logical timestamps
+ * holding a 1 at the last access of every tracked key. The number of tracked
+ * keys is capped (SHARDS fixed-size mode): when the cap is exceeded the key
+ * with the largest hash is dropped and the threshold lowered to it, so memory
+ * is bounded regardless of the key space. Histogram weights are 1 / R at the
+ * time of the access and are halved periodically, so the curve follows the
+ * live workload.
+ *
+ * Spatial sampling over- or under-represents the few hottest keys depending
+ * on which of them happen to be sampled. As in SHARDS-adj, the curve is
+ * normalized by the number of accesses actually seen rather than the
+ * weighted sampled count, which attributes the difference to distance-zero
+ * reuses.
+ *
+ * Unsampled accesses cost one hash, one atomic load and one relaxed increment.
+ */
+class ShardsSampler {
+public:
+    /**
+     * @brief One point of a miss-ratio curve.
+     */
+    struct Point {
+        size_t capacity;  ///< Cache capacity in entries.
+        double missRatio; ///< Estimated LRU miss ratio at that capacity.
+    };
+
+    /**
+     * @brief Construct a sampler.
+     * @param rate Initial sampling rate (fraction of keys tracked).
+     * @param maxTracked Cap on tracked keys; the rate is lowered to stay under it.
+     * @param decayPeriod Sampled accesses between halvings of the histogram (0 = 16 * maxTracked).
+     */
+    explicit ShardsSampler(double rate = 0.01, size_t maxTracked = 8192, size_t decayPeriod = 0)
+        : maxTracked(maxTracked),
+          decayPeriod(decayPeriod ? decayPeriod : 16 * maxTracked),
+          fenwick(4 * maxTracked + 1, 0),
+          timeKey(4 * maxTracked, nullptr) {
+        threshold.store(rateToThreshold(rate), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record one access.
+     * @param key The key accessed.
+     */
+    void access(const std::string& key) {
+        access(key, sampleHash(key));
+    }
+
+    /**
+     * @brief Record one access of a key whose sampleHash() the caller already has.
+     * @param key The key accessed.
+     * @param h sampleHash(key).
+     */
+    void access(const std::string& key, uint64_t h) {
+        seen.fetch_add(1, std::memory_order_relaxed);
+        if (h >= threshold.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        track(key, h);
+    }
+
+    /**
+     * @brief Record a batch of accesses under one lock.
+     *
+     * For callers that count accesses on their own and only keep the keys
+     * sampled() selects, e.g. a thread-per-core shard.
+     *
+     * @param keys The sampled keys of the batch, in access order.
+     * @param accesses Number of accesses in the batch, sampled or not.
+     */
+    void access(const std::vector<std::string>& keys, uint64_t accesses) {
+        seen.fetch_add(accesses, std::memory_order_relaxed);
+        if (keys.empty()) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& key : keys) {
+            track(key, sampleHash(key));
+        }
+    }
+
+    /**
+     * @brief Whether an access to a key is tracked at the current rate; takes no lock.
+     * @param key The key.
+     */
+    bool sampled(const std::string& key) const {
+        return sampleHash(key) < threshold.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Current sampling rate.
+     */
+    double rate() const {
+        return thresholdToRate(threshold.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Estimated number of distinct keys in the (decayed) stream.
+     */
+    size_t workingSetSize() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<size_t>(tracked.size() / rate());
+    }
+
+    /**
+     * @brief Estimated LRU miss ratio at a given capacity.
+     * @param capacity Cache capacity in entries.
+     * @return Miss ratio in [0, 1], or 1 if nothing has been sampled yet.
+     */
+    double missRatio(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return missRatioLocked(capacity);
+    }
+
+    /**
+     * @brief Miss-ratio curve around a capacity.
+     * @param capacity The current capacity.
+     * @return Points for 0.1x to 10x of the capacity.
+     */
+    std::vector<Point> missRatioCurve(size_t capacity) {
+        static const double factors[] = {0.1, 0.25, 0.5, 0.75, 1.0, 1.5, 2.0, 3.0, 5.0, 10.0};
+        std::vector<Point> curve;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (double f : factors) {
+            size_t c = static_cast<size_t>(capacity * f);
+            curve.push_back(Point{c, missRatioLocked(c)});
+        }
+        return curve;
+    }
+
+    /**
+     * @brief Sampling hash, independent of the hash used for routing and sharding.
+     *
+     * Shared with other spatially sampled simulators (see PolicyTuner).
+     */
+    static uint64_t sampleHash(const std::string& key) {
+        uint64_t z = static_cast<uint64_t>(std::hash<std::string>()(key)) + 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+private:
+    /**
+     * @brief Per-key tracking state.
+     */
+    struct Entry {
+        uint64_t hash;     ///< Sampling hash of the key.
+        size_t lastTime;   ///< Logical time of the last access.
+    };
+
+    static constexpr size_t kExactBuckets = 16; ///< Distances below this get their own bucket.
+    static constexpr int kSubBuckets = 8;       ///< Buckets per power of two above that.
+
+    size_t maxTracked;                                       ///< Cap on tracked keys.
+    size_t decayPeriod;                                      ///< Sampled accesses between halvings.
+    std::atomic<uint64_t> threshold{0};                      ///< Keys with sampleHash below this are tracked.
+    std::atomic<uint64_t> seen{0};                           ///< Accesses since the last halving (sampled or not).
+    std::mutex mutex_;                                       ///< Guards everything below.
+    std::unordered_map<std::string, Entry> tracked;          ///< Tracked keys.
+    std::multiset<std::pair<uint64_t, const std::string*>> byHash; ///< Tracked keys ordered by hash.
+    std::vector<int64_t> fenwick;                            ///< 1-based Fenwick tree over timestamps.
+    std::vector<const std::string*> timeKey;                 ///< Key whose last access is at each timestamp.
+    size_t clock = 0;                                        ///< Next logical timestamp.
+    std::unordered_map<size_t, double> histogram;            ///< Weighted reuse distances by bucket.
+    double coldWeight = 0;                                   ///< Weighted first accesses.
+    double totalWeight = 0;                                  ///< Weighted sampled accesses.
+    double seenBefore = 0;                                   ///< Decayed accesses seen before the last halving.
+    size_t sinceDecay = 0;                                   ///< Sampled accesses since the last halving.
+
+    static uint64_t rateToThreshold(double rate) {
+        if (rate >= 1.0) return UINT64_MAX;
+        return static_cast<uint64_t>(std::ldexp(rate > 0 ? rate : 1e-6, 64));
+    }
+
+    static double thresholdToRate(uint64_t t) {
+        return std::ldexp(static_cast<double>(t), -64);
+    }
+
+    /**
+     * @brief Record an access to a key with sampling hash `h`; caller holds mutex_.
+     */
+    void track(const std::string& key, uint64_t h) {
+        uint64_t limit = threshold.load(std::memory_order_relaxed);
+        if (h >= limit) return;
+        double weight = 1.0 / thresholdToRate(limit);
+
+        if (clock == timeKey.size()) compact();
+        auto it = tracked.find(key);
+        if (it != tracked.end()) {
+            // Distinct tracked keys accessed since this key's last access.
+            uint64_t distance = prefixSum(clock) - prefixSum(it->second.lastTime + 1);
+            histogram[bucketOf(static_cast<uint64_t>(distance * weight))] += weight;
+            add(it->second.lastTime, -1);
+            timeKey[it->second.lastTime] = nullptr;
+        } else {
+            coldWeight += weight;
+            it = tracked.emplace(key, Entry{h, 0}).first;
+            byHash.emplace(h, &it->first);
+        }
+        it->second.lastTime = clock;
+        timeKey[clock] = &it->first;
+        add(clock, +1);
+        ++clock;
+        totalWeight += weight;
+
+        if (tracked.size() > maxTracked) shrink();
+        if (++sinceDecay >= decayPeriod) decay();
+    }
+
+    /**
+     * @brief Histogram bucket of a distance: exact below 16, then 8 per power of two.
+     */
+    static size_t bucketOf(uint64_t d) {
+        if (d < kExactBuckets) return static_cast<size_t>(d);
+        int e = 63 - __builtin_clzll(d);
+        size_t sub = static_cast<size_t>((d >> (e - 3)) & (kSubBuckets - 1));
+        return kExactBuckets + static_cast<size_t>(e - 4) * kSubBuckets + sub;
+    }
+
+    /**
+     * @brief Smallest distance falling into a bucket.
+     */
+    static double bucketLow(size_t b) {
+        if (b < kExactBuckets) return static_cast<double>(b);
+        size_t e = (b - kExactBuckets) / kSubBuckets + 4;
+        size_t sub = (b - kExactBuckets) % kSubBuckets;
+        return std::ldexp(1.0 + sub / static_cast<double>(kSubBuckets), static_cast<int>(e));
+    }
+
+    double missRatioLocked(size_t capacity) const {
+        double expected = seenBefore + seen.load(std::memory_order_relaxed);
+        if (totalWeight <= 0 || expected <= 0) return 1.0;
+        // An LRU cache of size C misses every access with reuse distance >= C.
+        double misses = coldWeight;
+        for (const auto& [bucket, weight] : histogram) {
+            double low = bucketLow(bucket);
+            double high = bucketLow(bucket + 1);
+            if (low >= capacity) {
+                misses += weight;
+            } else if (high > capacity) {
+                misses += weight * (high - capacity) / (high - low);
+            }
+        }
+        return std::min(1.0, misses / expected);
+    }
+
+    void add(size_t time, int64_t delta) {
+        for (size_t i = time + 1; i < fenwick.size(); i += i & (~i + 1)) fenwick[i] += delta;
+    }
+
+    /**
+     * @brief Number of marks at timestamps [0, time).
+     */
+    int64_t prefixSum(size_t time) const {
+        int64_t sum = 0;
+        for (size_t i = time; i > 0; i -= i & (~i + 1)) sum += fenwick[i];
+        return sum;
+    }
+
+    /**
+     * @brief Renumber live timestamps to 0..n-1 once the timeline is full.
+     */
+    void compact() {
+        size_t next = 0;
+        std::fill(fenwick.begin(), fenwick.end(), 0);
+        for (size_t t = 0; t < clock; ++t) {
+            const std::string* key = timeKey[t];
+            if (!key) continue;
+            timeKey[t] = nullptr;
+            timeKey[next] = key;
+            tracked.find(*key)->second.lastTime = next;
+            add(next, +1);
+            ++next;
+        }
+        clock = next;
+    }
+
+    /**
+     * @brief Drop the tracked key with the largest hash and lower the threshold to it.
+     */
+    void shrink() {
+        auto last = std::prev(byHash.end());
+        threshold.store(last->first, std::memory_order_relaxed);
+        auto it = tracked.find(*last->second);
+        add(it->second.lastTime, -1);
+        timeKey[it->second.lastTime] = nullptr;
+        byHash.erase(last);
+        tracked.erase(it);
+    }
+
+    /**
+     * @brief Halve all weights so old behaviour fades out.
+     */
+    void decay() {
+        sinceDecay = 0;
+        for (auto& [bucket, weight] : histogram) weight *= 0.5;
+        coldWeight *= 0.5;
+        totalWeight *= 0.5;
+        seenBefore = (seenBefore + seen.exchange(0, std::memory_order_relaxed)) * 0.5;
+    }
+};
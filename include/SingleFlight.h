@@ -8,6 +8,8 @@
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 /**
  * @brief SingleFlight prevents duplicate function calls for the same key.
@@ -15,12 +17,16 @@
  * This class ensures that multiple concurrent calls with the same key 
  * will only execute the function once, with all callers receiving the same result.
  *
+ * Callers either block (run()) or register a callback (join()); both kinds
+ * can share one flight.
+ *
  * @tparam V The type of the value returned by the function.
  */
 template<typename V>
 class SingleFlight {
     using Result = std::optional<V>;
     using Func = std::function<Result()>;
+    using Callback = std::function<void(const Result&)>;
 
 private:
     /**
@@ -29,6 +35,7 @@ private:
     struct Task {
         std::promise<Result> promise;
         std::shared_future<Result> future = promise.get_future().share();
+        std::vector<Callback> callbacks; ///< Callbacks of the callers that joined; guarded by mtx.
     };
     
     std::mutex mtx;
@@ -48,14 +55,11 @@ public:
     Result run(const std::string& key, Func func) {
         std::unique_lock<std::mutex> lock(mtx);
         if (map.find(key) == map.end()) {
-            auto task = std::make_shared<Task>();
-            map[key] = task;
+            map[key] = std::make_shared<Task>();
             lock.unlock();
 
             Result result = func();
-            task->promise.set_value(result);
-            std::unique_lock<std::mutex> lock2(mtx);
-            map.erase(key);
+            land(key, result);
             return result;
         }
         auto task = map[key];
@@ -63,5 +67,49 @@ public:
         Result result = task->future.get();
         return result;
     }
+
+    /**
+     * @brief Join the call in flight for a key without blocking, or become its leader.
+     *
+     * A follower's callback runs on the thread that lands the result. A
+     * leader's callback runs there too, after the leader calls land().
+     *
+     * @param key The unique identifier for this function call.
+     * @param callback Receives the result; must not block.
+     * @return True if the caller leads the call and must land() its result.
+     */
+    bool join(const std::string& key, Callback callback) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = map.find(key);
+        bool leader = it == map.end();
+        if (leader) {
+            it = map.emplace(key, std::make_shared<Task>()).first;
+        }
+        it->second->callbacks.push_back(std::move(callback));
+        return leader;
+    }
+
+    /**
+     * @brief Hand the result of a led call to everyone waiting on it.
+     *
+     * @param key The key the caller leads (see join()).
+     * @param result The result.
+     */
+    void land(const std::string& key, const Result& result) {
+        std::shared_ptr<Task> task;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = map.find(key);
+            if (it == map.end()) {
+                return;
+            }
+            task = std::move(it->second);
+            map.erase(it);
+        }
+        task->promise.set_value(result);
+        for (auto& callback : task->callbacks) {
+            callback(result);
+        }
+    }
 };
-#endif // singleflighth
\ No newline at end of file
+#endif // singleflighth
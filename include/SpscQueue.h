@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free single-producer single-consumer ring buffer.
+ *
+ * Exactly one thread may call push() and exactly one (other) thread may call
+ * pop(). Head and tail live on separate cache lines and each side caches the
+ * other side's index, so the common case touches no shared line at all.
+ *
+ * @tparam T The element type (cheap to copy, e.g. a pointer).
+ */
+template<typename T>
+class SpscQueue {
+public:
+    /**
+     * @brief Construct a queue.
+     * @param capacity Minimum number of elements; rounded up to a power of two.
+     */
+    explicit SpscQueue(size_t capacity = 1024) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        buffer.resize(n);
+        mask = n - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Append an element (producer side).
+     * @param item The element to append.
+     * @return False if the queue is full.
+     */
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headCache > mask) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t - headCache > mask) return false;
+        }
+        buffer[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest element (consumer side).
+     * @param item Output parameter for the element.
+     * @return False if the queue is empty.
+     */
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h == tailCache) return false;
+        }
+        item = buffer[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> buffer; ///< Ring storage.
+    size_t mask = 0;       ///< Index mask (size - 1).
+    alignas(64) std::atomic<size_t> head{0}; ///< Next slot to pop (written by the consumer).
+    size_t tailCache = 0;                    ///< Consumer's last view of `tail`.
+    alignas(64) std::atomic<size_t> tail{0}; ///< Next slot to push (written by the producer).
+    size_t headCache = 0;                    ///< Producer's last view of `head`.
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Open-addressing hash index with SIMD tag matching (Swiss-table layout).
+ *
+ * Slots are grouped by 16. Each group has a 16-byte control array holding a
+ * 7-bit tag of the key's hash for full slots, or an EMPTY/DELETED marker. A
+ * lookup loads the control bytes of one group, compares all 16 tags against
+ * the key's tag with one SSE2 compare + movemask, and only touches slots whose
+ * tag matched, so a probe usually costs one control line and one slot line
+ * even at a 90% load factor. Groups are probed quadratically and a probe
+ * stops at the first group that still has an EMPTY slot.
+ *
+ * Mapped values are stored inline; use a pointer or a 32-bit slot number to
+ * index nodes kept in a separate (pooled) node store.
+ *
+ * @tparam Key    The type of the key.
+ * @tparam Mapped The type of the mapped value.
+ * @tparam Hash   Hash functor for Key; its output is re-mixed internally.
+ */
+template<typename Key, typename Mapped, typename Hash = std::hash<Key>>
+class SwissIndex {
+public:
+    static constexpr size_t kGroupWidth = 16;
+
+    /**
+     * @brief Construct an empty index.
+     * @param maxLoad Maximum fraction of slots (full or deleted) before growing.
+     */
+    explicit SwissIndex(double maxLoad = 0.9) : maxLoadFactor(maxLoad) {
+        rehash(1);
+    }
+
+    /**
+     * @brief Find the value mapped to a key.
+     * @param key The key to look up.
+     * @return Pointer to the mapped value, or nullptr if the key is absent.
+     */
+    Mapped* find(const Key& key) {
+        size_t slot = findSlot(key, mix(key));
+        return slot == npos ? nullptr : &slots[slot].second;
+    }
+
+    /**
+     * @brief Insert a key or overwrite its mapped value.
+     * @param key The key to insert.
+     * @param mapped The value to map the key to.
+     * @return True if the key was newly inserted.
+     */
+    bool insert(const Key& key, const Mapped& mapped) {
+        size_t h = mix(key);
+        size_t slot = findSlot(key, h);
+        if (slot != npos) {
+            slots[slot].second = mapped;
+            return false;
+        }
+        if (count + deleted + 1 > growthLimit) {
+            rehash(count + 1 > growthLimit * 3 / 4 ? groupCount() * 2 : groupCount());
+        }
+        slot = findFree(h);
+        if (ctrl[slot] == kDeleted) --deleted;
+        setCtrl(slot, tagOf(h));
+        slots[slot].first = key;
+        slots[slot].second = mapped;
+        ++count;
+        return true;
+    }
+
+    /**
+     * @brief Remove a key.
+     * @param key The key to remove.
+     * @return True if the key was present.
+     */
+    bool erase(const Key& key) {
+        size_t slot = findSlot(key, mix(key));
+        if (slot == npos) return false;
+        // A slot may only become EMPTY again if its group never filled up;
+        // otherwise probes that passed through it would stop too early.
+        size_t groupStart = slot & ~(kGroupWidth - 1);
+        bool groupHasEmpty = matchEmpty(groupStart) != 0;
+        setCtrl(slot, groupHasEmpty ? kEmpty : kDeleted);
+        if (!groupHasEmpty) ++deleted;
+        slots[slot] = std::pair<Key, Mapped>();
+        --count;
+        return true;
+    }
+
+    /**
+     * @brief Prefetch the control group a key's probe starts at.
+     *
+     * Lets batched lookups overlap the cache misses of several keys.
+     *
+     * @param key The key about to be looked up.
+     */
+    void prefetch(const Key& key) const {
+        size_t group = (mix(key) >> 7) & groupMask;
+        __builtin_prefetch(ctrl.data() + group * kGroupWidth);
+        __builtin_prefetch(slots.data() + group * kGroupWidth);
+    }
+
+    /**
+     * @brief Make room for at least n keys without growing.
+     * @param n The expected number of keys.
+     */
+    void reserve(size_t n) {
+        size_t groups = 1;
+        while (groups * kGroupWidth * maxLoadFactor < n + 1) groups <<= 1;
+        if (groups > groupCount()) rehash(groups);
+    }
+
+    /**
+     * @brief Visit every key and mapped value.
+     * @param f Callable invoked as f(const Key&, Mapped&).
+     */
+    template<typename F>
+    void forEach(F&& f) {
+        for (size_t i = 0; i < ctrl.size(); ++i) {
+            if (isFull(ctrl[i])) f(slots[i].first, slots[i].second);
+        }
+    }
+
+    /**
+     * @brief Number of keys stored.
+     */
+    size_t size() const { return count; }
+
+    /**
+     * @brief Number of slots (16 per group).
+     */
+    size_t capacity() const { return ctrl.size(); }
+
+private:
+    static constexpr int8_t kEmpty = static_cast<int8_t>(0x80);
+    static constexpr int8_t kDeleted = static_cast<int8_t>(0xFE);
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    std::vector<int8_t> ctrl;                   ///< One control byte per slot.
+    std::vector<std::pair<Key, Mapped>> slots;  ///< Key and mapped value per slot.
+    size_t groupMask = 0;                       ///< groupCount() - 1.
+    size_t count = 0;                           ///< Full slots.
+    size_t deleted = 0;                         ///< DELETED slots.
+    size_t growthLimit = 0;                     ///< Max full + deleted slots before growing.
+    double maxLoadFactor;                       ///< Load factor that triggers growth.
+
+    size_t groupCount() const { return groupMask + 1; }
+    static bool isFull(int8_t c) { return c >= 0; }
+    static int8_t tagOf(size_t h) { return static_cast<int8_t>(h & 0x7F); }
+    void setCtrl(size_t slot, int8_t c) { ctrl[slot] = c; }
+
+    /**
+     * @brief Hash a key and spread the bits (std::hash is the identity for integers).
+     */
+    static size_t mix(const Key& key) {
+        uint64_t h = static_cast<uint64_t>(Hash()(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    /**
+     * @brief Bitmask of the slots in a group whose control byte equals `tag`.
+     */
+    uint32_t match(size_t groupStart, int8_t tag) const {
+#if defined(__SSE2__)
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl.data() + groupStart));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(tag))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i) {
+            if (ctrl[groupStart + i] == tag) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    uint32_t matchEmpty(size_t groupStart) const { return match(groupStart, kEmpty); }
+
+    /**
+     * @brief Bitmask of the EMPTY or DELETED slots in a group.
+     */
+    uint32_t matchFree(size_t groupStart) const {
+#if defined(__SSE2__)
+        // Both markers have the sign bit set; full slots do not.
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl.data() + groupStart));
+        return static_cast<uint32_t>(_mm_movemask_epi8(c));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i) {
+            if (!isFull(ctrl[groupStart + i])) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    /**
+     * @brief Slot holding a key, or npos.
+     */
+    size_t findSlot(const Key& key, size_t h) const {
+        int8_t tag = tagOf(h);
+        size_t group = (h >> 7) & groupMask;
+        for (size_t step = 0; step <= groupMask; ++step) {
+            size_t start = group * kGroupWidth;
+            for (uint32_t m = match(start, tag); m != 0; m &= m - 1) {
+                size_t slot = start + static_cast<size_t>(__builtin_ctz(m));
+                if (slots[slot].first == key) return slot;
+            }
+            if (matchEmpty(start) != 0) return npos;
+            group = (group + step + 1) & groupMask;
+        }
+        return npos;
+    }
+
+    /**
+     * @brief First EMPTY or DELETED slot on a hash's probe sequence.
+     */
+    size_t findFree(size_t h) const {
+        size_t group = (h >> 7) & groupMask;
+        for (size_t step = 0;; ++step) {
+            size_t start = group * kGroupWidth;
+            uint32_t m = matchFree(start);
+            if (m != 0) return start + static_cast<size_t>(__builtin_ctz(m));
+            group = (group + step + 1) & groupMask;
+        }
+    }
+
+    /**
+     * @brief Rebuild the table with a given number of groups, dropping tombstones.
+     */
+    void rehash(size_t groups) {
+        std::vector<int8_t> oldCtrl(groups * kGroupWidth, kEmpty);
+        std::vector<std::pair<Key, Mapped>> oldSlots(groups * kGroupWidth);
+        oldCtrl.swap(ctrl);
+        oldSlots.swap(slots);
+        groupMask = groups - 1;
+        growthLimit = static_cast<size_t>(ctrl.size() * maxLoadFactor);
+        if (growthLimit >= ctrl.size()) growthLimit = ctrl.size() - 1;
+        deleted = 0;
+        for (size_t i = 0; i < oldCtrl.size(); ++i) {
+            if (!isFull(oldCtrl[i])) continue;
+            size_t h = mix(oldSlots[i].first);
+            size_t slot = findFree(h);
+            setCtrl(slot, tagOf(h));
+            slots[slot] = std::move(oldSlots[i]);
+        }
+    }
+};
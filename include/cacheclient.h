@@ -0,0 +1,324 @@
+#ifndef CACHE_CLIENT_H
+#define CACHE_CLIENT_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include <etcd/Client.hpp>
+
+#include "cache.grpc.pb.h"
+#include "cache.pb.h"
+#include "include/Cache.h"
+#include "include/cacheentry.h"
+#include "include/consistentHash.h"
+
+/**
+ * @brief Configuration options for a CacheClient.
+ */
+struct ClientOptions {
+    std::vector<std::string> etcd_endpoints; ///< List of etcd server endpoints for service discovery.
+    std::chrono::milliseconds refresh_interval; ///< How often the node list is re-read from etcd.
+    std::chrono::milliseconds timeout; ///< Deadline of each call, including the node's load on a miss.
+    bool local_transport; ///< Dial nodes on this host over their Unix domain socket (see LocalTarget).
+    size_t near_cache_capacity; ///< Entries held in the near cache (0 = no near cache).
+    std::string near_cache_policy; ///< Policy spec of the near cache, e.g. "lru" or "lfu" (see PolicySpec).
+    std::chrono::milliseconds near_cache_ttl; ///< How long a near-cached value is served before it is read again.
+
+    /**
+     * @brief Default constructor with sensible default values.
+     */
+    ClientOptions()
+        : etcd_endpoints({"http://127.0.0.1:2379"}),
+          refresh_interval(std::chrono::seconds(1)),
+          timeout(std::chrono::seconds(3)),
+          local_transport(true),
+          near_cache_capacity(0),
+          near_cache_policy("lru"),
+          near_cache_ttl(std::chrono::seconds(1)) {}
+};
+
+/**
+ * @brief Cache client that routes every call straight to the key's owner.
+ *
+ * Applications linking the client skip the HTTP gateway: the client reads
+ * the registered nodes from etcd, places them on the same consistent hash
+ * ring as the nodes' PeerPicker, and sends each call to the node owning
+ * the key, so a call is one hop instead of two or three.
+ *
+ * Each node gets one persistent channel, and calls use gRPC's callback
+ * API: any number of calls are in flight on a channel at once (pipelined
+ * over HTTP/2) and no thread blocks on them. The *Async methods expose this
+ * directly; the plain methods wait for one call. MultiGet and MultiSet
+ * route a batch of keys with one consistentHash::GetBatch() and send each
+ * node one batched call with the keys it owns, issuing every node's call
+ * before waiting for any.
+ *
+ * An optional near cache keeps recently read values in the process for
+ * `near_cache_ttl`. Values written through this client are dropped from it
+ * at once; writes by other clients are seen after at most the TTL. A read
+ * that races with a write through this client never fills the near cache.
+ *
+ * Values are bytes; calls to groups of other types fail with INTERNAL.
+ * Thread-safe.
+ */
+class CacheClient {
+public:
+    using GetCallback = std::function<void(const grpc::Status&, std::optional<std::string>)>; ///< Completion of GetAsync().
+    using DoneCallback = std::function<void(const grpc::Status&)>; ///< Completion of a write.
+    using IncrCallback = std::function<void(const grpc::Status&, const cache::IncrResponse&)>; ///< Completion of IncrAsync().
+
+    /**
+     * @brief Construct a client and read the current nodes.
+     *
+     * @param service_name The name the cache nodes register under in etcd.
+     * @param options Configuration options for the client (defaults to ClientOptions()).
+     * @throws std::runtime_error If the nodes cannot be read from etcd.
+     * @throws std::invalid_argument If `near_cache_policy` does not parse.
+     */
+    CacheClient(const std::string& service_name, const ClientOptions& options = ClientOptions());
+
+    /**
+     * @brief Stop discovery and wait for the calls in flight.
+     */
+    ~CacheClient();
+
+    /**
+     * @brief Get a value, from the near cache if it holds the key.
+     *
+     * @param group The name of the group.
+     * @param key The key to look up.
+     * @param status Optional output parameter for the call status.
+     * @return The value, or std::nullopt if the call failed.
+     */
+    std::optional<std::string> Get(const std::string& group, const std::string& key, grpc::Status* status = nullptr);
+
+    /**
+     * @brief Store a value at the key's owner.
+     *
+     * @return The call status.
+     */
+    grpc::Status Set(const std::string& group, const std::string& key, const std::string& value);
+
+    /**
+     * @brief Delete a key at its owner.
+     *
+     * @return The call status.
+     */
+    grpc::Status Delete(const std::string& group, const std::string& key);
+
+    /**
+     * @brief Add to a counter at its owner.
+     *
+     * @param request The increment.
+     * @param response Receives the counter after the increment.
+     * @return The call status.
+     */
+    grpc::Status Incr(const cache::IncrRequest& request, cache::IncrResponse* response);
+
+    /**
+     * @brief Get several keys of a group, with one call per node, all in flight at once.
+     *
+     * Near-cached keys are answered locally, and a key listed twice is
+     * fetched once.
+     *
+     * @param group The name of the group.
+     * @param keys The keys to look up.
+     * @param statuses Optional output parameter for each key's status, in the order of `keys`.
+     * @return Each key's value, or std::nullopt where its call failed, in the order of `keys`.
+     */
+    std::vector<std::optional<std::string>> MultiGet(const std::string& group, const std::vector<std::string>& keys,
+                                                     std::vector<grpc::Status>* statuses = nullptr);
+
+    /**
+     * @brief Store several values of a group, with one call per node, all in flight at once.
+     *
+     * @param group The name of the group.
+     * @param entries Key-value pairs to store.
+     * @return OK, or the status of the first write that failed.
+     */
+    grpc::Status MultiSet(const std::string& group, const std::vector<std::pair<std::string, std::string>>& entries);
+
+    /**
+     * @brief Get a value without blocking.
+     *
+     * @param done Called with the status and the value, on a gRPC thread
+     *             (or on the calling thread for a near-cache hit or a routing failure).
+     */
+    void GetAsync(const std::string& group, const std::string& key, GetCallback done);
+
+    /**
+     * @brief Store a value without blocking.
+     *
+     * @param done Called with the status, like GetAsync()'s callback; may be empty.
+     */
+    void SetAsync(const std::string& group, const std::string& key, const std::string& value, DoneCallback done);
+
+    /**
+     * @brief Delete a key without blocking.
+     *
+     * @param done Called with the status, like GetAsync()'s callback; may be empty.
+     */
+    void DeleteAsync(const std::string& group, const std::string& key, DoneCallback done);
+
+    /**
+     * @brief Add to a counter at its owner without blocking.
+     *
+     * @param done Called with the status and the counter after the increment, like GetAsync()'s callback; may be empty.
+     */
+    void IncrAsync(const cache::IncrRequest& request, IncrCallback done);
+
+    /**
+     * @brief Number of nodes currently known.
+     */
+    size_t NodeCount();
+
+private:
+    /**
+     * @brief A cache node and its persistent channel.
+     */
+    struct Node {
+        std::string addr; ///< The node's registered address.
+        std::shared_ptr<grpc::Channel> channel; ///< Channel kept open for the node's lifetime in the ring.
+        std::unique_ptr<cache::Cache::Stub> stub; ///< Stub on `channel`.
+    };
+
+    /// Completion of one key of a batched call: the key's position in the batch, its status and value.
+    using KeyCallback = std::function<void(size_t, const grpc::Status&, std::optional<std::string>)>;
+
+    /**
+     * @brief Connect to a node.
+     */
+    std::shared_ptr<Node> Dial(const std::string& addr);
+
+    /**
+     * @brief The node owning a key, or nullptr if none is known.
+     */
+    std::shared_ptr<Node> Route(const std::string& key);
+
+    /**
+     * @brief The node owning each key, in order (nullptr if none is known).
+     */
+    std::vector<std::shared_ptr<Node>> RouteBatch(const std::vector<std::string>& keys);
+
+    /**
+     * @brief Positions of routed keys, grouped by their node (nullptr for keys without one).
+     */
+    static std::vector<std::pair<std::shared_ptr<Node>, std::vector<size_t>>> GroupByNode(
+        const std::vector<std::shared_ptr<Node>>& nodes);
+
+    /**
+     * @brief Send a Get to a node and fill the near cache with the answer.
+     *
+     * @param node The key's owner; a null node fails the call with UNAVAILABLE.
+     */
+    void IssueGet(std::shared_ptr<Node> node, const std::string& group, const std::string& key, GetCallback done);
+
+    /**
+     * @brief Send a Set to a node, dropping the key from the near cache before and after.
+     *
+     * @param node The key's owner; a null node fails the call with UNAVAILABLE.
+     */
+    void IssueSet(std::shared_ptr<Node> node, const std::string& group, const std::string& key,
+                  const std::string& value, DoneCallback done);
+
+    /**
+     * @brief Send a node one MultiGet for keys it owns and fill the near cache with the answers.
+     *
+     * @param node The keys' owner; a null node fails every key with UNAVAILABLE.
+     * @param done Called once per key.
+     */
+    void IssueMultiGet(std::shared_ptr<Node> node, const std::string& group, const std::vector<std::string>& keys,
+                       KeyCallback done);
+
+    /**
+     * @brief Send a node one MultiSet for entries it owns, dropping their keys from the near cache before and after.
+     *
+     * @param node The keys' owner; a null node fails the call with UNAVAILABLE.
+     * @param entries The entries, of which `which` are sent.
+     * @param done Called with OK, or the status of the call or of its first entry that failed.
+     */
+    void IssueMultiSet(std::shared_ptr<Node> node, const std::string& group,
+                       const std::vector<std::pair<std::string, std::string>>& entries,
+                       const std::vector<size_t>& which, DoneCallback done);
+
+    /**
+     * @brief Re-read the nodes from etcd and update the ring.
+     *
+     * @return True if etcd answered.
+     */
+    bool Refresh();
+
+    /**
+     * @brief Refresh every `refresh_interval`, or sooner after a node was unreachable, until stopped.
+     */
+    void DiscoveryLoop();
+
+    /**
+     * @brief Note that a call failed; an unreachable node triggers an early refresh.
+     */
+    void OnFailure(const grpc::Status& status);
+
+    /**
+     * @brief Key of (group, key) in the near cache.
+     */
+    static std::string NearKey(const std::string& group, const std::string& key);
+
+    /**
+     * @brief Write counter of the stripe a near-cache key belongs to.
+     */
+    std::atomic<uint64_t>& NearStripe(const std::string& nearKey);
+
+    /**
+     * @brief Look a key up in the near cache, dropping it if it expired.
+     */
+    bool NearGet(const std::string& nearKey, std::string& value);
+
+    /**
+     * @brief Fill the near cache unless a write to the key's stripe started after `stamp` was read.
+     */
+    void NearPut(const std::string& nearKey, const std::string& value, uint64_t stamp);
+
+    /**
+     * @brief Drop a key from the near cache around a write; called when the write starts and when it ends.
+     */
+    void NearInvalidate(const std::string& nearKey);
+
+    /**
+     * @brief Deadline of a call started now.
+     */
+    std::chrono::system_clock::time_point Deadline() const {
+        return std::chrono::system_clock::now() + options_.timeout;
+    }
+
+    static constexpr size_t kNearStripes = 64; ///< Write counters guarding near-cache fills.
+
+    std::string service_name_; ///< The service name the nodes register under.
+    ClientOptions options_; ///< Configuration options for this client.
+    std::shared_ptr<etcd::Client> etcd_client_; ///< etcd client for service discovery.
+    consistentHash ring_; ///< The cluster ring, as in the nodes' PeerPicker (see consistentHash()).
+    std::shared_mutex mtx_; ///< Guards `nodes_`.
+    std::unordered_map<std::string, std::shared_ptr<Node>> nodes_; ///< Node address -> node.
+    std::unique_ptr<Cache<std::string, CacheEntry<std::string>>> near_; ///< Near cache, or null.
+    std::array<std::atomic<uint64_t>, kNearStripes> nearWrites_{}; ///< Writes started per stripe of keys.
+    std::atomic<size_t> inFlight_{0}; ///< Calls whose callback has not run yet.
+    std::mutex discoveryMtx_; ///< Guards `stopping_` and `refreshNow_`.
+    std::condition_variable discoveryCv_; ///< Wakes the discovery thread.
+    bool stopping_ = false; ///< The destructor is running.
+    bool refreshNow_ = false; ///< A node was unreachable; refresh before the interval ends.
+    std::thread discovery_thread_; ///< Thread running DiscoveryLoop().
+};
+
+#endif // CACHE_CLIENT_H
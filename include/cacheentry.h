@@ -0,0 +1,97 @@
+#ifndef CACHE_ENTRY_H
+#define CACHE_ENTRY_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_set>
+
+/**
+ * @brief A cached value with its expiry deadline, recompute cost and generation stamp.
+ *
+ * @tparam Value The cache value type.
+ */
+template<typename Value>
+struct CacheEntry {
+    Value value;                ///< The cached value.
+    int64_t expiry = 0;         ///< Deadline in steady_clock nanoseconds (0 = never expires).
+    float delta = 0;            ///< Time the value took to compute, in nanoseconds.
+    uint64_t generation = 0;    ///< Generations::Stamp() from before the value was read.
+};
+
+/**
+ * @brief Probabilistic early expiration ("XFetch", Vattani et al., VLDB 2015).
+ *
+ * A read at time `now` recomputes early when
+ * `now - delta * beta * ln(rand()) >= expiry`, with rand() uniform in (0, 1].
+ * The chance is negligible while the deadline is far away compared with the
+ * recompute cost and rises to certainty at the deadline, so the readers of a
+ * hot key trigger about one refresh shortly before it expires instead of
+ * all missing together after it does. Entries that are expensive to
+ * recompute (large delta) start refreshing earlier; beta > 1 favours
+ * earlier refreshes, beta < 1 later ones.
+ */
+struct XFetch {
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief The current time in the units of CacheEntry::expiry.
+     */
+    static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Whether a read of an unexpired entry should start a refresh.
+     *
+     * @param expiry The entry's deadline (non-zero).
+     * @param delta The entry's recompute cost in nanoseconds.
+     * @param beta Eagerness factor (0 disables early refreshes).
+     * @param now The current time.
+     */
+    static bool RefreshEarly(int64_t expiry, float delta, double beta, int64_t now) {
+        if (delta <= 0 || beta <= 0) {
+            return false;
+        }
+        thread_local std::mt19937_64 rng{std::random_device{}()};
+        double uniform = 1.0 - std::generate_canonical<double, 53>(rng); // (0, 1]
+        return now - delta * beta * std::log(uniform) >= static_cast<double>(expiry);
+    }
+};
+
+/**
+ * @brief Keys with an early refresh in flight, so a key is refreshed at most once at a time.
+ *
+ * Near its deadline every read of a hot key may start a refresh; all but
+ * the first are dropped here instead of each queueing a load.
+ */
+class RefreshSet {
+public:
+    /**
+     * @brief Claim a key for a refresh.
+     *
+     * @return True if the caller should refresh it and End() it afterwards,
+     *         false if a refresh of the key is already running.
+     */
+    bool Begin(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return keys_.insert(key).second;
+    }
+
+    /**
+     * @brief Release a key claimed by Begin().
+     */
+    void End(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        keys_.erase(key);
+    }
+
+private:
+    std::mutex mtx_;                       ///< Guards `keys_`.
+    std::unordered_set<std::string> keys_; ///< Keys being refreshed.
+};
+
+#endif // CACHE_ENTRY_H
@@ -1,34 +1,42 @@
 #ifndef CACHE_GROUP_H
 #define CACHE_GROUP_H
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <exception>
 #include <functional>
+#include <future>
 #include <memory>
+#include <optional>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <unordered_map>
+#include <vector>
 #include <mutex>
 #include <shared_mutex>
+#include <stdexcept>
 
-#include "include/Lru.h"
+#include "include/CachePolicy.h"
+#include "include/ShardsSampler.h"
+#include "include/cacheentry.h"
+#include "include/countercodec.h"
+#include "include/generations.h"
+#include "include/groupregistry.h"
+#include "include/keyedqueue.h"
+#include "include/leasetable.h"
+#include "include/memorygovernor.h"
 #include "include/peer.h"
+#include "include/readsections.h"
+#include "include/removalqueue.h"
 #include "include/singleflight.h"
-
-/**
- * @brief Synchronization operation types for cache broadcasting.
- */
-enum class Sync {
-    SET,    ///< Set operation - add or update a key-value pair.
-    DELETE  ///< Delete operation - remove a key-value pair.
-};
-
-// Forward declaration
-template<typename Value>
-class CacheGroup;
-
-std::unordered_map<std::string, CacheGroup<google::protobuf::Any>> cacheGroups;
-std::mutex cacheGroupsMutex;
+#include "include/taskscheduler.h"
+#include "include/tracing.h"
+#include "include/wirecodec.h"
+#include "include/writebehind.h"
 
 /**
  * @brief Distributed cache group with peer synchronization and service discovery.
@@ -37,109 +45,144 @@ std::mutex cacheGroupsMutex;
  * using etcd for service discovery. It provides automatic cache miss handling,
  * peer selection, and data synchronization across multiple cache instances.
  *
+ * Each group is a MemoryTenant of the node's MemoryGovernor. Its byte usage
+ * is estimated as entries times a moving average of the stored entry size;
+ * a hard quota is enforced on every store, a soft quota sets the group's
+ * fair share of the node limit.
+ *
+ * With a TTL set (SetTtl()), entries expire and reads refresh them early
+ * with probability rising toward the deadline (see XFetch), so a hot key is
+ * reloaded in the background by one reader instead of missing everywhere
+ * at once when it expires.
+ *
+ * In write-behind mode (EnableWriteBehind()), the owner of a key queues
+ * client writes for a batch writer instead of leaving persistence to the
+ * caller. Until a write is flushed, the owner answers loads of the key from
+ * the write-behind buffer, so evicting a dirty entry loses nothing.
+ *
+ * Invalidate() drops every key under a prefix, or the whole group, in O(1):
+ * it bumps a generation (see Generations) that entries are checked against
+ * when read, and sends one Invalidate RPC per peer instead of a Delete per
+ * key.
+ *
+ * Incr and CompareAndSet are read-modify-writes run at the key's owner
+ * under the key's lease shard lock, which every client write of the key
+ * takes, so concurrent counters and CAS loops need no client retries on a
+ * race. A key the owner does not cache starts from its pending write-behind
+ * value or the loader's. Non-owners forward them and drop their own copy of
+ * the key.
+ *
+ * The group listens to its cache's removals (RemovalListener). Entries
+ * leaving it are queued to a RemovalQueue and passed to the listeners added
+ * with AddRemovalListener() on the scheduler's background lane; values of
+ * kDeferDestroyBytes or more are queued even without listeners, so they are
+ * freed there rather than on the request thread.
+ *
+ * Groups live in the GroupRegistry and never move; request handlers reach
+ * them through CacheGroupBase, which encodes values with WireCodec<Value>.
+ *
  * @tparam Value The type of the cache value.
  */
 template<typename Value>
-class CacheGroup {
+class CacheGroup : public CacheGroupBase, public MemoryTenant, public RemovalListener<std::string, CacheEntry<Value>> {
 public:
+    using Entry = CacheEntry<Value>;
+
+    /**
+     * @brief Outcome of a load shared by the callers of one flight.
+     */
+    struct Loaded {
+        grpc::Status status;          ///< OK, NOT_FOUND, the owner's error, or INTERNAL if the loader threw.
+        std::optional<Value> value;   ///< The value, if the status is OK.
+        uint64_t ttlMs = 0;           ///< Time the value has left at the owner in ms (0 = no expiry or unknown).
+        bool stored = false;          ///< This node loaded the value as owner and already stored it.
+    };
+
     /**
      * @brief Construct a CacheGroup with distributed cache capabilities.
      * 
      * @param groupName The name identifier for this cache group.
-     * @param cacheMissHandler Function called when a key is not found locally or in peers.
+     * @param cacheMissHandler Function called when a key is not found locally or in peers; returns nullopt if the backing store has no value either.
      * @param etcdServiceName The prefix for service registration in etcd.
      * @param etcdKey The specific key for this cache instance in etcd.
      * @param etcdEndpoints Comma-separated list of etcd endpoints.
+     * @param policy Replacement policy and capacity of the local cache (capacity 0 = kDefaultCapacity).
      */
-    CacheGroup(std::string groupName, std::function<Value(const std::string&)> cacheMissHandler, std::string etcdServiceName, std::string etcdKey, std::string etcdEndpoints)
-        : groupName_(groupName),
+    CacheGroup(std::string groupName, std::function<std::optional<Value>(const std::string&)> cacheMissHandler, std::string etcdServiceName, std::string etcdKey, std::string etcdEndpoints, const PolicySpec& policy = PolicySpec())
+        : capacity_(policy.capacity ? policy.capacity : kDefaultCapacity),
+          groupName_(groupName),
           cacheMissHandler_(cacheMissHandler),
           isClosed_(false),
           etcdServiceName_(etcdServiceName),
           etcdKey_(etcdKey),
           etcdEndpoints_(etcdEndpoints) {
-        cache_ = std::make_unique<Lru<std::string, Value>>();
+        policy_ = policy.withCapacity(capacity_);
+        auto cache = makeCache<std::string, Entry>(policy_);
+        cache->setRemovalListener(this);
+        cache_.store(cache.release());
+        sampler_ = std::make_unique<ShardsSampler>();
         peerPicker_ = std::make_unique<PeerPicker>(etcdServiceName, etcdKey, etcdEndpoints);
+        governor_->Register(this);
     }
 
-    /**
-     * @brief Move constructor for CacheGroup.
-     * 
-     * @param other The CacheGroup to move from.
-     */
-    CacheGroup(const CacheGroup&& other) noexcept {
-        groupName_ = std::move(other.groupName_);
-        cacheMissHandler_ = std::move(other.cacheMissHandler_);
-        isClosed_ = other.isClosed_;
-        etcdServiceName_ = other.etcdServiceName_;
-        etcdKey_ = other.etcdKey_;
-        etcdEndpoints_ = other.etcdEndpoints_;
-        cache_ = std::move(other.cache_);
-        peerPicker_ = std::move(other.peerPicker_);
-    }
+    CacheGroup(const CacheGroup&) = delete;
+    CacheGroup& operator=(const CacheGroup&) = delete;
 
     /**
-     * @brief Move assignment operator for CacheGroup.
+     * @brief Stop being accounted by the memory governor, then wait for the group's queued tasks.
      * 
-     * @param other The CacheGroup to move from.
-     * @return Reference to this CacheGroup.
+     * Loads, refreshes, replications (with their retry timers) and
+     * broadcasts hold a token of `tasks_`, so none of them runs on a
+     * destroyed group.
      */
-    CacheGroup& operator=(const CacheGroup&& other) noexcept {
-        if (this != &other) {
-            groupName_ = std::move(other.groupName_);
-            cacheMissHandler_ = std::move(other.cacheMissHandler_);
-            isClosed_ = other.isClosed_;
-            etcdServiceName_ = other.etcdServiceName_;
-            etcdKey_ = other.etcdKey_;
-            etcdEndpoints_ = other.etcdEndpoints_;
-            cache_ = std::move(other.cache_);
-            peerPicker_ = std::move(other.peerPicker_);
+    ~CacheGroup() override {
+        governor_->Unregister(this);
+        tasks_.Wait();
+        for (auto* cache : retired_) {
+            delete cache;
         }
-        return *this;
+        delete previous_.load();
+        delete cache_.load();
     }
 
     /**
      * @brief Create or retrieve a CacheGroup instance.
      * 
-     * This static method implements a singleton pattern for CacheGroup instances,
-     * ensuring only one CacheGroup exists per group name.
+     * Only one group exists per name, whatever its value type; see GroupRegistry.
      * 
      * @param groupName The name identifier for the cache group.
-     * @param cacheMissHandler Function to handle cache misses.
+     * @param cacheMissHandler Function to handle cache misses; returns nullopt for keys the backing store lacks.
      * @param etcdServiceName The etcd service prefix.
      * @param etcdKey The etcd service key.
      * @param etcdEndpoints The etcd endpoints.
+     * @param policy Replacement policy and capacity of the local cache (see parsePolicySpec()).
      * @return Reference to the CacheGroup instance.
+     * @throws std::invalid_argument If the name is taken by a group of another value type.
      */
     static CacheGroup& CreateCacheGroup(const std::string& groupName, 
-                                    std::function<Value(const std::string&)> cacheMissHandler, 
+                                    std::function<std::optional<Value>(const std::string&)> cacheMissHandler, 
                                     const std::string& etcdServiceName, 
                                     const std::string& etcdKey, 
-                                    const std::string& etcdEndpoints) {
-        std::lock_guard<std::mutex> lock(cacheGroupsMutex);
-        auto it = cacheGroups.find(groupName);
-        if (it != cacheGroups.end()) {
-            return it->second;
+                                    const std::string& etcdEndpoints,
+                                    const PolicySpec& policy = PolicySpec()) {
+        auto* group = GroupRegistry::Instance().Add(groupName, [&]() -> std::unique_ptr<CacheGroupBase> {
+            return std::make_unique<CacheGroup>(groupName, cacheMissHandler, etcdServiceName, etcdKey, etcdEndpoints, policy);
+        });
+        auto* typed = dynamic_cast<CacheGroup*>(group);
+        if (!typed) {
+            throw std::invalid_argument("Cache group " + groupName + " already exists with another value type");
         }
-
-        auto [iter, success] = cacheGroups.emplace(groupName, 
-                                                   CacheGroup(groupName, cacheMissHandler, etcdServiceName, etcdKey, etcdEndpoints));
-        return iter->second;
+        return *typed;
     } 
 
     /**
      * @brief Retrieve an existing CacheGroup by name.
      * 
      * @param groupName The name of the cache group to retrieve.
-     * @return Pointer to the CacheGroup if found, nullptr otherwise.
+     * @return Pointer to the CacheGroup if found with this value type, nullptr otherwise.
      */
     static CacheGroup* GetCacheGroup(const std::string& groupName) {
-        std::lock_guard<std::mutex> lock(cacheGroupsMutex);
-        auto it = cacheGroups.find(groupName);
-        if (it != cacheGroups.end()) {
-            return &it->second;
-        }
-        return nullptr;
+        return GroupRegistry::Instance().Find<CacheGroup>(groupName);
     }
 
     /**
@@ -152,14 +195,196 @@ public:
      * @return Optional containing the value if found, empty otherwise.
      */
     std::optional<Value> Get(const std::string& key) {
-        auto res = cache_->get(key);
-        if(res) {
-            return res;
+        Span span("group.get");
+        Entry res;
+        bool hit = Lookup(key, res);
+        RecordAccess(key, hit);
+        if(hit) {
+            span.SetAttribute("result", "hit");
+            return std::move(res.value);
         }
+        span.SetAttribute("result", "miss");
 
         return LoadFromPeer(key);
     }
 
+    /**
+     * @brief Count a lookup and feed it to the working-set estimator.
+     * 
+     * Called by Get(), and by request paths that serve the group from their
+     * own storage (e.g. thread-per-core shards).
+     * 
+     * @param key The key looked up.
+     * @param hit Whether the lookup hit.
+     */
+    void RecordAccess(const std::string& key, bool hit) override {
+        (hit ? hits_ : misses_).fetch_add(1, std::memory_order_relaxed);
+        uint64_t hash = ShardsSampler::sampleHash(key);
+        sampler_->access(key, hash);
+        if (tuning_.load(std::memory_order_acquire) && tuner_->record(hash)) {
+            DrainTuner();
+        }
+    }
+
+    bool SamplesKey(const std::string& key) override {
+        return sampler_->sampled(key) || (tuning_.load(std::memory_order_acquire) && tuner_->sampled(key));
+    }
+
+    void RecordAccesses(const std::vector<std::string>& sampled, uint64_t hits, uint64_t misses) override {
+        hits_.fetch_add(hits, std::memory_order_relaxed);
+        misses_.fetch_add(misses, std::memory_order_relaxed);
+        sampler_->access(sampled, hits + misses);
+        if (tuning_.load(std::memory_order_acquire) && tuner_->record(sampled)) {
+            DrainTuner();
+        }
+    }
+
+    /**
+     * @brief Replace the local cache with one running another policy.
+     * 
+     * The new cache starts empty and is published at once. Until it has
+     * absorbed `capacity_` misses, misses also probe the previous cache and
+     * move hits over, so the hit ratio does not collapse during the switch.
+     * Caches are published as raw pointers read inside `reads_` sections, so
+     * a Get pays no reference count; the retired cache is freed on the
+     * background lane once every section that could still hold it has ended,
+     * however long a reader stalls.
+     * 
+     * @param spec The policy to run; its capacity is ignored in favour of the group's.
+     */
+    void SetPolicy(const PolicySpec& spec) {
+        std::lock_guard<std::mutex> lock(policyMutex_);
+        PolicySpec next = spec.withCapacity(capacity_);
+        if (next.name() != policy_.name()) {
+            auto cache = makeCache<std::string, Entry>(next);
+            cache->setRemovalListener(this);
+            RetirePreviousLocked();
+            migrationMisses_.store(0, std::memory_order_relaxed);
+            previous_.store(cache_.load());
+            cache_.store(cache.release());
+            spdlog::info("Cache group {} switched policy {} -> {}", groupName_, policy_.name(), next.name());
+            policy_ = next;
+        }
+        if (tuner_) {
+            tuner_->switched(policy_);
+        }
+    }
+
+    /**
+     * @brief Start shadow-simulating alternative policies and switch to the best one.
+     * 
+     * See PolicyTuner for how candidates are scored and when a switch is made;
+     * requests only queue sampled keys, and the simulators and switches run
+     * on the scheduler's background lane. In thread-per-core mode
+     * the per-core shards keep their LRU engines and only the group's own
+     * cache is switched.
+     * 
+     * @param options Tuning parameters.
+     */
+    void EnableAutoTuning(TunerOptions options = TunerOptions()) {
+        std::lock_guard<std::mutex> lock(policyMutex_);
+        if (tuner_) {
+            return;
+        }
+        tuner_ = std::make_unique<PolicyTuner>(policy_, std::vector<PolicySpec>{}, options);
+        tuning_.store(true, std::memory_order_release);
+        spdlog::info("Cache group {} auto-tuning from {} at sample rate {}", groupName_, policy_.name(),
+                     tuner_->sampleRate());
+    }
+
+    /**
+     * @brief Persist client writes through a batch writer (write-behind).
+     * 
+     * Sets and Deletes of keys this node owns are coalesced per key and
+     * passed to `writer` every `options.interval` or once `options.batchSize`
+     * keys are dirty; see WriteBehind. Writes replicated from other nodes
+     * reach the owner through its Set RPC, so each key is written by one node.
+     * 
+     * @param writer Writes a batch of (key, value or nullopt for a deletion); false to retry.
+     * @param options Flush interval and batch size.
+     */
+    void EnableWriteBehind(typename WriteBehind<Value>::BatchWriter writer,
+                           WriteBehindOptions options = WriteBehindOptions()) {
+        std::lock_guard<std::mutex> lock(policyMutex_);
+        if (writeBehind_) {
+            return;
+        }
+        writeBehind_ = std::make_unique<WriteBehind<Value>>(std::move(writer), options, *scheduler_);
+        writingBehind_.store(true, std::memory_order_release);
+        spdlog::info("Cache group {} writing behind every {} ms or {} keys", groupName_, options.interval.count(),
+                     options.batchSize);
+    }
+
+    /**
+     * @brief Write all dirty keys to the backing store now.
+     * 
+     * @return True if nothing is left dirty (or write-behind is off).
+     */
+    bool FlushWrites() {
+        return !writingBehind_.load(std::memory_order_acquire) || writeBehind_->Flush();
+    }
+
+    /**
+     * @brief Call a function for every entry that leaves the local cache.
+     * 
+     * Runs on the scheduler's background lane, after the removal; the cause
+     * is SIZE (evicted or reclaimed), EXPIRED (removed after its TTL, see
+     * SetTtl()), EXPLICIT (deleted or invalidated) or REPLACED (overwritten by a Set).
+     * Entries of the cache replaced by a policy switch are not reported.
+     * 
+     * @param listener Called with the key, the removed value and the cause.
+     */
+    void AddRemovalListener(typename RemovalQueue<Value>::Listener listener) {
+        removals_.AddListener(std::move(listener));
+    }
+
+    /**
+     * @brief Queue an entry removed from the local cache; called under the policy's lock.
+     */
+    void onRemoval(const std::string& key, Entry&& entry, RemovalCause cause) override {
+        if (cause != RemovalCause::REPLACED && entry.expiry != 0 && entry.expiry <= XFetch::Now()) {
+            cause = RemovalCause::EXPIRED;
+        }
+        if (removals_.Listening() || EntryBytes(key, entry.value) >= kDeferDestroyBytes) {
+            removals_.Push(key, std::move(entry.value), cause);
+        }
+    }
+
+    /**
+     * @brief The replacement policy of the local cache.
+     */
+    PolicySpec GetPolicy() {
+        std::lock_guard<std::mutex> lock(policyMutex_);
+        return policy_;
+    }
+
+    /**
+     * @brief Snapshot hit counters, working-set size and the miss-ratio curve.
+     * 
+     * @return The group's statistics.
+     */
+    GroupStats GetStats() override {
+        GroupStats stats;
+        stats.capacity = capacity_;
+        stats.hits = hits_.load(std::memory_order_relaxed);
+        stats.misses = misses_.load(std::memory_order_relaxed);
+        stats.sampleRate = sampler_->rate();
+        stats.workingSetSize = sampler_->workingSetSize();
+        stats.missRatioCurve = sampler_->missRatioCurve(capacity_);
+        stats.policy = GetPolicy().name();
+        if (tuning_.load(std::memory_order_acquire)) {
+            stats.policyScores = tuner_->scores();
+        }
+        stats.memoryBytes = MemoryUsage();
+        stats.softQuota = softQuota_.load(std::memory_order_relaxed);
+        stats.hardQuota = hardQuota_.load(std::memory_order_relaxed);
+        stats.fairShare = governor_->FairShare(this);
+        if (writingBehind_.load(std::memory_order_acquire)) {
+            stats.writeBehind = writeBehind_->GetStats();
+        }
+        return stats;
+    }
+
     /**
      * @brief Set a key-value pair in the cache with optional broadcasting.
      * 
@@ -168,89 +393,1245 @@ public:
      * @param needBoardcast Whether to broadcast this update to peers.
      */
     void Set(const std::string& key, const Value& value, bool needBoardcast) {
-        cache_->put(key, value);
+        leases_.Invalidate(key, [&] {
+            Write(key, value);
+            if (needBoardcast) {
+                MarkOwned(key, value);
+            }
+        });
         if (needBoardcast) {
             BoardCast(key, value, Sync::SET);
         }
     }
 
+    /**
+     * @brief Fill a key under a lease from a leased miss.
+     * 
+     * @param key The string key to set.
+     * @param value The value the lease holder loaded.
+     * @param token The lease token.
+     * @return False (and nothing stored) if the lease expired or the key was written or deleted meanwhile.
+     */
+    bool SetWithLease(const std::string& key, const Value& value, uint64_t token) {
+        if (!leases_.Redeem(key, token, [&] {
+                Write(key, value);
+                MarkOwned(key, value);
+            })) {
+            return false;
+        }
+        BoardCast(key, value, Sync::SET);
+        return true;
+    }
+
     /**
      * @brief Delete a key from the cache with optional broadcasting.
      * 
+     * Outstanding leases on the key end, and the deleted value is kept as a
+     * stale answer for hot misses (see ServeLease()).
+     * 
      * @param key The string key to delete.
      * @param needBoardcast Whether to broadcast this deletion to peers.
      */
     void Del(const std::string& key, bool needBoardcast) {
-        cache_->remove(key);
+        leases_.Invalidate(key, [&] {
+            auto reading = reads_.Enter();
+            if (auto previous = previous_.load()) {
+                previous->remove(key);
+            }
+            auto cache = cache_.load();
+            Entry old;
+            if (cache->get(key, old)) {
+                stale_.put(key, old.value);
+            }
+            cache->remove(key);
+            if (needBoardcast) {
+                MarkOwned(key, std::nullopt);
+            }
+        });
         if (needBoardcast) {
             BoardCast(key, Value(), Sync::DELETE);
         }
     }
 
+    /**
+     * @brief Invalidate every key starting with a prefix, without visiting the keys.
+     * 
+     * Bumps the prefix's generation: entries stored before are dropped when
+     * next read (see Generations) and outstanding leases on matching keys
+     * end. Values whose load started before the call are stored already
+     * stale. Write-behind buffers are not touched; invalidation only
+     * concerns cached copies.
+     * 
+     * @param prefix The key prefix; empty invalidates the whole group.
+     * @param needBoardcast Whether to send the invalidation to every peer.
+     */
+    void Invalidate(const std::string& prefix, bool needBoardcast) {
+        generations_.Bump(prefix);
+        leases_.InvalidatePrefix(prefix);
+        if (!needBoardcast) {
+            return;
+        }
+        SpanContext trace = Tracer::Current();
+        for (auto& peer : peerPicker_->AllPeers()) {
+            scheduler_->Submit([this, peer, prefix, trace, token = tasks_.Hold()] {
+                Span span("group.invalidate", trace);
+                peer->invalidate(groupName_, prefix);
+            }, TaskPriority::BACKGROUND);
+        }
+    }
+
     /**
      * @brief Broadcast a cache operation to the appropriate peer.
      * 
+     * The replication RPC is an async call issued from the scheduler's
+     * background lane, so neither the caller nor a worker waits on a peer
+     * round trip. Replications of one key go through one FIFO lane of
+     * `replication_`, which each holds until its call completes, so the
+     * owner receives them in the order they were written here. In
+     * write-behind groups the owner is the only node that persists the key,
+     * so a failed replication is retried (kReplicationAttempts in all, the
+     * next one scheduled after a backoff) before the write is given up.
+     * 
      * @param key The string key being operated on.
      * @param value The value (ignored for DELETE operations).
      * @param sync The type of operation (SET or DELETE).
      */
     void BoardCast(const std::string& key, const Value& value, Sync sync) {
         auto peer = peerPicker_->PickPeer(key);
+        if (!peer) {
+            return;
+        }
+        SpanContext trace = Tracer::Current();
+        int attempts = writingBehind_.load(std::memory_order_acquire) ? kReplicationAttempts : 1;
+        replication_.SubmitAsync(key, [this, peer, key, value, sync, trace, attempts,
+                                       token = tasks_.Hold()](KeyedQueue::Task done) {
+            SendToOwner(peer, key, value, sync, trace, 1, attempts, std::move(done));
+        });
+    }
+
+    /**
+     * @brief Queue a write of a key this node owns for the backing store (write-behind groups).
+     * 
+     * Called under the key's lease lock together with the cache write, so
+     * the buffer sees a key's writes in the order the cache did and
+     * LoadAsOwner() never finds the cache written but the write not pending.
+     * 
+     * @param key The key written.
+     * @param value The new value, or nullopt for a deletion.
+     */
+    void MarkOwned(const std::string& key, std::optional<Value> value) {
+        if (writingBehind_.load(std::memory_order_acquire) && !peerPicker_->PickPeer(key)) {
+            writeBehind_->Mark(key, std::move(value));
+        }
+    }
+
+    /**
+     * @brief Reload a key in the background and store the fresh value locally.
+     * 
+     * Used for refresh-ahead: the current value keeps being served while the
+     * reload runs on the scheduler's background lane. A key is refreshed at
+     * most once at a time; calls while its refresh runs do nothing. A copy
+     * refreshed from the owner keeps the deadline the owner reported, so it
+     * does not outlive the owner's entry.
+     * 
+     * @param key The string key to refresh.
+     */
+    void RefreshAsync(const std::string& key) {
+        if (!refreshing_.Begin(key)) {
+            return;
+        }
+        SpanContext trace = Tracer::Current();
+        scheduler_->Submit([this, key, trace, token = tasks_.Hold()] {
+            Span span("group.refresh", trace);
+            uint64_t stamp = generations_.Stamp();
+            int64_t start = XFetch::Now();
+            Loaded loaded = LoadBlocking(key, false);
+            if (loaded.value && !loaded.stored) {
+                int64_t now = XFetch::Now();
+                int64_t expiry = loaded.ttlMs != 0 ? now + static_cast<int64_t>(loaded.ttlMs) * 1000000 : 0;
+                Store(key, *loaded.value, static_cast<float>(now - start), stamp, expiry);
+            }
+            refreshing_.End(key);
+        }, TaskPriority::BACKGROUND);
+    }
+
+    /**
+     * @brief Let entries expire, and refresh them early on reads.
+     * 
+     * Applies to entries stored from now on. A read of an entry at `now`
+     * starts RefreshAsync() when `now - delta * beta * ln(rand()) >= expiry`,
+     * where delta is how long the entry's value took to load (for values
+     * written by clients, the group's mean load time).
+     * 
+     * @param ttl Time-to-live of stored entries (0 = never expire).
+     * @param beta Eagerness of early refreshes (0 = only reload after expiry).
+     */
+    void SetTtl(std::chrono::milliseconds ttl, double beta = 1.0) {
+        ttl_.store(std::chrono::duration_cast<std::chrono::nanoseconds>(ttl).count(), std::memory_order_relaxed);
+        xfetchBeta_.store(beta, std::memory_order_relaxed);
+        spdlog::info("Cache group {} TTL {} ms, early refresh beta {}", groupName_, ttl.count(), beta);
+    }
+
+    /**
+     * @brief Load a value through the key's owner using SingleFlight to prevent duplicate requests.
+     * 
+     * Blocks until LoadAsync() completes; for application threads. Request
+     * handlers use the async path (LoadEncodedAsync(), LoadChunksAsync()).
+     * 
+     * @param key The string key to load.
+     * @param asOwner Load here without asking a peer (the request was forwarded to this node).
+     * @return Optional containing the loaded value if successful.
+     */
+    std::optional<Value> LoadFromPeer(const std::string& key, bool asOwner = false) {
+        return LoadBlocking(key, asOwner).value;
+    }
+
+    /**
+     * @brief Load a value through the key's owner without blocking, using SingleFlight to prevent duplicate requests.
+     * 
+     * Only the ring owner of a key calls the loader, so a key costs at most
+     * one loader call cluster-wide. Within a node, SingleFlight collapses
+     * concurrent requests into one; across nodes, a non-owner sends the
+     * owner an async Get (up to kOwnerLoadTimeout), which joins the owner's
+     * in-flight load. A non-owner loads locally only if the owner failed
+     * explicitly (see OwnerFailed()); any other error, such as
+     * DEADLINE_EXCEEDED while the owner still loads, is passed on as it is,
+     * never turned into a miss. The owner keeps what it loaded, so later
+     * misses elsewhere hit it.
+     * 
+     * No thread waits on the peer: its answer arrives on a gRPC thread, and
+     * loader calls run on the scheduler's foreground lane (inline when
+     * already on a worker). Forwarded loads use their own SingleFlight, so
+     * two nodes that disagree about the owner cannot end up waiting on each other.
+     * 
+     * @param key The string key to load.
+     * @param asOwner Load here without asking a peer (the request was forwarded to this node).
+     * @param done Receives OK and the value, NOT_FOUND if the loader had none, or the owner's
+     *        error, with the value's remaining TTL; runs on the thread that finished the load
+     *        and must not block.
+     */
+    void LoadAsync(const std::string& key, bool asOwner, std::function<void(const Loaded&)> done) {
+        auto* flight = asOwner ? &ownerFlight_ : &singleFlight_;
+        bool leader = flight->join(key, [done = std::move(done)](const std::optional<Loaded>& loaded) {
+            done(*loaded);
+        });
+        if (!leader) {
+            return;
+        }
+        SpanContext trace = Tracer::Current();
+        auto land = [flight, key](Loaded loaded) {
+            if (loaded.status.ok() && !loaded.value) {
+                loaded.status = grpc::Status(grpc::StatusCode::NOT_FOUND, "Key not found");
+            }
+            flight->land(key, loaded);
+        };
+        auto loadHere = [this, key, trace, land](bool owner) {
+            auto run = [this, key, trace, land, owner, token = tasks_.Hold()] {
+                Span span("group.load", trace);
+                // A throwing loader must still land, or the flight's waiters
+                // (and a core's off-core count) would wait forever.
+                Loaded loaded;
+                try {
+                    loaded = Loaded{grpc::Status::OK, owner ? LoadAsOwner(key) : Load(key)};
+                } catch (const std::exception& e) {
+                    span.SetError(e.what());
+                    loaded = Loaded{LoaderFailed(key, e.what()), std::nullopt};
+                } catch (...) {
+                    loaded = Loaded{LoaderFailed(key, "unknown exception"), std::nullopt};
+                }
+                if (owner && loaded.value) {
+                    loaded.ttlMs = RemainingTtlMs(ExpiryFromNow());
+                    loaded.stored = true;
+                }
+                land(std::move(loaded));
+            };
+            if (scheduler_->OnWorkerThread()) {
+                run();
+            } else {
+                scheduler_->Submit(run, TaskPriority::FOREGROUND);
+            }
+        };
+        auto* peer = asOwner ? nullptr : peerPicker_->PickPeer(key);
+        if (!peer) {
+            loadHere(true);
+            return;
+        }
+        peer->template get_async<Value>(groupName_, key, kOwnerLoadTimeout,
+                                        [key, land, loadHere, token = tasks_.Hold()](const grpc::Status& status,
+                                                                                     std::optional<Value> value,
+                                                                                     uint64_t ttlMs) {
+            if (value) {
+                land(Loaded{grpc::Status::OK, std::move(value), ttlMs});
+                return;
+            }
+            if (!OwnerFailed(status)) {
+                spdlog::warn("Owner could not load key {}: {}", key, status.error_message());
+                land(Loaded{status, std::nullopt});
+                return;
+            }
+            spdlog::warn("Owner of key {} failed ({}), loading locally", key, status.error_message());
+            loadHere(false);
+        });
+    }
+
+    const std::string& GroupName() const override {
+        return groupName_;
+    }
+
+    bool ServeLocal(const std::string& key, grpc::ByteBuffer* response) override {
+        Span span("group.get");
+        Entry entry;
+        bool hit = Lookup(key, entry);
+        RecordAccess(key, hit);
+        span.SetAttribute("result", hit ? "hit" : "miss");
+        if (hit) {
+            EncodeGetResponse(entry.value, response, RemainingTtlMs(entry.expiry));
+        }
+        return hit;
+    }
+
+    void ServeLease(const std::string& key, cache::GetResponse* response) override {
+        uint64_t token = leases_.Acquire(key);
+        if (token != 0) {
+            response->set_lease_token(token);
+            return;
+        }
+        response->set_hot_miss(true);
+        Value old;
+        if (stale_.get(key, old)) {
+            WireCodec<Value>::Encode(old, response);
+            response->set_stale(true);
+        }
+    }
+
+    bool RedeemLease(const std::string& key, uint64_t token) override {
+        return leases_.Redeem(key, token, [] {});
+    }
+
+    void InvalidateLease(const std::string& key) override {
+        leases_.End(key);
+    }
+
+    void ServeInvalidate(const std::string& prefix, bool broadcast) override {
+        Invalidate(prefix, broadcast);
+    }
+
+    uint64_t Generation() const override {
+        return generations_.Stamp();
+    }
+
+    grpc::Status ServeSet(const cache::Request& request) override {
+        Value value;
+        if (!WireCodec<Value>::Decode(request, value)) {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Value does not match the group's type");
+        }
+        if (request.lease_token() != 0) {
+            if (!SetWithLease(request.key(), value, request.lease_token())) {
+                return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Lease expired or invalidated");
+            }
+            return grpc::Status::OK;
+        }
+        Set(request.key(), value, true);
+        return grpc::Status::OK;
+    }
+
+    void ServeDelete(const std::string& key) override {
+        Del(key, true);
+    }
+
+    bool OwnsKey(const std::string& key) override {
+        return peerPicker_->PickPeer(key) == nullptr;
+    }
+
+    void ServeIncr(const cache::IncrRequest& request, bool asOwner, cache::IncrResponse* response,
+                   StatusCallback done) override {
+        auto* peer = asOwner ? nullptr : peerPicker_->PickPeer(request.key());
         if (peer) {
-            switch (sync) {
-                case Sync::SET:
-                    peer->Set(key, value);
-                    break;
-                case Sync::DELETE:
-                    peer->Del(key);
-                    break;
-                default:
-                    break;
+            Drop(request.key());
+            peer->incr_async(request, response, std::move(done));
+            return;
+        }
+        IncrAsOwner(request, response, std::nullopt, std::move(done));
+    }
+
+    void ServeCompareAndSet(const cache::CompareAndSetRequest& request, bool asOwner,
+                            cache::CompareAndSetResponse* response, StatusCallback done) override {
+        Value value;
+        if (!WireCodec<Value>::Decode(request.request(), value)) {
+            done(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Value does not match the group's type"));
+            return;
+        }
+        auto* peer = asOwner ? nullptr : peerPicker_->PickPeer(request.request().key());
+        if (peer) {
+            Drop(request.request().key());
+            peer->compare_and_set_async(request, response, std::move(done));
+            return;
+        }
+        CompareAndSetAsOwner(request, value, response, std::nullopt, std::move(done));
+    }
+
+    /**
+     * @brief Apply an increment at the key's owner (see ServeIncr()).
+     * 
+     * A key that is not cached starts from its pending write-behind value,
+     * else from what the loader returns; `initial` applies only if neither
+     * has it. The loader runs without the lock (see LoadThen()), and the
+     * increment is then retried with its answer.
+     * 
+     * @param loaded The loader's answer for the key, once it has been asked.
+     */
+    void IncrAsOwner(const cache::IncrRequest& request, cache::IncrResponse* response,
+                     const std::optional<std::optional<Value>>& loaded, StatusCallback done) {
+        const std::string& key = request.key();
+        Value stored{};
+        int64_t counter = 0;
+        grpc::Status status;
+        bool load = false;
+        leases_.Invalidate(key, [&] {
+            Entry entry;
+            bool cached = false;
+            std::optional<Value> current;
+            if (!CurrentAsOwner(key, entry, cached, current, loaded)) {
+                load = true;
+                return;
+            }
+            status = ApplyIncr(current ? &*current : nullptr, request, stored, counter);
+            if (!status.ok()) {
+                return;
             }
+            if (!cached) {
+                entry = Entry{};
+                entry.generation = generations_.Stamp();
+                int64_t ttl = request.ttl_ms() > 0 ? static_cast<int64_t>(request.ttl_ms()) * 1000000
+                                                   : ttl_.load(std::memory_order_relaxed);
+                if (ttl > 0) {
+                    entry.expiry = XFetch::Now() + ttl;
+                }
+            }
+            entry.value = stored;
+            entry.delta = 0; // a counter is never reloaded early
+            Put(key, entry);
+            DropOlderCopies(key);
+            if (writingBehind_.load(std::memory_order_acquire)) {
+                writeBehind_->Mark(key, stored);
+            }
+        });
+        if (load) {
+            LoadThen(key, [this, &request, response, done = std::move(done)](const grpc::Status& loaded,
+                                                                              std::optional<Value> value) mutable {
+                if (!loaded.ok()) {
+                    done(loaded);
+                    return;
+                }
+                IncrAsOwner(request, response, std::make_optional(std::move(value)), std::move(done));
+            });
+            return;
+        }
+        if (status.ok()) {
+            response->set_value(counter);
         }
+        done(status);
     }
 
     /**
-     * @brief Load a value from peers using SingleFlight to prevent duplicate requests.
+     * @brief Compare and set at the key's owner (see ServeCompareAndSet()).
      * 
-     * This method uses the SingleFlight pattern to ensure that concurrent requests
-     * for the same key result in only one network call to peers.
+     * A key that is not cached is compared like in IncrAsOwner(): by its
+     * pending write-behind value, else by what the loader returns.
      * 
-     * @param key The string key to load from peers.
-     * @return Optional containing the loaded value if successful.
+     * @param loaded The loader's answer for the key, once it has been asked.
      */
-    std::optional<Value> LoadFromPeer(const std::string& key) {
-        auto res = singleFlight_.run(key, [&](const std::string& k) -> std::optional<Value> {
-            auto peer = peerPicker_->PickPeer(k);
-            if (peer) {
-                auto value = peer->Get(k);
-                if (!value) {
-                    spdlog::warn("Failed to load key {} from peer", k);
-                    value = cacheMissHandler_(k);
-                    if (!value) {
-                        spdlog::error("Failed to load key {} from cacheMissHandler", k);
-                        return std::nullopt;
-                    }
+    void CompareAndSetAsOwner(const cache::CompareAndSetRequest& request, const Value& value,
+                              cache::CompareAndSetResponse* response,
+                              const std::optional<std::optional<Value>>& loaded, StatusCallback done) {
+        const std::string& key = request.request().key();
+        bool swapped = false;
+        bool load = false;
+        leases_.Invalidate(key, [&] {
+            Entry entry;
+            bool cached = false;
+            std::optional<Value> stored;
+            if (!CurrentAsOwner(key, entry, cached, stored, loaded)) {
+                load = true;
+                return;
+            }
+            cache::GetResponse current;
+            if (stored) {
+                WireCodec<Value>::Encode(*stored, &current);
+            }
+            if (!SamePayload(current, request.expected())) {
+                response->mutable_current()->Swap(&current);
+                return;
+            }
+            Write(key, value);
+            if (writingBehind_.load(std::memory_order_acquire)) {
+                writeBehind_->Mark(key, value);
+            }
+            swapped = true;
+        });
+        if (load) {
+            LoadThen(key, [this, &request, value, response,
+                           done = std::move(done)](const grpc::Status& loaded, std::optional<Value> current) mutable {
+                if (!loaded.ok()) {
+                    done(loaded);
+                    return;
                 }
-                return value;
+                CompareAndSetAsOwner(request, value, response, std::make_optional(std::move(current)),
+                                     std::move(done));
+            });
+            return;
+        }
+        response->set_swapped(swapped);
+        done(grpc::Status::OK);
+    }
+
+    /**
+     * @brief The value a read-modify-write at the key's owner starts from; caller holds the key's lease lock.
+     * 
+     * @param key The string key.
+     * @param entry Receives the cached entry, if any.
+     * @param cached Set to whether the key is cached.
+     * @param current Receives the value, or nullopt if the key has none.
+     * @param loaded The loader's answer for the key, if it has been asked.
+     * @return False if the key is neither cached nor pending and the loader has not been asked yet.
+     */
+    bool CurrentAsOwner(const std::string& key, Entry& entry, bool& cached, std::optional<Value>& current,
+                        const std::optional<std::optional<Value>>& loaded) {
+        cached = Lookup(key, entry, false);
+        if (cached) {
+            current = entry.value;
+            return true;
+        }
+        // A pending write, or deletion, is newer than what the backing store holds.
+        if (writingBehind_.load(std::memory_order_acquire) && writeBehind_->Pending(key, current)) {
+            return true;
+        }
+        if (!loaded) {
+            return false;
+        }
+        current = *loaded;
+        return true;
+    }
+
+    /**
+     * @brief Call the loader on the scheduler's foreground lane, then a continuation with its answer.
+     * 
+     * Lets a read-modify-write at the owner wait for the loader without
+     * holding the key's lease lock or the calling RPC thread.
+     * 
+     * @param key The string key to load.
+     * @param then Runs on the worker that called the loader, with INTERNAL if the loader threw.
+     */
+    void LoadThen(const std::string& key, std::function<void(const grpc::Status&, std::optional<Value>)> then) {
+        SpanContext trace = Tracer::Current();
+        scheduler_->Submit([this, key, trace, then = std::move(then), token = tasks_.Hold()] {
+            Span span("group.load", trace);
+            std::optional<Value> value;
+            try {
+                value = Load(key);
+            } catch (const std::exception& e) {
+                span.SetError(e.what());
+                then(LoaderFailed(key, e.what()), std::nullopt);
+                return;
+            } catch (...) {
+                then(LoaderFailed(key, "unknown exception"), std::nullopt);
+                return;
+            }
+            then(grpc::Status::OK, std::move(value));
+        }, TaskPriority::FOREGROUND);
+    }
+
+    grpc::Status IncrEncoded(const cache::GetResponse* current, const cache::IncrRequest& request,
+                             cache::GetResponse* updated, int64_t* counter) override {
+        if constexpr (!CounterCodec<Value>::kSupported) {
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Group values have no integer form");
+        } else {
+            return CounterStatus(IncrementEncoded<Value>(current, request.delta(), request.initial(), updated,
+                                                         *counter));
+        }
+    }
+
+    void LoadEncodedAsync(const std::string& key, bool asOwner, cache::GetResponse* response,
+                          StatusCallback done) override {
+        LoadAsync(key, asOwner, [response, done = std::move(done)](const Loaded& loaded) {
+            if (loaded.value) {
+                WireCodec<Value>::Encode(*loaded.value, response);
+                response->set_ttl_ms(loaded.ttlMs);
+            }
+            done(loaded.status);
+        });
+    }
+
+    bool ServeLocalChunks(const std::string& key, ChunkedValue* value, uint64_t* ttlMs) override {
+        Span span("group.get_stream");
+        Entry entry;
+        bool hit = Lookup(key, entry);
+        RecordAccess(key, hit);
+        span.SetAttribute("result", hit ? "hit" : "miss");
+        if (hit) {
+            *value = ToChunks(entry.value);
+            *ttlMs = RemainingTtlMs(entry.expiry);
+        }
+        return hit;
+    }
+
+    void LoadChunksAsync(const std::string& key, bool asOwner, ChunkedValue* value, uint64_t* ttlMs,
+                         StatusCallback done) override {
+        LoadAsync(key, asOwner, [value, ttlMs, done = std::move(done)](const Loaded& loaded) {
+            if (loaded.value) {
+                *value = ToChunks(*loaded.value);
+                *ttlMs = loaded.ttlMs;
             }
-            return cacheMissHandler_(k);
+            done(loaded.status);
+        });
+    }
+
+    grpc::Status ServeSetChunks(const std::string& key, const ChunkedValue& value,
+                                cache::GetResponse* shardValue) override {
+        Value decoded{};
+        if (!FromChunks(value, decoded)) {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Value does not match the group's type");
+        }
+        if (!shardValue) {
+            Set(key, decoded, true);
+            return grpc::Status::OK;
+        }
+        leases_.Invalidate(key, [&] {
+            DropCached(key);
+            MarkOwned(key, decoded);
         });
-        
-        if (!res) {
-            spdlog::error("Failed to load key {} from singleFlight", key);
-            return std::nullopt;
+        WireCodec<Value>::Encode(decoded, shardValue);
+        BoardCast(key, decoded, Sync::SET);
+        return grpc::Status::OK;
+    }
+
+    bool Replicate(const cache::Request& request, Sync sync) override {
+        Value value{};
+        if (sync == Sync::SET && !WireCodec<Value>::Decode(request, value)) {
+            return false;
         }
-        return res;
+        // The core that owns the key's shard makes all its writes, in order.
+        // The shard holds the new value; a copy a miss loaded into the
+        // group's cache is dropped, so it cannot come back once the shard
+        // loses the key.
+        leases_.WithLock(request.key(), [&] {
+            DropCached(request.key());
+            MarkOwned(request.key(), sync == Sync::SET ? std::optional<Value>(value) : std::nullopt);
+        });
+        BoardCast(request.key(), value, sync);
+        return true;
+    }
+
+    /**
+     * @brief Set the group's memory quotas.
+     * 
+     * @param softQuota Bytes guaranteed to the group before the governor
+     *        reclaims from it (0 = an equal share of what other quotas leave).
+     * @param hardQuota Bytes the group may never exceed; each store evicts
+     *        in policy order to stay below it (0 = none).
+     */
+    void SetMemoryQuota(size_t softQuota, size_t hardQuota) {
+        softQuota_.store(softQuota, std::memory_order_relaxed);
+        hardQuota_.store(hardQuota, std::memory_order_relaxed);
+        spdlog::info("Cache group {} memory quota: soft {} bytes, hard {} bytes", groupName_, softQuota, hardQuota);
+    }
+
+    const std::string& TenantName() const override {
+        return groupName_;
+    }
+
+    /**
+     * @brief Estimated bytes held: entries (including a cache being migrated from) times the mean entry size.
+     */
+    size_t MemoryUsage() override {
+        auto reading = reads_.Enter();
+        size_t entries = cache_.load()->size();
+        if (auto previous = previous_.load()) {
+            entries += previous->size();
+        }
+        return static_cast<size_t>(entries * entryBytes_.load(std::memory_order_relaxed));
+    }
+
+    size_t SoftQuota() const override {
+        return softQuota_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Evict in policy order until the estimated bytes are freed.
+     * 
+     * The cache being migrated from after a policy switch is drained first,
+     * since its entries are the least likely to be read again.
+     * 
+     * @param bytes Bytes to free.
+     * @return Estimated bytes freed.
+     */
+    size_t Reclaim(size_t bytes) override {
+        double entry = entryBytes_.load(std::memory_order_relaxed);
+        size_t entries = static_cast<size_t>(std::ceil(bytes / entry));
+        size_t evicted = 0;
+        auto reading = reads_.Enter();
+        if (auto previous = previous_.load()) {
+            while (evicted < entries && previous->evict()) {
+                ++evicted;
+            }
+        }
+        auto cache = cache_.load();
+        while (evicted < entries && cache->evict()) {
+            ++evicted;
+        }
+        return static_cast<size_t>(evicted * entry);
     }
 
 private:
-    std::unique_ptr<Lru<std::string, Value>> cache_; ///< Local cache instance.
+    /**
+     * @brief Run the tuner's simulators over the queued accesses on the scheduler's background lane,
+     *        and switch to the policy it recommends.
+     */
+    void DrainTuner() {
+        scheduler_->Submit([this, token = tasks_.Hold()] {
+            PolicySpec spec;
+            if (tuner_->drain() && tuner_->recommendation(spec)) {
+                SetPolicy(spec);
+            }
+        }, TaskPriority::BACKGROUND);
+    }
+
+    /**
+     * @brief Issue one try of a replication; a failed try schedules the next after a backoff.
+     * 
+     * @param owner The key's owner.
+     * @param key The string key.
+     * @param value The value (ignored for DELETE operations).
+     * @param sync The type of operation.
+     * @param trace Trace context of the write.
+     * @param attempt This try, from 1.
+     * @param attempts Tries in all.
+     * @param done Releases the key's replication lane once the write is sent or given up.
+     */
+    void SendToOwner(peer* owner, const std::string& key, const Value& value, Sync sync, const SpanContext& trace,
+                     int attempt, int attempts, KeyedQueue::Task done) {
+        Span span("group.replicate", trace);
+        auto sent = [this, owner, key, value, sync, trace, attempt, attempts, done = std::move(done),
+                     token = tasks_.Hold()](bool ok) mutable {
+            if (ok) {
+                done();
+                return;
+            }
+            if (attempt < attempts) {
+                scheduler_->ScheduleAfter(kReplicationBackoff * attempt,
+                                          [this, owner, key, value, sync, trace, attempt, attempts,
+                                           done = std::move(done), token]() mutable {
+                    SendToOwner(owner, key, value, sync, trace, attempt + 1, attempts, std::move(done));
+                }, TaskPriority::BACKGROUND);
+                return;
+            }
+            if (attempts > 1) {
+                spdlog::error("Write of key {} in group {} not replicated to its owner after {} attempts; "
+                              "it is not written behind", key, groupName_, attempts);
+            }
+            done();
+        };
+        if (sync == Sync::SET) {
+            owner->set_async(groupName_, key, value, std::move(sent));
+        } else {
+            owner->delete_key_async(groupName_, key, std::move(sent));
+        }
+    }
+
+    /**
+     * @brief Store a value written by a client; caller holds the key's lease shard lock.
+     * 
+     * @param key The string key.
+     * @param value The value to store.
+     */
+    void Write(const std::string& key, const Value& value) {
+        Store(key, value, static_cast<float>(loadNanos_.load(std::memory_order_relaxed)), generations_.Stamp());
+        DropOlderCopies(key);
+    }
+
+    /**
+     * @brief Forget copies of a just-written key kept beside the current cache (previous cache, stale values).
+     */
+    void DropOlderCopies(const std::string& key) {
+        auto reading = reads_.Enter();
+        if (auto previous = previous_.load()) {
+            previous->remove(key);
+        }
+        stale_.remove(key);
+    }
+
+    /**
+     * @brief Remove a key whose live copy is kept by its owner, so local reads go there.
+     */
+    void Drop(const std::string& key) {
+        leases_.Invalidate(key, [&] { DropCached(key); });
+    }
+
+    /**
+     * @brief Remove a key from the current and previous caches; caller holds the key's lease lock.
+     */
+    void DropCached(const std::string& key) {
+        auto reading = reads_.Enter();
+        if (auto previous = previous_.load()) {
+            previous->remove(key);
+        }
+        cache_.load()->remove(key);
+    }
+
+    /**
+     * @brief Compute an increment (see ServeIncr()).
+     * 
+     * @param current The stored value, or nullptr if the key is missing.
+     * @param request The increment.
+     * @param updated Receives the new value.
+     * @param counter Receives the new counter.
+     */
+    static grpc::Status ApplyIncr(const Value* current, const cache::IncrRequest& request, Value& updated,
+                                  int64_t& counter) {
+        if constexpr (!CounterCodec<Value>::kSupported) {
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Group values have no integer form");
+        } else {
+            return CounterStatus(IncrementCounter(current, request.delta(), request.initial(), updated, counter));
+        }
+    }
+
+    /**
+     * @brief Status of an increment's outcome.
+     */
+    static grpc::Status CounterStatus(CounterStep step) {
+        switch (step) {
+        case CounterStep::NOT_INTEGER:
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Value is not an integer");
+        case CounterStep::OVERFLOWED:
+            return grpc::Status(grpc::StatusCode::OUT_OF_RANGE, "Counter overflow");
+        case CounterStep::DOES_NOT_FIT:
+            return grpc::Status(grpc::StatusCode::OUT_OF_RANGE, "Counter does not fit the group's value type");
+        case CounterStep::OK:
+            break;
+        }
+        return grpc::Status::OK;
+    }
+
+    /**
+     * @brief Look a key up in the local cache, honouring invalidations and expiry.
+     * 
+     * An invalidated or expired entry is removed and reported as a miss; an
+     * unexpired one may start an early refresh (see SetTtl()). A Set racing
+     * with the removal of such an entry can be dropped, as if it had been
+     * evicted.
+     * 
+     * @param key The string key.
+     * @param entry Output parameter for the entry.
+     * @param refreshEarly Whether a hit may start an early refresh.
+     * @return True on a hit.
+     */
+    bool Lookup(const std::string& key, Entry& entry, bool refreshEarly = true) {
+        auto reading = reads_.Enter();
+        auto cache = cache_.load();
+        if (!cache->get(key, entry) && !GetFromPrevious(key, entry)) {
+            return false;
+        }
+        if (!generations_.Valid(key, entry.generation)) {
+            cache->remove(key);
+            return false;
+        }
+        if (entry.expiry == 0) {
+            return true;
+        }
+        int64_t now = XFetch::Now();
+        if (now >= entry.expiry) {
+            cache->remove(key);
+            return false;
+        }
+        if (refreshEarly && XFetch::RefreshEarly(entry.expiry, entry.delta, xfetchBeta_.load(std::memory_order_relaxed), now)) {
+            RefreshAsync(key);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Put a value into the local cache with a TTL deadline (see Put()).
+     * 
+     * @param key The string key.
+     * @param value The value to store.
+     * @param delta Time the value took to load, in nanoseconds.
+     * @param stamp Generations::Stamp() taken before the value was read.
+     * @param expiry Deadline to keep, e.g. the owner's (0 = the group's TTL from now).
+     */
+    void Store(const std::string& key, const Value& value, float delta, uint64_t stamp, int64_t expiry = 0) {
+        Entry entry{value, expiry != 0 ? expiry : ExpiryFromNow(), delta, stamp};
+        Put(key, entry);
+    }
+
+    /**
+     * @brief Deadline of an entry stored now with the group's TTL (0 = none).
+     */
+    int64_t ExpiryFromNow() const {
+        int64_t ttl = ttl_.load(std::memory_order_relaxed);
+        return ttl > 0 ? XFetch::Now() + ttl : 0;
+    }
+
+    /**
+     * @brief Time left until a deadline in ms, as sent in `ttl_ms` (0 = no deadline).
+     *
+     * A deadline less than a millisecond away still reports 1, so it is not
+     * mistaken for none.
+     */
+    static uint64_t RemainingTtlMs(int64_t expiry) {
+        if (expiry == 0) {
+            return 0;
+        }
+        int64_t left = (expiry - XFetch::Now()) / 1000000;
+        return left > 0 ? static_cast<uint64_t>(left) : 1;
+    }
+
+    /**
+     * @brief Run LoadAsync() and wait for it; logs a failed load.
+     */
+    Loaded LoadBlocking(const std::string& key, bool asOwner) {
+        Span span("group.singleflight");
+        std::promise<Loaded> promise;
+        auto future = promise.get_future();
+        LoadAsync(key, asOwner, [&promise](const Loaded& loaded) {
+            promise.set_value(loaded);
+        });
+        Loaded loaded = future.get();
+        if (!loaded.value) {
+            span.SetError(loaded.status.error_message());
+            spdlog::error("Failed to load key {} from singleFlight: {}", key, loaded.status.error_message());
+        }
+        return loaded;
+    }
+
+    /**
+     * @brief Put a stamped entry into the local cache and account for its memory.
+     * 
+     * Updates the mean entry size, evicts until usage is at or below the
+     * hard quota and reports the growth to the governor.
+     * 
+     * @param key The string key.
+     * @param stored The entry, with its deadline and generation already set.
+     */
+    void Put(const std::string& key, const Entry& stored) {
+        auto reading = reads_.Enter();
+        cache_.load()->put(key, stored);
+        double entry = entryBytes_.load(std::memory_order_relaxed);
+        entry += (EntryBytes(key, stored.value) - entry) * kEntryBytesWeight;
+        entryBytes_.store(entry, std::memory_order_relaxed);
+        size_t hardQuota = hardQuota_.load(std::memory_order_relaxed);
+        if (hardQuota > 0) {
+            // Stops early only if nothing is left to evict.
+            for (size_t usage = MemoryUsage(); usage > hardQuota; usage = MemoryUsage()) {
+                if (Reclaim(usage - hardQuota) == 0) {
+                    break;
+                }
+            }
+        }
+        governor_->OnGrowth(this);
+    }
+
+    /**
+     * @brief Approximate footprint of one entry: payload plus map and list node overhead.
+     */
+    static double EntryBytes(const std::string& key, const Value& value) {
+        size_t bytes = kEntryOverhead + sizeof(Entry) - sizeof(Value) + key.size();
+        if constexpr (std::is_base_of_v<google::protobuf::MessageLite, Value>) {
+            bytes += value.ByteSizeLong();
+        } else if constexpr (std::is_same_v<Value, std::string> || std::is_same_v<Value, SliceValue>) {
+            bytes += value.size();
+        } else if constexpr (std::is_same_v<Value, ChunkedValue>) {
+            bytes += value.size() + value.chunks() * (sizeof(SliceValue) + kChunkOverhead);
+        } else {
+            bytes += sizeof(Value);
+        }
+        return static_cast<double>(bytes);
+    }
+
+    /**
+     * @brief Whether the group's values travel in the `value` (Any) payload rather than `data`.
+     */
+    static constexpr bool kAnyPayload = std::is_same_v<Value, int32_t> || std::is_same_v<Value, google::protobuf::Any>;
+
+    /**
+     * @brief A value as the chunk chain GetStream sends (see GroupStreams::ServeLocalChunks()).
+     */
+    static ChunkedValue ToChunks(const Value& value) {
+        if constexpr (std::is_same_v<Value, ChunkedValue>) {
+            return value;
+        } else if constexpr (std::is_same_v<Value, SliceValue>) {
+            return ChunkedValue::Share(value);
+        } else if constexpr (std::is_same_v<Value, std::string>) {
+            return ChunkedValue(value);
+        } else {
+            cache::GetResponse encoded;
+            WireCodec<Value>::Encode(value, &encoded);
+            if constexpr (kAnyPayload) {
+                return ChunkedValue(encoded.value().SerializeAsString());
+            } else {
+                return ChunkedValue(encoded.data());
+            }
+        }
+    }
+
+    /**
+     * @brief Decode a chunk chain received by SetStream; the reverse of ToChunks().
+     */
+    static bool FromChunks(const ChunkedValue& chunks, Value& value) {
+        if constexpr (std::is_same_v<Value, ChunkedValue>) {
+            value = chunks;
+            return true;
+        } else if constexpr (std::is_same_v<Value, SliceValue>) {
+            value = SliceValue(chunks.str());
+            return true;
+        } else if constexpr (std::is_same_v<Value, std::string>) {
+            value = chunks.str();
+            return true;
+        } else {
+            cache::Request request;
+            if constexpr (kAnyPayload) {
+                if (!request.mutable_value()->ParseFromString(chunks.str())) {
+                    return false;
+                }
+            } else {
+                request.set_data(chunks.str());
+            }
+            return WireCodec<Value>::Decode(request, value);
+        }
+    }
+
+    /**
+     * @brief On a miss after a policy switch, look the key up in the previous cache.
+     * 
+     * A hit is moved into the current cache through Put(), so it is
+     * accounted and held to the quotas like any store. The previous cache
+     * is retired once the current one has absorbed `capacity_` misses.
+     * 
+     * @param key The string key that missed.
+     * @param value Output parameter for the value.
+     * @return True if the previous cache held the key.
+     */
+    bool GetFromPrevious(const std::string& key, Entry& value) {
+        auto reading = reads_.Enter();
+        auto previous = previous_.load();
+        if (!previous) {
+            return false;
+        }
+        bool hit = previous->get(key, value);
+        if (hit) {
+            Put(key, value);
+        }
+        if (migrationMisses_.fetch_add(1, std::memory_order_relaxed) + 1 == capacity_) {
+            std::lock_guard<std::mutex> lock(policyMutex_);
+            RetirePreviousLocked();
+        }
+        return hit;
+    }
+
+    /**
+     * @brief Unpublish the previous cache and free it on the scheduler's background lane (see FreeRetired()).
+     * 
+     * Caller holds policyMutex_.
+     */
+    void RetirePreviousLocked() {
+        Cache<std::string, Entry>* retired = previous_.exchange(nullptr);
+        if (!retired) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(retiredMutex_);
+            retired_.push_back(retired);
+        }
+        scheduler_->Submit([this, token = tasks_.Hold()] { FreeRetired(); }, TaskPriority::BACKGROUND);
+    }
+
+    /**
+     * @brief Free the retired caches once no `reads_` section can still hold them.
+     * 
+     * Run from inside a section (a task run inline by a stopping scheduler),
+     * it leaves them to the next call or to the destructor.
+     */
+    void FreeRetired() {
+        std::vector<Cache<std::string, Entry>*> retired;
+        {
+            std::lock_guard<std::mutex> lock(retiredMutex_);
+            retired.swap(retired_);
+        }
+        if (retired.empty()) {
+            return;
+        }
+        if (!reads_.Synchronize()) {
+            std::lock_guard<std::mutex> lock(retiredMutex_);
+            retired_.insert(retired_.end(), retired.begin(), retired.end());
+            return;
+        }
+        for (auto* cache : retired) {
+            delete cache;
+        }
+    }
+
+    /**
+     * @brief Call the loader as the key's owner and keep the value locally.
+     * 
+     * @param key The string key to load.
+     * @return Optional containing the loaded value.
+     */
+    std::optional<Value> LoadAsOwner(const std::string& key) {
+        uint64_t stamp = generations_.Stamp();
+        std::optional<Value> value;
+        bool pending = false;
+        leases_.WithLock(key, [&] { pending = StorePending(key, value, stamp); });
+        if (pending) {
+            return value;
+        }
+        int64_t start = XFetch::Now();
+        value = Load(key);
+        if (!value) {
+            return value;
+        }
+        auto delta = static_cast<double>(XFetch::Now() - start);
+        double mean = loadNanos_.load(std::memory_order_relaxed);
+        loadNanos_.store(mean == 0 ? delta : mean + (delta - mean) * kLoadNanosWeight, std::memory_order_relaxed);
+        // Writes are stored and marked under the same lock, so one that landed
+        // while the loader ran is found here and wins over what it read.
+        leases_.WithLock(key, [&] {
+            Entry entry;
+            if (StorePending(key, value, stamp)) {
+                return;
+            }
+            if (Lookup(key, entry, false)) {
+                value = entry.value;
+                return;
+            }
+            Store(key, *value, static_cast<float>(delta), stamp);
+        });
+        return value;
+    }
+
+    /**
+     * @brief Store a key's write the backing store has not seen yet; caller holds the key's lease lock.
+     * 
+     * @param key The string key.
+     * @param value Receives the pending value, or nullopt for a pending deletion.
+     * @param stamp Generation stamp taken before the load started.
+     * @return True if the key has a pending write.
+     */
+    bool StorePending(const std::string& key, std::optional<Value>& value, uint64_t stamp) {
+        std::optional<Value> pending;
+        if (!writingBehind_.load(std::memory_order_acquire) || !writeBehind_->Pending(key, pending)) {
+            return false;
+        }
+        if (pending) {
+            Store(key, *pending, static_cast<float>(loadNanos_.load(std::memory_order_relaxed)), stamp);
+        }
+        value = std::move(pending);
+        return true;
+    }
+
+    /**
+     * @brief Whether a failed owner Get allows loading locally.
+     * 
+     * Only an owner that is unreachable or broke (UNAVAILABLE, UNKNOWN,
+     * INTERNAL) counts. NOT_FOUND means the owner's loader had no value, and
+     * DEADLINE_EXCEEDED means its load is still running; loading here would
+     * only add a second query for the same key. Either is handed to the
+     * caller as the load's status, so a timeout is never served as a miss.
+     * 
+     * @param status Status of the owner Get.
+     * @return True if the caller may call the loader itself.
+     */
+    static bool OwnerFailed(const grpc::Status& status) {
+        switch (status.error_code()) {
+            case grpc::StatusCode::UNAVAILABLE:
+            case grpc::StatusCode::UNKNOWN:
+            case grpc::StatusCode::INTERNAL:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * @brief Log a loader call that threw and turn it into the load's status.
+     * 
+     * @param key The string key being loaded.
+     * @param what The exception's message.
+     * @return INTERNAL, which peers waiting on this owner treat as a failed owner.
+     */
+    static grpc::Status LoaderFailed(const std::string& key, const std::string& what) {
+        spdlog::error("Loader failed for key {}: {}", key, what);
+        return grpc::Status(grpc::StatusCode::INTERNAL, "Loader failed: " + what);
+    }
+
+    /**
+     * @brief Run the cache miss handler on the scheduler's foreground lane.
+     * 
+     * Loader calls are bounded by the scheduler's worker count instead of the
+     * number of gRPC threads that happen to miss at the same time. Calls made
+     * from a worker (e.g. a background refresh) run inline.
+     * 
+     * @param key The string key to load.
+     * @return The loaded value, or nullopt if the backing store has none.
+     */
+    std::optional<Value> Load(const std::string& key) {
+        if (scheduler_->OnWorkerThread()) {
+            Span span("group.loader");
+            return cacheMissHandler_(key);
+        }
+        SpanContext trace = Tracer::Current();
+        return scheduler_->Async([this, key, trace]() -> std::optional<Value> {
+            Span span("group.loader", trace);
+            return cacheMissHandler_(key);
+        }, TaskPriority::FOREGROUND).get();
+    }
+
+    static constexpr size_t kDefaultCapacity = 1 << 16; ///< Capacity used when none is given.
+    static constexpr std::chrono::milliseconds kOwnerLoadTimeout{10000}; ///< How long a non-owner waits on the owner's load.
+    static constexpr int kStaleCapacity = 1024; ///< Recently deleted values kept for hot misses.
+    static constexpr size_t kEntryOverhead = 96; ///< Per-entry bookkeeping bytes (hash node, list node, key object).
+    static constexpr size_t kChunkOverhead = 32; ///< Per-chunk bookkeeping bytes of a ChunkedValue (grpc_slice refcount header).
+    static constexpr double kEntryBytesWeight = 0.01; ///< Weight of a new sample in the mean entry size.
+    static constexpr double kLoadNanosWeight = 0.05; ///< Weight of a new sample in the mean load time.
+    static constexpr int kReplicationAttempts = 3; ///< Tries of a write-behind group's replication to the owner.
+    static constexpr std::chrono::milliseconds kReplicationBackoff{100}; ///< Delay of the next try after a failed one, times the tries so far.
+    static constexpr size_t kDeferDestroyBytes = 16 << 10; ///< Removed values this large are freed off the request thread.
+
+    size_t capacity_; ///< Maximum number of entries held locally.
+    PolicySpec policy_; ///< Replacement policy of the local cache (guarded by policyMutex_).
+    std::atomic<Cache<std::string, Entry>*> cache_; ///< Local cache instance, swapped on a policy switch; read inside `reads_` sections.
+    std::atomic<Cache<std::string, Entry>*> previous_; ///< Replaced cache still probed on misses, or null; read inside `reads_` sections.
+    ReadSections reads_; ///< Sections of the threads using cache_ or previous_, so a retired cache is freed only after them.
+    std::mutex retiredMutex_; ///< Guards retired_.
+    std::vector<Cache<std::string, Entry>*> retired_; ///< Unpublished caches waiting for FreeRetired().
+    std::atomic<size_t> migrationMisses_{0}; ///< Misses served since the last switch.
+    std::unique_ptr<PolicyTuner> tuner_; ///< Ghost simulators of alternative policies, or null.
+    std::atomic<bool> tuning_{false}; ///< Set once tuner_ is ready.
+    std::unique_ptr<WriteBehind<Value>> writeBehind_; ///< Dirty-key buffer of write-behind mode, or null.
+    std::atomic<bool> writingBehind_{false}; ///< Set once writeBehind_ is ready.
+    std::atomic<double> entryBytes_{kEntryOverhead}; ///< Moving average of stored entry sizes.
+    std::atomic<size_t> softQuota_{0}; ///< Soft memory quota in bytes (0 = none).
+    std::atomic<size_t> hardQuota_{0}; ///< Hard memory quota in bytes (0 = none).
+    std::atomic<int64_t> ttl_{0}; ///< Time-to-live of stored entries in nanoseconds (0 = none).
+    std::atomic<double> xfetchBeta_{1.0}; ///< Eagerness of early refreshes.
+    std::atomic<double> loadNanos_{0}; ///< Moving average of loader time, the recompute cost of client writes.
+    MemoryGovernor* governor_ = &MemoryGovernor::Instance(); ///< Node memory accounting.
+    std::mutex policyMutex_; ///< Serializes policy switches.
+    std::unique_ptr<ShardsSampler> sampler_; ///< Sampled reuse-distance tracker (SHARDS).
+    std::atomic<uint64_t> hits_{0}; ///< Local cache hits.
+    std::atomic<uint64_t> misses_{0}; ///< Local cache misses.
     std::unique_ptr<PeerPicker> peerPicker_; ///< Peer selection and management.
     std::string groupName_; ///< Name of this cache group.
     std::atomic<bool> isClosed_; ///< Flag indicating if the cache group is closed.
-    std::function<Value(const std::string&)> cacheMissHandler_; ///< Function to handle cache misses.
-    SingleFlight<Value> singleFlight_; ///< SingleFlight instance to prevent duplicate requests.
+    std::function<std::optional<Value>(const std::string&)> cacheMissHandler_; ///< Function to handle cache misses.
+    SingleFlight<Loaded> singleFlight_; ///< SingleFlight instance to prevent duplicate requests.
+    SingleFlight<Loaded> ownerFlight_; ///< SingleFlight for loads forwarded to this node as owner.
+    RefreshSet refreshing_; ///< Keys with an early refresh in flight.
+    RemovalQueue<Value> removals_{TaskScheduler::Instance()}; ///< Removed entries on their way to listeners.
+    LeaseTable leases_; ///< Leases handed out on lease-aware misses.
+    Generations generations_; ///< Invalidation generations of the group and of key prefixes.
+    Lru<std::string, Value> stale_{kStaleCapacity}; ///< Recently deleted values, served only on hot misses.
+    TaskScheduler* scheduler_ = &TaskScheduler::Instance(); ///< Executor for loader, refresh and replication tasks.
+    KeyedQueue replication_{*scheduler_}; ///< Replications to peers, in write order per key.
+    TaskTracker tasks_; ///< Queued tasks and callbacks that refer to the group, waited for on destruction.
     std::string etcdServiceName_; ///< etcd service prefix.
     std::string etcdKey_; ///< etcd service key.
     std::string etcdEndpoints_; ///< etcd endpoints configuration.
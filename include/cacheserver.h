@@ -10,7 +10,12 @@
 
 #include "cache.grpc.pb.h"
 #include "cache.pb.h"
+#include "include/arenaallocator.h"
+#include "include/corerouter.h"
+#include "include/groupregistry.h"
 #include "include/registry.h"
+#include "include/shmtransport.h"
+#include "include/tracing.h"
 
 /**
  * @brief Configuration options for the CacheServer.
@@ -26,6 +31,11 @@ struct ServerOptions {
     bool tls; ///< Flag indicating whether to enable TLS encryption.
     std::string cert_file; ///< Path to the TLS certificate file.
     std::string key_file; ///< Path to the TLS private key file.
+    bool thread_per_core; ///< Serve requests from per-core shared-nothing loops (see CoreRouter).
+    size_t cores; ///< Number of core loops in thread-per-core mode (0 = all cores).
+    size_t core_shard_capacity; ///< Capacity of each per-core shard of a cache group.
+    bool local_socket; ///< Also listen on a Unix domain socket for colocated clients (see LocalSocketPath).
+    size_t shm_slots; ///< Client slots of the shared-memory transport (0 = off; see ShmServer).
 
     /**
      * @brief Default constructor with sensible default values.
@@ -34,7 +44,12 @@ struct ServerOptions {
         : etcd_endpoints({"http://127.0.0.1:2379"}),
           dial_timeout(std::chrono::seconds(5)),
           max_msg_size(4 << 20),  // 4MB
-          tls(false) {}
+          tls(false),
+          thread_per_core(false),
+          cores(0),
+          core_shard_capacity(1 << 16),
+          local_socket(true),
+          shm_slots(0) {}
 };
 
 /**
@@ -42,10 +57,40 @@ struct ServerOptions {
  * 
  * CacheServer provides a distributed cache service that can be accessed via gRPC.
  * It automatically registers itself with etcd for service discovery and provides
- * Get, Set, and Delete operations for cache management. The server supports
+ * Get, Set, Delete, Invalidate, Incr and CompareAndSet operations for cache management. The server supports
  * high-concurrency access and integrates with peer nodes for distributed caching.
+ *
+ * Requests are served through gRPC's callback API. Each call's request and
+ * response are allocated on a per-call protobuf arena (ArenaMessageAllocator)
+ * and freed in one shot when the call completes. Get misses are handed to the
+ * task scheduler, so a slow peer or loader never holds a gRPC thread; so
+ * are Incr and CompareAndSet calls that have to be forwarded to the key's owner.
+ *
+ * Get is a raw method: the response is a pre-serialized ByteBuffer, so a
+ * hit in a SliceValue group passes the cached slice to the transport
+ * without copying the payload.
+ *
+ * MultiGet and MultiSet carry many keys in one call, each with its own
+ * status; clients send one per node with the keys that node owns.
+ *
+ * Values too large for one message go through GetStream and SetStream,
+ * which move them one ChunkedValue chunk per message (see ChunkStreamWriter).
+ *
+ * Besides its TCP address the server listens on a Unix domain socket, which
+ * colocated gateways dial instead, and can offer a shared-memory transport
+ * for Get, Set and Delete (see ShmServer).
  */
-class CacheServer final : public cache::Cache::Service{
+class CacheServer final : public cache::Cache::WithRawCallbackMethod_Get<
+                              cache::Cache::WithCallbackMethod_Set<
+                              cache::Cache::WithCallbackMethod_Delete<
+                              cache::Cache::WithCallbackMethod_Stats<
+                              cache::Cache::WithCallbackMethod_Invalidate<
+                              cache::Cache::WithCallbackMethod_Incr<
+                              cache::Cache::WithCallbackMethod_CompareAndSet<
+                              cache::Cache::WithCallbackMethod_GetStream<
+                              cache::Cache::WithCallbackMethod_SetStream<
+                              cache::Cache::WithCallbackMethod_MultiGet<
+                              cache::Cache::WithCallbackMethod_MultiSet<cache::Cache::Service>>>>>>>>>>> {
 public:
     /**
      * @brief Construct a new CacheServer instance.
@@ -65,12 +110,12 @@ public:
      * @brief Handle gRPC Get requests to retrieve cached values.
      * 
      * @param context The gRPC server context for this request.
-     * @param request The incoming Get request containing the group and key.
-     * @param response The response object to populate with the cached value.
-     * @return gRPC status indicating success or failure of the operation.
+     * @param request The serialized Get request containing the group and key.
+     * @param response Receives the serialized GetResponse.
+     * @return Reactor finished with the status of the operation (possibly later, on a miss).
      */
-    grpc::Status Get(grpc::ServerContext* context, const cache::Request* request,
-                     cache::GetResponse* response) override;
+    grpc::ServerUnaryReactor* Get(grpc::CallbackServerContext* context, const grpc::ByteBuffer* request,
+                                  grpc::ByteBuffer* response) override;
 
     /**
      * @brief Handle gRPC Set requests to store key-value pairs in the cache.
@@ -78,10 +123,10 @@ public:
      * @param context The gRPC server context for this request.
      * @param request The incoming Set request containing the group, key, and value.
      * @param response The response object to indicate operation success.
-     * @return gRPC status indicating success or failure of the operation.
+     * @return Reactor finished with the status of the operation.
      */
-    grpc::Status Set(grpc::ServerContext* context, const cache::Request* request,
-                     cache::SetResponse* response) override;
+    grpc::ServerUnaryReactor* Set(grpc::CallbackServerContext* context, const cache::Request* request,
+                                  cache::SetResponse* response) override;
 
     /**
      * @brief Handle gRPC Delete requests to remove keys from the cache.
@@ -89,10 +134,154 @@ public:
      * @param context The gRPC server context for this request.
      * @param request The incoming Delete request containing the group and key.
      * @param response The response object to indicate operation success.
-     * @return gRPC status indicating success or failure of the operation.
+     * @return Reactor finished with the status of the operation.
      */
-    grpc::Status Delete(grpc::ServerContext* context, const cache::Request* request,
-                        cache::DeleteResponse* response) override;
+    grpc::ServerUnaryReactor* Delete(grpc::CallbackServerContext* context, const cache::Request* request,
+                                     cache::DeleteResponse* response) override;
+
+    /**
+     * @brief Handle gRPC Stats requests reporting a group's hit counters and sizing estimates.
+     * 
+     * @param context The gRPC server context for this request.
+     * @param request The incoming Stats request containing the group.
+     * @param response The response object to populate with the statistics.
+     * @return Reactor finished with the status of the operation.
+     */
+    grpc::ServerUnaryReactor* Stats(grpc::CallbackServerContext* context, const cache::StatsRequest* request,
+                                    cache::StatsResponse* response) override;
+
+    /**
+     * @brief Handle gRPC Invalidate requests dropping every key of a group under a prefix.
+     * 
+     * @param context The gRPC server context for this request.
+     * @param request The incoming Invalidate request containing the group and prefix.
+     * @param response The response object to indicate operation success.
+     * @return Reactor finished with the status of the operation.
+     */
+    grpc::ServerUnaryReactor* Invalidate(grpc::CallbackServerContext* context, const cache::InvalidateRequest* request,
+                                         cache::InvalidateResponse* response) override;
+
+    /**
+     * @brief Handle gRPC Incr requests adding to an integer counter at its owner.
+     * 
+     * @param context The gRPC server context for this request.
+     * @param request The incoming Incr request containing the key, delta, initial value and TTL.
+     * @param response The response object to populate with the new counter.
+     * @return Reactor finished with the status of the operation (later, if forwarded to the owner).
+     */
+    grpc::ServerUnaryReactor* Incr(grpc::CallbackServerContext* context, const cache::IncrRequest* request,
+                                   cache::IncrResponse* response) override;
+
+    /**
+     * @brief Handle gRPC CompareAndSet requests storing a value only if the key holds an expected one.
+     * 
+     * @param context The gRPC server context for this request.
+     * @param request The incoming request containing the write and the expected value.
+     * @param response The response object to populate with the outcome.
+     * @return Reactor finished with the status of the operation (later, if forwarded to the owner).
+     */
+    grpc::ServerUnaryReactor* CompareAndSet(grpc::CallbackServerContext* context,
+                                            const cache::CompareAndSetRequest* request,
+                                            cache::CompareAndSetResponse* response) override;
+
+    /**
+     * @brief Handle gRPC GetStream requests sending a value chunk by chunk.
+     * 
+     * @param context The gRPC server context for this request.
+     * @param request The incoming request containing the group and key.
+     * @return Reactor writing the chunks.
+     */
+    grpc::ServerWriteReactor<cache::Chunk>* GetStream(grpc::CallbackServerContext* context,
+                                                      const cache::Request* request) override;
+
+    /**
+     * @brief Handle gRPC SetStream requests storing a value received chunk by chunk.
+     * 
+     * @param context The gRPC server context for this request.
+     * @param response The response object to indicate operation success.
+     * @return Reactor reading the chunks.
+     */
+    grpc::ServerReadReactor<cache::Chunk>* SetStream(grpc::CallbackServerContext* context,
+                                                     cache::SetResponse* response) override;
+
+    /**
+     * @brief Handle gRPC MultiGet requests retrieving several keys of a group.
+     * 
+     * @param context The gRPC server context for this request.
+     * @param request The incoming request containing the group and keys.
+     * @param response The response object to populate with one result per key.
+     * @return Reactor finished once every key has been answered (later, if any missed).
+     */
+    grpc::ServerUnaryReactor* MultiGet(grpc::CallbackServerContext* context, const cache::MultiGetRequest* request,
+                                       cache::MultiGetResponse* response) override;
+
+    /**
+     * @brief Handle gRPC MultiSet requests storing several key-value pairs.
+     * 
+     * @param context The gRPC server context for this request.
+     * @param request The incoming request containing one Set request per key.
+     * @param response The response object to populate with one result per key.
+     * @return Reactor finished with the status of the call.
+     */
+    grpc::ServerUnaryReactor* MultiSet(grpc::CallbackServerContext* context, const cache::MultiSetRequest* request,
+                                       cache::MultiSetResponse* response) override;
+
+    /**
+     * @brief Completion of an async unary call that finishes it and then ends its server span.
+     * 
+     * The span is marked failed on an error status. The handler started it
+     * and detaches it (Span::Detach()) before returning, so it covers the
+     * whole call, including loads that complete on other threads.
+     * 
+     * @param reactor The call's reactor.
+     * @param span The call's server span.
+     * @return The callback to pass to the async work.
+     */
+    static StatusCallback FinishWithSpan(grpc::ServerUnaryReactor* reactor, std::shared_ptr<Span> span);
+
+    /**
+     * @brief Serve a MultiGet request (shared with the thread-per-core path).
+     * 
+     * Hits are answered at once; misses are loaded like a Get miss, without
+     * blocking the caller. A key's failure goes into its result, not the call's status.
+     * 
+     * @param request The MultiGet request.
+     * @param asOwner The call was forwarded by another node (see IsOwnerLoad()).
+     * @param router The core router in thread-per-core mode, or nullptr.
+     * @param response Receives one result per key, in request order; must stay alive until `done`.
+     * @param done Called once every key has been answered, with NOT_FOUND if the group does not exist.
+     */
+    static void ServeMultiGet(const cache::MultiGetRequest& request, bool asOwner, CoreRouter* router,
+                              cache::MultiGetResponse* response, StatusCallback done);
+
+    /**
+     * @brief Apply a MultiSet request (shared with the thread-per-core path).
+     * 
+     * @param request The MultiSet request.
+     * @param router The core router in thread-per-core mode, or nullptr.
+     * @param response Receives one result per entry, in request order.
+     */
+    static void ApplyMultiSet(const cache::MultiSetRequest& request, CoreRouter* router,
+                              cache::MultiSetResponse* response);
+
+    /**
+     * @brief Apply an Invalidate request (shared with the thread-per-core path).
+     * 
+     * A request not marked `local` is sent on to every peer.
+     * 
+     * @param request The Invalidate request.
+     * @return gRPC status indicating whether the group exists.
+     */
+    static grpc::Status ApplyInvalidate(const cache::InvalidateRequest& request);
+
+    /**
+     * @brief Fill a Stats response for a group (shared with the thread-per-core path).
+     * 
+     * @param group The cache group name.
+     * @param response The response object to populate.
+     * @return gRPC status indicating whether the group exists.
+     */
+    static grpc::Status FillStats(const std::string& group, cache::StatsResponse* response);
     
     /**
      * @brief Start the gRPC server and register with etcd.
@@ -115,6 +304,17 @@ private:
     ServerOptions options_; ///< Configuration options for this server instance.
     std::unique_ptr<etcdRegistry> etcd_registry_; ///< Registry client for etcd service discovery.
     std::unique_ptr<grpc::Server> server_; ///< The underlying gRPC server instance.
+    CoreService async_service_; ///< Service used in thread-per-core mode.
+    std::unique_ptr<CoreRouter> core_router_; ///< Per-core loops, only in thread-per-core mode.
+    std::unique_ptr<ShmServer> shm_server_; ///< Shared-memory transport, if enabled.
+    ArenaMessageAllocator<cache::Request, cache::SetResponse> set_allocator_; ///< Per-call arenas for Set.
+    ArenaMessageAllocator<cache::Request, cache::DeleteResponse> delete_allocator_; ///< Per-call arenas for Delete.
+    ArenaMessageAllocator<cache::StatsRequest, cache::StatsResponse> stats_allocator_; ///< Per-call arenas for Stats.
+    ArenaMessageAllocator<cache::InvalidateRequest, cache::InvalidateResponse> invalidate_allocator_; ///< Per-call arenas for Invalidate.
+    ArenaMessageAllocator<cache::IncrRequest, cache::IncrResponse> incr_allocator_; ///< Per-call arenas for Incr.
+    ArenaMessageAllocator<cache::CompareAndSetRequest, cache::CompareAndSetResponse> cas_allocator_; ///< Per-call arenas for CompareAndSet.
+    ArenaMessageAllocator<cache::MultiGetRequest, cache::MultiGetResponse> multi_get_allocator_; ///< Per-call arenas for MultiGet.
+    ArenaMessageAllocator<cache::MultiSetRequest, cache::MultiSetResponse> multi_set_allocator_; ///< Per-call arenas for MultiSet.
 };
 
 
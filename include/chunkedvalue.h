@@ -0,0 +1,171 @@
+#ifndef CHUNKED_VALUE_H
+#define CHUNKED_VALUE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "include/slicevalue.h"
+
+/**
+ * @brief Immutable, reference-counted byte payload stored as a chain of fixed-size chunks.
+ *
+ * Meant for values of several megabytes: the payload is allocated
+ * kChunkSize bytes at a time instead of in one contiguous block, and it is
+ * moved over the GetStream and SetStream RPCs one chunk per message, so a
+ * large transfer never holds a channel with a single huge message. Copying
+ * a ChunkedValue (into or out of a cache) only bumps a reference count, and
+ * each chunk is a SliceValue that gRPC can send without copying.
+ */
+class ChunkedValue {
+public:
+    static constexpr size_t kChunkSize = 64 << 10; ///< Bytes per chunk; the last chunk may be shorter.
+
+    /**
+     * @brief Builds a chain from bytes that arrive in pieces of any size.
+     */
+    class Builder {
+    public:
+        /**
+         * @brief Append bytes, cutting them into chunks.
+         *
+         * A full chunk handed over while no partial chunk is pending is
+         * adopted without copying.
+         *
+         * @param bytes The bytes; left in an unspecified state.
+         */
+        void Append(std::string&& bytes) {
+            if (pending_.empty() && bytes.size() == kChunkSize) {
+                chunks_->push_back(SliceValue(std::move(bytes)));
+                size_ += kChunkSize;
+                return;
+            }
+            Append(std::string_view(bytes));
+        }
+
+        /**
+         * @brief Append bytes, cutting them into chunks.
+         */
+        void Append(std::string_view bytes) {
+            while (!bytes.empty()) {
+                if (pending_.capacity() < kChunkSize) {
+                    pending_.reserve(kChunkSize);
+                }
+                size_t n = std::min(bytes.size(), kChunkSize - pending_.size());
+                pending_.append(bytes.data(), n);
+                bytes.remove_prefix(n);
+                size_ += n;
+                if (pending_.size() == kChunkSize) {
+                    chunks_->push_back(SliceValue(std::move(pending_)));
+                    pending_ = std::string();
+                }
+            }
+        }
+
+        /**
+         * @brief Append the bytes of a chunk that was sent at `offset` of the value.
+         *
+         * @param offset Where the bytes start in the value; must equal size().
+         * @param bytes The bytes; left in an unspecified state if they are appended.
+         * @return False, appending nothing, if the bytes do not continue the
+         *         value (an earlier chunk is missing or this one is out of order).
+         */
+        bool AppendAt(size_t offset, std::string&& bytes) {
+            if (offset != size_) {
+                return false;
+            }
+            Append(std::move(bytes));
+            return true;
+        }
+
+        /**
+         * @brief Bytes appended so far.
+         */
+        size_t size() const { return size_; }
+
+        /**
+         * @brief Finish the chain; the builder is left empty.
+         */
+        ChunkedValue Build() {
+            if (!pending_.empty()) {
+                pending_.shrink_to_fit();
+                chunks_->push_back(SliceValue(std::move(pending_)));
+                pending_ = std::string();
+            }
+            ChunkedValue value(std::move(chunks_), size_);
+            chunks_ = std::make_shared<std::vector<SliceValue>>();
+            size_ = 0;
+            return value;
+        }
+
+    private:
+        std::shared_ptr<std::vector<SliceValue>> chunks_ = std::make_shared<std::vector<SliceValue>>(); ///< Full chunks.
+        std::string pending_;   ///< The chunk being filled.
+        size_t size_ = 0;       ///< Bytes appended.
+    };
+
+    ChunkedValue() = default;
+
+    /**
+     * @brief Copy bytes into a chain.
+     */
+    explicit ChunkedValue(std::string_view bytes) {
+        Builder builder;
+        builder.Append(bytes);
+        *this = builder.Build();
+    }
+
+    /**
+     * @brief Share a slice's bytes as a chain of sub-slices, without copying.
+     */
+    static ChunkedValue Share(const SliceValue& value) {
+        auto chunks = std::make_shared<std::vector<SliceValue>>();
+        for (size_t begin = 0; begin < value.size(); begin += kChunkSize) {
+            size_t end = std::min(value.size(), begin + kChunkSize);
+            chunks->push_back(SliceValue(value.slice().sub(begin, end)));
+        }
+        return ChunkedValue(std::move(chunks), value.size());
+    }
+
+    /**
+     * @brief Total payload bytes.
+     */
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * @brief Number of chunks.
+     */
+    size_t chunks() const { return chunks_ ? chunks_->size() : 0; }
+
+    /**
+     * @brief One chunk of the chain.
+     */
+    const SliceValue& chunk(size_t i) const { return (*chunks_)[i]; }
+
+    /**
+     * @brief A contiguous copy of the payload.
+     */
+    std::string str() const {
+        std::string bytes;
+        bytes.reserve(size_);
+        for (size_t i = 0; i < chunks(); ++i) {
+            bytes.append(chunk(i).view());
+        }
+        return bytes;
+    }
+
+private:
+    ChunkedValue(std::shared_ptr<const std::vector<SliceValue>> chunks, size_t size)
+        : chunks_(std::move(chunks)), size_(size) {}
+
+    std::shared_ptr<const std::vector<SliceValue>> chunks_; ///< Shared chunk chain, or null when empty.
+    size_t size_ = 0;                                       ///< Total payload bytes.
+};
+
+#endif // CHUNKED_VALUE_H
@@ -0,0 +1,109 @@
+#ifndef CHUNK_STREAM_H
+#define CHUNK_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <grpcpp/grpcpp.h>
+
+#include "cache.grpc.pb.h"
+#include "include/chunkedvalue.h"
+#include "include/groupregistry.h"
+#include "include/tracing.h"
+
+class CoreRouter;
+
+/**
+ * @brief Serves one GetStream call: the value goes out one chunk per message.
+ *
+ * The next chunk is written only once the transport has taken the previous
+ * one, so a transfer holds one chunk of message memory at a time and other
+ * calls on the connection interleave with it. A miss is loaded without
+ * blocking a thread (see GroupStreams::LoadChunksAsync()), as for Get.
+ *
+ * With a CoreRouter (thread-per-core mode) the key is looked up in the
+ * owning core's shard instead of the group's cache.
+ */
+class ChunkStreamWriter final : public grpc::ServerWriteReactor<cache::Chunk> {
+public:
+    /**
+     * @brief Start serving a call.
+     *
+     * @param context The call's server context.
+     * @param request The group and key.
+     * @param router The core router in thread-per-core mode, or nullptr.
+     */
+    ChunkStreamWriter(grpc::CallbackServerContext* context, const cache::Request* request, CoreRouter* router);
+
+    void OnWriteDone(bool ok) override;
+    void OnDone() override;
+
+private:
+    /**
+     * @brief Load a missing key without blocking, then send it; a failed load finishes with its status.
+     */
+    void Load();
+
+    /**
+     * @brief Start sending a value.
+     */
+    void Send(ChunkedValue value);
+
+    /**
+     * @brief Write the next chunk, or finish after the last.
+     */
+    void WriteNext();
+
+    GroupStreams* group_ = nullptr;     ///< The group read.
+    std::string key_;                   ///< The key read.
+    bool asOwner_ = false;              ///< The call was forwarded by another node (kOwnerLoadMetadata).
+    SpanContext trace_;                 ///< Context of the call's span, for the load.
+    ChunkedValue value_;                ///< The value being sent.
+    uint64_t ttlMs_ = 0;                ///< Time the value has left, sent in the first chunk (0 = no expiry).
+    size_t next_ = 0;                   ///< Index of the next chunk to write.
+    size_t offset_ = 0;                 ///< Payload bytes written so far, the next chunk's `offset`.
+    cache::Chunk chunk_;                ///< Message of the write in flight.
+};
+
+/**
+ * @brief Serves one SetStream call: chunks are collected into a chain and stored when the client is done.
+ *
+ * Incoming chunks of any size are cut into ChunkedValue::kChunkSize pieces
+ * as they arrive, so the value is never held in one contiguous buffer.
+ *
+ * With a CoreRouter (thread-per-core mode) the value is stored in the
+ * owning core's shard, as a unary Set would.
+ */
+class ChunkStreamReader final : public grpc::ServerReadReactor<cache::Chunk> {
+public:
+    /**
+     * @brief Start serving a call.
+     *
+     * @param context The call's server context.
+     * @param response Receives whether the value was stored.
+     * @param router The core router in thread-per-core mode, or nullptr.
+     */
+    ChunkStreamReader(grpc::CallbackServerContext* context, cache::SetResponse* response, CoreRouter* router);
+
+    void OnReadDone(bool ok) override;
+    void OnDone() override;
+
+private:
+    /**
+     * @brief Store the collected value and finish.
+     */
+    void Store();
+
+    cache::SetResponse* response_;      ///< The call's response.
+    CoreRouter* router_;                ///< Core router, or nullptr.
+    SpanContext trace_;                 ///< Context of the caller.
+    GroupStreams* group_ = nullptr;     ///< The group written, once the first chunk arrived.
+    std::string groupName_;             ///< Name of the group written.
+    std::string key_;                   ///< The key written.
+    uint64_t totalSize_ = 0;            ///< Size announced by the first chunk (0 = not announced).
+    ChunkedValue::Builder builder_;     ///< The value collected so far.
+    cache::Chunk chunk_;                ///< Message of the read in flight.
+};
+
+#endif // CHUNK_STREAM_H
@@ -9,6 +9,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include "BatchHash.h"
+
 /**
  * @brief Consistent hashing implementation for distributed cache load balancing.
  * 
@@ -18,15 +20,30 @@
  */
 class consistentHash{
 public:
+    static constexpr int kReplicaNum = 50; ///< Virtual nodes per physical node of the cluster ring.
+    static constexpr int kMinReplica = 10; ///< Minimum virtual nodes of the cluster ring.
+    static constexpr int kMaxReplica = 200; ///< Maximum virtual nodes of the cluster ring.
+    static constexpr double kRebalanceThreshold = 0.25; ///< Rebalance threshold of the cluster ring.
+
     /**
      * @brief Construct a consistent hash ring.
      * 
+     * The defaults are the cluster ring: every node's PeerPicker and every
+     * CacheClient construct it this way, so given the same nodes they all
+     * pick the same owner for a key.
+     * 
      * @param replicanum Default number of virtual nodes per physical node.
      * @param minreplica Minimum number of virtual nodes per physical node.
      * @param maxreplica Maximum number of virtual nodes per physical node.
      * @param rebalancerthreashold Traffic imbalance threshold for rebalancing.
      */
-    consistentHash(int replicanum, int minreplica, int maxreplica, double rebalancerthreashold);
+    consistentHash(int replicanum = kReplicaNum, int minreplica = kMinReplica, int maxreplica = kMaxReplica,
+                   double rebalancerthreashold = kRebalanceThreshold);
+
+    /**
+     * @brief Destructor.
+     */
+    ~consistentHash();
 
     /**
      * @brief Add a node to the consistent hash ring.
@@ -51,6 +68,18 @@ public:
      * @return The identifier of the node that should handle this key.
      */
     std::string Get(const std::string& key);
+
+    /**
+     * @brief Get the nodes responsible for a batch of keys.
+     * 
+     * Keys are hashed in SIMD batches and the ring is searched for several
+     * keys in lockstep with a branchless binary search, so the memory loads of
+     * independent searches overlap. Equivalent to calling Get() per key.
+     * 
+     * @param keys The keys to lookup.
+     * @return The node identifier for each key, in the same order.
+     */
+    std::vector<std::string> GetBatch(const std::vector<std::string>& keys);
     
 private:
     mutable std::shared_mutex mtx; ///< Mutex for thread-safe operations.
@@ -66,7 +95,7 @@ private:
      * @param key The string to hash.
      * @return The hash value.
      */
-    int hashFunction(const std::string& key){ return static_cast<int>(std::hash<std::string>{}(key));}
+    int hashFunction(const std::string& key){ return static_cast<int>(batchhash::hash32(key));}
     
     std::vector<int> hashRing; ///< Sorted list of hash positions on the ring.
     std::unordered_map<int,std::string> hashToNode; ///< Mapping from hash positions to node identifiers.
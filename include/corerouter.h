@@ -0,0 +1,361 @@
+#ifndef CORE_ROUTER_H
+#define CORE_ROUTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+
+#include "cache.grpc.pb.h"
+#include "include/CacheEngine.h"
+#include "include/SpscQueue.h"
+#include "include/memorygovernor.h"
+
+/**
+ * @brief Shared-nothing request router for thread-per-core mode.
+ *
+ * The router runs one event loop per core. Each loop owns a completion queue
+ * of the async gRPC service and a private, lock-free shard of every cache
+ * group. A key belongs to exactly one core (hash of the key modulo the core
+ * count); a request that arrives on another core is handed to the owner
+ * through a single-producer single-consumer queue, so shard data is only ever
+ * touched by its owning thread and the hit path takes no lock. When that
+ * queue is full, the call is parked on the owner's mutex-guarded queue
+ * instead, so the receiving core never waits on a busy peer; later calls
+ * from that core are parked behind it until it has run, so they keep their
+ * order. Each core
+ * resolves a group once and keeps the pointer with its shard, and counts
+ * accesses itself: only keys the group samples are kept, and they are
+ * reported in batches (see GroupAccessCounter::RecordAccesses()), so the group's
+ * counters and estimator locks are touched once per batch, not per request.
+ * Writes still consult the group's ring and lease table and hand
+ * replication to the task scheduler.
+ *
+ * Misses fall back to the regular CacheGroup (peers, then the loader)
+ * through GroupReader::LoadEncodedAsync(): the owner is asked with an async
+ * call and the loader runs on the task scheduler, so neither a slow loader
+ * nor a slow peer stalls a core loop or parks a worker; the loaded value
+ * is handed back to the owner core to fill its shard. Incr and CompareAndSet
+ * of keys this node owns are plain read-modify-writes of the owning core's
+ * shard; on a shard miss the key's value is first loaded the same way
+ * (pending write-behind value, then the loader), since a counter the shard
+ * evicted is not a new one. Those of other nodes' keys are forwarded with
+ * async calls.
+ *
+ * Stop() waits for the calls still being served off-core before it shuts
+ * the completion queues down, since those calls finish on them.
+ *
+ * The shards are one MemoryTenant of the MemoryGovernor, registered while
+ * the router runs. Each core keeps its entry count and mean entry size in
+ * atomics, so usage is read from any thread; Reclaim() posts evictions to
+ * the cores, which evict from their largest shards first.
+ *
+ * Shards follow the group's invalidation generation (see Generations): a
+ * core that sees the generation move on swaps its shard of the group for an
+ * empty one, and drops fills whose load started before the change.
+ *
+ * The chunked streams (GetStream, SetStream) and the batches (MultiGet,
+ * MultiSet) are not core calls; they are served on gRPC's threads (see
+ * CoreService) and reach each key's shard through Peek(), Put() and
+ * Write(), which run on the owning core.
+ */
+class CacheGroupBase;
+class CoreService;
+
+class CoreRouter : public MemoryTenant {
+public:
+    /**
+     * @brief Construct a router.
+     *
+     * @param service The service the completion queues belong to.
+     * @param cores Number of core loops (0 selects the number of cores).
+     * @param shardCapacity Capacity of each per-core, per-group shard.
+     */
+    CoreRouter(CoreService* service, size_t cores, size_t shardCapacity);
+
+    /**
+     * @brief Destructor that stops every core loop.
+     */
+    ~CoreRouter();
+
+    /**
+     * @brief Number of core loops; the caller adds this many completion queues.
+     */
+    size_t CoreCount() const { return cores_.size(); }
+
+    /**
+     * @brief Start one pinned event loop per completion queue.
+     *
+     * @param cqs Completion queues added to the server builder, one per core.
+     */
+    void Start(std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs);
+
+    /**
+     * @brief Shut the completion queues down and join the core loops.
+     *
+     * Must be called after the gRPC server itself has been shut down.
+     */
+    void Stop();
+
+    /**
+     * @brief Core that owns a key.
+     *
+     * @param key The cache key.
+     * @return Index of the owning core.
+     */
+    size_t OwnerOf(const std::string& key) const;
+
+    /**
+     * @brief Look a key up in its owning core's shard, from any thread.
+     *
+     * Counts the access like a Get.
+     *
+     * @param group The group name.
+     * @param key The key.
+     * @param done Runs on the owning core with the value (which it may take), or nullptr on a miss; must not block.
+     */
+    void Peek(const std::string& group, const std::string& key, std::function<void(cache::GetResponse*)> done);
+
+    /**
+     * @brief Store a value in its owning core's shard, from any thread.
+     *
+     * The caller has already replicated the write. A value put before the
+     * group is invalidated is dropped, like a fill.
+     *
+     * @param group The group name.
+     * @param key The key.
+     * @param value The value, wire-encoded.
+     */
+    void Put(const std::string& group, const std::string& key, cache::GetResponse value);
+
+    /**
+     * @brief Apply a Set from any thread, as a unary Set would: check the lease, replicate, then Put().
+     *
+     * @param request The Set request.
+     * @return The status a unary Set would finish with.
+     */
+    grpc::Status Write(const cache::Request& request);
+
+    const std::string& TenantName() const override {
+        return tenantName_;
+    }
+
+    /**
+     * @brief Estimated bytes held by every core's shards.
+     */
+    size_t MemoryUsage() override;
+
+    size_t SoftQuota() const override {
+        return 0;
+    }
+
+    /**
+     * @brief Ask each core to evict its part of the bytes, in proportion to its usage.
+     *
+     * The evictions run on the cores shortly after this returns.
+     *
+     * @param bytes Bytes to free.
+     * @return Estimated bytes the cores were asked to free.
+     */
+    size_t Reclaim(size_t bytes) override;
+
+private:
+    /// Shards hold values wire-encoded, so one core loop serves groups of any value type.
+    using Shard = CacheEngine<std::string, cache::GetResponse, HashIndex, LruEviction, AlwaysAdmit, NoExpiry, NoLock>;
+
+    /**
+     * @brief One in-flight RPC; see corerouter.cpp for the state machine.
+     */
+    class Call;
+
+    /**
+     * @brief A value loaded off-core, to be inserted into the owner's shard.
+     */
+    struct Fill {
+        std::string group;               ///< Cache group name.
+        std::string key;                 ///< Key that was loaded.
+        cache::GetResponse value;        ///< Loaded value, wire-encoded.
+        uint64_t generation = 0;         ///< Group generation from before the load.
+    };
+
+    /**
+     * @brief A core's shard of one group, and its accesses not yet reported to the group.
+     */
+    struct ShardSlot {
+        CacheGroupBase* group = nullptr; ///< The group; groups live until process exit.
+        std::unique_ptr<Shard> shard;    ///< The shard.
+        uint64_t generation = 0;         ///< Group generation its entries belong to.
+        std::vector<std::string> sampled; ///< Accessed keys the group samples, in order.
+        uint64_t hits = 0;               ///< Hits since the last report.
+        uint64_t misses = 0;             ///< Misses since the last report.
+    };
+
+    static constexpr double kEntryOverhead = 96;     ///< Per-entry bookkeeping bytes (hash node, list node, key object).
+    static constexpr double kEntryBytesWeight = 0.01; ///< Weight of a new sample in a core's mean entry size.
+
+    /**
+     * @brief State owned by a single core loop.
+     */
+    struct Core {
+        size_t index = 0;                                       ///< Position in `cores_`.
+        std::unique_ptr<grpc::ServerCompletionQueue> cq;       ///< Completion queue polled by this core.
+        std::vector<std::unique_ptr<SpscQueue<Call*>>> inbox;  ///< inbox[from]: calls forwarded by core `from`.
+        std::vector<std::atomic<size_t>> parked;                ///< parked[from]: calls from core `from` waiting in `peeks`.
+        std::unordered_map<std::string, ShardSlot> shards;      ///< This core's shard of each group.
+        std::mutex fillMtx;                                     ///< Guards `fills` and `peeks` (off-core producers only).
+        std::vector<Fill> fills;                                ///< Loaded values waiting to be inserted.
+        std::vector<std::function<void()>> peeks;               ///< Shard work posted by Peek(), Reclaim() and Route() when an inbox is full.
+        std::atomic<bool> hasFills{false};                      ///< Cheap check before taking `fillMtx`.
+        std::atomic<size_t> entries{0};                         ///< Entries across this core's shards.
+        std::atomic<double> entryBytes{kEntryOverhead};         ///< Moving average of this core's entry sizes.
+        std::thread thread;                                     ///< The core loop.
+    };
+
+    /**
+     * @brief Main loop of one core.
+     */
+    void Loop(Core& core);
+
+    /**
+     * @brief Route a freshly received call to its owning core.
+     */
+    void Route(Core& core, Call* call);
+
+    /**
+     * @brief Execute a call against the shard of the core that owns its key.
+     */
+    void Execute(Core& core, Call* call);
+
+    /**
+     * @brief Apply an INCR or CAS of a key this node owns to its current value; on the owning core.
+     *
+     * @param current The key's value, or nullptr if it has none (taken on a CAS mismatch).
+     */
+    void ApplyUpdate(Core& core, ShardSlot& slot, Call* call, cache::GetResponse* current);
+
+    /**
+     * @brief On a shard miss of an INCR or CAS, load the key's value through the group, then ApplyUpdate() on the core.
+     */
+    void LoadCurrent(Core& core, CacheGroupBase* group, Call* call);
+
+    /**
+     * @brief Drain forwarded calls and off-core fills for a core.
+     *
+     * @return True if any work was done.
+     */
+    bool DrainInboxes(Core& core);
+
+    /**
+     * @brief This core's slot of a group, created on first use.
+     *
+     * Only the first use of a group looks it up in the GroupRegistry. A
+     * shard filled under an older generation is replaced by an empty one;
+     * the old one is freed on the scheduler's background lane.
+     *
+     * @param core The calling core.
+     * @param group The group name.
+     * @return The slot, at the group's current generation, or nullptr if no such group exists.
+     */
+    ShardSlot* SlotFor(Core& core, const std::string& group);
+
+    /**
+     * @brief Run a function on a core, from any thread.
+     */
+    void Post(Core& core, std::function<void()> fn);
+
+    /**
+     * @brief Store a value in a slot's shard and account its memory; on the owning core.
+     */
+    void Store(Core& core, ShardSlot& slot, const std::string& key, const cache::GetResponse& value);
+
+    /**
+     * @brief Remove a key from a slot's shard and account it; on the owning core.
+     */
+    void Erase(Core& core, ShardSlot& slot, const std::string& key);
+
+    /**
+     * @brief Evict entries from a core's shards, from the largest shard first; on the owning core.
+     */
+    void Evict(Core& core, size_t entries);
+
+    /**
+     * @brief Count a shard lookup, reporting the slot's accesses once a batch is full.
+     */
+    void CountAccess(ShardSlot& slot, const std::string& key, bool hit);
+
+    /**
+     * @brief Report a slot's counted accesses to its group.
+     */
+    void ReportAccesses(ShardSlot& slot);
+
+    /**
+     * @brief Account a call about to be served off-core; see Stop().
+     */
+    void BeginOffCore() { offCore_.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Account an off-core call that has been finished.
+     */
+    void EndOffCore() { offCore_.fetch_sub(1, std::memory_order_release); }
+
+    static constexpr size_t kAccessBatch = 4096;  ///< Accesses a core counts before reporting them.
+    static constexpr size_t kSampledBatch = 64;   ///< Sampled keys a core keeps before reporting them.
+
+    CoreService* service_;                           ///< Service the calls are requested on.
+    size_t shardCapacity_;                           ///< Capacity of each shard.
+    std::vector<std::unique_ptr<Core>> cores_;       ///< The core loops.
+    std::atomic<bool> running_{false};               ///< True between Start() and Stop().
+    std::atomic<size_t> offCore_{0};                 ///< Calls being served off-core, not yet finished.
+    std::string tenantName_{"core-shards"};          ///< Name of the shards as a memory tenant.
+};
+
+/**
+ * @brief The service of thread-per-core mode.
+ *
+ * Unary methods are async: the core loops request and complete them on
+ * their own completion queues. GetStream and SetStream are callback
+ * methods, served on gRPC's threads by ChunkStreamWriter and
+ * ChunkStreamReader; a large transfer never occupies a core loop. So are
+ * MultiGet and MultiSet, whose keys belong to many cores.
+ */
+class CoreService final : public cache::Cache::WithAsyncMethod_Get<
+                              cache::Cache::WithAsyncMethod_Set<
+                              cache::Cache::WithAsyncMethod_Delete<
+                              cache::Cache::WithAsyncMethod_Stats<
+                              cache::Cache::WithAsyncMethod_Invalidate<
+                              cache::Cache::WithAsyncMethod_Incr<
+                              cache::Cache::WithAsyncMethod_CompareAndSet<
+                              cache::Cache::WithCallbackMethod_GetStream<
+                              cache::Cache::WithCallbackMethod_SetStream<
+                              cache::Cache::WithCallbackMethod_MultiGet<
+                              cache::Cache::WithCallbackMethod_MultiSet<cache::Cache::Service>>>>>>>>>>> {
+public:
+    /**
+     * @brief Set the router whose shards the streams and batches use; before the server starts.
+     */
+    void SetRouter(CoreRouter* router) { router_ = router; }
+
+    grpc::ServerWriteReactor<cache::Chunk>* GetStream(grpc::CallbackServerContext* context,
+                                                      const cache::Request* request) override;
+
+    grpc::ServerReadReactor<cache::Chunk>* SetStream(grpc::CallbackServerContext* context,
+                                                     cache::SetResponse* response) override;
+
+    grpc::ServerUnaryReactor* MultiGet(grpc::CallbackServerContext* context, const cache::MultiGetRequest* request,
+                                       cache::MultiGetResponse* response) override;
+
+    grpc::ServerUnaryReactor* MultiSet(grpc::CallbackServerContext* context, const cache::MultiSetRequest* request,
+                                       cache::MultiSetResponse* response) override;
+
+private:
+    CoreRouter* router_ = nullptr; ///< Router of the core loops.
+};
+
+#endif // CORE_ROUTER_H
@@ -0,0 +1,130 @@
+#ifndef COUNTER_CODEC_H
+#define COUNTER_CODEC_H
+
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "include/slicevalue.h"
+
+/**
+ * @brief Integer form of a cache group's value type, for atomic counters (Incr).
+ *
+ * int32_t groups hold counters natively; string and slice groups hold them
+ * as decimal text, as memcached and Redis do, so a counter written through
+ * the HTTP gateway can be incremented and read back as is. Other value
+ * types have no integer form (`kSupported` is false).
+ *
+ * @tparam Value The cache value type.
+ */
+template<typename Value>
+struct CounterCodec {
+    static constexpr bool kSupported = false;
+};
+
+/**
+ * @brief Decimal text; the whole value must parse.
+ */
+template<>
+struct CounterCodec<std::string> {
+    static constexpr bool kSupported = true;
+
+    static bool Read(const std::string& value, int64_t& counter) {
+        return Parse(value.data(), value.size(), counter);
+    }
+
+    static bool Write(int64_t counter, std::string& value) {
+        value = std::to_string(counter);
+        return true;
+    }
+
+    static bool Parse(const char* data, size_t size, int64_t& counter) {
+        auto [end, error] = std::from_chars(data, data + size, counter);
+        return error == std::errc() && end == data + size && size > 0;
+    }
+};
+
+/**
+ * @brief Decimal text in a slice.
+ */
+template<>
+struct CounterCodec<SliceValue> {
+    static constexpr bool kSupported = true;
+
+    static bool Read(const SliceValue& value, int64_t& counter) {
+        std::string_view text = value.view();
+        return CounterCodec<std::string>::Parse(text.data(), text.size(), counter);
+    }
+
+    static bool Write(int64_t counter, SliceValue& value) {
+        value = SliceValue(std::to_string(counter));
+        return true;
+    }
+};
+
+/**
+ * @brief Native 32-bit integers; counters outside their range do not fit.
+ */
+template<>
+struct CounterCodec<int32_t> {
+    static constexpr bool kSupported = true;
+
+    static bool Read(int32_t value, int64_t& counter) {
+        counter = value;
+        return true;
+    }
+
+    static bool Write(int64_t counter, int32_t& value) {
+        if (counter < std::numeric_limits<int32_t>::min() || counter > std::numeric_limits<int32_t>::max()) {
+            return false;
+        }
+        value = static_cast<int32_t>(counter);
+        return true;
+    }
+};
+
+/**
+ * @brief Outcome of IncrementCounter().
+ */
+enum class CounterStep {
+    OK,           ///< The counter was updated.
+    NOT_INTEGER,  ///< The stored value has no integer form.
+    OVERFLOWED,   ///< The increment overflows 64 bits.
+    DOES_NOT_FIT, ///< The new counter does not fit the value type.
+};
+
+/**
+ * @brief Apply an increment to a counter, shared by the group's and the per-core Incr paths.
+ *
+ * A key with no value (neither cached nor known to the loader) starts at
+ * `initial`, which is returned as is; `delta` only applies to a stored value.
+ *
+ * @param current The stored value, or nullptr if the key has none.
+ * @param delta Amount added to a stored counter.
+ * @param initial Counter of a key that has no value.
+ * @param updated Receives the new value.
+ * @param counter Receives the new counter.
+ */
+template<typename Value>
+CounterStep IncrementCounter(const Value* current, int64_t delta, int64_t initial, Value& updated, int64_t& counter) {
+    static_assert(CounterCodec<Value>::kSupported, "Value has no integer form");
+    counter = initial;
+    if (current) {
+        int64_t stored = 0;
+        if (!CounterCodec<Value>::Read(*current, stored)) {
+            return CounterStep::NOT_INTEGER;
+        }
+        if (__builtin_add_overflow(stored, delta, &counter)) {
+            return CounterStep::OVERFLOWED;
+        }
+    }
+    if (!CounterCodec<Value>::Write(counter, updated)) {
+        return CounterStep::DOES_NOT_FIT;
+    }
+    return CounterStep::OK;
+}
+
+#endif // COUNTER_CODEC_H
@@ -0,0 +1,123 @@
+#ifndef GENERATIONS_H
+#define GENERATIONS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Generation counters that invalidate a whole group, or every key under a prefix, in O(1).
+ *
+ * One clock advances on every invalidation, and entries are stamped with
+ * its value when they are stored (Stamp()). Invalidating a prefix records
+ * the new clock value as the floor of that prefix ("" covers every key).
+ * An entry stays valid only while its stamp is at or above the floor of
+ * every invalidated prefix of its key. Nothing is scanned or deleted up
+ * front: stale entries are dropped when they are next read, or evicted like
+ * any other entry.
+ *
+ * Validating an entry costs one floor lookup per distinct length of
+ * invalidated prefixes, and none until a non-empty prefix has been
+ * invalidated. Lookups take no lock and copy no key: the prefix floors are
+ * an immutable snapshot that Bump() replaces, and prefixes of the key are
+ * looked up as string views. One floor is kept per prefix ever
+ * invalidated, so prefixes are meant to be a bounded set such as tenant or
+ * table names ("tenant42:"), not single keys; each Bump() of a prefix
+ * copies them.
+ */
+class Generations {
+public:
+    /**
+     * @brief The stamp for an entry whose value is read now; also the group's generation.
+     *
+     * Changes on every invalidation. Take it before loading a value, so a
+     * load that overlaps an invalidation stores an entry that is already stale.
+     */
+    uint64_t Stamp() const {
+        return clock_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Whether an entry survives every invalidation since it was stamped.
+     *
+     * @param key The entry's key.
+     * @param stamp The entry's stamp.
+     */
+    bool Valid(const std::string& key, uint64_t stamp) const {
+        if (stamp < allFloor_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::shared_ptr<const Floors> floors = floors_.load(std::memory_order_acquire);
+        if (!floors) {
+            return true;
+        }
+        std::string_view view(key);
+        for (size_t length : floors->lengths) {
+            if (length > view.size()) {
+                break;
+            }
+            auto it = floors->floors.find(view.substr(0, length));
+            if (it != floors->floors.end() && stamp < it->second) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Invalidate every entry stamped so far whose key starts with a prefix.
+     *
+     * @param prefix The key prefix; empty invalidates every key.
+     * @return The new generation.
+     */
+    uint64_t Bump(const std::string& prefix) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        uint64_t generation = clock_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        if (prefix.empty()) {
+            allFloor_.store(generation, std::memory_order_release);
+            return generation;
+        }
+        std::shared_ptr<const Floors> current = floors_.load(std::memory_order_acquire);
+        auto next = current ? std::make_shared<Floors>(*current) : std::make_shared<Floors>();
+        if (next->floors.insert_or_assign(prefix, generation).second) {
+            auto at = std::lower_bound(next->lengths.begin(), next->lengths.end(), prefix.size());
+            if (at == next->lengths.end() || *at != prefix.size()) {
+                next->lengths.insert(at, prefix.size());
+            }
+        }
+        floors_.store(std::move(next), std::memory_order_release);
+        return generation;
+    }
+
+private:
+    /**
+     * @brief Hash of std::string that also hashes std::string_view, for lookups without a copy.
+     */
+    struct PrefixHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view prefix) const { return std::hash<std::string_view>{}(prefix); }
+    };
+
+    /**
+     * @brief The floors of invalidated prefixes; never changed once published.
+     */
+    struct Floors {
+        std::unordered_map<std::string, uint64_t, PrefixHash, std::equal_to<>> floors; ///< Oldest valid stamp per prefix.
+        std::vector<size_t> lengths;                        ///< Distinct lengths of the keys of `floors`, ascending.
+    };
+
+    std::atomic<uint64_t> clock_{1};                     ///< Current generation, advanced by every Bump().
+    std::atomic<uint64_t> allFloor_{0};                  ///< Oldest valid stamp for any key.
+    std::mutex mtx_;                                     ///< Serializes Bump().
+    std::atomic<std::shared_ptr<const Floors>> floors_;  ///< Current prefix floors, or null until a prefix is invalidated.
+};
+
+#endif // GENERATIONS_H
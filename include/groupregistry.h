@@ -0,0 +1,386 @@
+#ifndef GROUP_REGISTRY_H
+#define GROUP_REGISTRY_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/support/byte_buffer.h>
+
+#include "cache.pb.h"
+#include "include/CachePolicy.h"
+#include "include/ShardsSampler.h"
+#include "include/chunkedvalue.h"
+#include "include/writebehind.h"
+
+/**
+ * @brief Synchronization operation types for cache broadcasting.
+ */
+enum class Sync {
+    SET,    ///< Set operation - add or update a key-value pair.
+    DELETE  ///< Delete operation - remove a key-value pair.
+};
+
+/**
+ * @brief Completion of an operation that may wait on a peer or the loader.
+ *
+ * Runs on whichever thread finished the operation (a gRPC thread, a
+ * scheduler worker, or the caller's own thread) and must not block.
+ */
+using StatusCallback = std::function<void(const grpc::Status&)>;
+
+/**
+ * @brief Request metadata marking a Get (or Incr, CompareAndSet) sent to the key's owner by another node.
+ *
+ * The owner serves such a request from its cache or loads the key itself;
+ * it never forwards it again, even if its view of the ring differs.
+ */
+inline constexpr char kOwnerLoadMetadata[] = "cache-owner-load";
+
+/**
+ * @brief Whether an incoming call carries kOwnerLoadMetadata.
+ */
+inline bool IsOwnerLoad(const grpc::ServerContextBase& context) {
+    return context.client_metadata().count(kOwnerLoadMetadata) > 0;
+}
+
+/**
+ * @brief Snapshot of a cache group's counters and sizing estimates.
+ */
+struct GroupStats {
+    size_t capacity = 0;                                ///< Configured capacity in entries.
+    uint64_t hits = 0;                                  ///< Local cache hits.
+    uint64_t misses = 0;                                ///< Local cache misses.
+    double sampleRate = 0;                              ///< Current key sampling rate of the estimator.
+    size_t workingSetSize = 0;                          ///< Estimated number of distinct keys in use.
+    std::vector<ShardsSampler::Point> missRatioCurve;   ///< Estimated LRU miss ratio from 0.1x to 10x capacity.
+    std::string policy;                                 ///< Replacement policy of the local cache.
+    std::vector<PolicyTuner::Score> policyScores;       ///< Simulated hit ratios, live policy first (empty unless auto-tuning).
+    size_t memoryBytes = 0;                             ///< Estimated bytes held by the local cache.
+    size_t softQuota = 0;                               ///< Soft memory quota in bytes (0 = none).
+    size_t hardQuota = 0;                               ///< Hard memory quota in bytes (0 = none).
+    size_t fairShare = 0;                               ///< Share of the node memory limit (0 = unlimited).
+    WriteBehindStats writeBehind;                       ///< Write-behind counters (zero unless enabled).
+};
+
+/**
+ * @brief Reads of a group's keys in wire form, as served to Get calls.
+ */
+class GroupReader {
+public:
+    virtual ~GroupReader() = default;
+
+    /**
+     * @brief Look a key up in the local cache only, count the access and serialize a hit as a GetResponse.
+     *
+     * Never blocks on peers or the loader; on a miss follow up with
+     * LoadEncodedAsync(). SliceValue groups hand their payload over without
+     * copying it (see EncodeGetResponse()). A hit carries the entry's
+     * remaining `ttl_ms`, so a non-owner copy expires with the owner's.
+     *
+     * @param key The key.
+     * @param response Empty buffer that receives the serialized GetResponse on a hit.
+     * @return True on a hit.
+     */
+    virtual bool ServeLocal(const std::string& key, grpc::ByteBuffer* response) = 0;
+
+    /**
+     * @brief Answer a miss of a lease-aware Get: a lease token, or a hot miss with any stale value.
+     *
+     * @param key The key that missed.
+     * @param response Receives `lease_token`, or `hot_miss` plus a `stale` payload if one is kept.
+     */
+    virtual void ServeLease(const std::string& key, cache::GetResponse* response) = 0;
+
+    /**
+     * @brief Load a key through its owner (or the loader, on the owner), bypassing the local cache.
+     *
+     * Never blocks the calling thread: a wait on the owner is an async peer
+     * call, and the loader runs on the scheduler, so request threads hand
+     * off instead of parking a worker.
+     *
+     * @param key The key.
+     * @param asOwner The request was forwarded by another node (kOwnerLoadMetadata): load here.
+     * @param response Receives the value and its `ttl_ms`; must stay valid until `done` runs.
+     * @param done Receives OK with the value loaded, NOT_FOUND if there is none, or
+     *        the owner's error (e.g. DEADLINE_EXCEEDED while its load still runs).
+     */
+    virtual void LoadEncodedAsync(const std::string& key, bool asOwner, cache::GetResponse* response,
+                                  StatusCallback done) = 0;
+};
+
+/**
+ * @brief Writes of a group's keys in wire form: stores, deletes, counters, invalidation and leases.
+ */
+class GroupWriter {
+public:
+    virtual ~GroupWriter() = default;
+
+    /**
+     * @brief Decode the request's value, store it and replicate it to the owning peer.
+     *
+     * A request with a `lease_token` is stored only if its lease is still valid.
+     *
+     * @return OK, INVALID_ARGUMENT if the payload does not decode to the
+     *         group's value type, or FAILED_PRECONDITION if the lease ended.
+     */
+    virtual grpc::Status ServeSet(const cache::Request& request) = 0;
+
+    /**
+     * @brief Delete a key locally and on the owning peer.
+     */
+    virtual void ServeDelete(const std::string& key) = 0;
+
+    /**
+     * @brief Add to an integer counter, atomically with every other write of the key.
+     *
+     * Runs at the owner, before this returns unless the owner has to ask
+     * its loader for the key first; elsewhere the request is forwarded to
+     * the owner with an async call and the local copy of the key is dropped.
+     *
+     * @param request The key, delta, initial value and TTL; must stay valid until `done` runs.
+     * @param asOwner The request was forwarded by another node (kOwnerLoadMetadata): apply it here.
+     * @param response Receives the counter after the call; must stay valid until `done` runs.
+     * @param done Receives OK; FAILED_PRECONDITION if the group's value type has no integer
+     *        form or the stored value is not an integer; OUT_OF_RANGE on overflow; or the owner's error.
+     */
+    virtual void ServeIncr(const cache::IncrRequest& request, bool asOwner, cache::IncrResponse* response,
+                           StatusCallback done) = 0;
+
+    /**
+     * @brief Store a value only if the key holds an expected one, atomically with every other write of the key.
+     *
+     * Runs at the owner, like ServeIncr().
+     *
+     * @param request The write and the expected value; must stay valid until `done` runs.
+     * @param asOwner The request was forwarded by another node: apply it here.
+     * @param response Receives whether the value was stored, or the value found instead.
+     * @param done Receives OK, INVALID_ARGUMENT if the payload does not decode to the
+     *        group's value type, or the owner's error.
+     */
+    virtual void ServeCompareAndSet(const cache::CompareAndSetRequest& request, bool asOwner,
+                                    cache::CompareAndSetResponse* response, StatusCallback done) = 0;
+
+    /**
+     * @brief Apply an increment to a wire-encoded value held outside the group (e.g. in a per-core shard).
+     *
+     * @param current The stored value, or nullptr if the key is missing.
+     * @param request The increment.
+     * @param updated Receives the new value, wire-encoded.
+     * @param counter Receives the counter after the increment.
+     * @return As ServeIncr().
+     */
+    virtual grpc::Status IncrEncoded(const cache::GetResponse* current, const cache::IncrRequest& request,
+                                     cache::GetResponse* updated, int64_t* counter) = 0;
+
+    /**
+     * @brief Invalidate every key starting with a prefix (empty = the whole group) in O(1).
+     *
+     * @param prefix The key prefix.
+     * @param broadcast Send the invalidation on to every peer (false when a peer sent it).
+     */
+    virtual void ServeInvalidate(const std::string& prefix, bool broadcast) = 0;
+
+    /**
+     * @brief End a lease for a write stored outside the group (e.g. in a per-core shard).
+     *
+     * @return True if the token was valid; the write must be dropped otherwise.
+     */
+    virtual bool RedeemLease(const std::string& key, uint64_t token) = 0;
+
+    /**
+     * @brief End any lease on a key written or deleted outside the group; takes no lock if the key's lease shard is empty.
+     */
+    virtual void InvalidateLease(const std::string& key) = 0;
+
+    /**
+     * @brief Replicate a write that was stored outside the group (e.g. in a per-core shard).
+     *
+     * The group's own copy of the key, if a miss loaded one, is dropped.
+     *
+     * @param request The write; its payload is ignored for DELETE.
+     * @param sync The operation.
+     * @return False if a SET payload does not decode to the group's value type.
+     */
+    virtual bool Replicate(const cache::Request& request, Sync sync) = 0;
+};
+
+/**
+ * @brief Access counting for lookups served from storage outside the group (e.g. a per-core shard).
+ */
+class GroupAccessCounter {
+public:
+    virtual ~GroupAccessCounter() = default;
+
+    /**
+     * @brief Count a lookup served from storage outside the group (e.g. a per-core shard).
+     */
+    virtual void RecordAccess(const std::string& key, bool hit) = 0;
+
+    /**
+     * @brief Whether RecordAccess() of a key would feed the working-set estimator or the policy tuner.
+     *
+     * Takes no lock, so storage outside the group can count accesses on its
+     * own and only keep these keys for RecordAccesses().
+     */
+    virtual bool SamplesKey(const std::string& key) = 0;
+
+    /**
+     * @brief Count a batch of lookups served from storage outside the group, taking each lock once.
+     *
+     * @param sampled Keys of the batch for which SamplesKey() held, in access order.
+     * @param hits Hits in the batch.
+     * @param misses Misses in the batch.
+     */
+    virtual void RecordAccesses(const std::vector<std::string>& sampled, uint64_t hits, uint64_t misses) = 0;
+};
+
+/**
+ * @brief Reads and writes of a group's keys as chunk chains, as served to GetStream and SetStream.
+ */
+class GroupStreams {
+public:
+    virtual ~GroupStreams() = default;
+
+    /**
+     * @brief Look a key up in the local cache only, count the access and return a hit as a chunk chain.
+     *
+     * The streaming twin of ServeLocal(): ChunkedValue and SliceValue groups
+     * share their payload, other groups chunk the bytes of its wire form
+     * (the `data` payload, or the serialized Any for Any and int32_t groups).
+     *
+     * @param ttlMs Receives the time the value has left in ms, as `ttl_ms` (0 = no expiry).
+     * @return True on a hit.
+     */
+    virtual bool ServeLocalChunks(const std::string& key, ChunkedValue* value, uint64_t* ttlMs) = 0;
+
+    /**
+     * @brief Load a key as a chunk chain without blocking, like LoadEncodedAsync().
+     *
+     * @param value Receives the value; must stay valid until `done` runs.
+     * @param ttlMs Receives the time the value has left in ms; must stay valid until `done` runs.
+     */
+    virtual void LoadChunksAsync(const std::string& key, bool asOwner, ChunkedValue* value, uint64_t* ttlMs,
+                                 StatusCallback done) = 0;
+
+    /**
+     * @brief Store a value received as a chunk chain and replicate it to the owning peer, like ServeSet().
+     *
+     * @param key The key.
+     * @param value The value.
+     * @param shardValue If given, the value is stored outside the group (e.g.
+     *        in a per-core shard): it is encoded into this response instead of
+     *        being stored, and still replicated.
+     * @return OK, or INVALID_ARGUMENT if the bytes do not decode to the group's value type.
+     */
+    virtual grpc::Status ServeSetChunks(const std::string& key, const ChunkedValue& value,
+                                        cache::GetResponse* shardValue) = 0;
+};
+
+/**
+ * @brief Counters and sizing estimates of a group, as served to Stats calls.
+ */
+class GroupStatsSource {
+public:
+    virtual ~GroupStatsSource() = default;
+
+    /**
+     * @brief Snapshot hit counters, sizing estimates and memory usage.
+     */
+    virtual GroupStats GetStats() = 0;
+};
+
+/**
+ * @brief Value-type-independent face of a CacheGroup, as seen by the request handlers.
+ *
+ * The server and the thread-per-core router only deal in wire messages;
+ * each CacheGroup<Value> converts between them and its own value type with
+ * WireCodec<Value>, so groups of different value types are served side by side.
+ *
+ * The operations are split by concern into GroupReader, GroupWriter,
+ * GroupAccessCounter, GroupStreams and GroupStatsSource; a handler holds
+ * the narrowest one it uses. The base adds what identifies the group and
+ * its keys' placement.
+ */
+class CacheGroupBase : public GroupReader,
+                       public GroupWriter,
+                       public GroupAccessCounter,
+                       public GroupStreams,
+                       public GroupStatsSource {
+public:
+    /**
+     * @brief Name of the group.
+     */
+    virtual const std::string& GroupName() const = 0;
+
+    /**
+     * @brief Whether this node owns a key on the hash ring (no peer does).
+     */
+    virtual bool OwnsKey(const std::string& key) = 0;
+
+    /**
+     * @brief The group's invalidation generation; changes whenever keys are invalidated.
+     *
+     * Lets storage outside the group (e.g. a per-core shard) notice that it holds stale values.
+     */
+    virtual uint64_t Generation() const = 0;
+};
+
+/**
+ * @brief Process-wide registry of cache groups by name.
+ *
+ * Groups are created once and live until process exit, so the pointers
+ * handed out stay valid. Lookups take a shared lock.
+ */
+class GroupRegistry {
+public:
+    /**
+     * @brief The process-wide registry.
+     */
+    static GroupRegistry& Instance();
+
+    /**
+     * @brief Find a group by name.
+     *
+     * @return The group, or nullptr if none is registered under the name.
+     */
+    CacheGroupBase* Find(const std::string& name);
+
+    /**
+     * @brief Find a group by name and value type.
+     *
+     * @tparam Group The concrete group type, e.g. CacheGroup<std::string>.
+     * @return The group, or nullptr if it is missing or of another type.
+     */
+    template<typename Group>
+    Group* Find(const std::string& name) {
+        return dynamic_cast<Group*>(Find(name));
+    }
+
+    /**
+     * @brief Return the group registered under a name, creating it if there is none.
+     *
+     * @param name The group name.
+     * @param factory Builds the group; called at most once, under the registry lock.
+     * @return The existing or new group.
+     */
+    CacheGroupBase* Add(const std::string& name, const std::function<std::unique_ptr<CacheGroupBase>()>& factory);
+
+    /**
+     * @brief Names of all registered groups.
+     */
+    std::vector<std::string> Names();
+
+private:
+    GroupRegistry();
+
+    std::shared_mutex mtx_;                                                  ///< Guards `groups_`.
+    std::unordered_map<std::string, std::unique_ptr<CacheGroupBase>> groups_; ///< Groups by name.
+};
+
+#endif // GROUP_REGISTRY_H
@@ -5,13 +5,24 @@
 #include <httplib.h>
 #include <spdlog/common.h>
 #include <spdlog/spdlog.h>
+#include <etcd/Client.hpp>
+#include <memory>
 #include <string>
 #include <thread>
-#include "kcache/consistent_hash.h"
+#include <unordered_map>
+#include "cache.grpc.pb.h"
+#include "include/consistentHash.h"
+#include "include/shmtransport.h"
+#include "include/tracing.h"
 
 DEFINE_int32(http_port, 9000, "HTTP port");
 DEFINE_string(etcd_endpoints, "http://127.0.0.1:2379", "etcd address");
 DEFINE_string(service_name, "kcache", "cache service name");
+DEFINE_double(trace_sample_ratio, 0.0, "fraction of requests traced (0 disables tracing)");
+DEFINE_string(trace_file, "", "append sampled spans to this file as JSON lines");
+DEFINE_string(trace_otlp_endpoint, "", "OTLP/HTTP collector to post sampled spans to");
+DEFINE_bool(local_transport, true, "dial colocated cache nodes over their Unix domain socket");
+DEFINE_bool(shm, false, "send Get, Set and Delete to colocated cache nodes over shared memory when offered");
 
 /**
  * @brief HTTP gateway for the distributed cache system.
@@ -20,6 +31,14 @@ DEFINE_string(service_name, "kcache", "cache service name");
  * It acts as a gateway that routes HTTP requests to appropriate cache nodes using
  * consistent hashing and service discovery via etcd. This allows clients to access
  * the cache system through standard HTTP protocols.
+ *
+ * Every request continues the caller's W3C `traceparent` header (or starts a
+ * sampled trace) and forwards it to the cache node as gRPC metadata.
+ *
+ * Cache nodes on the same host are dialed over their Unix domain socket
+ * (see LocalTarget). With shared memory enabled, Get, Set and Delete to such
+ * a node go over its ShmServer segment when it offers one, falling back to
+ * gRPC whenever a call cannot.
  */
 class HttpGateway {
 public:
@@ -29,8 +48,11 @@ public:
      * @param port The HTTP port to listen on for incoming requests.
      * @param etcd_endpoints The comma-separated list of etcd endpoints for service discovery.
      * @param service_name The name of the cache service to discover in etcd.
+     * @param local_transport Dial colocated nodes over their Unix domain socket.
+     * @param shm Use the shared-memory transport of colocated nodes.
      */
-    HttpGateway(int port, const std::string &etcd_endpoints, const std::string &service_name);
+    HttpGateway(int port, const std::string &etcd_endpoints, const std::string &service_name,
+                bool local_transport = true, bool shm = false);
     
     /**
      * @brief Destructor that properly shuts down the HTTP server and discovery services.
@@ -48,7 +70,8 @@ private:
     /**
      * @brief Set up HTTP route handlers for cache operations.
      * 
-     * Configures the HTTP server with endpoints for GET, SET, and DELETE operations.
+     * Configures the HTTP server with endpoints for GET, SET, and DELETE operations,
+     * POST on `<key>/incr` for counters, and DELETE on a whole group for invalidation.
      */
     void SetupRoute();
     
@@ -61,12 +84,20 @@ private:
     void StartDiscovery();
     
     /**
-     * @brief Get the cache node responsible for handling a specific key.
+     * @brief Get a client for the cache node responsible for a specific key.
      * 
      * @param key The cache key to route.
-     * @return The network address of the cache node that should handle this key.
+     * @return A stub connected to the owning cache node, or nullptr if no node is known.
      */
-    auto GetCacheClient(std::string &key);
+    std::unique_ptr<cache::Cache::Stub> GetCacheClient(const std::string &key);
+
+    /**
+     * @brief Get the shared-memory client of the cache node responsible for a key.
+     * 
+     * @param key The cache key to route.
+     * @return The client, or nullptr if the owning node offers no shared memory to this host.
+     */
+    std::shared_ptr<ShmClient> GetShmClient(const std::string &key);
     
     /**
      * @brief Handle HTTP GET requests for cache retrieval.
@@ -91,15 +122,37 @@ private:
      * @param res The HTTP response to indicate operation success.
      */
     void Del(const httplib::Request &req, httplib::Response &res);
+
+    /**
+     * @brief Handle HTTP POST requests on `<key>/incr`: add `delta` (default 1) to a counter.
+     * 
+     * A missing counter is created holding `initial` (default `delta`) for `ttl_ms`.
+     * 
+     * @param req The incoming HTTP request containing the key and a JSON body.
+     * @param res The HTTP response with the new counter value.
+     */
+    void Incr(const httplib::Request &req, httplib::Response &res);
+
+    /**
+     * @brief Handle HTTP DELETE requests on a group: invalidate it, or only keys under `?prefix=`.
+     * 
+     * @param req The incoming HTTP request containing the group and optional prefix.
+     * @param res The HTTP response to indicate operation success.
+     */
+    void Invalidate(const httplib::Request &req, httplib::Response &res);
     
     int port_; ///< The HTTP port this gateway listens on.
     std::string etcd_endpoints_; ///< The etcd endpoints for service discovery.
     std::string service_name_; ///< The name of the cache service to discover.
+    bool local_transport_; ///< Dial colocated nodes over their Unix domain socket.
+    bool shm_; ///< Use the shared-memory transport of colocated nodes.
     httplib::Server http_server_; ///< The underlying HTTP server instance.
     std::shared_ptr<etcd::Client> etcd_client_; ///< etcd client for service discovery.
     std::mutex mtx_; ///< Mutex for thread-safe operations.
     std::thread discovery_thread_; ///< Thread for running service discovery.
     consistentHash consistent_hash_; ///< Consistent hash ring for load balancing.
+    std::unordered_map<std::string, std::string> targets_; ///< Node address -> gRPC target to dial (see LocalTarget).
+    std::unordered_map<std::string, std::shared_ptr<ShmClient>> shm_clients_; ///< Node address -> shared-memory client.
 };
 
 #endif // HTTPGATEWAY_H
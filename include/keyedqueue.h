@@ -0,0 +1,158 @@
+#ifndef KEYED_QUEUE_H
+#define KEYED_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "include/taskscheduler.h"
+
+/**
+ * @brief Runs tasks on a TaskScheduler in submission order per key, and tasks of different keys in parallel.
+ *
+ * Keys hash to one of kLanes FIFO lanes. A lane with queued tasks has one
+ * drain on the scheduler, which runs them one after the other, so two
+ * tasks of one key never run at once or out of order; the scheduler's
+ * LIFO pops and work stealing only reorder whole lanes.
+ *
+ * Used for replication: a client's Set then Delete of a key reach the
+ * key's owner in that order.
+ *
+ * A task submitted with SubmitAsync() keeps its lane until it calls the
+ * continuation it is given, e.g. from an RPC completion or a retry timer;
+ * the lane's later tasks wait, but no worker does.
+ */
+class KeyedQueue {
+public:
+    using Task = std::function<void()>;
+    using AsyncTask = std::function<void(Task done)>;
+
+    /**
+     * @brief Construct a queue.
+     *
+     * @param scheduler Runs the lane drains.
+     * @param priority The lane of the scheduler drains are submitted to.
+     */
+    explicit KeyedQueue(TaskScheduler& scheduler = TaskScheduler::Instance(),
+                        TaskPriority priority = TaskPriority::BACKGROUND)
+        : scheduler_(scheduler), priority_(priority) {}
+
+    KeyedQueue(const KeyedQueue&) = delete;
+    KeyedQueue& operator=(const KeyedQueue&) = delete;
+
+    /**
+     * @brief Wait for the queued tasks, which refer to the queue, including those not finished yet.
+     */
+    ~KeyedQueue() {
+        while (draining_.load(std::memory_order_acquire) > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    /**
+     * @brief Queue a task behind the earlier tasks of its key.
+     *
+     * @param key The key the task belongs to.
+     * @param task The task.
+     */
+    void Submit(const std::string& key, Task task) {
+        SubmitAsync(key, [task = std::move(task)](Task done) {
+            task();
+            done();
+        });
+    }
+
+    /**
+     * @brief Queue a task that finishes later, behind the earlier tasks of its key.
+     *
+     * The key's next task starts once `task` has called `done`, from any
+     * thread; `done` must be called exactly once.
+     *
+     * @param key The key the task belongs to.
+     * @param task The task; receives the continuation that releases the lane.
+     */
+    void SubmitAsync(const std::string& key, AsyncTask task) {
+        Lane& lane = lanes_[std::hash<std::string>{}(key) % kLanes];
+        {
+            std::lock_guard<std::mutex> lock(lane.mtx);
+            lane.tasks.push_back(std::move(task));
+            if (lane.draining) {
+                return;
+            }
+            lane.draining = true;
+        }
+        draining_.fetch_add(1, std::memory_order_relaxed);
+        scheduler_.Submit([this, &lane] { Drain(lane); }, priority_);
+    }
+
+private:
+    static constexpr size_t kLanes = 64; ///< Number of FIFO lanes keys hash to.
+
+    /**
+     * @brief Tasks of the keys hashing to one lane.
+     */
+    struct Lane {
+        std::mutex mtx;            ///< Guards `tasks` and `draining`.
+        std::deque<AsyncTask> tasks; ///< Queued tasks, oldest first.
+        bool draining = false;     ///< A drain is submitted or running, or a task has not finished.
+    };
+
+    /**
+     * @brief Where a task stands, for handing the lane between Drain() and the task's continuation.
+     */
+    enum class Step { RUNNING, FINISHED, SUSPENDED };
+
+    /**
+     * @brief Run a lane's tasks until it is empty, or until a task has not finished when it returns.
+     *
+     * A task that finishes later resubmits the drain from its continuation.
+     */
+    void Drain(Lane& lane) {
+        for (;;) {
+            AsyncTask task;
+            {
+                std::lock_guard<std::mutex> lock(lane.mtx);
+                if (lane.tasks.empty()) {
+                    lane.draining = false;
+                    break;
+                }
+                task = std::move(lane.tasks.front());
+                lane.tasks.pop_front();
+            }
+            auto step = std::make_shared<std::atomic<Step>>(Step::RUNNING);
+            bool failed = false;
+            try {
+                task([this, &lane, step] {
+                    if (step->exchange(Step::FINISHED, std::memory_order_acq_rel) == Step::SUSPENDED) {
+                        scheduler_.Submit([this, &lane] { Drain(lane); }, priority_);
+                    }
+                });
+            } catch (const std::exception& e) {
+                spdlog::error("Keyed task failed: {}", e.what());
+                failed = true;
+            }
+            if (!failed && step->exchange(Step::SUSPENDED, std::memory_order_acq_rel) != Step::FINISHED) {
+                return; // the continuation resumes the lane
+            }
+        }
+        draining_.fetch_sub(1, std::memory_order_release);
+    }
+
+    TaskScheduler& scheduler_;           ///< Runs the drains.
+    TaskPriority priority_;              ///< Scheduler lane of the drains.
+    std::array<Lane, kLanes> lanes_;     ///< FIFO lanes by key hash.
+    std::atomic<size_t> draining_{0};    ///< Lanes with a drain submitted or running.
+};
+
+#endif // KEYED_QUEUE_H
@@ -0,0 +1,196 @@
+#ifndef LEASE_TABLE_H
+#define LEASE_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Memcache-style leases on missing keys.
+ *
+ * The first caller to miss on a key gets a token and the right to fill it;
+ * callers that miss while the lease is outstanding get 0 (a hot miss) and
+ * are expected to retry shortly or use a stale value, so one miss costs one
+ * loader call instead of one per client. A lease ends when it is redeemed by
+ * a Set, when the key is written or deleted by anyone else (Invalidate), or
+ * after the lease TTL; a Set with an ended lease is refused, which keeps a
+ * slow filler from overwriting a newer value with the one it read earlier.
+ *
+ * Leases live in hashed shards, each with its own mutex. Redeem() and
+ * Invalidate() run a callback under the shard lock, so a leased store and a
+ * concurrent delete of the same key are ordered.
+ */
+class LeaseTable {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Construct a lease table.
+     *
+     * @param ttl How long a lease stays valid if it is never redeemed.
+     */
+    explicit LeaseTable(std::chrono::milliseconds ttl = std::chrono::seconds(3)) : ttl_(ttl) {}
+
+    /**
+     * @brief Try to take the lease on a key after a miss.
+     *
+     * @param key The key that missed.
+     * @return A non-zero token, or 0 if another caller holds a live lease (hot miss).
+     */
+    uint64_t Acquire(const std::string& key) {
+        auto now = Clock::now();
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        if (shard.leases.size() >= kPruneThreshold) {
+            Prune(shard, now);
+        }
+        auto& lease = shard.leases[key];
+        if (lease.token != 0 && lease.expiry > now) {
+            return 0;
+        }
+        lease.token = nextToken_.fetch_add(1, std::memory_order_relaxed);
+        lease.expiry = now + ttl_;
+        shard.live.store(shard.leases.size(), std::memory_order_release);
+        return lease.token;
+    }
+
+    /**
+     * @brief Whether a key has a live lease (someone is filling it).
+     */
+    bool Outstanding(const std::string& key) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.leases.find(key);
+        return it != shard.leases.end() && it->second.expiry > Clock::now();
+    }
+
+    /**
+     * @brief End a lease by filling the key, if the token is still valid.
+     *
+     * @param key The key.
+     * @param token The token returned by Acquire().
+     * @param store Stores the value; runs under the shard lock, only if the lease is valid.
+     * @return True if the lease was valid and `store` ran.
+     */
+    template<typename Store>
+    bool Redeem(const std::string& key, uint64_t token, Store&& store) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.leases.find(key);
+        if (token == 0 || it == shard.leases.end() || it->second.token != token || it->second.expiry <= Clock::now()) {
+            return false;
+        }
+        shard.leases.erase(it);
+        shard.live.store(shard.leases.size(), std::memory_order_release);
+        store();
+        return true;
+    }
+
+    /**
+     * @brief End any lease on a key because the key was written or deleted.
+     *
+     * @param key The key.
+     * @param update The write or delete; runs under the shard lock.
+     */
+    template<typename Update>
+    void Invalidate(const std::string& key, Update&& update) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.leases.erase(key);
+        shard.live.store(shard.leases.size(), std::memory_order_release);
+        update();
+    }
+
+    /**
+     * @brief Run a callback under a key's shard lock, leaving any lease on the key alone.
+     *
+     * Orders a fill from the loader against the writes made under Redeem()
+     * and Invalidate(), so the fill can check for a newer value first.
+     *
+     * @param key The key.
+     * @param fn Runs under the shard lock.
+     */
+    template<typename Fn>
+    void WithLock(const std::string& key, Fn&& fn) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        fn();
+    }
+
+    /**
+     * @brief End any lease on a key because it was written or deleted elsewhere.
+     *
+     * Invalidate() with nothing to run under the lock: a shard that holds
+     * no lease is skipped without taking its lock.
+     *
+     * @param key The key.
+     */
+    void End(const std::string& key) {
+        Shard& shard = ShardFor(key);
+        if (shard.live.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.leases.erase(key);
+        shard.live.store(shard.leases.size(), std::memory_order_release);
+    }
+
+    /**
+     * @brief End every lease on keys starting with a prefix (see Generations).
+     *
+     * @param prefix The key prefix; empty ends every lease.
+     */
+    void InvalidatePrefix(const std::string& prefix) {
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            for (auto it = shard.leases.begin(); it != shard.leases.end();) {
+                it = it->first.starts_with(prefix) ? shard.leases.erase(it) : std::next(it);
+            }
+            shard.live.store(shard.leases.size(), std::memory_order_release);
+        }
+    }
+
+private:
+    static constexpr size_t kShards = 64;            ///< Number of independently locked shards.
+    static constexpr size_t kPruneThreshold = 1024;  ///< Shard size that triggers dropping expired leases.
+
+    /**
+     * @brief An outstanding lease.
+     */
+    struct Lease {
+        uint64_t token = 0;         ///< Token handed to the filler.
+        Clock::time_point expiry;   ///< When the lease lapses.
+    };
+
+    /**
+     * @brief Leases of the keys hashing to one shard.
+     */
+    struct Shard {
+        std::mutex mtx;                                  ///< Guards `leases`.
+        std::unordered_map<std::string, Lease> leases;   ///< Leases by key.
+        std::atomic<size_t> live{0};                     ///< Size of `leases`, read by End() without the lock.
+    };
+
+    Shard& ShardFor(const std::string& key) {
+        return shards_[std::hash<std::string>{}(key) % kShards];
+    }
+
+    static void Prune(Shard& shard, Clock::time_point now) {
+        for (auto it = shard.leases.begin(); it != shard.leases.end();) {
+            it = it->second.expiry <= now ? shard.leases.erase(it) : std::next(it);
+        }
+    }
+
+    std::chrono::milliseconds ttl_;               ///< Lease lifetime.
+    std::atomic<uint64_t> nextToken_{1};          ///< Next token (0 means "no lease").
+    std::array<Shard, kShards> shards_;           ///< Hashed lease shards.
+};
+
+#endif // LEASE_TABLE_H
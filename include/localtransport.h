@@ -0,0 +1,37 @@
+#ifndef LOCAL_TRANSPORT_H
+#define LOCAL_TRANSPORT_H
+
+#include <string>
+
+/**
+ * @brief Host-local endpoints of a cache node, derived from its registered address.
+ *
+ * A node registered as `host:port` also listens on a Unix domain socket at
+ * LocalSocketPath() and may offer a shared-memory segment named
+ * ShmSegmentName() (see ShmServer). Both names are derived from the address
+ * alone, so a colocated client finds them without asking the node or etcd.
+ */
+
+/**
+ * @brief Path of the Unix domain socket a node serving `addr` listens on.
+ */
+std::string LocalSocketPath(const std::string& addr);
+
+/**
+ * @brief Name (for shm_open) of the shared-memory segment a node serving `addr` offers.
+ */
+std::string ShmSegmentName(const std::string& addr);
+
+/**
+ * @brief Whether an address names this host: loopback, this host's name or one of its interface addresses.
+ *
+ * A bare port (no host part) counts as local.
+ */
+bool IsLocalAddress(const std::string& addr);
+
+/**
+ * @brief The gRPC target to dial for a node: its Unix domain socket if it runs on this host and listens there, else `addr`.
+ */
+std::string LocalTarget(const std::string& addr);
+
+#endif // LOCAL_TRANSPORT_H
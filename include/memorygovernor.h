@@ -0,0 +1,156 @@
+#ifndef MEMORY_GOVERNOR_H
+#define MEMORY_GOVERNOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A consumer of node memory that the governor can account and shrink.
+ *
+ * Implemented by CacheGroup. Usage is an estimate; reclaiming evicts entries
+ * in the tenant's own eviction order.
+ */
+class MemoryTenant {
+public:
+    virtual ~MemoryTenant() = default;
+
+    /**
+     * @brief Name used in logs and statistics.
+     */
+    virtual const std::string& TenantName() const = 0;
+
+    /**
+     * @brief Estimated bytes currently held.
+     */
+    virtual size_t MemoryUsage() = 0;
+
+    /**
+     * @brief Bytes the tenant is guaranteed before others are reclaimed (0 = equal share).
+     */
+    virtual size_t SoftQuota() const = 0;
+
+    /**
+     * @brief Free at least the given number of bytes if possible.
+     *
+     * @param bytes Bytes to free.
+     * @return Bytes actually freed (estimated).
+     */
+    virtual size_t Reclaim(size_t bytes) = 0;
+};
+
+/**
+ * @brief Usage of one tenant as seen by the last accounting pass.
+ */
+struct TenantUsage {
+    std::string name;   ///< Tenant name.
+    size_t bytes = 0;   ///< Estimated bytes held.
+    size_t share = 0;   ///< Fair share of the node limit.
+};
+
+/**
+ * @brief Node-level memory bound shared by all cache groups.
+ *
+ * Tenants report growth through OnGrowth(). Every few growth events the
+ * governor sums the tenants' usage; above `high_watermark * limit` it runs a
+ * reclaim pass on the scheduler's background lane that brings the node down
+ * to `low_watermark * limit`. The bytes to free are taken only from tenants
+ * above their fair share of that target, in proportion to how far above it
+ * they are, so a bursty tenant pays for its own burst; what a tenant cannot
+ * free is split again among the other tenants above their share. Only when
+ * soft quotas overcommit the target are tenants within their share reclaimed
+ * from, and only by the amount overcommitted.
+ *
+ * A tenant's fair share is its soft quota if it has one; tenants without a
+ * soft quota split what is left of the limit equally. If the node is over
+ * the limit itself, the growing tenant also reclaims inline when it is above
+ * its share, which bounds overshoot while the background pass is queued.
+ *
+ * With a limit of 0 (the default) the governor only keeps accounts.
+ */
+class MemoryGovernor {
+public:
+    /**
+     * @brief The process-wide governor.
+     */
+    static MemoryGovernor& Instance();
+
+    /**
+     * @brief Set the node limit.
+     *
+     * @param limitBytes Node memory limit for cached data (0 disables enforcement).
+     * @param highWatermark Fraction of the limit that triggers a reclaim pass.
+     * @param lowWatermark Fraction of the limit a reclaim pass brings usage down to.
+     */
+    void Configure(size_t limitBytes, double highWatermark = 0.9, double lowWatermark = 0.8);
+
+    /**
+     * @brief Start accounting a tenant.
+     */
+    void Register(MemoryTenant* tenant);
+
+    /**
+     * @brief Stop accounting a tenant (no-op if it was never registered).
+     */
+    void Unregister(MemoryTenant* tenant);
+
+    /**
+     * @brief Report that a tenant stored new data.
+     *
+     * Cheap on most calls: one relaxed increment. Every kCheckInterval calls
+     * the tenants' usage is summed and reclaiming is started if needed.
+     *
+     * @param tenant The tenant that grew.
+     */
+    void OnGrowth(MemoryTenant* tenant);
+
+    /**
+     * @brief Fair share of a tenant under the current limit (0 when unlimited).
+     */
+    size_t FairShare(const MemoryTenant* tenant);
+
+    /**
+     * @brief Per-tenant usage and fair shares, computed now.
+     */
+    std::vector<TenantUsage> Snapshot();
+
+    /**
+     * @brief Configured node limit in bytes (0 = unlimited).
+     */
+    size_t Limit() const { return limit_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Bytes freed by reclaim passes and inline reclaims so far.
+     */
+    uint64_t Reclaimed() const { return reclaimed_.load(std::memory_order_relaxed); }
+
+private:
+    MemoryGovernor() = default;
+
+    static constexpr uint64_t kCheckInterval = 64; ///< Growth events between usage checks.
+
+    /**
+     * @brief Fair shares of all tenants; mtx_ must be held.
+     */
+    std::vector<size_t> SharesLocked(size_t limit) const;
+
+    /**
+     * @brief Free bytes from tenants above their fair share until usage reaches the low watermark (see the class comment).
+     */
+    void ReclaimPass();
+
+    std::atomic<size_t> limit_{0};            ///< Node limit in bytes (0 = unlimited).
+    std::atomic<double> highWatermark_{0.9};  ///< Fraction of the limit that triggers reclaiming.
+    std::atomic<double> lowWatermark_{0.8};   ///< Fraction of the limit reclaiming aims for.
+    std::atomic<uint64_t> growth_{0};         ///< Growth events since start.
+    std::atomic<bool> reclaiming_{false};     ///< A reclaim pass is queued or running.
+    std::atomic<uint64_t> reclaimed_{0};      ///< Total bytes reclaimed.
+
+    std::mutex mtx_;                          ///< Guards `tenants_`.
+    std::vector<MemoryTenant*> tenants_;      ///< Registered tenants.
+};
+
+#endif // MEMORY_GOVERNOR_H
@@ -9,9 +9,11 @@
 #include <grpcpp/security/credentials.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <chrono>
 #include <etcd/Client.hpp>
 #include <etcd/Response.hpp>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <shared_mutex>
@@ -21,6 +23,10 @@
 #include <unordered_map>
 
 #include "cache.grpc.pb.h"
+#include "include/chunkedvalue.h"
+#include "include/groupregistry.h"
+#include "include/tracing.h"
+#include "include/wirecodec.h"
 
 /**
  * @brief Represents a peer cache node in the distributed cache system.
@@ -48,52 +54,112 @@ public:
     /**
      * @brief Gets the value associated with a key in a specific group.
      * 
-     * This method sends a gRPC Get request to the peer and deserializes the response
-     * based on the template type. Currently supports std::string and int types.
+     * This method sends a gRPC Get request to the peer and decodes the response
+     * with WireCodec<T>; ChunkedValue groups use get_stream() instead. The request is marked as an owner load
+     * (kOwnerLoadMetadata): the peer is expected to own the key and loads it
+     * itself on a miss instead of forwarding it again.
      * 
-     * @tparam T The type of the value to retrieve (std::string or int).
+     * @tparam T The value type of the group (any type WireCodec supports).
      * @param group_name The name of the group.
      * @param key The key to look up.
+     * @param status Optional output parameter for the RPC status (INTERNAL if the value did not decode).
+     * @param timeout How long to wait, including the peer's own load on a miss.
      * @return An optional containing the value if found, or std::nullopt if not found.
      */
     template<typename T>
-    std::optional<T> get(const std::string& group_name, const std::string& key) {
+    std::optional<T> get(const std::string& group_name, const std::string& key, grpc::Status* status = nullptr,
+                         std::chrono::milliseconds timeout = std::chrono::seconds(3)) {
+        if constexpr (std::is_same_v<T, ChunkedValue>) {
+            return get_stream(group_name, key, status, timeout);
+        }
+        Span span("peer.get");
+        span.SetAttribute("peer", name_);
         grpc::ClientContext context;
-        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+        context.set_deadline(std::chrono::system_clock::now() + timeout);
+        context.AddMetadata(kOwnerLoadMetadata, "1");
+        InjectTraceContext(context);
         cache::Request request;
         request.set_group(group_name);
         request.set_key(key);
         cache::GetResponse response;
-        grpc::Status status = stub_->Get(&context, request, &response);
-        if (!status.ok() || !response.has_value()) {
+        grpc::Status result = stub_->Get(&context, request, &response);
+        if (result.ok() && response.payload_case() == cache::GetResponse::PAYLOAD_NOT_SET) {
+            result = grpc::Status(grpc::StatusCode::INTERNAL, "empty response");
+        }
+        T value{};
+        if (result.ok() && !WireCodec<T>::Decode(response, value)) {
+            spdlog::error("Failed to unpack response value for key: {} to requested type", key);
+            result = grpc::Status(grpc::StatusCode::INTERNAL, "value does not decode to the requested type");
+        }
+        if (status) {
+            *status = result;
+        }
+        if (!result.ok()) {
+            span.SetError(result.error_message());
             return std::nullopt;
         }
-        if constexpr (std::is_same_v<T, std::string>) {
-            google::protobuf::StringValue w;
-            if (response.value().UnpackTo(&w)) {
-                return w.value();
-            }
-        } else if constexpr (std::is_same_v<T, int> || std::is_same_v<T, int32_t>) {
-            google::protobuf::Int32Value w;
-            if (response.value().UnpackTo(&w)) {
-                return static_cast<T>(w.value());
-            }
+        return value;
+    }
+
+    /**
+     * @brief Gets a value like get(), without blocking the calling thread.
+     *
+     * The call is issued on gRPC's callback API; `done` runs on a gRPC
+     * thread once the peer answers or the deadline passes, and must not
+     * block. The "peer.get" span covers only issuing the call.
+     *
+     * @tparam T The value type of the group.
+     * @param group_name The name of the group.
+     * @param key The key to look up.
+     * @param timeout How long to wait, including the peer's own load on a miss.
+     * @param done Receives the RPC status (INTERNAL if the value did not decode), the value if it is OK,
+     *        and the time the value has left at the peer in ms (0 = no expiry).
+     */
+    template<typename T>
+    void get_async(const std::string& group_name, const std::string& key, std::chrono::milliseconds timeout,
+                   std::function<void(const grpc::Status&, std::optional<T>, uint64_t)> done) {
+        if constexpr (std::is_same_v<T, ChunkedValue>) {
+            get_stream_async(group_name, key, timeout, std::move(done));
         } else {
-            static_assert(std::is_same_v<T, void>, "peer::get supports only std::string and int");
+            Span span("peer.get");
+            span.SetAttribute("peer", name_);
+            struct Call {
+                grpc::ClientContext context;
+                cache::Request request;
+                cache::GetResponse response;
+            };
+            auto call = std::make_shared<Call>();
+            call->context.set_deadline(std::chrono::system_clock::now() + timeout);
+            call->context.AddMetadata(kOwnerLoadMetadata, "1");
+            InjectTraceContext(call->context);
+            call->request.set_group(group_name);
+            call->request.set_key(key);
+            stub_->async()->Get(&call->context, &call->request, &call->response,
+                                [call, done = std::move(done)](grpc::Status result) {
+                if (result.ok() && call->response.payload_case() == cache::GetResponse::PAYLOAD_NOT_SET) {
+                    result = grpc::Status(grpc::StatusCode::INTERNAL, "empty response");
+                }
+                T value{};
+                if (result.ok() && !WireCodec<T>::Decode(call->response, value)) {
+                    spdlog::error("Failed to unpack response value for key: {} to requested type", call->request.key());
+                    result = grpc::Status(grpc::StatusCode::INTERNAL, "value does not decode to the requested type");
+                }
+                if (!result.ok()) {
+                    done(result, std::nullopt, 0);
+                    return;
+                }
+                done(result, std::move(value), call->response.ttl_ms());
+            });
         }
-
-        spdlog::error("Failed to unpack response value for key: {} to requested type", key);
-        return std::nullopt;
     }
 
     /**
      * @brief Sets a value for a key in a specific group.
      * 
      * This method sends a gRPC Set request to the peer with the specified value.
-     * The value is automatically serialized based on its type using Protocol Buffers.
-     * Currently supports std::string and int types.
+     * The value is encoded with WireCodec<T>; ChunkedValue groups use set_stream() instead.
      * 
-     * @tparam T The type of the value to set (std::string or int).
+     * @tparam T The value type of the group (any type WireCodec supports).
      * @param group_name The name of the group.
      * @param key The key to set.
      * @param value The value to associate with the key.
@@ -101,26 +167,24 @@ public:
      */
     template<typename T>
     bool set(const std::string& group_name, const std::string& key, const T& value) {
+        if constexpr (std::is_same_v<T, ChunkedValue>) {
+            return set_stream(group_name, key, value);
+        }
+        Span span("peer.set");
+        span.SetAttribute("peer", name_);
         grpc::ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+        InjectTraceContext(context);
         cache::Request request;
         request.set_group(group_name);
         request.set_key(key);
 
-        if constexpr (std::is_same_v<T, std::string>) {
-            google::protobuf::StringValue w;
-            w.set_value(value);
-            request.mutable_value()->PackFrom(w);
-        } else if constexpr (std::is_same_v<T, int> || std::is_same_v<T, int32_t>) {
-            google::protobuf::Int32Value w;
-            w.set_value(static_cast<int32_t>(value));
-            request.mutable_value()->PackFrom(w);
-        } else {
-            static_assert(std::is_same_v<T, void>, "peer::set supports only std::string and int");
-        }
+        WireCodec<T>::Encode(value, &request);
 
         cache::SetResponse response;
         grpc::Status status = stub_->Set(&context, request, &response);
         if (!status.ok()) {
+            span.SetError(status.error_message());
             spdlog::error("Set RPC failed for {}:{} — {} (code={})",
                         group_name, key, status.error_message(), static_cast<int>(status.error_code()));
             return false;
@@ -128,6 +192,190 @@ public:
         return true;
     }
 
+    /**
+     * @brief Sets a value like set(), without blocking the calling thread.
+     *
+     * ChunkedValue groups go through set_stream_async().
+     *
+     * @tparam T The value type of the group.
+     * @param group_name The name of the group.
+     * @param key The key to set.
+     * @param value The value to associate with the key.
+     * @param done Runs on a gRPC thread with whether the peer stored the value; must not block.
+     */
+    template<typename T>
+    void set_async(const std::string& group_name, const std::string& key, const T& value,
+                   std::function<void(bool)> done) {
+        if constexpr (std::is_same_v<T, ChunkedValue>) {
+            set_stream_async(group_name, key, value, std::move(done));
+        } else {
+            Span span("peer.set");
+            span.SetAttribute("peer", name_);
+            struct Call {
+                grpc::ClientContext context;
+                cache::Request request;
+                cache::SetResponse response;
+            };
+            auto call = std::make_shared<Call>();
+            call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+            InjectTraceContext(call->context);
+            call->request.set_group(group_name);
+            call->request.set_key(key);
+            WireCodec<T>::Encode(value, &call->request);
+            stub_->async()->Set(&call->context, &call->request, &call->response,
+                                [call, done = std::move(done)](grpc::Status status) {
+                if (!status.ok()) {
+                    spdlog::error("Set RPC failed for {}:{} — {} (code={})", call->request.group(),
+                                  call->request.key(), status.error_message(), static_cast<int>(status.error_code()));
+                }
+                done(status.ok());
+            });
+        }
+    }
+
+    /**
+     * @brief Gets a large value chunk by chunk over GetStream.
+     *
+     * Marked as an owner load, like get(). The chunks are collected into a
+     * chain as they arrive, so the value is never held in one buffer.
+     *
+     * @param group_name The name of the group.
+     * @param key The key to look up.
+     * @param status Optional output parameter for the RPC status.
+     * @param timeout How long to wait for the whole stream.
+     * @return The value, or std::nullopt if the stream failed.
+     */
+    std::optional<ChunkedValue> get_stream(const std::string& group_name, const std::string& key,
+                                           grpc::Status* status = nullptr,
+                                           std::chrono::milliseconds timeout = std::chrono::seconds(3)) {
+        Span span("peer.get_stream");
+        span.SetAttribute("peer", name_);
+        grpc::ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + timeout);
+        context.AddMetadata(kOwnerLoadMetadata, "1");
+        InjectTraceContext(context);
+        cache::Request request;
+        request.set_group(group_name);
+        request.set_key(key);
+        auto reader = stub_->GetStream(&context, request);
+        ChunkedValue::Builder builder;
+        cache::Chunk chunk;
+        bool ordered = true;
+        while (ordered && reader->Read(&chunk)) {
+            ordered = builder.AppendAt(chunk.offset(), std::move(*chunk.mutable_data()));
+        }
+        if (!ordered) {
+            context.TryCancel();
+        }
+        grpc::Status result = reader->Finish();
+        if (!ordered) {
+            result = grpc::Status(grpc::StatusCode::DATA_LOSS, "Chunk is missing or out of order");
+        }
+        if (status) {
+            *status = result;
+        }
+        if (!result.ok()) {
+            span.SetError(result.error_message());
+            return std::nullopt;
+        }
+        return builder.Build();
+    }
+
+    /**
+     * @brief Gets a large value over GetStream like get_stream(), without blocking the calling thread.
+     *
+     * @param group_name The name of the group.
+     * @param key The key to look up.
+     * @param timeout How long to wait for the whole stream.
+     * @param done Runs on a gRPC thread with the stream's status, the value if it is OK, and the
+     *        time the value has left at the peer in ms (0 = no expiry); must not block.
+     */
+    void get_stream_async(const std::string& group_name, const std::string& key, std::chrono::milliseconds timeout,
+                          std::function<void(const grpc::Status&, std::optional<ChunkedValue>, uint64_t)> done) {
+        Span span("peer.get_stream");
+        span.SetAttribute("peer", name_);
+        auto* reader = new StreamReader(std::move(done));
+        reader->context.set_deadline(std::chrono::system_clock::now() + timeout);
+        reader->context.AddMetadata(kOwnerLoadMetadata, "1");
+        InjectTraceContext(reader->context);
+        reader->request.set_group(group_name);
+        reader->request.set_key(key);
+        stub_->async()->GetStream(&reader->context, &reader->request, reader);
+        reader->StartRead(&reader->chunk);
+        reader->StartCall();
+    }
+
+    /**
+     * @brief Sets a large value chunk by chunk over SetStream.
+     *
+     * @param group_name The name of the group.
+     * @param key The key to set.
+     * @param value The value; each of its chunks is sent as one message.
+     * @param timeout How long to wait for the whole stream.
+     * @return True if the operation was successful, false otherwise.
+     */
+    bool set_stream(const std::string& group_name, const std::string& key, const ChunkedValue& value,
+                    std::chrono::milliseconds timeout = std::chrono::seconds(3)) {
+        Span span("peer.set_stream");
+        span.SetAttribute("peer", name_);
+        grpc::ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + timeout);
+        InjectTraceContext(context);
+        cache::SetResponse response;
+        auto writer = stub_->SetStream(&context, &response);
+        cache::Chunk chunk;
+        chunk.set_group(group_name);
+        chunk.set_key(key);
+        chunk.set_total_size(value.size());
+        size_t offset = 0;
+        for (size_t i = 0; i < value.chunks(); ++i) {
+            const SliceValue& piece = value.chunk(i);
+            chunk.set_offset(offset);
+            chunk.set_data(piece.data(), piece.size());
+            if (!writer->Write(chunk)) {
+                break;
+            }
+            offset += piece.size();
+            chunk.Clear();
+        }
+        if (value.chunks() == 0) {
+            writer->Write(chunk);
+        }
+        writer->WritesDone();
+        grpc::Status status = writer->Finish();
+        if (!status.ok()) {
+            span.SetError(status.error_message());
+            spdlog::error("SetStream RPC failed for {}:{} — {} (code={})",
+                        group_name, key, status.error_message(), static_cast<int>(status.error_code()));
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Sets a large value over SetStream like set_stream(), without blocking the calling thread.
+     *
+     * The next chunk is written when the previous write completes, so the
+     * value is never copied into one buffer.
+     *
+     * @param group_name The name of the group.
+     * @param key The key to set.
+     * @param value The value; each of its chunks is sent as one message.
+     * @param done Runs on a gRPC thread with whether the peer stored the value; must not block.
+     * @param timeout How long to wait for the whole stream.
+     */
+    void set_stream_async(const std::string& group_name, const std::string& key, const ChunkedValue& value,
+                          std::function<void(bool)> done,
+                          std::chrono::milliseconds timeout = std::chrono::seconds(3)) {
+        Span span("peer.set_stream");
+        span.SetAttribute("peer", name_);
+        auto* writer = new StreamWriter(group_name, key, value, std::move(done));
+        writer->context.set_deadline(std::chrono::system_clock::now() + timeout);
+        InjectTraceContext(writer->context);
+        stub_->async()->SetStream(&writer->context, &writer->response, writer);
+        writer->Start();
+    }
+
     /**
      * @brief Deletes a key from a specific group.
      * 
@@ -138,21 +386,293 @@ public:
      * @return True if the operation was successful, false otherwise.
      */
     bool delete_key(const std::string& group_name, const std::string& key) {
+        Span span("peer.delete");
+        span.SetAttribute("peer", name_);
         grpc::ClientContext context;
         context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+        InjectTraceContext(context);
         cache::Request request;
         request.set_group(group_name);
         request.set_key(key);
         cache::DeleteResponse response;
         grpc::Status status = stub_->Delete(&context, request, &response);
         if (!status.ok()) {
+            span.SetError(status.error_message());
             spdlog::error("Failed to delete key from peer: {}", status.error_message());
             return false;
         }
         return true;
     }
 
+    /**
+     * @brief Deletes a key like delete_key(), without blocking the calling thread.
+     *
+     * @param group_name The name of the group.
+     * @param key The key to delete.
+     * @param done Runs on a gRPC thread with whether the peer deleted the key; must not block.
+     */
+    void delete_key_async(const std::string& group_name, const std::string& key, std::function<void(bool)> done) {
+        Span span("peer.delete");
+        span.SetAttribute("peer", name_);
+        struct Call {
+            grpc::ClientContext context;
+            cache::Request request;
+            cache::DeleteResponse response;
+        };
+        auto call = std::make_shared<Call>();
+        call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+        InjectTraceContext(call->context);
+        call->request.set_group(group_name);
+        call->request.set_key(key);
+        stub_->async()->Delete(&call->context, &call->request, &call->response,
+                               [call, done = std::move(done)](grpc::Status status) {
+            if (!status.ok()) {
+                spdlog::error("Failed to delete key from peer: {}", status.error_message());
+            }
+            done(status.ok());
+        });
+    }
+
+    /**
+     * @brief Adds to a counter on the peer that owns it.
+     *
+     * The request is marked as an owner request (kOwnerLoadMetadata), so the
+     * peer applies it itself instead of forwarding it again.
+     *
+     * @param request The increment.
+     * @param response Receives the counter after the increment.
+     * @return The peer's status, passed through to the caller.
+     */
+    grpc::Status incr(const cache::IncrRequest& request, cache::IncrResponse* response) {
+        Span span("peer.incr");
+        span.SetAttribute("peer", name_);
+        grpc::ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+        context.AddMetadata(kOwnerLoadMetadata, "1");
+        InjectTraceContext(context);
+        grpc::Status status = stub_->Incr(&context, request, response);
+        if (!status.ok()) {
+            span.SetError(status.error_message());
+        }
+        return status;
+    }
+
+    /**
+     * @brief Compares and sets a key on the peer that owns it.
+     *
+     * Marked as an owner request, like incr().
+     *
+     * @param request The write and the expected value.
+     * @param response Receives whether the value was stored, or the value found instead.
+     * @return The peer's status, passed through to the caller.
+     */
+    grpc::Status compare_and_set(const cache::CompareAndSetRequest& request, cache::CompareAndSetResponse* response) {
+        Span span("peer.compare_and_set");
+        span.SetAttribute("peer", name_);
+        grpc::ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+        context.AddMetadata(kOwnerLoadMetadata, "1");
+        InjectTraceContext(context);
+        grpc::Status status = stub_->CompareAndSet(&context, request, response);
+        if (!status.ok()) {
+            span.SetError(status.error_message());
+        }
+        return status;
+    }
+
+    /**
+     * @brief Adds to a counter on its owner like incr(), without blocking the calling thread.
+     *
+     * @param request The increment.
+     * @param response Receives the counter; must stay valid until `done` runs.
+     * @param done Runs on a gRPC thread with the peer's status; must not block.
+     */
+    void incr_async(const cache::IncrRequest& request, cache::IncrResponse* response,
+                    std::function<void(const grpc::Status&)> done) {
+        Span span("peer.incr");
+        span.SetAttribute("peer", name_);
+        struct Call {
+            grpc::ClientContext context;
+            cache::IncrRequest request;
+        };
+        auto call = std::make_shared<Call>();
+        call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+        call->context.AddMetadata(kOwnerLoadMetadata, "1");
+        InjectTraceContext(call->context);
+        call->request = request;
+        stub_->async()->Incr(&call->context, &call->request, response,
+                             [call, done = std::move(done)](grpc::Status status) { done(status); });
+    }
+
+    /**
+     * @brief Compares and sets a key on its owner like compare_and_set(), without blocking the calling thread.
+     *
+     * @param request The write and the expected value.
+     * @param response Receives the outcome; must stay valid until `done` runs.
+     * @param done Runs on a gRPC thread with the peer's status; must not block.
+     */
+    void compare_and_set_async(const cache::CompareAndSetRequest& request, cache::CompareAndSetResponse* response,
+                               std::function<void(const grpc::Status&)> done) {
+        Span span("peer.compare_and_set");
+        span.SetAttribute("peer", name_);
+        struct Call {
+            grpc::ClientContext context;
+            cache::CompareAndSetRequest request;
+        };
+        auto call = std::make_shared<Call>();
+        call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+        call->context.AddMetadata(kOwnerLoadMetadata, "1");
+        InjectTraceContext(call->context);
+        call->request = request;
+        stub_->async()->CompareAndSet(&call->context, &call->request, response,
+                                      [call, done = std::move(done)](grpc::Status status) { done(status); });
+    }
+
+    /**
+     * @brief Invalidates every key starting with a prefix in a specific group.
+     * 
+     * The request is marked `local`, so the peer applies it without sending
+     * it on to its own peers.
+     * 
+     * @param group_name The name of the group.
+     * @param prefix The key prefix; empty invalidates the whole group.
+     * @return True if the operation was successful, false otherwise.
+     */
+    bool invalidate(const std::string& group_name, const std::string& prefix) {
+        Span span("peer.invalidate");
+        span.SetAttribute("peer", name_);
+        grpc::ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(3));
+        InjectTraceContext(context);
+        cache::InvalidateRequest request;
+        request.set_group(group_name);
+        request.set_prefix(prefix);
+        request.set_local(true);
+        cache::InvalidateResponse response;
+        grpc::Status status = stub_->Invalidate(&context, request, &response);
+        if (!status.ok()) {
+            span.SetError(status.error_message());
+            spdlog::error("Failed to invalidate prefix '{}' of group {} on peer {}: {}", prefix, group_name, name_,
+                          status.error_message());
+            return false;
+        }
+        return true;
+    }
+
 private:
+    /**
+     * @brief One GetStream call of get_stream_async(); deletes itself when the stream is done.
+     */
+    class StreamReader : public grpc::ClientReadReactor<cache::Chunk> {
+    public:
+        explicit StreamReader(std::function<void(const grpc::Status&, std::optional<ChunkedValue>, uint64_t)> done)
+            : done_(std::move(done)) {}
+
+        void OnReadDone(bool ok) override {
+            if (ok) {
+                if (chunk.ttl_ms() != 0) {
+                    ttlMs_ = chunk.ttl_ms();
+                }
+                if (!builder_.AppendAt(chunk.offset(), std::move(*chunk.mutable_data()))) {
+                    misordered_ = true;
+                    context.TryCancel();
+                    return;
+                }
+                StartRead(&chunk);
+            }
+        }
+
+        void OnDone(const grpc::Status& status) override {
+            if (misordered_) {
+                done_(grpc::Status(grpc::StatusCode::DATA_LOSS, "Chunk is missing or out of order"), std::nullopt, 0);
+            } else if (status.ok()) {
+                done_(status, builder_.Build(), ttlMs_);
+            } else {
+                done_(status, std::nullopt, 0);
+            }
+            delete this;
+        }
+
+        grpc::ClientContext context; ///< Context of the call.
+        cache::Request request;      ///< The key requested.
+        cache::Chunk chunk;          ///< Message of the read in flight.
+
+    private:
+        std::function<void(const grpc::Status&, std::optional<ChunkedValue>, uint64_t)> done_; ///< Completion.
+        ChunkedValue::Builder builder_; ///< The value received so far.
+        uint64_t ttlMs_ = 0;            ///< `ttl_ms` of the first chunk.
+        bool misordered_ = false;       ///< A chunk did not continue the value; the call was cancelled.
+    };
+
+    /**
+     * @brief One SetStream call of set_stream_async(); deletes itself when the stream is done.
+     */
+    class StreamWriter : public grpc::ClientWriteReactor<cache::Chunk> {
+    public:
+        StreamWriter(const std::string& group, const std::string& key, const ChunkedValue& value,
+                     std::function<void(bool)> done)
+            : value_(value), done_(std::move(done)), key_(key) {
+            chunk_.set_group(group);
+            chunk_.set_key(key);
+            chunk_.set_total_size(value.size());
+        }
+
+        /**
+         * @brief Start the call with its first chunk (an empty one for an empty value).
+         */
+        void Start() {
+            WriteNext();
+            StartCall();
+        }
+
+        void OnWriteDone(bool ok) override {
+            if (!ok) {
+                return; // the stream is broken; OnDone() reports its status
+            }
+            chunk_.Clear();
+            WriteNext();
+        }
+
+        void OnDone(const grpc::Status& status) override {
+            if (!status.ok()) {
+                spdlog::error("SetStream RPC failed for {} — {} (code={})", key_, status.error_message(),
+                              static_cast<int>(status.error_code()));
+            }
+            done_(status.ok());
+            delete this;
+        }
+
+        grpc::ClientContext context; ///< Context of the call.
+        cache::SetResponse response; ///< The peer's answer.
+
+    private:
+        /**
+         * @brief Write the next chunk, or close the stream after the last one.
+         */
+        void WriteNext() {
+            size_t chunks = std::max<size_t>(value_.chunks(), 1); // an empty value still sends one message
+            if (next_ == chunks) {
+                StartWritesDone();
+                return;
+            }
+            chunk_.set_offset(offset_);
+            if (next_ < value_.chunks()) {
+                const SliceValue& piece = value_.chunk(next_);
+                chunk_.set_data(piece.data(), piece.size());
+                offset_ += piece.size();
+            }
+            ++next_;
+            StartWrite(&chunk_);
+        }
+
+        ChunkedValue value_;            ///< The value being sent (shares the caller's chunks).
+        std::function<void(bool)> done_; ///< Completion.
+        std::string key_;               ///< The key, for logging once chunk_ is cleared.
+        cache::Chunk chunk_;            ///< Message of the write in flight.
+        size_t next_ = 0;               ///< Index of the next chunk to write.
+        size_t offset_ = 0;             ///< Offset of the next chunk in the value.
+    };
+
     std::string name_; ///< The network address (host:port) of this peer.
     std::shared_ptr<grpc::Channel> channel_; ///< gRPC channel for communication with the peer.
     std::unique_ptr<cache::Cache::Stub> stub_; ///< gRPC stub for making cache service calls.
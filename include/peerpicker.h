@@ -2,8 +2,8 @@
 #define PEER_PICKER_H
 
 #include "include/peer.h"
-#include "kcache.grpc.pb.h"
-#include "include/ConsistentHash.h"
+#include "cache.grpc.pb.h"
+#include "include/consistentHash.h"
 
 #include <fmt/core.h>
 #include <grpcpp/channel.h>
@@ -16,6 +16,7 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 /**
  * @brief PeerPicker class for managing peers in the local node.
@@ -48,7 +49,14 @@ public:
      * @param key The key for which to select a peer.
      * @return Pointer to the selected peer, or nullptr if no peers are available.
      */
-    Peer* PickPeer(const std::string& key);
+    peer* PickPeer(const std::string& key);
+
+    /**
+     * @brief Every known peer except the local node, e.g. to fan an invalidation out.
+     * 
+     * @return The peers; they stay usable if they leave the cluster meanwhile.
+     */
+    std::vector<std::shared_ptr<peer>> AllPeers();
 
 private:
     /**
@@ -104,7 +112,7 @@ private:
 
     std::shared_mutex mtx; ///< Reader-writer mutex for thread-safe peer management.
     std::unordered_map<std::string, std::shared_ptr<peer>> peers; ///< Map of peer addresses to peer instances.
-    ConsistentHash hash_ring; ///< Consistent hash ring for peer selection.
+    consistentHash hash_ring; ///< Consistent hash ring for peer selection, shared with CacheClient's (see consistentHash()).
     std::shared_ptr<etcd::Client> etcd_client; ///< etcd client for service discovery.
     std::unique_ptr<etcd::Watcher> watcher; ///< etcd watcher for monitoring service changes.
     std::thread watcher_thread; ///< Thread for running the etcd watcher.
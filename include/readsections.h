@@ -0,0 +1,122 @@
+#ifndef READ_SECTIONS_H
+#define READ_SECTIONS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Read-side critical sections that let a writer reclaim objects readers reach through raw pointers.
+ *
+ * Readers Enter() a section, load the published pointer and use it until the
+ * guard goes out of scope. A writer unpublishes an object (swaps the pointer),
+ * then calls Synchronize(), which returns once every section that could have
+ * loaded the old pointer has ended; the object can then be freed.
+ *
+ * Sections are counted per stripe, and a thread always uses the same stripe,
+ * so entering one is two uncontended atomic increments rather than the
+ * shared reference count (and, for std::atomic<std::shared_ptr>, the lock
+ * bit) every reader of a shared pointer touches. Sections also carry the
+ * parity of a generation counter that Synchronize() flips, so it waits only
+ * for sections that began before it and cannot be starved by new readers.
+ *
+ * The published pointers must be swapped and loaded with the default,
+ * sequentially consistent, order: the argument that a section Synchronize()
+ * missed loads the new pointer relies on it.
+ *
+ * Synchronize() blocks, so it belongs on a background task; called from
+ * inside a section (which it would wait for forever) it returns false at once.
+ */
+class ReadSections {
+public:
+    static constexpr size_t kStripes = 64; ///< Section counters; threads are spread over them round-robin.
+
+    /**
+     * @brief An open section; ends when destroyed.
+     */
+    class Guard {
+    public:
+        explicit Guard(std::atomic<int64_t>* readers) : readers_(readers) { ++Self().depth; }
+        Guard(Guard&& other) noexcept : readers_(other.readers_) { other.readers_ = nullptr; }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        Guard& operator=(Guard&&) = delete;
+
+        ~Guard() {
+            if (readers_) {
+                readers_->fetch_sub(1, std::memory_order_release);
+                --Self().depth;
+            }
+        }
+
+    private:
+        std::atomic<int64_t>* readers_; ///< Counter this section incremented.
+    };
+
+    ReadSections() = default;
+    ReadSections(const ReadSections&) = delete;
+    ReadSections& operator=(const ReadSections&) = delete;
+
+    /**
+     * @brief Open a section; pointers loaded after this stay valid until the guard is destroyed.
+     */
+    Guard Enter() {
+        Stripe& stripe = stripes_[Self().stripe];
+        std::atomic<int64_t>* readers = &stripe.readers[generation_.load() & 1];
+        // Sequentially consistent, like the writer's swap and flip: a section
+        // counted too late for Synchronize() to see loads the new pointer.
+        readers->fetch_add(1);
+        return Guard(readers);
+    }
+
+    /**
+     * @brief Wait until every section open when the call started has ended.
+     *
+     * Objects unpublished before the call are unreachable once it returns true.
+     *
+     * @return False, without waiting, if the calling thread is inside a section.
+     */
+    bool Synchronize() {
+        if (Self().depth > 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mtx_);
+        size_t parity = generation_.fetch_add(1) & 1;
+        for (auto& stripe : stripes_) {
+            while (stripe.readers[parity].load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+        return true;
+    }
+
+private:
+    /**
+     * @brief Section counters of the threads mapped to one stripe, by generation parity.
+     */
+    struct alignas(64) Stripe {
+        std::atomic<int64_t> readers[2] = {0, 0};
+    };
+
+    /**
+     * @brief Per-thread state, shared by every ReadSections.
+     */
+    struct ThreadState {
+        size_t stripe;  ///< Stripe of the thread, assigned on its first section.
+        int depth = 0;  ///< Sections the thread has open.
+    };
+
+    static ThreadState& Self() {
+        static std::atomic<size_t> next{0};
+        thread_local ThreadState self{next.fetch_add(1, std::memory_order_relaxed) % kStripes};
+        return self;
+    }
+
+    Stripe stripes_[kStripes];              ///< Open sections per stripe.
+    std::atomic<uint64_t> generation_{0};   ///< Flipped by each Synchronize(); its parity picks the counter.
+    std::mutex mtx_;                        ///< Serializes Synchronize() calls.
+};
+
+#endif // READ_SECTIONS_H
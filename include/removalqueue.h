@@ -0,0 +1,131 @@
+#ifndef REMOVAL_QUEUE_H
+#define REMOVAL_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "include/Cache.h"
+#include "include/MpscQueue.h"
+#include "include/taskscheduler.h"
+
+/**
+ * @brief Delivers removed cache entries to listeners on the scheduler's background lane.
+ *
+ * Push() is called from a policy's removal path, under the policy's lock: it
+ * only moves the entry into a lock-free MPSC queue and, if no drain is
+ * pending, submits one. The drain calls every listener for each entry and
+ * then destroys the entry there, so neither listener work nor the freeing
+ * of large values lands on the request thread.
+ *
+ * @tparam Value The cache value type.
+ */
+template<typename Value>
+class RemovalQueue {
+public:
+    using Listener = std::function<void(const std::string&, const Value&, RemovalCause)>; ///< Called per removed entry.
+
+    /**
+     * @brief Construct a queue.
+     *
+     * @param scheduler Runs the drains.
+     */
+    explicit RemovalQueue(TaskScheduler& scheduler = TaskScheduler::Instance()) : scheduler_(scheduler) {}
+
+    RemovalQueue(const RemovalQueue&) = delete;
+    RemovalQueue& operator=(const RemovalQueue&) = delete;
+
+    /**
+     * @brief Wait for a submitted drain to finish; entries still queued are destroyed undelivered.
+     */
+    ~RemovalQueue() {
+        drains_.Wait();
+    }
+
+    /**
+     * @brief Add a listener; it sees entries removed from now on.
+     */
+    void AddListener(Listener listener) {
+        std::lock_guard<std::mutex> lock(drainMtx_);
+        listeners_.push_back(std::move(listener));
+        listening_.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Whether any listener is registered.
+     */
+    bool Listening() const {
+        return listening_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Queue a removed entry for delivery (any thread, never blocks).
+     *
+     * @param key The removed key.
+     * @param value The removed value; destroyed after delivery.
+     * @param cause Why it was removed.
+     */
+    void Push(const std::string& key, Value&& value, RemovalCause cause) {
+        queue_.push(Removal{key, std::move(value), cause});
+        if (!scheduled_.exchange(true, std::memory_order_acq_rel)) {
+            scheduler_.Submit([this, token = drains_.Hold()] { Drain(); }, TaskPriority::BACKGROUND);
+        }
+    }
+
+    /**
+     * @brief Deliver and destroy every queued entry on the calling thread.
+     */
+    void Drain() {
+        std::lock_guard<std::mutex> lock(drainMtx_);
+        // Cleared before popping: a Push that lands after the last pop sees
+        // false and submits the next drain.
+        scheduled_.store(false, std::memory_order_release);
+        Removal removal;
+        while (queue_.pop(removal)) {
+            for (auto& listener : listeners_) {
+                try {
+                    listener(removal.key, removal.value, removal.cause);
+                } catch (const std::exception& e) {
+                    spdlog::error("Removal listener failed for key {}: {}", removal.key, e.what());
+                }
+            }
+            removal = Removal();
+            delivered_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Entries delivered (and destroyed) so far.
+     */
+    uint64_t Delivered() const {
+        return delivered_.load(std::memory_order_relaxed);
+    }
+
+private:
+    /**
+     * @brief A queued removal.
+     */
+    struct Removal {
+        std::string key;                            ///< The removed key.
+        Value value{};                              ///< The removed value.
+        RemovalCause cause = RemovalCause::SIZE;    ///< Why it was removed.
+    };
+
+    TaskScheduler& scheduler_;              ///< Runs the drains.
+    MpscQueue<Removal> queue_;              ///< Removed entries awaiting delivery.
+    std::atomic<bool> scheduled_{false};    ///< A drain is submitted and has not started popping.
+    std::atomic<bool> listening_{false};    ///< Set once a listener is registered.
+    std::atomic<uint64_t> delivered_{0};    ///< Entries delivered so far.
+    std::mutex drainMtx_;                   ///< Guards listeners_ and the consumer side of queue_.
+    std::vector<Listener> listeners_;       ///< Registered listeners.
+    TaskTracker drains_;                    ///< Submitted drains, waited for on destruction.
+};
+
+#endif // REMOVAL_QUEUE_H
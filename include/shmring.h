@@ -0,0 +1,116 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Single-producer single-consumer ring of length-prefixed messages, for shared memory.
+ *
+ * The ring is placed inside a mapping shared by two processes, so it holds
+ * no pointers: `head` and `tail` are running byte counts and the bytes
+ * follow the header. A message is a 32-bit length followed by its bytes;
+ * both may wrap around the end of the buffer. Exactly one side calls
+ * Push() and exactly one other side calls Pop(), as with SpscQueue.
+ */
+struct ShmRing {
+    static constexpr size_t kBytes = 256 << 10; ///< Buffer size; a power of two.
+    static constexpr size_t kMaxMessage = kBytes - sizeof(uint32_t); ///< Largest message that fits.
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ShmRing needs address-free atomics");
+
+    /**
+     * @brief Empty the ring; only while neither side uses it.
+     */
+    void Init() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Append one message made of several parts (producer side).
+     *
+     * @param parts Range of std::string_view, concatenated into the message.
+     * @return False if the ring has no room for it now.
+     */
+    template<typename Parts>
+    bool Push(const Parts& parts) {
+        size_t size = 0;
+        for (std::string_view part : parts) {
+            size += part.size();
+        }
+        if (size > kMaxMessage) {
+            return false;
+        }
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t + sizeof(uint32_t) + size - head.load(std::memory_order_acquire) > kBytes) {
+            return false;
+        }
+        auto length = static_cast<uint32_t>(size);
+        CopyIn(t, &length, sizeof(length));
+        t += sizeof(length);
+        for (std::string_view part : parts) {
+            CopyIn(t, part.data(), part.size());
+            t += part.size();
+        }
+        tail.store(t, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest message (consumer side).
+     *
+     * The length prefix is written by the other process, so it is checked
+     * against what was produced; a corrupt one empties the ring instead of
+     * reading past the message.
+     *
+     * @param message Replaced by the message.
+     * @return False if the ring is empty or its oldest message had a corrupt length.
+     */
+    bool Pop(std::string& message) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        if (h == t) {
+            return false;
+        }
+        uint64_t produced = t - h;
+        uint32_t length = 0;
+        if (produced >= sizeof(length)) {
+            CopyOut(h, &length, sizeof(length));
+        }
+        if (produced < sizeof(length) || length > kMaxMessage || length > produced - sizeof(length)) {
+            head.store(t, std::memory_order_release);
+            return false;
+        }
+        h += sizeof(length);
+        message.resize(length);
+        CopyOut(h, message.data(), length);
+        head.store(h + length, std::memory_order_release);
+        return true;
+    }
+
+    alignas(64) std::atomic<uint64_t> head; ///< Bytes consumed (written by the consumer).
+    alignas(64) std::atomic<uint64_t> tail; ///< Bytes produced (written by the producer).
+    alignas(64) char data[kBytes];          ///< The buffer.
+
+private:
+    void CopyIn(uint64_t pos, const void* src, size_t n) {
+        size_t offset = pos & (kBytes - 1);
+        size_t first = n < kBytes - offset ? n : kBytes - offset;
+        std::memcpy(data + offset, src, first);
+        std::memcpy(data, static_cast<const char*>(src) + first, n - first);
+    }
+
+    void CopyOut(uint64_t pos, void* dst, size_t n) const {
+        size_t offset = pos & (kBytes - 1);
+        size_t first = n < kBytes - offset ? n : kBytes - offset;
+        std::memcpy(dst, data + offset, first);
+        std::memcpy(static_cast<char*>(dst) + first, data, n - first);
+    }
+};
+
+#endif // SHM_RING_H
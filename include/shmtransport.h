@@ -0,0 +1,211 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <google/protobuf/message.h>
+#include <grpcpp/grpcpp.h>
+
+#include "include/shmring.h"
+
+/**
+ * @brief Calls served over shared memory: the request/response path of the gateway.
+ */
+enum class ShmMethod : uint8_t {
+    GET = 1,    ///< cache::Request -> cache::GetResponse.
+    SET = 2,    ///< cache::Request -> cache::SetResponse.
+    DELETE = 3  ///< cache::Request -> cache::DeleteResponse.
+};
+
+/**
+ * @brief One client's pair of rings in a shared-memory segment.
+ */
+struct ShmSlot {
+    std::atomic<uint32_t> owner;        ///< Pid of the client process holding the slot (0 = free).
+    std::atomic<uint32_t> responseSeq;  ///< Bumped after each response; the client parks on it.
+    std::atomic<uint32_t> waiting;      ///< The client is parked on `responseSeq`.
+    ShmRing requests;                   ///< Client to server.
+    ShmRing responses;                  ///< Server to client.
+};
+
+/**
+ * @brief Header of a shared-memory segment; the slots follow it.
+ */
+struct ShmSegment {
+    static constexpr uint64_t kMagic = 0x6b63616368650001; ///< "kcache", layout version 1.
+
+    std::atomic<uint64_t> magic;        ///< kMagic once initialized; 0 once the server stopped.
+    uint32_t slots;                     ///< Number of slots.
+    std::atomic<uint32_t> doorbell;     ///< Bumped after each request; the server parks on it.
+    std::atomic<uint32_t> sleeping;     ///< The server is parked on `doorbell`.
+
+    /**
+     * @brief Size of a segment with `slots` slots.
+     */
+    static size_t Bytes(size_t slots) { return SlotsOffset() + slots * sizeof(ShmSlot); }
+
+    ShmSlot& Slot(size_t i) {
+        return reinterpret_cast<ShmSlot*>(reinterpret_cast<char*>(this) + SlotsOffset())[i];
+    }
+
+private:
+    static constexpr size_t SlotsOffset() { return (sizeof(ShmSegment) + 63) & ~size_t(63); }
+};
+
+/**
+ * @brief Serves Get, Set and Delete from colocated clients over shared-memory rings.
+ *
+ * The node creates a segment named ShmSegmentName(addr) with a fixed number
+ * of slots. A client process claims a slot, writes serialized requests into
+ * its request ring and reads responses from its response ring, so a
+ * colocated hop costs two memory copies and no socket. One server thread
+ * polls the slots and parks on a futex in the segment when all are idle;
+ * clients park on their slot's futex the same way.
+ *
+ * Requests of a slot are answered in order. A miss is loaded without
+ * blocking the server thread (GroupReader::LoadEncodedAsync()), as for the
+ * gRPC Get; the slot is not polled again until the load has answered, so
+ * each ring always has a single producer. Slots of
+ * client processes that died are reclaimed.
+ *
+ * Calls go to the cache groups directly, so the transport is not offered
+ * in thread-per-core mode, where writes live in per-core shards.
+ */
+class ShmServer {
+public:
+    /**
+     * @brief Create the segment, replacing a stale one.
+     *
+     * @param addr The node's registered address.
+     * @param slots Number of client slots.
+     * @throws std::runtime_error If the segment cannot be created.
+     */
+    ShmServer(const std::string& addr, size_t slots);
+
+    /**
+     * @brief Stop serving and remove the segment.
+     */
+    ~ShmServer();
+
+    /**
+     * @brief Start the polling thread.
+     */
+    void Start();
+
+    /**
+     * @brief Stop the polling thread, mark the segment closed and remove its name.
+     */
+    void Stop();
+
+private:
+    /**
+     * @brief Poll the slots until stopped.
+     */
+    void Loop();
+
+    /**
+     * @brief Serve the next request of a slot, if any.
+     *
+     * @return True if a request was taken.
+     */
+    bool Serve(size_t i);
+
+    /**
+     * @brief Push a response into a slot's ring and wake its client.
+     *
+     * @param i The slot.
+     * @param id The request id.
+     * @param code The status code.
+     * @param payload The serialized response if OK, else the error message.
+     */
+    void Respond(size_t i, uint64_t id, grpc::StatusCode code, const std::vector<std::string_view>& payload);
+
+    /**
+     * @brief Free the slots of client processes that no longer exist.
+     */
+    void ReclaimDead();
+
+    std::string name_;                          ///< Segment name.
+    ShmSegment* segment_ = nullptr;             ///< The mapping.
+    size_t bytes_ = 0;                          ///< Size of the mapping.
+    std::unique_ptr<std::atomic<bool>[]> busy_; ///< busy_[i]: slot i's response is being produced off-thread.
+    std::thread thread_;                        ///< The polling thread.
+    std::atomic<bool> running_{false};          ///< True between Start() and Stop().
+};
+
+/**
+ * @brief Client side of a ShmServer segment.
+ *
+ * Thread-safe: each call borrows one of the slots this process has claimed
+ * (claiming another one if all are in use), so concurrent calls never share
+ * a ring.
+ */
+class ShmClient {
+public:
+    /**
+     * @brief Map the segment offered by the node serving `addr`.
+     *
+     * @return The client, or nullptr if the node offers no segment.
+     */
+    static std::unique_ptr<ShmClient> Open(const std::string& addr);
+
+    /**
+     * @brief Release the claimed slots and unmap the segment.
+     */
+    ~ShmClient();
+
+    /**
+     * @brief Whether the server stopped; calls fail and the client should be reopened.
+     */
+    bool Closed() const;
+
+    /**
+     * @brief Make a call over shared memory.
+     *
+     * @param method The method.
+     * @param request The request.
+     * @param response Receives the response.
+     * @param status Receives the server's status (DEADLINE_EXCEEDED on timeout).
+     * @param traceparent W3C trace context forwarded to the server (may be empty).
+     * @param timeout How long to wait for the response.
+     * @return False if the call could not go over shared memory (segment closed,
+     *         no free slot, request or response too large for a ring);
+     *         `status` is untouched and the caller should use gRPC.
+     */
+    bool Call(ShmMethod method, const google::protobuf::Message& request, google::protobuf::Message* response,
+              grpc::Status* status, const std::string& traceparent = "",
+              std::chrono::milliseconds timeout = std::chrono::seconds(3));
+
+private:
+    ShmClient(ShmSegment* segment, size_t bytes) : segment_(segment), bytes_(bytes) {}
+
+    /**
+     * @brief Borrow a slot of this process, claiming a free one if needed.
+     *
+     * @return The slot index, or -1 if every slot is taken.
+     */
+    int AcquireSlot();
+
+    /**
+     * @brief Return a borrowed slot.
+     */
+    void ReleaseSlot(int slot);
+
+    ShmSegment* segment_;                       ///< The mapping.
+    size_t bytes_;                              ///< Size of the mapping.
+    std::mutex mtx_;                            ///< Guards `idle_` and `claimed_`.
+    std::vector<int> idle_;                     ///< Claimed slots not in use.
+    std::vector<int> claimed_;                  ///< Every slot this process claimed.
+    std::atomic<uint32_t> nextId_{1};           ///< Low half of the next request id.
+};
+
+#endif // SHM_TRANSPORT_H
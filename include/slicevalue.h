@@ -0,0 +1,69 @@
+#ifndef SLICE_VALUE_H
+#define SLICE_VALUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <grpcpp/support/slice.h>
+
+/**
+ * @brief Immutable, reference-counted byte payload backed by a grpc::Slice.
+ *
+ * Copying a SliceValue (into or out of a cache) only bumps a reference
+ * count, and the slice can be handed to gRPC as part of a ByteBuffer, so a
+ * cache hit reaches the transport without the payload being copied.
+ */
+class SliceValue {
+public:
+    SliceValue() = default;
+
+    /**
+     * @brief Adopt a string's buffer without copying it.
+     *
+     * @param bytes The payload; moved into a heap string the slice owns.
+     */
+    explicit SliceValue(std::string bytes) {
+        auto* owned = new std::string(std::move(bytes));
+        slice_ = grpc::Slice(owned->data(), owned->size(), &DestroyString, owned);
+    }
+
+    /**
+     * @brief Share an existing slice.
+     */
+    explicit SliceValue(grpc::Slice slice) : slice_(std::move(slice)) {}
+
+    const uint8_t* data() const { return slice_.begin(); }
+
+    size_t size() const { return slice_.size(); }
+
+    bool empty() const { return slice_.size() == 0; }
+
+    /**
+     * @brief The payload as a view; valid while this value (or a copy) lives.
+     */
+    std::string_view view() const {
+        return std::string_view(reinterpret_cast<const char*>(slice_.begin()), slice_.size());
+    }
+
+    /**
+     * @brief A copy of the payload.
+     */
+    std::string str() const { return std::string(view()); }
+
+    /**
+     * @brief The underlying slice, for building ByteBuffers.
+     */
+    const grpc::Slice& slice() const { return slice_; }
+
+private:
+    static void DestroyString(void* owned) {
+        delete static_cast<std::string*>(owned);
+    }
+
+    grpc::Slice slice_; ///< Shared payload bytes.
+};
+
+#endif // SLICE_VALUE_H
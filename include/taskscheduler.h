@@ -0,0 +1,250 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Priority lanes of the task scheduler.
+ */
+enum class TaskPriority {
+    FOREGROUND = 0, ///< Work a client is waiting on (loader calls on a miss).
+    BACKGROUND = 1  ///< Work nobody waits on (refresh-ahead, replication, snapshots).
+};
+
+/**
+ * @brief Work-stealing task scheduler with foreground and background lanes.
+ *
+ * Every worker owns one deque per lane. Tasks submitted from a worker go to
+ * that worker's own deque and are popped LIFO for locality; idle workers steal
+ * FIFO from the other deques. Workers always drain the foreground lane first
+ * and at most `workers - 1` of them run background tasks at the same time, so
+ * one worker is always free to pick up a loader call; there are at least two
+ * workers for that reason.
+ *
+ * Tasks submitted after Shutdown() has started run inline on the caller.
+ * Timers still waiting when Shutdown() starts run right away instead of at
+ * their due time, and ScheduleAfter() once the timer thread has exited runs
+ * the task inline too, so a delayed task (a retry, say) is never dropped.
+ * Periodic tasks stop re-arming once Stopping() is true.
+ */
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * @brief Construct a scheduler and start its worker threads.
+     *
+     * @param workers Number of worker threads (0 selects the number of cores; at least 2).
+     */
+    explicit TaskScheduler(size_t workers = 0);
+
+    /**
+     * @brief Destructor that drains pending tasks and joins all threads.
+     */
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /**
+     * @brief Process-wide scheduler shared by all cache groups.
+     *
+     * @return Reference to the default scheduler.
+     */
+    static TaskScheduler& Instance();
+
+    /**
+     * @brief Queue a task for execution.
+     *
+     * @param task The task to run.
+     * @param priority The lane to queue the task on.
+     */
+    void Submit(Task task, TaskPriority priority = TaskPriority::FOREGROUND);
+
+    /**
+     * @brief Queue a task for execution after a delay.
+     *
+     * @param delay How long to wait before the task becomes runnable.
+     * @param task The task to run.
+     * @param priority The lane the task is queued on once it is due.
+     */
+    void ScheduleAfter(std::chrono::milliseconds delay, Task task,
+                       TaskPriority priority = TaskPriority::BACKGROUND);
+
+    /**
+     * @brief Queue a callable and return a future for its result.
+     *
+     * @param func The callable to run.
+     * @param priority The lane to queue the callable on.
+     * @return Future that becomes ready when the callable returns.
+     */
+    template<typename F>
+    auto Async(F&& func, TaskPriority priority = TaskPriority::FOREGROUND)
+        -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using R = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+        auto future = task->get_future();
+        Submit([task] { (*task)(); }, priority);
+        return future;
+    }
+
+    /**
+     * @brief Check whether the calling thread is one of this scheduler's workers.
+     *
+     * Callers use this to run nested work inline instead of blocking a worker
+     * on a future that may only be served by the same worker.
+     *
+     * @return True if called from a worker thread of this scheduler.
+     */
+    bool OnWorkerThread() const;
+
+    /**
+     * @brief Whether Shutdown() has started; periodic tasks check it before re-arming.
+     */
+    bool Stopping() const { return stop_.load(); }
+
+    /**
+     * @brief Number of worker threads.
+     */
+    size_t WorkerCount() const { return workers_.size(); }
+
+    /**
+     * @brief Stop accepting tasks, run what is queued and join all threads.
+     */
+    void Shutdown();
+
+private:
+    static constexpr size_t kLanes = 2;
+
+    /**
+     * @brief Per-worker state: one deque per priority lane.
+     */
+    struct Worker {
+        std::mutex mtx;                 ///< Guards the lane deques.
+        std::deque<Task> lanes[kLanes]; ///< Pending tasks by priority.
+        std::thread thread;             ///< The worker thread.
+    };
+
+    /**
+     * @brief A delayed task waiting in the timer queue.
+     */
+    struct TimedTask {
+        std::chrono::steady_clock::time_point due; ///< When the task becomes runnable.
+        TaskPriority priority;                     ///< Lane to submit the task to.
+        Task task;                                 ///< The task itself.
+        bool operator>(const TimedTask& other) const { return due > other.due; }
+    };
+
+    /**
+     * @brief Main loop of a worker thread.
+     *
+     * @param index Index of the worker in `workers_`.
+     */
+    void WorkerLoop(size_t index);
+
+    /**
+     * @brief Main loop of the timer thread.
+     */
+    void TimerLoop();
+
+    /**
+     * @brief Try to find a runnable task for a worker.
+     *
+     * Looks at the worker's own foreground deque, then steals foreground work,
+     * then does the same for the background lane if a background slot is free.
+     *
+     * @param index Index of the worker looking for work.
+     * @param task Output parameter for the task found.
+     * @param priority Output parameter for the lane the task came from.
+     * @return True if a task was found.
+     */
+    bool FindTask(size_t index, Task& task, TaskPriority& priority);
+
+    /**
+     * @brief Pop from a worker's own lane (LIFO end).
+     */
+    bool PopLocal(size_t index, size_t lane, Task& task);
+
+    /**
+     * @brief Steal from another worker's lane (FIFO end).
+     */
+    bool Steal(size_t thief, size_t lane, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_; ///< Worker threads and their deques.
+    std::atomic<size_t> pending_[kLanes];          ///< Number of queued tasks per lane.
+    std::atomic<size_t> activeBackground_{0};      ///< Background tasks currently running.
+    size_t maxBackground_;                         ///< Cap on concurrently running background tasks.
+    std::atomic<size_t> nextWorker_{0};            ///< Round-robin cursor for external submits.
+    std::atomic<bool> stop_{false};                ///< Set once Shutdown() has been called.
+
+    std::mutex sleepMtx_;             ///< Mutex paired with `sleepCv_`.
+    std::condition_variable sleepCv_; ///< Wakes idle workers when work arrives.
+
+    std::mutex timerMtx_;             ///< Guards `timers_`.
+    std::condition_variable timerCv_; ///< Wakes the timer thread.
+    std::priority_queue<TimedTask, std::vector<TimedTask>, std::greater<TimedTask>> timers_; ///< Delayed tasks.
+    std::thread timerThread_;         ///< Thread moving due timers onto the lanes.
+    bool timersDone_ = false;         ///< The timer thread has exited; guarded by `timerMtx_`.
+};
+
+/**
+ * @brief Counts the queued tasks that refer to an object, so its destructor can wait for them.
+ *
+ * Hold() returns a token that a task captures next to the object's `this`;
+ * Wait() returns once every token is gone, whether its task ran or was
+ * destroyed without running. A task that hands work on (a continuation, an
+ * RPC callback, a retry timer) gives it a token of its own.
+ */
+class TaskTracker {
+public:
+    using Token = std::shared_ptr<void>;
+
+    TaskTracker() = default;
+    TaskTracker(const TaskTracker&) = delete;
+    TaskTracker& operator=(const TaskTracker&) = delete;
+
+    /**
+     * @brief A token to capture in a task; the task counts as outstanding until it is released.
+     */
+    Token Hold() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            ++held_;
+        }
+        return Token(this, [](void* tracker) { static_cast<TaskTracker*>(tracker)->Release(); });
+    }
+
+    /**
+     * @brief Block until no token is held; must not be called from a task holding one.
+     */
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        idle_.wait(lock, [this] { return held_ == 0; });
+    }
+
+private:
+    void Release() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (--held_ == 0) {
+            idle_.notify_all();
+        }
+    }
+
+    std::mutex mtx_;                  ///< Guards `held_`.
+    std::condition_variable idle_;    ///< Signalled when `held_` drops to zero.
+    size_t held_ = 0;                 ///< Tokens not yet released.
+};
+
+#endif // TASK_SCHEDULER_H
@@ -0,0 +1,296 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+
+/**
+ * @brief Identity of a span as carried by W3C `traceparent`.
+ *
+ * A context with `sampled == false` is inert: spans created under it record
+ * nothing and cost a thread-local read and a branch.
+ */
+struct SpanContext {
+    std::array<uint8_t, 16> trace_id{}; ///< Trace the span belongs to.
+    std::array<uint8_t, 8> span_id{};   ///< The span itself (all zero for a fresh root).
+    bool sampled = false;               ///< Whether spans under this context are recorded.
+
+    /**
+     * @brief True if the context carries a non-zero trace id.
+     */
+    bool IsValid() const;
+};
+
+/**
+ * @brief Format a context as a W3C `traceparent` value ("00-<trace>-<span>-<flags>").
+ */
+std::string FormatTraceparent(const SpanContext& ctx);
+
+/**
+ * @brief Parse a W3C `traceparent` value.
+ *
+ * @param header The header value.
+ * @return The parsed context, or an invalid context if the value is malformed.
+ */
+SpanContext ParseTraceparent(const std::string& header);
+
+/**
+ * @brief A finished span, as handed to exporters.
+ */
+struct SpanRecord {
+    std::array<uint8_t, 16> trace_id{};                           ///< Trace id.
+    std::array<uint8_t, 8> span_id{};                             ///< Span id.
+    std::array<uint8_t, 8> parent_span_id{};                      ///< Parent span id (zero for roots).
+    const char* name = "";                                        ///< Stage name (string literal).
+    int64_t start_unix_ns = 0;                                    ///< Wall-clock start.
+    int64_t duration_ns = 0;                                      ///< Duration of the stage.
+    bool error = false;                                           ///< Whether the stage failed.
+    std::vector<std::pair<const char*, std::string>> attributes;  ///< Stage attributes.
+};
+
+/**
+ * @brief Destination for finished spans; called from the tracer's flush thread.
+ */
+class SpanExporter {
+public:
+    virtual ~SpanExporter() = default;
+
+    /**
+     * @brief Export a batch of spans.
+     *
+     * @param spans The spans to export.
+     */
+    virtual void Export(const std::vector<SpanRecord>& spans) = 0;
+};
+
+/**
+ * @brief Appends spans to a local file, one JSON object per line.
+ */
+class FileSpanExporter : public SpanExporter {
+public:
+    explicit FileSpanExporter(const std::string& path);
+    void Export(const std::vector<SpanRecord>& spans) override;
+
+private:
+    std::string path_; ///< Output file.
+};
+
+/**
+ * @brief Posts spans as OTLP/JSON to a collector's `/v1/traces` endpoint.
+ */
+class OtlpHttpSpanExporter : public SpanExporter {
+public:
+    /**
+     * @param endpoint Collector base URL, e.g. "http://127.0.0.1:4318".
+     * @param service_name Value of the `service.name` resource attribute.
+     */
+    OtlpHttpSpanExporter(const std::string& endpoint, const std::string& service_name);
+    void Export(const std::vector<SpanRecord>& spans) override;
+
+private:
+    std::string endpoint_;     ///< Collector base URL.
+    std::string service_name_; ///< Reported service name.
+};
+
+/**
+ * @brief Tracing configuration.
+ */
+struct TracerOptions {
+    double sample_ratio = 0.0;                          ///< Fraction of new traces recorded (0 disables tracing).
+    size_t buffer_capacity = 8192;                      ///< Max spans held before new ones are dropped.
+    std::chrono::milliseconds flush_interval{1000};     ///< How often the buffer is exported.
+    std::unique_ptr<SpanExporter> exporter;             ///< Where spans go; required when sampling.
+};
+
+/**
+ * @brief Process-wide tracer: sampling decisions, span buffer and exporting.
+ *
+ * Finished spans go into a fixed-size buffer that a flush thread drains into
+ * the exporter. When the buffer is full new spans are dropped and counted, so
+ * tracing memory stays bounded no matter how slow the exporter is.
+ */
+class Tracer {
+public:
+    /**
+     * @brief The process-wide tracer.
+     */
+    static Tracer& Instance();
+
+    ~Tracer();
+
+    /**
+     * @brief Apply a configuration and (re)start the flush thread.
+     *
+     * @param options The tracing configuration.
+     */
+    void Configure(TracerOptions options);
+
+    /**
+     * @brief Export what is buffered and stop the flush thread.
+     */
+    void Shutdown();
+
+    /**
+     * @brief Whether any trace can be recorded.
+     */
+    bool Enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Context to continue at a process edge (gateway or server entry).
+     *
+     * Continues a valid remote context, otherwise starts a new trace subject
+     * to the sample ratio. Returns an inert context when tracing is disabled.
+     *
+     * @param remote Context received from the caller, possibly invalid.
+     * @return The parent context for the edge span.
+     */
+    SpanContext Continue(const SpanContext& remote);
+
+    /**
+     * @brief Context of the span active on the calling thread.
+     */
+    static const SpanContext& Current();
+
+    /**
+     * @brief Buffer a finished span; drops it when the buffer is full.
+     */
+    void Record(SpanRecord&& span);
+
+    /**
+     * @brief Number of spans dropped because the buffer was full.
+     */
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    Tracer() = default;
+
+    /**
+     * @brief Flush thread: export the buffer periodically or when it half fills.
+     */
+    void FlushLoop();
+
+    std::atomic<bool> enabled_{false};          ///< True while sample_ratio > 0 and an exporter is set.
+    std::atomic<uint64_t> sample_threshold_{0}; ///< Roots are sampled when a random 64-bit draw is below this.
+    std::atomic<uint64_t> dropped_{0};          ///< Spans dropped on a full buffer.
+
+    std::mutex mtx_;                            ///< Guards the buffer and exporter.
+    std::condition_variable cv_;                ///< Wakes the flush thread.
+    std::vector<SpanRecord> buffer_;            ///< Finished spans waiting to be exported.
+    size_t capacity_ = 0;                       ///< Max size of `buffer_`.
+    std::chrono::milliseconds flush_interval_{1000}; ///< Export period.
+    std::shared_ptr<SpanExporter> exporter_;    ///< Current exporter.
+    bool stop_ = true;                          ///< Tells the flush thread to exit.
+    std::thread flush_thread_;                  ///< Drains `buffer_` into `exporter_`.
+};
+
+/**
+ * @brief RAII span timing one stage of a request.
+ *
+ * While alive, the span is the current context of its thread, so nested
+ * spans and outgoing RPCs pick it up as their parent. Work handed to another
+ * thread must capture Tracer::Current() and pass it explicitly. A span that
+ * ends when async work completes is held in a shared_ptr and detached from
+ * its thread (Detach()) before the thread moves on.
+ */
+class Span {
+public:
+    /**
+     * @brief Start a child of the span active on this thread.
+     */
+    explicit Span(const char* name) : Span(name, Tracer::Current()) {}
+
+    /**
+     * @brief Start a child of an explicit parent (inert unless it is sampled).
+     */
+    Span(const char* name, const SpanContext& parent);
+
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    /**
+     * @brief Whether this span is being recorded.
+     */
+    bool Recording() const { return record_ != nullptr; }
+
+    /**
+     * @brief Attach an attribute (no-op when not recording).
+     */
+    void SetAttribute(const char* key, const std::string& value) {
+        if (record_) record_->attributes.emplace_back(key, value);
+    }
+    void SetAttribute(const char* key, const char* value) {
+        if (record_) record_->attributes.emplace_back(key, value);
+    }
+
+    /**
+     * @brief Mark the stage as failed (no-op when not recording).
+     */
+    void SetError(const std::string& message) {
+        if (record_) {
+            record_->error = true;
+            record_->attributes.emplace_back("error.message", message);
+        }
+    }
+    void SetError(const char* message) {
+        if (record_) {
+            record_->error = true;
+            record_->attributes.emplace_back("error.message", message);
+        }
+    }
+
+    /**
+     * @brief Context of this span, for propagation.
+     */
+    SpanContext Context() const;
+
+    /**
+     * @brief Stop being the current span of the constructing thread, which gets its previous context back.
+     *
+     * Called on that thread; the span keeps recording and ends when it is
+     * destroyed, on any thread.
+     */
+    void Detach();
+
+private:
+    std::unique_ptr<SpanRecord> record_;                 ///< Span being recorded, null when inert.
+    std::chrono::steady_clock::time_point start_;        ///< Monotonic start time.
+    SpanContext previous_;                               ///< Thread context restored on destruction.
+    bool attached_ = false;                              ///< Still the current span of its thread.
+};
+
+/**
+ * @brief Configure the process-wide tracer from command-line settings.
+ *
+ * @param sample_ratio Fraction of new traces to record (0 disables tracing).
+ * @param file If non-empty, append spans to this file as JSON lines.
+ * @param otlp_endpoint Otherwise, if non-empty, post spans to this OTLP/HTTP collector.
+ * @param service_name Service name reported with exported spans.
+ */
+void ConfigureTracing(double sample_ratio, const std::string& file, const std::string& otlp_endpoint,
+                      const std::string& service_name);
+
+/**
+ * @brief Add the current thread's trace context to an outgoing gRPC call.
+ */
+void InjectTraceContext(grpc::ClientContext& context);
+
+/**
+ * @brief Read the caller's trace context from incoming gRPC metadata.
+ */
+SpanContext ExtractTraceContext(const grpc::ServerContextBase& context);
+
+#endif // TRACING_H
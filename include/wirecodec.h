@@ -0,0 +1,302 @@
+#ifndef WIRE_CODEC_H
+#define WIRE_CODEC_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <google/protobuf/any.pb.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/wrappers.pb.h>
+#include <grpcpp/support/byte_buffer.h>
+#include <grpcpp/support/proto_buffer_writer.h>
+
+#include "cache.pb.h"
+#include "include/chunkedvalue.h"
+#include "include/countercodec.h"
+#include "include/slicevalue.h"
+
+/**
+ * @brief Maps a cache group's value type onto the `payload` oneof of Request and GetResponse.
+ *
+ * String (bytes) groups and typed protobuf groups travel in `data`, so the
+ * server never builds or inspects an Any for them; only Any groups use
+ * `value`. Decoding also accepts the Any-wrapped forms of the original
+ * protocol (StringValue, Int32Value, a packed message), so older clients
+ * and peers keep working.
+ *
+ * Encode() and Decode() are templates over the message so the same codec
+ * serves cache::Request and cache::GetResponse. EncodeGetResponse() writes
+ * a whole serialized GetResponse for raw (ByteBuffer) handlers.
+ *
+ * @tparam Value The cache value type.
+ */
+template<typename Value, typename Enable = void>
+struct WireCodec {
+    static_assert(!std::is_same_v<Value, Value>,
+                  "WireCodec supports std::string, SliceValue, ChunkedValue, int32_t, google::protobuf::Any and protobuf messages");
+};
+
+/**
+ * @brief Raw bytes in `data`.
+ */
+template<>
+struct WireCodec<std::string> {
+    template<typename Message>
+    static void Encode(const std::string& value, Message* message) {
+        message->set_data(value);
+    }
+
+    template<typename Message>
+    static bool Decode(const Message& message, std::string& value) {
+        if (message.payload_case() == Message::kData) {
+            value = message.data();
+            return true;
+        }
+        google::protobuf::StringValue wrapped;
+        if (message.has_value() && message.value().UnpackTo(&wrapped)) {
+            value = wrapped.value();
+            return true;
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief Shared slices in `data`; decoding copies the bytes once into a new slice.
+ */
+template<>
+struct WireCodec<SliceValue> {
+    template<typename Message>
+    static void Encode(const SliceValue& value, Message* message) {
+        message->set_data(value.data(), value.size());
+    }
+
+    template<typename Message>
+    static bool Decode(const Message& message, SliceValue& value) {
+        std::string bytes;
+        if (!WireCodec<std::string>::Decode(message, bytes)) {
+            return false;
+        }
+        value = SliceValue(std::move(bytes));
+        return true;
+    }
+};
+
+/**
+ * @brief Chunk chains in `data`, for unary Get and Set; large values should use GetStream and SetStream.
+ */
+template<>
+struct WireCodec<ChunkedValue> {
+    template<typename Message>
+    static void Encode(const ChunkedValue& value, Message* message) {
+        *message->mutable_data() = value.str();
+    }
+
+    template<typename Message>
+    static bool Decode(const Message& message, ChunkedValue& value) {
+        std::string bytes;
+        if (!WireCodec<std::string>::Decode(message, bytes)) {
+            return false;
+        }
+        ChunkedValue::Builder builder;
+        builder.Append(std::move(bytes));
+        value = builder.Build();
+        return true;
+    }
+};
+
+/**
+ * @brief 32-bit integers as a packed Int32Value, as in the original protocol.
+ */
+template<>
+struct WireCodec<int32_t> {
+    template<typename Message>
+    static void Encode(int32_t value, Message* message) {
+        google::protobuf::Int32Value wrapped;
+        wrapped.set_value(value);
+        message->mutable_value()->PackFrom(wrapped);
+    }
+
+    template<typename Message>
+    static bool Decode(const Message& message, int32_t& value) {
+        google::protobuf::Int32Value wrapped;
+        if (message.has_value() && message.value().UnpackTo(&wrapped)) {
+            value = wrapped.value();
+            return true;
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief Any groups pass the `value` field through untouched.
+ */
+template<>
+struct WireCodec<google::protobuf::Any> {
+    template<typename Message>
+    static void Encode(const google::protobuf::Any& value, Message* message) {
+        *message->mutable_value() = value;
+    }
+
+    template<typename Message>
+    static bool Decode(const Message& message, google::protobuf::Any& value) {
+        if (!message.has_value()) {
+            return false;
+        }
+        value = message.value();
+        return true;
+    }
+};
+
+/**
+ * @brief Typed protobuf groups: the serialized message in `data`.
+ */
+template<typename Value>
+struct WireCodec<Value, std::enable_if_t<std::is_base_of_v<google::protobuf::Message, Value> &&
+                                         !std::is_same_v<Value, google::protobuf::Any>>> {
+    template<typename Message>
+    static void Encode(const Value& value, Message* message) {
+        value.SerializeToString(message->mutable_data());
+    }
+
+    template<typename Message>
+    static bool Decode(const Message& message, Value& value) {
+        if (message.payload_case() == Message::kData) {
+            return value.ParseFromString(message.data());
+        }
+        return message.has_value() && message.value().UnpackTo(&value);
+    }
+};
+
+/**
+ * @brief Whether two responses carry the same payload: the same oneof case and bytes.
+ *
+ * Two responses without a payload are equal, which CompareAndSet uses for
+ * "the key is missing".
+ */
+inline bool SamePayload(const cache::GetResponse& a, const cache::GetResponse& b) {
+    if (a.payload_case() != b.payload_case()) {
+        return false;
+    }
+    switch (a.payload_case()) {
+        case cache::GetResponse::kData:
+            return a.data() == b.data();
+        case cache::GetResponse::kValue:
+            return a.value().type_url() == b.value().type_url() && a.value().value() == b.value().value();
+        default:
+            return true;
+    }
+}
+
+/**
+ * @brief Serialize a GetResponse carrying a value into a ByteBuffer.
+ *
+ * @param value The value.
+ * @param buffer Output buffer, replaced.
+ * @param ttlMs Time the value has left, for `ttl_ms` (0 = no expiry).
+ */
+template<typename Value>
+void EncodeGetResponse(const Value& value, grpc::ByteBuffer* buffer, uint64_t ttlMs = 0) {
+    cache::GetResponse response;
+    WireCodec<Value>::Encode(value, &response);
+    response.set_ttl_ms(ttlMs);
+    grpc::ProtoBufferWriter writer(buffer, grpc::kProtoBufferWriterMaxBufferLength,
+                                   static_cast<int>(response.ByteSizeLong()));
+    response.SerializeToZeroCopyStream(&writer);
+}
+
+/**
+ * @brief The bytes of a GetResponse that precede a `data` payload.
+ *
+ * The wire form of `GetResponse{data: payload}` is the tag of field 2
+ * (length-delimited), the varint length and the payload itself, so the
+ * zero-copy encoders below send these bytes followed by the payload slices.
+ */
+inline grpc::Slice GetResponseDataHeader(uint64_t size) {
+    uint8_t header[1 + 10];
+    size_t n = 0;
+    header[n++] = (cache::GetResponse::kDataFieldNumber << 3) | 2;
+    for (uint64_t length = size; ; length >>= 7) {
+        if (length < 0x80) {
+            header[n++] = static_cast<uint8_t>(length);
+            break;
+        }
+        header[n++] = static_cast<uint8_t>(length | 0x80);
+    }
+    return grpc::Slice(header, n);
+}
+
+/**
+ * @brief The bytes of a GetResponse's `ttl_ms` field, sent after a `data` payload.
+ *
+ * Fields may come in any order on the wire, so the zero-copy encoders
+ * append this to the payload slices.
+ */
+inline grpc::Slice GetResponseTtlTrailer(uint64_t ttlMs) {
+    uint8_t trailer[1 + 10];
+    size_t n = 0;
+    trailer[n++] = (cache::GetResponse::kTtlMsFieldNumber << 3) | 0;
+    for (uint64_t value = ttlMs; ; value >>= 7) {
+        if (value < 0x80) {
+            trailer[n++] = static_cast<uint8_t>(value);
+            break;
+        }
+        trailer[n++] = static_cast<uint8_t>(value | 0x80);
+    }
+    return grpc::Slice(trailer, n);
+}
+
+/**
+ * @brief Zero-copy GetResponse for a slice: a few header bytes plus a reference to the payload.
+ */
+inline void EncodeGetResponse(const SliceValue& value, grpc::ByteBuffer* buffer, uint64_t ttlMs = 0) {
+    grpc::Slice slices[3] = {GetResponseDataHeader(value.size()), value.slice()};
+    if (ttlMs != 0) {
+        slices[2] = GetResponseTtlTrailer(ttlMs);
+    }
+    grpc::ByteBuffer(slices, ttlMs != 0 ? 3 : 2).Swap(buffer);
+}
+
+/**
+ * @brief Zero-copy GetResponse for a chunk chain: the header followed by every chunk's slice.
+ */
+inline void EncodeGetResponse(const ChunkedValue& value, grpc::ByteBuffer* buffer, uint64_t ttlMs = 0) {
+    std::vector<grpc::Slice> slices;
+    slices.reserve(2 + value.chunks());
+    slices.push_back(GetResponseDataHeader(value.size()));
+    for (size_t i = 0; i < value.chunks(); ++i) {
+        slices.push_back(value.chunk(i).slice());
+    }
+    if (ttlMs != 0) {
+        slices.push_back(GetResponseTtlTrailer(ttlMs));
+    }
+    grpc::ByteBuffer(slices.data(), slices.size()).Swap(buffer);
+}
+
+/**
+ * @brief IncrementCounter() on an encoded value, as the per-core shards hold them.
+ *
+ * @param current The stored value, or nullptr if the key has none (`initial` applies).
+ * @param delta Amount added to a stored counter.
+ * @param initial Counter of a key that has no value.
+ * @param updated Receives the new value.
+ * @param counter Receives the new counter.
+ */
+template<typename Value>
+CounterStep IncrementEncoded(const cache::GetResponse* current, int64_t delta, int64_t initial,
+                             cache::GetResponse* updated, int64_t& counter) {
+    Value stored{};
+    if (current && !WireCodec<Value>::Decode(*current, stored)) {
+        return CounterStep::NOT_INTEGER;
+    }
+    Value value{};
+    CounterStep step = IncrementCounter(current ? &stored : nullptr, delta, initial, value, counter);
+    if (step == CounterStep::OK) {
+        WireCodec<Value>::Encode(value, updated);
+    }
+    return step;
+}
+
+#endif // WIRE_CODEC_H
@@ -0,0 +1,246 @@
+#ifndef WRITE_BEHIND_H
+#define WRITE_BEHIND_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "include/taskscheduler.h"
+
+/**
+ * @brief Options of a write-behind buffer.
+ */
+struct WriteBehindOptions {
+    std::chrono::milliseconds interval{1000}; ///< Longest time a write waits before it is flushed.
+    size_t batchSize = 512;                   ///< Dirty keys that trigger a flush, and the most passed to one writer call.
+};
+
+/**
+ * @brief Write-behind counters; write amplification is flushedKeys / writes.
+ */
+struct WriteBehindStats {
+    uint64_t writes = 0;          ///< Writes marked dirty (logical writes).
+    uint64_t flushedKeys = 0;     ///< Keys written to the backing store (physical writes).
+    uint64_t batches = 0;         ///< Successful writer calls.
+    uint64_t failedBatches = 0;   ///< Writer calls that failed and were requeued.
+    size_t dirtyKeys = 0;         ///< Keys waiting to be written, including an in-flight batch.
+};
+
+/**
+ * @brief Dirty-key buffer that coalesces writes and flushes them to a backing store in batches.
+ *
+ * Mark() records the latest value (or a deletion) of a key; repeated writes
+ * of a key before a flush cost one store write. A flush runs on the
+ * scheduler's background lane when `batchSize` keys are dirty and at least
+ * every `interval`, and hands the batch writer up to `batchSize` keys at a
+ * time. A failed batch is requeued under any newer write of its keys and
+ * retried on the next flush.
+ *
+ * Dirty keys stay in the buffer until their batch is written, independent
+ * of the cache in front of it, so Pending() can answer for keys the cache
+ * has already evicted and the loader never reads an older stored value.
+ * Destroying the buffer stops its timer and flushes what is left. A
+ * scheduler that shuts down first runs the queued timer early, and the
+ * timer is not re-armed after that.
+ *
+ * @tparam Value The cache value type.
+ */
+template<typename Value>
+class WriteBehind {
+public:
+    using Batch = std::vector<std::pair<std::string, std::optional<Value>>>; ///< Keys with their value, or nullopt for a deletion.
+    using BatchWriter = std::function<bool(const Batch&)>;                 ///< Writes a batch; false to retry it later.
+
+    /**
+     * @brief Construct a buffer and start its flush timer.
+     *
+     * @param writer Writes batches to the backing store.
+     * @param options Flush interval and batch size.
+     * @param scheduler Runs flushes.
+     */
+    WriteBehind(BatchWriter writer, WriteBehindOptions options, TaskScheduler& scheduler = TaskScheduler::Instance())
+        : writer_(std::move(writer)), options_(options), scheduler_(scheduler) {
+        options_.batchSize = std::max<size_t>(1, options_.batchSize);
+        ArmTimer();
+    }
+
+    WriteBehind(const WriteBehind&) = delete;
+    WriteBehind& operator=(const WriteBehind&) = delete;
+
+    /**
+     * @brief Cancel the queued flushes and write every dirty key.
+     */
+    ~WriteBehind() {
+        {
+            std::lock_guard<std::mutex> lock(lifetime_->mtx);
+            lifetime_->stopped = true;
+        }
+        if (!Flush()) {
+            spdlog::error("Write-behind buffer destroyed with {} keys unwritten", GetStats().dirtyKeys);
+        }
+    }
+
+    /**
+     * @brief Record a write to be flushed.
+     *
+     * @param key The key written.
+     * @param value The new value, or nullopt for a deletion.
+     */
+    void Mark(const std::string& key, std::optional<Value> value) {
+        bool full;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            dirty_[key] = std::move(value);
+            ++writes_;
+            full = dirty_.size() >= options_.batchSize && !flushQueued_;
+            flushQueued_ = flushQueued_ || full;
+        }
+        if (full) {
+            scheduler_.Submit(WhileAlive([this] { Flush(); }), TaskPriority::BACKGROUND);
+        }
+    }
+
+    /**
+     * @brief The unflushed write of a key, if any.
+     *
+     * @param key The key.
+     * @param value Receives the pending value, or nullopt for a pending deletion.
+     * @return True if the key has a write that the backing store has not seen.
+     */
+    bool Pending(const std::string& key, std::optional<Value>& value) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = dirty_.find(key);
+        if (it == dirty_.end()) {
+            it = inflight_.find(key);
+            if (it == inflight_.end()) {
+                return false;
+            }
+        }
+        value = it->second;
+        return true;
+    }
+
+    /**
+     * @brief Write every dirty key now, in batches of at most `batchSize`.
+     *
+     * @return True if all batches were written.
+     */
+    bool Flush() {
+        std::lock_guard<std::mutex> flushing(flushMtx_);
+        bool ok = true;
+        for (;;) {
+            Batch batch;
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                flushQueued_ = false;
+                if (dirty_.empty()) {
+                    break;
+                }
+                batch.reserve(std::min(options_.batchSize, dirty_.size()));
+                for (auto it = dirty_.begin(); it != dirty_.end() && batch.size() < options_.batchSize;) {
+                    inflight_.emplace(it->first, it->second);
+                    batch.emplace_back(it->first, std::move(it->second));
+                    it = dirty_.erase(it);
+                }
+            }
+            bool written = Write(batch);
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (auto& [key, value] : batch) {
+                inflight_.erase(key);
+                if (!written) {
+                    dirty_.emplace(key, std::move(value)); // keeps a newer write of the key
+                }
+            }
+            if (written) {
+                flushedKeys_ += batch.size();
+                ++batches_;
+            } else {
+                ++failedBatches_;
+                ok = false;
+                break;
+            }
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Snapshot the counters.
+     */
+    WriteBehindStats GetStats() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        WriteBehindStats stats;
+        stats.writes = writes_;
+        stats.flushedKeys = flushedKeys_;
+        stats.batches = batches_;
+        stats.failedBatches = failedBatches_;
+        stats.dirtyKeys = dirty_.size() + inflight_.size();
+        return stats;
+    }
+
+private:
+    bool Write(const Batch& batch) {
+        try {
+            return writer_(batch);
+        } catch (const std::exception& e) {
+            spdlog::error("Write-behind batch of {} keys failed: {}", batch.size(), e.what());
+            return false;
+        }
+    }
+
+    void ArmTimer() {
+        scheduler_.ScheduleAfter(options_.interval, WhileAlive([this] {
+            Flush();
+            if (!scheduler_.Stopping()) {
+                ArmTimer();
+            }
+        }), TaskPriority::BACKGROUND);
+    }
+
+    /**
+     * @brief Wrap a queued task so it does nothing once the buffer is destroyed.
+     */
+    std::function<void()> WhileAlive(std::function<void()> task) {
+        return [lifetime = lifetime_, task = std::move(task)] {
+            std::lock_guard<std::mutex> lock(lifetime->mtx);
+            if (!lifetime->stopped) {
+                task();
+            }
+        };
+    }
+
+    /**
+     * @brief Whether the buffer still exists; shared with its queued tasks, which may outlive it.
+     */
+    struct Lifetime {
+        std::mutex mtx;         ///< Held while a queued task runs, so the destructor waits for it.
+        bool stopped = false;   ///< Set by the destructor.
+    };
+
+    BatchWriter writer_;            ///< Writes batches to the backing store.
+    WriteBehindOptions options_;    ///< Flush interval and batch size.
+    TaskScheduler& scheduler_;      ///< Runs flushes and the timer.
+    std::mutex mtx_;                ///< Guards the maps, flushQueued_ and counters.
+    std::mutex flushMtx_;           ///< Serializes flushes, so a key is never in two batches at once.
+    std::unordered_map<std::string, std::optional<Value>> dirty_;     ///< Latest unflushed write per key.
+    std::unordered_map<std::string, std::optional<Value>> inflight_;  ///< Writes of the batch being written.
+    bool flushQueued_ = false;      ///< A size-triggered flush is queued.
+    uint64_t writes_ = 0;           ///< Writes marked dirty.
+    uint64_t flushedKeys_ = 0;      ///< Keys written to the backing store.
+    uint64_t batches_ = 0;          ///< Successful writer calls.
+    uint64_t failedBatches_ = 0;    ///< Failed writer calls.
+    std::shared_ptr<Lifetime> lifetime_ = std::make_shared<Lifetime>(); ///< Checked by queued flushes.
+};
+
+#endif // WRITE_BEHIND_H
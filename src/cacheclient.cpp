@@ -0,0 +1,589 @@
+#include "include/cacheclient.h"
+#include "include/CachePolicy.h"
+#include "include/localtransport.h"
+#include "include/tracing.h"
+
+#include <functional>
+#include <future>
+#include <latch>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <grpcpp/create_channel.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+constexpr auto kMinRefreshGap = std::chrono::milliseconds(100); ///< Early refreshes are at least this far apart.
+
+/**
+ * @brief State of one async call; lives until its callback has run.
+ */
+template<typename Request, typename Response>
+struct Call {
+    grpc::ClientContext context; ///< The call's context.
+    Request request;             ///< The request.
+    Response response;           ///< Receives the response.
+};
+
+const grpc::Status& NoNode() {
+    static const grpc::Status status(grpc::StatusCode::UNAVAILABLE, "No available cache nodes");
+    return status;
+}
+} // namespace
+
+CacheClient::CacheClient(const std::string& service_name, const ClientOptions& options)
+    : service_name_(service_name), options_(options) {
+    etcd_client_ = std::make_shared<etcd::Client>(options_.etcd_endpoints[0]);
+    if (options_.near_cache_capacity > 0) {
+        PolicySpec spec = parsePolicySpec(options_.near_cache_policy).withCapacity(options_.near_cache_capacity);
+        near_ = makeCache<std::string, CacheEntry<std::string>>(spec);
+    }
+    if (!Refresh()) {
+        throw std::runtime_error("Failed to discover cache nodes");
+    }
+    discovery_thread_ = std::thread([this] { DiscoveryLoop(); });
+}
+
+CacheClient::~CacheClient() {
+    {
+        std::lock_guard<std::mutex> lock(discoveryMtx_);
+        stopping_ = true;
+    }
+    discoveryCv_.notify_all();
+    if (discovery_thread_.joinable()) {
+        discovery_thread_.join();
+    }
+    // Callbacks of calls in flight still use the near cache and the counters.
+    while (inFlight_.load(std::memory_order_acquire) > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+std::optional<std::string> CacheClient::Get(const std::string& group, const std::string& key, grpc::Status* status) {
+    std::promise<std::pair<grpc::Status, std::optional<std::string>>> result;
+    GetAsync(group, key, [&result](const grpc::Status& s, std::optional<std::string> value) {
+        result.set_value({s, std::move(value)});
+    });
+    auto [s, value] = result.get_future().get();
+    if (status) {
+        *status = s;
+    }
+    return value;
+}
+
+grpc::Status CacheClient::Set(const std::string& group, const std::string& key, const std::string& value) {
+    std::promise<grpc::Status> result;
+    SetAsync(group, key, value, [&result](const grpc::Status& s) { result.set_value(s); });
+    return result.get_future().get();
+}
+
+grpc::Status CacheClient::Delete(const std::string& group, const std::string& key) {
+    std::promise<grpc::Status> result;
+    DeleteAsync(group, key, [&result](const grpc::Status& s) { result.set_value(s); });
+    return result.get_future().get();
+}
+
+grpc::Status CacheClient::Incr(const cache::IncrRequest& request, cache::IncrResponse* response) {
+    std::promise<grpc::Status> result;
+    IncrAsync(request, [&result, response](const grpc::Status& s, const cache::IncrResponse& counter) {
+        if (response) {
+            *response = counter;
+        }
+        result.set_value(s);
+    });
+    return result.get_future().get();
+}
+
+std::vector<std::optional<std::string>> CacheClient::MultiGet(const std::string& group,
+                                                              const std::vector<std::string>& keys,
+                                                              std::vector<grpc::Status>* statuses) {
+    std::vector<std::optional<std::string>> values(keys.size());
+    std::vector<grpc::Status> results(keys.size());
+    // Each distinct key not near-cached is fetched once, for all its positions.
+    std::unordered_map<std::string, std::vector<size_t>> positions;
+    std::vector<std::string> pending;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        std::string value;
+        if (near_ && NearGet(NearKey(group, keys[i]), value)) {
+            values[i] = std::move(value);
+            continue;
+        }
+        auto [it, inserted] = positions.try_emplace(keys[i]);
+        if (inserted) {
+            pending.push_back(keys[i]);
+        }
+        it->second.push_back(i);
+    }
+
+    // One call per node, carrying the keys it owns.
+    auto batches = GroupByNode(RouteBatch(pending));
+    std::vector<const std::vector<size_t>*> at;
+    at.reserve(pending.size());
+    for (const auto& key : pending) {
+        at.push_back(&positions[key]);
+    }
+    std::latch left(static_cast<std::ptrdiff_t>(pending.size()));
+    for (const auto& [node, members] : batches) {
+        std::vector<std::string> batchKeys;
+        batchKeys.reserve(members.size());
+        for (size_t j : members) {
+            batchKeys.push_back(pending[j]);
+        }
+        const std::vector<size_t>* batch = &members;
+        IssueMultiGet(node, group, batchKeys,
+                      [&values, &results, &at, &left, batch](size_t k, const grpc::Status& s,
+                                                             std::optional<std::string> value) {
+            for (size_t i : *at[(*batch)[k]]) {
+                results[i] = s;
+                values[i] = value;
+            }
+            left.count_down();
+        });
+    }
+    left.wait();
+    if (statuses) {
+        *statuses = std::move(results);
+    }
+    return values;
+}
+
+grpc::Status CacheClient::MultiSet(const std::string& group,
+                                   const std::vector<std::pair<std::string, std::string>>& entries) {
+    std::vector<std::string> keys;
+    keys.reserve(entries.size());
+    for (const auto& [key, value] : entries) {
+        keys.push_back(key);
+    }
+    auto batches = GroupByNode(RouteBatch(keys));
+    std::mutex mtx;
+    grpc::Status first;
+    std::latch left(static_cast<std::ptrdiff_t>(batches.size()));
+    for (const auto& [node, members] : batches) {
+        IssueMultiSet(node, group, entries, members, [&mtx, &first, &left](const grpc::Status& s) {
+            if (!s.ok()) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (first.ok()) {
+                    first = s;
+                }
+            }
+            left.count_down();
+        });
+    }
+    left.wait();
+    return first;
+}
+
+void CacheClient::GetAsync(const std::string& group, const std::string& key, GetCallback done) {
+    std::string value;
+    if (near_ && NearGet(NearKey(group, key), value)) {
+        done(grpc::Status::OK, std::move(value));
+        return;
+    }
+    IssueGet(Route(key), group, key, std::move(done));
+}
+
+void CacheClient::SetAsync(const std::string& group, const std::string& key, const std::string& value,
+                           DoneCallback done) {
+    IssueSet(Route(key), group, key, value, std::move(done));
+}
+
+void CacheClient::DeleteAsync(const std::string& group, const std::string& key, DoneCallback done) {
+    auto node = Route(key);
+    if (!node) {
+        if (done) {
+            done(NoNode());
+        }
+        return;
+    }
+    std::string nearKey = near_ ? NearKey(group, key) : std::string();
+    NearInvalidate(nearKey);
+    auto* call = new Call<cache::Request, cache::DeleteResponse>();
+    call->context.set_deadline(Deadline());
+    InjectTraceContext(call->context);
+    call->request.set_group(group);
+    call->request.set_key(key);
+    inFlight_.fetch_add(1, std::memory_order_relaxed);
+    node->stub->async()->Delete(&call->context, &call->request, &call->response,
+                                [this, call, nearKey = std::move(nearKey), done = std::move(done)](grpc::Status status) {
+        std::unique_ptr<Call<cache::Request, cache::DeleteResponse>> owned(call);
+        NearInvalidate(nearKey);
+        if (!status.ok()) {
+            OnFailure(status);
+        }
+        if (done) {
+            done(status);
+        }
+        inFlight_.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+void CacheClient::IncrAsync(const cache::IncrRequest& request, IncrCallback done) {
+    auto node = Route(request.key());
+    if (!node) {
+        if (done) {
+            done(NoNode(), cache::IncrResponse());
+        }
+        return;
+    }
+    std::string nearKey = near_ ? NearKey(request.group(), request.key()) : std::string();
+    NearInvalidate(nearKey);
+    auto* call = new Call<cache::IncrRequest, cache::IncrResponse>();
+    call->context.set_deadline(Deadline());
+    InjectTraceContext(call->context);
+    call->request = request;
+    inFlight_.fetch_add(1, std::memory_order_relaxed);
+    node->stub->async()->Incr(&call->context, &call->request, &call->response,
+                              [this, call, nearKey = std::move(nearKey), done = std::move(done)](grpc::Status status) {
+        std::unique_ptr<Call<cache::IncrRequest, cache::IncrResponse>> owned(call);
+        NearInvalidate(nearKey);
+        if (!status.ok()) {
+            OnFailure(status);
+        }
+        if (done) {
+            done(status, call->response);
+        }
+        inFlight_.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+size_t CacheClient::NodeCount() {
+    std::shared_lock lock(mtx_);
+    return nodes_.size();
+}
+
+void CacheClient::IssueGet(std::shared_ptr<Node> node, const std::string& group, const std::string& key,
+                           GetCallback done) {
+    if (!node) {
+        done(NoNode(), std::nullopt);
+        return;
+    }
+    std::string nearKey = near_ ? NearKey(group, key) : std::string();
+    // Read before the call: a write to the stripe after this point keeps the answer out of the near cache.
+    uint64_t stamp = near_ ? NearStripe(nearKey).load(std::memory_order_acquire) : 0;
+    auto* call = new Call<cache::Request, cache::GetResponse>();
+    call->context.set_deadline(Deadline());
+    InjectTraceContext(call->context);
+    call->request.set_group(group);
+    call->request.set_key(key);
+    inFlight_.fetch_add(1, std::memory_order_relaxed);
+    node->stub->async()->Get(&call->context, &call->request, &call->response,
+                             [this, call, stamp, nearKey = std::move(nearKey), done = std::move(done)](grpc::Status status) {
+        std::unique_ptr<Call<cache::Request, cache::GetResponse>> owned(call);
+        std::optional<std::string> value;
+        if (status.ok() && call->response.payload_case() != cache::GetResponse::kData) {
+            status = grpc::Status(grpc::StatusCode::INTERNAL, "value is not bytes");
+        }
+        if (status.ok()) {
+            value = std::move(*call->response.mutable_data());
+            if (near_) {
+                NearPut(nearKey, *value, stamp);
+            }
+        } else {
+            OnFailure(status);
+        }
+        done(status, std::move(value));
+        inFlight_.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+void CacheClient::IssueSet(std::shared_ptr<Node> node, const std::string& group, const std::string& key,
+                           const std::string& value, DoneCallback done) {
+    if (!node) {
+        if (done) {
+            done(NoNode());
+        }
+        return;
+    }
+    std::string nearKey = near_ ? NearKey(group, key) : std::string();
+    NearInvalidate(nearKey);
+    auto* call = new Call<cache::Request, cache::SetResponse>();
+    call->context.set_deadline(Deadline());
+    InjectTraceContext(call->context);
+    call->request.set_group(group);
+    call->request.set_key(key);
+    call->request.set_data(value);
+    inFlight_.fetch_add(1, std::memory_order_relaxed);
+    node->stub->async()->Set(&call->context, &call->request, &call->response,
+                             [this, call, nearKey = std::move(nearKey), done = std::move(done)](grpc::Status status) {
+        std::unique_ptr<Call<cache::Request, cache::SetResponse>> owned(call);
+        NearInvalidate(nearKey);
+        if (!status.ok()) {
+            OnFailure(status);
+        }
+        if (done) {
+            done(status);
+        }
+        inFlight_.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+void CacheClient::IssueMultiGet(std::shared_ptr<Node> node, const std::string& group,
+                                const std::vector<std::string>& keys, KeyCallback done) {
+    if (!node) {
+        for (size_t k = 0; k < keys.size(); ++k) {
+            done(k, NoNode(), std::nullopt);
+        }
+        return;
+    }
+    auto* call = new Call<cache::MultiGetRequest, cache::MultiGetResponse>();
+    call->context.set_deadline(Deadline());
+    InjectTraceContext(call->context);
+    call->request.set_group(group);
+    // Stamps are read before the call, as in IssueGet().
+    std::vector<std::string> nearKeys;
+    std::vector<uint64_t> stamps;
+    for (const auto& key : keys) {
+        call->request.add_keys(key);
+        if (near_) {
+            nearKeys.push_back(NearKey(group, key));
+            stamps.push_back(NearStripe(nearKeys.back()).load(std::memory_order_acquire));
+        }
+    }
+    inFlight_.fetch_add(1, std::memory_order_relaxed);
+    node->stub->async()->MultiGet(&call->context, &call->request, &call->response,
+                                  [this, call, nearKeys = std::move(nearKeys), stamps = std::move(stamps),
+                                   done = std::move(done)](grpc::Status status) {
+        std::unique_ptr<Call<cache::MultiGetRequest, cache::MultiGetResponse>> owned(call);
+        if (status.ok() && call->response.results_size() != call->request.keys_size()) {
+            status = grpc::Status(grpc::StatusCode::INTERNAL, "MultiGet answered a different number of keys");
+        }
+        if (!status.ok()) {
+            OnFailure(status);
+        }
+        for (int k = 0; k < call->request.keys_size(); ++k) {
+            if (!status.ok()) {
+                done(k, status, std::nullopt);
+                continue;
+            }
+            cache::KeyResult* result = call->response.mutable_results(k);
+            grpc::Status keyStatus(static_cast<grpc::StatusCode>(result->code()), result->message());
+            std::optional<std::string> value;
+            if (keyStatus.ok() && result->value().payload_case() != cache::GetResponse::kData) {
+                keyStatus = grpc::Status(grpc::StatusCode::INTERNAL, "value is not bytes");
+            }
+            if (keyStatus.ok()) {
+                value = std::move(*result->mutable_value()->mutable_data());
+                if (near_) {
+                    NearPut(nearKeys[k], *value, stamps[k]);
+                }
+            }
+            done(k, keyStatus, std::move(value));
+        }
+        inFlight_.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+void CacheClient::IssueMultiSet(std::shared_ptr<Node> node, const std::string& group,
+                                const std::vector<std::pair<std::string, std::string>>& entries,
+                                const std::vector<size_t>& which, DoneCallback done) {
+    if (!node) {
+        done(NoNode());
+        return;
+    }
+    auto* call = new Call<cache::MultiSetRequest, cache::MultiSetResponse>();
+    call->context.set_deadline(Deadline());
+    InjectTraceContext(call->context);
+    std::vector<std::string> nearKeys;
+    for (size_t i : which) {
+        cache::Request* entry = call->request.add_entries();
+        entry->set_group(group);
+        entry->set_key(entries[i].first);
+        entry->set_data(entries[i].second);
+        if (near_) {
+            nearKeys.push_back(NearKey(group, entries[i].first));
+            NearInvalidate(nearKeys.back());
+        }
+    }
+    inFlight_.fetch_add(1, std::memory_order_relaxed);
+    node->stub->async()->MultiSet(&call->context, &call->request, &call->response,
+                                  [this, call, nearKeys = std::move(nearKeys), done = std::move(done)](grpc::Status status) {
+        std::unique_ptr<Call<cache::MultiSetRequest, cache::MultiSetResponse>> owned(call);
+        for (const auto& nearKey : nearKeys) {
+            NearInvalidate(nearKey);
+        }
+        if (!status.ok()) {
+            OnFailure(status);
+        } else if (call->response.results_size() != call->request.entries_size()) {
+            status = grpc::Status(grpc::StatusCode::INTERNAL, "MultiSet answered a different number of keys");
+        }
+        for (int k = 0; status.ok() && k < call->response.results_size(); ++k) {
+            const cache::KeyResult& result = call->response.results(k);
+            status = grpc::Status(static_cast<grpc::StatusCode>(result.code()), result.message());
+        }
+        done(status);
+        inFlight_.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+std::shared_ptr<CacheClient::Node> CacheClient::Dial(const std::string& addr) {
+    grpc::ChannelArguments args;
+    args.SetInt(GRPC_ARG_INITIAL_RECONNECT_BACKOFF_MS, 100);
+    args.SetInt(GRPC_ARG_MAX_RECONNECT_BACKOFF_MS, 1000);
+    // Keep idle channels open, so the first call after a quiet spell pays no handshake.
+    args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, 30000);
+    args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+    auto node = std::make_shared<Node>();
+    node->addr = addr;
+    std::string target = options_.local_transport ? LocalTarget(addr) : addr;
+    node->channel = grpc::CreateCustomChannel(target, grpc::InsecureChannelCredentials(), args);
+    node->stub = cache::Cache::NewStub(node->channel);
+    return node;
+}
+
+std::shared_ptr<CacheClient::Node> CacheClient::Route(const std::string& key) {
+    std::shared_lock lock(mtx_);
+    if (nodes_.empty()) {
+        return nullptr;
+    }
+    auto it = nodes_.find(ring_.Get(key));
+    return it == nodes_.end() ? nullptr : it->second;
+}
+
+std::vector<std::shared_ptr<CacheClient::Node>> CacheClient::RouteBatch(const std::vector<std::string>& keys) {
+    std::vector<std::shared_ptr<Node>> routed(keys.size());
+    std::shared_lock lock(mtx_);
+    if (nodes_.empty() || keys.empty()) {
+        return routed;
+    }
+    auto addrs = ring_.GetBatch(keys);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto it = nodes_.find(addrs[i]);
+        if (it != nodes_.end()) {
+            routed[i] = it->second;
+        }
+    }
+    return routed;
+}
+
+std::vector<std::pair<std::shared_ptr<CacheClient::Node>, std::vector<size_t>>> CacheClient::GroupByNode(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+    std::vector<std::pair<std::shared_ptr<Node>, std::vector<size_t>>> batches;
+    std::unordered_map<Node*, size_t> batchOf;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        auto [it, inserted] = batchOf.try_emplace(nodes[i].get(), batches.size());
+        if (inserted) {
+            batches.emplace_back(nodes[i], std::vector<size_t>());
+        }
+        batches[it->second].second.push_back(i);
+    }
+    return batches;
+}
+
+bool CacheClient::Refresh() {
+    std::string prefix = service_name_ + "/";
+    std::unordered_set<std::string> live;
+    try {
+        auto respond = etcd_client_->ls(prefix).get();
+        if (!respond.is_ok()) {
+            spdlog::error("Failed to fetch cache nodes: {}", respond.error_message());
+            return false;
+        }
+        for (const auto& key : respond.keys()) {
+            if (key.rfind(prefix, 0) == 0) {
+                live.insert(key.substr(prefix.length()));
+            }
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Error occurred while fetching cache nodes: {}", e.what());
+        return false;
+    }
+
+    // Dial new nodes before taking the lock; channels connect lazily.
+    std::vector<std::shared_ptr<Node>> added;
+    {
+        std::shared_lock lock(mtx_);
+        for (const auto& addr : live) {
+            if (!nodes_.count(addr)) {
+                added.push_back(Dial(addr));
+            }
+        }
+    }
+    std::unique_lock lock(mtx_);
+    for (auto& node : added) {
+        if (nodes_.emplace(node->addr, node).second) {
+            ring_.Add(node->addr);
+            spdlog::info("Added cache node: {}", node->addr);
+        }
+    }
+    for (auto it = nodes_.begin(); it != nodes_.end();) {
+        if (live.count(it->first)) {
+            ++it;
+            continue;
+        }
+        // Calls in flight keep the node's channel alive through their shared_ptr.
+        ring_.Remove(it->first);
+        spdlog::info("Removed cache node: {}", it->first);
+        it = nodes_.erase(it);
+    }
+    return true;
+}
+
+void CacheClient::DiscoveryLoop() {
+    std::unique_lock<std::mutex> lock(discoveryMtx_);
+    while (!stopping_) {
+        discoveryCv_.wait_for(lock, options_.refresh_interval, [this] { return stopping_ || refreshNow_; });
+        if (stopping_) {
+            break;
+        }
+        refreshNow_ = false;
+        lock.unlock();
+        Refresh();
+        lock.lock();
+        // A dead node fails every call until its registration expires; do not refresh on each one.
+        discoveryCv_.wait_for(lock, kMinRefreshGap, [this] { return stopping_; });
+    }
+}
+
+void CacheClient::OnFailure(const grpc::Status& status) {
+    if (status.error_code() != grpc::StatusCode::UNAVAILABLE) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(discoveryMtx_);
+        refreshNow_ = true;
+    }
+    discoveryCv_.notify_one();
+}
+
+std::string CacheClient::NearKey(const std::string& group, const std::string& key) {
+    std::string nearKey;
+    nearKey.reserve(group.size() + 1 + key.size());
+    nearKey.append(group).push_back('\0');
+    nearKey.append(key);
+    return nearKey;
+}
+
+std::atomic<uint64_t>& CacheClient::NearStripe(const std::string& nearKey) {
+    return nearWrites_[std::hash<std::string>{}(nearKey) % kNearStripes];
+}
+
+bool CacheClient::NearGet(const std::string& nearKey, std::string& value) {
+    CacheEntry<std::string> entry;
+    if (!near_->get(nearKey, entry)) {
+        return false;
+    }
+    if (XFetch::Now() >= entry.expiry) {
+        near_->remove(nearKey);
+        return false;
+    }
+    value = std::move(entry.value);
+    return true;
+}
+
+void CacheClient::NearPut(const std::string& nearKey, const std::string& value, uint64_t stamp) {
+    if (NearStripe(nearKey).load(std::memory_order_acquire) != stamp) {
+        return;
+    }
+    CacheEntry<std::string> entry;
+    entry.value = value;
+    entry.expiry = XFetch::Now() + std::chrono::duration_cast<std::chrono::nanoseconds>(options_.near_cache_ttl).count();
+    near_->put(nearKey, entry);
+}
+
+void CacheClient::NearInvalidate(const std::string& nearKey) {
+    if (!near_) {
+        return;
+    }
+    NearStripe(nearKey).fetch_add(1, std::memory_order_acq_rel);
+    near_->remove(nearKey);
+}
@@ -2,6 +2,7 @@
 #include <csignal>
 #include <exception>
 #include <memory>
+#include <optional>
 #include <string>
 #include <thread>
 #include <vector>
@@ -14,10 +15,26 @@
 #include "include/cachegroup.h"
 #include "include/cacheserver.h"
 #include "include/peer.h"
+#include "include/slicevalue.h"
+#include "include/tracing.h"
 
 DEFINE_int32(port, 8001, "port");
 DEFINE_string(node, "A", "node");
 DEFINE_string(etcd_endpoints, "http://127.0.0.1:2379", "etcd endpoints");
+DEFINE_bool(thread_per_core, false, "serve requests from per-core shared-nothing loops");
+DEFINE_int32(cores, 0, "core loops in thread-per-core mode (0 = all cores)");
+DEFINE_double(trace_sample_ratio, 0.0, "fraction of requests traced (0 disables tracing)");
+DEFINE_string(trace_file, "", "append sampled spans to this file as JSON lines");
+DEFINE_string(policy, "lru", "cache policy spec, e.g. lru, arc:threshold=3 or sharded-lru-k:capacity=1000000,shards=32");
+DEFINE_bool(auto_tune, false, "switch the cache policy when a shadow-simulated candidate beats it");
+DEFINE_string(trace_otlp_endpoint, "", "OTLP/HTTP collector to post sampled spans to");
+DEFINE_int64(memory_limit_mb, 0, "node memory limit for cached data in MiB (0 = unlimited)");
+DEFINE_int64(memory_soft_quota_mb, 0, "memory guaranteed to the group before it is reclaimed from, in MiB");
+DEFINE_int64(memory_hard_quota_mb, 0, "memory the group may never exceed, in MiB (0 = none)");
+DEFINE_int64(ttl_ms, 0, "time-to-live of cached entries in ms (0 = never expire)");
+DEFINE_double(xfetch_beta, 1.0, "eagerness of probabilistic early refresh before expiry (0 = off)");
+DEFINE_bool(local_socket, true, "also listen on a Unix domain socket for colocated gateways");
+DEFINE_int32(shm_slots, 0, "client slots of the shared-memory transport (0 = off)");
 
 std::unordered_map<std::string, std::string> db = {
     {"Tom", "Tom"},  {"Jack", "Jack"},  {"Alice", "Alice"},
@@ -35,10 +52,17 @@ int main(int argc, char** argv){
     std::string addr = std::to_string(FLAGS_port);
     std::string service_name = "cache" + FLAGS_node;
     spdlog::info("Starting {} on {}", service_name, addr);
+    ConfigureTracing(FLAGS_trace_sample_ratio, FLAGS_trace_file, FLAGS_trace_otlp_endpoint, service_name);
 
     try {
+        PolicySpec policy = parsePolicySpec(FLAGS_policy);
+        MemoryGovernor::Instance().Configure(static_cast<size_t>(FLAGS_memory_limit_mb) << 20);
         ServerOptions opts;
         opts.etcd_endpoints = {FLAGS_etcd_endpoints};
+        opts.thread_per_core = FLAGS_thread_per_core;
+        opts.cores = static_cast<size_t>(FLAGS_cores);
+        opts.local_socket = FLAGS_local_socket;
+        opts.shm_slots = static_cast<size_t>(FLAGS_shm_slots);
         auto node = make_unique<CacheServer>(addr, service_name, opts);
 
         std::thread server_thread{[&] {
@@ -58,20 +82,31 @@ int main(int argc, char** argv){
         };
         std::signal(SIGINT, HandleCtrlC);
 
-        auto& CacheGroup = CacheGroup<std::string>::CreateCacheGroup(
+        auto& group = CacheGroup<SliceValue>::CreateCacheGroup(
             "test",
-            [&](const std::string& key) -> std::string {
+            [&](const std::string& key) -> std::optional<SliceValue> {
                 spdlog::info("Cache miss for key: {}", key);
                 if (db.find(key) != db.end()) {
-                    return db[key];
+                    return SliceValue(db[key]);
                 }
                 spdlog::warn("Key {} not found in database", key);
-                return "";
+                return std::nullopt;
             },
             service_name,
             addr,
-            FLAGS_etcd_endpoints
+            FLAGS_etcd_endpoints,
+            policy
         );
+        if (FLAGS_auto_tune) {
+            group.EnableAutoTuning();
+        }
+        if (FLAGS_memory_soft_quota_mb > 0 || FLAGS_memory_hard_quota_mb > 0) {
+            group.SetMemoryQuota(static_cast<size_t>(FLAGS_memory_soft_quota_mb) << 20,
+                                 static_cast<size_t>(FLAGS_memory_hard_quota_mb) << 20);
+        }
+        if (FLAGS_ttl_ms > 0) {
+            group.SetTtl(std::chrono::milliseconds(FLAGS_ttl_ms), FLAGS_xfetch_beta);
+        }
 
         spdlog::info("[node{}] service running, press Ctrl+C to exit...", FLAGS_node);
 
@@ -1,13 +1,48 @@
 #include "include/cacheserver.h"
-#include "include/cachegroup.h"
+#include "include/chunkstream.h"
+#include "include/groupregistry.h"
+#include "include/localtransport.h"
+#include "include/tracing.h"
 #include <fmt/base.h>
 #include <grpcpp/health_check_service_interface.h>
 #include <grpcpp/security/server_credentials.h>
 #include <grpcpp/server_builder.h>
+#include <grpcpp/support/proto_buffer_reader.h>
 #include <spdlog/spdlog.h>
-#include <google/protobuf/any.pb.h>
 
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <string>
+
+namespace {
+/**
+ * @brief Keys of a MultiGet still being answered; the last one finishes the call.
+ */
+struct MultiGetCall {
+    std::atomic<size_t> left{0}; ///< Keys without an answer yet.
+    StatusCallback done;         ///< Finishes the call.
+
+    /**
+     * @brief Record one key's answer.
+     */
+    void Land() {
+        if (left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            done(grpc::Status::OK);
+        }
+    }
+};
+
+/**
+ * @brief Record a key's failure in its result.
+ */
+void SetFailure(cache::KeyResult* result, const grpc::Status& status) {
+    result->set_code(status.error_code());
+    result->set_message(status.error_message());
+}
+} // namespace
 
 CacheServer::CacheServer(const std::string &service_addr, const std::string &service_name, const ServerOptions options)
     : service_addr_(service_addr), service_name_(service_name), options_(options) {
@@ -25,9 +60,48 @@ void CacheServer::Start() {
         grpc::ServerBuilder builder;
 
         builder.AddListeningPort(service_addr_, grpc::InsecureServerCredentials());
-        builder.RegisterService(this);
+        if (options_.local_socket) {
+            // A socket left by a node that crashed would fail the bind.
+            unlink(LocalSocketPath(service_addr_).c_str());
+            builder.AddListeningPort("unix:" + LocalSocketPath(service_addr_), grpc::InsecureServerCredentials());
+        }
+        if (!options_.thread_per_core) {
+            SetMessageAllocatorFor_Set(&set_allocator_);
+            SetMessageAllocatorFor_Delete(&delete_allocator_);
+            SetMessageAllocatorFor_Stats(&stats_allocator_);
+            SetMessageAllocatorFor_Invalidate(&invalidate_allocator_);
+            SetMessageAllocatorFor_Incr(&incr_allocator_);
+            SetMessageAllocatorFor_CompareAndSet(&cas_allocator_);
+            SetMessageAllocatorFor_MultiGet(&multi_get_allocator_);
+            SetMessageAllocatorFor_MultiSet(&multi_set_allocator_);
+            builder.RegisterService(this);
+            server_ = builder.BuildAndStart();
+            if (options_.shm_slots > 0) {
+                shm_server_ = std::make_unique<ShmServer>(service_addr_, options_.shm_slots);
+                shm_server_->Start();
+            }
+            spdlog::info("CacheServer started at {}", service_addr_);
+            return;
+        }
+
+        if (options_.shm_slots > 0) {
+            spdlog::warn("Shared-memory transport is not offered in thread-per-core mode");
+        }
+
+        // Thread-per-core: gRPC binds the port with SO_REUSEPORT and hands each
+        // core loop its own completion queue; CoreRouter steers every request
+        // to the core owning its key.
+        builder.AddChannelArgument(GRPC_ARG_ALLOW_REUSEPORT, 1);
+        builder.RegisterService(&async_service_);
+        core_router_ = std::make_unique<CoreRouter>(&async_service_, options_.cores, options_.core_shard_capacity);
+        async_service_.SetRouter(core_router_.get());
+        std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs;
+        for (size_t i = 0; i < core_router_->CoreCount(); ++i) {
+            cqs.push_back(builder.AddCompletionQueue());
+        }
         server_ = builder.BuildAndStart();
-        spdlog::info("CacheServer started at {}", service_addr_);
+        core_router_->Start(std::move(cqs));
+        spdlog::info("CacheServer started at {} with {} core loops", service_addr_, core_router_->CoreCount());
     } catch (const std::exception& e) {
         spdlog::error("Failed to start CacheServer: {}", e.what());
         throw;
@@ -35,8 +109,17 @@ void CacheServer::Start() {
 }
 
 void CacheServer::Stop() {
+    if (shm_server_) {
+        shm_server_->Stop();
+    }
     if (server_) {
         server_->Shutdown();
+        if (core_router_) {
+            core_router_->Stop();
+        }
+        if (options_.local_socket) {
+            unlink(LocalSocketPath(service_addr_).c_str());
+        }
         spdlog::info("CacheServer at {} stopped", service_addr_);
     }
     if (etcd_registry_) {
@@ -45,48 +128,336 @@ void CacheServer::Stop() {
     }
 }
 
-grpc::Status CacheServer::Get(grpc::ServerContext* context, const cache::Request* request, cache::GetResponse* response) {
-    auto group = CacheGroup<google::protobuf::Any>::GetCacheGroup(request->group());
+grpc::ServerUnaryReactor* CacheServer::Get(grpc::CallbackServerContext* context, const grpc::ByteBuffer* request,
+                                           grpc::ByteBuffer* response) {
+    auto* reactor = context->DefaultReactor();
+    // The request is parsed onto an arena whose first block is on the stack.
+    alignas(std::max_align_t) char block[512];
+    google::protobuf::ArenaOptions arena_options;
+    arena_options.initial_block = block;
+    arena_options.initial_block_size = sizeof(block);
+    google::protobuf::Arena arena(arena_options);
+    auto* parsed = google::protobuf::Arena::CreateMessage<cache::Request>(&arena);
+    grpc::ByteBuffer input(*request);
+    grpc::ProtoBufferReader reader(&input);
+    if (!parsed->ParseFromZeroCopyStream(&reader)) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed Get request"));
+        return reactor;
+    }
+
+    auto span = std::make_shared<Span>("server.get", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span->SetAttribute("group", parsed->group());
+    span->SetAttribute("key", parsed->key());
+    GroupReader* group = GroupRegistry::Instance().Find(parsed->group());
     if(!group){
-        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found");
+        span->SetError("group not found");
+        reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+        return reactor;
     }
-    auto val = group->Get(request->key());
-    if(!val){
-        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Key not found");
+    if(group->ServeLocal(parsed->key(), response)){
+        reactor->Finish(grpc::Status::OK);
+        return reactor;
     }
-    response->mutable_value() = *val;
-    return grpc::Status::OK;
+    if (parsed->lease()) {
+        // Lease-aware miss: the client loads and fills the key itself, so
+        // answer with a lease token (or a hot miss) instead of loading here.
+        cache::GetResponse leased;
+        group->ServeLease(parsed->key(), &leased);
+        span->SetAttribute("lease", leased.lease_token() != 0 ? "granted" : "hot_miss");
+        bool own_buffer = false;
+        reactor->Finish(grpc::SerializationTraits<cache::GetResponse>::Serialize(leased, response, &own_buffer));
+        return reactor;
+    }
+    // Miss: the owner's answer and the loader arrive asynchronously; the
+    // call is finished from their completion, with the load's own status
+    // (NOT_FOUND, or e.g. DEADLINE_EXCEEDED from the owner). The response
+    // buffer stays alive until Finish(). The span ends there too, so it
+    // covers the load.
+    auto loaded = std::make_shared<cache::GetResponse>();
+    auto finish = FinishWithSpan(reactor, span);
+    group->LoadEncodedAsync(parsed->key(), IsOwnerLoad(*context), loaded.get(),
+                            [loaded, response, finish](const grpc::Status& status) {
+        if (!status.ok()) {
+            finish(status);
+            return;
+        }
+        bool own_buffer = false;
+        finish(grpc::SerializationTraits<cache::GetResponse>::Serialize(*loaded, response, &own_buffer));
+    });
+    span->Detach();
+    return reactor;
 }
 
-grpc::Status CacheServer::Set(grpc::ServerContext* context, const cache::Request* request, cache::SetResponse* response) {
-    auto* group = CacheGroup<google::protobuf::Any>::GetCacheGroup(request->group());
+grpc::ServerUnaryReactor* CacheServer::Set(grpc::CallbackServerContext* context, const cache::Request* request,
+                                           cache::SetResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    Span span("server.set", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span.SetAttribute("group", request->group());
+    span.SetAttribute("key", request->key());
+    GroupWriter* group = GroupRegistry::Instance().Find(request->group());
     if (!group) {
-        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found");
+        reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+        return reactor;
     }
     
-    group->Set(
-        request->key(),
-        request->value(),
-        true  
-    );
+    grpc::Status status = group->ServeSet(*request);
+    if (!status.ok()) {
+        span.SetError(status.error_message());
+        reactor->Finish(status);
+        return reactor;
+    }
     
     response->set_value(true);
-    return grpc::Status::OK;
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
 }
 
-grpc::Status CacheServer::Delete(grpc::ServerContext* context, const cache::Request* request,
-                                cache::DeleteResponse* response) {
-    auto* group = CacheGroup<google::protobuf::Any>::GetCacheGroup(request->group());
+grpc::ServerUnaryReactor* CacheServer::Delete(grpc::CallbackServerContext* context, const cache::Request* request,
+                                              cache::DeleteResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    Span span("server.delete", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span.SetAttribute("group", request->group());
+    span.SetAttribute("key", request->key());
+    GroupWriter* group = GroupRegistry::Instance().Find(request->group());
     if (!group) {
-        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found");
+        reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+        return reactor;
     }
     
-    group->Del(
-        request->key(),
-        true 
-    );
+    group->ServeDelete(request->key());
     
     response->set_value(true);
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* CacheServer::Stats(grpc::CallbackServerContext* context, const cache::StatsRequest* request,
+                                             cache::StatsResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(FillStats(request->group(), response));
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* CacheServer::Incr(grpc::CallbackServerContext* context, const cache::IncrRequest* request,
+                                            cache::IncrResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    auto span = std::make_shared<Span>("server.incr", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span->SetAttribute("group", request->group());
+    span->SetAttribute("key", request->key());
+    GroupWriter* group = GroupRegistry::Instance().Find(request->group());
+    if (!group) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+        return reactor;
+    }
+    // Applied here if this node owns the counter; otherwise forwarded with
+    // an async call that finishes this one when the owner answers.
+    group->ServeIncr(*request, IsOwnerLoad(*context), response, FinishWithSpan(reactor, span));
+    span->Detach();
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* CacheServer::CompareAndSet(grpc::CallbackServerContext* context,
+                                                     const cache::CompareAndSetRequest* request,
+                                                     cache::CompareAndSetResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    auto span = std::make_shared<Span>("server.compare_and_set",
+                                       Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span->SetAttribute("group", request->request().group());
+    span->SetAttribute("key", request->request().key());
+    GroupWriter* group = GroupRegistry::Instance().Find(request->request().group());
+    if (!group) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+        return reactor;
+    }
+    // Applied here or forwarded to the owner, like Incr.
+    group->ServeCompareAndSet(*request, IsOwnerLoad(*context), response, FinishWithSpan(reactor, span));
+    span->Detach();
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* CacheServer::MultiGet(grpc::CallbackServerContext* context,
+                                                const cache::MultiGetRequest* request,
+                                                cache::MultiGetResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    auto span = std::make_shared<Span>("server.multi_get", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span->SetAttribute("group", request->group());
+    span->SetAttribute("keys", std::to_string(request->keys_size()));
+    ServeMultiGet(*request, IsOwnerLoad(*context), nullptr, response, FinishWithSpan(reactor, span));
+    span->Detach();
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* CacheServer::MultiSet(grpc::CallbackServerContext* context,
+                                                const cache::MultiSetRequest* request,
+                                                cache::MultiSetResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    Span span("server.multi_set", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span.SetAttribute("keys", std::to_string(request->entries_size()));
+    ApplyMultiSet(*request, nullptr, response);
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+StatusCallback CacheServer::FinishWithSpan(grpc::ServerUnaryReactor* reactor, std::shared_ptr<Span> span) {
+    return [reactor, span = std::move(span)](const grpc::Status& status) mutable {
+        if (!status.ok()) {
+            span->SetError(status.error_message());
+        }
+        reactor->Finish(status);
+        span.reset();
+    };
+}
+
+void CacheServer::ServeMultiGet(const cache::MultiGetRequest& request, bool asOwner, CoreRouter* router,
+                                cache::MultiGetResponse* response, StatusCallback done) {
+    CacheGroupBase* group = GroupRegistry::Instance().Find(request.group());
+    if (!group) {
+        done(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+        return;
+    }
+    if (request.keys().empty()) {
+        done(grpc::Status::OK);
+        return;
+    }
+    // Every result exists before the first answer, so answers arriving on
+    // other threads each write only their own.
+    for (int i = 0; i < request.keys_size(); ++i) {
+        response->add_results();
+    }
+    auto call = std::make_shared<MultiGetCall>();
+    call->left.store(request.keys_size(), std::memory_order_relaxed);
+    call->done = std::move(done);
+    // A miss is loaded like a Get miss; in thread-per-core mode the loaded
+    // value fills the owning core's shard, unless the group was invalidated meanwhile.
+    auto load = [group, asOwner, router, call](const std::string& name, const std::string& key,
+                                               cache::KeyResult* result) {
+        uint64_t generation = group->Generation();
+        group->LoadEncodedAsync(key, asOwner, result->mutable_value(),
+                                [group, router, call, name, key, result, generation](const grpc::Status& status) {
+            if (!status.ok()) {
+                result->clear_value();
+                SetFailure(result, status);
+            } else if (router && group->Generation() == generation) {
+                cache::GetResponse fill = result->value();
+                fill.clear_ttl_ms(); // Shards do not expire; the deadline is the caller's.
+                router->Put(name, key, std::move(fill));
+            }
+            call->Land();
+        });
+    };
+    for (int i = 0; i < request.keys_size(); ++i) {
+        const std::string& key = request.keys(i);
+        cache::KeyResult* result = response->mutable_results(i);
+        if (router) {
+            router->Peek(request.group(), key,
+                         [load, call, name = request.group(), key, result](cache::GetResponse* value) {
+                if (!value) {
+                    load(name, key, result);
+                    return;
+                }
+                result->mutable_value()->Swap(value);
+                call->Land();
+            });
+            continue;
+        }
+        grpc::ByteBuffer hit;
+        if (!group->ServeLocal(key, &hit)) {
+            load(request.group(), key, result);
+            continue;
+        }
+        grpc::Status parsed = grpc::SerializationTraits<cache::GetResponse>::Deserialize(&hit, result->mutable_value());
+        if (!parsed.ok()) {
+            SetFailure(result, parsed);
+        }
+        call->Land();
+    }
+}
+
+void CacheServer::ApplyMultiSet(const cache::MultiSetRequest& request, CoreRouter* router,
+                                cache::MultiSetResponse* response) {
+    for (const auto& entry : request.entries()) {
+        cache::KeyResult* result = response->add_results();
+        grpc::Status status;
+        if (router) {
+            status = router->Write(entry);
+        } else if (GroupWriter* group = GroupRegistry::Instance().Find(entry.group())) {
+            status = group->ServeSet(entry);
+        } else {
+            status = grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found");
+        }
+        if (!status.ok()) {
+            SetFailure(result, status);
+        }
+    }
+}
+
+grpc::ServerWriteReactor<cache::Chunk>* CacheServer::GetStream(grpc::CallbackServerContext* context,
+                                                               const cache::Request* request) {
+    return new ChunkStreamWriter(context, request, nullptr);
+}
+
+grpc::ServerReadReactor<cache::Chunk>* CacheServer::SetStream(grpc::CallbackServerContext* context,
+                                                              cache::SetResponse* response) {
+    return new ChunkStreamReader(context, response, nullptr);
+}
+
+grpc::ServerUnaryReactor* CacheServer::Invalidate(grpc::CallbackServerContext* context,
+                                                  const cache::InvalidateRequest* request,
+                                                  cache::InvalidateResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    Span span("server.invalidate", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span.SetAttribute("group", request->group());
+    span.SetAttribute("prefix", request->prefix());
+    grpc::Status status = ApplyInvalidate(*request);
+    if (!status.ok()) {
+        span.SetError(status.error_message());
+        reactor->Finish(status);
+        return reactor;
+    }
+    response->set_value(true);
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+grpc::Status CacheServer::ApplyInvalidate(const cache::InvalidateRequest& request) {
+    GroupWriter* group = GroupRegistry::Instance().Find(request.group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found");
+    }
+    group->ServeInvalidate(request.prefix(), !request.local());
     return grpc::Status::OK;
 }
 
+grpc::Status CacheServer::FillStats(const std::string& group_name, cache::StatsResponse* response) {
+    GroupStatsSource* group = GroupRegistry::Instance().Find(group_name);
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found");
+    }
+    GroupStats stats = group->GetStats();
+    response->set_capacity(stats.capacity);
+    response->set_hits(stats.hits);
+    response->set_misses(stats.misses);
+    response->set_sample_rate(stats.sampleRate);
+    response->set_working_set_size(stats.workingSetSize);
+    for (const auto& point : stats.missRatioCurve) {
+        auto* out = response->add_miss_ratio_curve();
+        out->set_capacity(point.capacity);
+        out->set_miss_ratio(point.missRatio);
+    }
+    response->set_policy(stats.policy);
+    for (const auto& score : stats.policyScores) {
+        auto* out = response->add_policy_scores();
+        out->set_policy(score.spec.name());
+        out->set_hit_ratio(score.hitRatio);
+    }
+    response->set_memory_bytes(stats.memoryBytes);
+    response->set_memory_soft_quota(stats.softQuota);
+    response->set_memory_hard_quota(stats.hardQuota);
+    response->set_memory_fair_share(stats.fairShare);
+    response->set_write_behind_writes(stats.writeBehind.writes);
+    response->set_write_behind_flushed_keys(stats.writeBehind.flushedKeys);
+    response->set_write_behind_batches(stats.writeBehind.batches);
+    response->set_write_behind_failed_batches(stats.writeBehind.failedBatches);
+    response->set_write_behind_dirty_keys(stats.writeBehind.dirtyKeys);
+    return grpc::Status::OK;
+}
@@ -0,0 +1,173 @@
+#include "include/chunkstream.h"
+#include "include/corerouter.h"
+
+#include <utility>
+
+namespace {
+/**
+ * @brief A shard value (as Get returns it) as the chunk chain GetStream sends.
+ *
+ * Matches CacheGroup's own conversion: the `data` payload, or the
+ * serialized Any of groups whose values travel in `value`.
+ */
+ChunkedValue ChunksOf(cache::GetResponse& value) {
+    ChunkedValue::Builder builder;
+    if (value.payload_case() == cache::GetResponse::kData) {
+        builder.Append(std::move(*value.mutable_data()));
+    } else if (value.has_value()) {
+        builder.Append(value.value().SerializeAsString());
+    }
+    return builder.Build();
+}
+} // namespace
+
+ChunkStreamWriter::ChunkStreamWriter(grpc::CallbackServerContext* context, const cache::Request* request,
+                                     CoreRouter* router)
+    : key_(request->key()), asOwner_(IsOwnerLoad(*context)) {
+    Span span("server.get_stream", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span.SetAttribute("group", request->group());
+    span.SetAttribute("key", request->key());
+    trace_ = span.Context();
+    group_ = GroupRegistry::Instance().Find(request->group());
+    if (!group_) {
+        span.SetError("group not found");
+        Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+        return;
+    }
+    if (router) {
+        // The shard belongs to its core: look there, and continue on that
+        // core with the result.
+        router->Peek(request->group(), key_, [this](cache::GetResponse* value) {
+            if (value) {
+                Send(ChunksOf(*value));
+            } else {
+                Load();
+            }
+        });
+        return;
+    }
+    ChunkedValue value;
+    if (group_->ServeLocalChunks(key_, &value, &ttlMs_)) {
+        Send(std::move(value));
+        return;
+    }
+    Load();
+}
+
+void ChunkStreamWriter::Load() {
+    Span load("server.load", trace_);
+    group_->LoadChunksAsync(key_, asOwner_, &value_, &ttlMs_, [this](const grpc::Status& status) {
+        if (!status.ok()) {
+            Finish(status);
+            return;
+        }
+        WriteNext();
+    });
+}
+
+void ChunkStreamWriter::Send(ChunkedValue value) {
+    value_ = std::move(value);
+    WriteNext();
+}
+
+void ChunkStreamWriter::WriteNext() {
+    // An empty value still gets one (empty) chunk carrying total_size.
+    if (next_ > 0 && next_ >= value_.chunks()) {
+        Finish(grpc::Status::OK);
+        return;
+    }
+    chunk_.Clear();
+    if (next_ == 0) {
+        chunk_.set_total_size(value_.size());
+        chunk_.set_ttl_ms(ttlMs_);
+    }
+    chunk_.set_offset(offset_);
+    if (next_ < value_.chunks()) {
+        const SliceValue& piece = value_.chunk(next_);
+        chunk_.set_data(piece.data(), piece.size());
+        offset_ += piece.size();
+    }
+    ++next_;
+    StartWrite(&chunk_);
+}
+
+void ChunkStreamWriter::OnWriteDone(bool ok) {
+    if (!ok) {
+        Finish(grpc::Status(grpc::StatusCode::CANCELLED, "Stream closed"));
+        return;
+    }
+    WriteNext();
+}
+
+void ChunkStreamWriter::OnDone() {
+    delete this;
+}
+
+ChunkStreamReader::ChunkStreamReader(grpc::CallbackServerContext* context, cache::SetResponse* response,
+                                     CoreRouter* router)
+    : response_(response), router_(router),
+      trace_(Tracer::Instance().Continue(ExtractTraceContext(*context))) {
+    StartRead(&chunk_);
+}
+
+void ChunkStreamReader::OnReadDone(bool ok) {
+    if (!ok) {
+        // The client is done sending (or gone; then Finish is a no-op).
+        Store();
+        return;
+    }
+    if (!group_) {
+        group_ = GroupRegistry::Instance().Find(chunk_.group());
+        if (!group_) {
+            Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+            return;
+        }
+        groupName_ = chunk_.group();
+        key_ = chunk_.key();
+        totalSize_ = chunk_.total_size();
+    }
+    if (totalSize_ != 0 && builder_.size() + chunk_.data().size() > totalSize_) {
+        Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Stream is longer than its total_size"));
+        return;
+    }
+    if (!builder_.AppendAt(chunk_.offset(), std::move(*chunk_.mutable_data()))) {
+        Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Chunk is missing or out of order"));
+        return;
+    }
+    StartRead(&chunk_);
+}
+
+void ChunkStreamReader::Store() {
+    Span span("server.set_stream", trace_);
+    if (!group_) {
+        Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Empty stream"));
+        return;
+    }
+    span.SetAttribute("group", groupName_);
+    span.SetAttribute("key", key_);
+    if (totalSize_ != 0 && builder_.size() != totalSize_) {
+        span.SetError("truncated");
+        Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Stream is shorter than its total_size"));
+        return;
+    }
+    ChunkedValue value = builder_.Build();
+    grpc::Status status;
+    if (router_) {
+        cache::GetResponse encoded;
+        status = group_->ServeSetChunks(key_, value, &encoded);
+        if (status.ok()) {
+            router_->Put(groupName_, key_, std::move(encoded));
+        }
+    } else {
+        status = group_->ServeSetChunks(key_, value, nullptr);
+    }
+    if (!status.ok()) {
+        span.SetError(status.error_message());
+    }
+    response_->set_value(status.ok());
+    Finish(status);
+}
+
+void ChunkStreamReader::OnDone() {
+    delete this;
+}
@@ -1,9 +1,9 @@
-#include "include/ConsistentHash.h"
+#include "include/consistentHash.h"
 
 #include <mutex>
 #include <iostream>
 #include <algorithm>
-consistentHash::consistentHash(int replicanum = 50, int minreplica = 10, int maxreplica = 200, double rebalancerthreashold = 0.25):
+consistentHash::consistentHash(int replicanum, int minreplica, int maxreplica, double rebalancerthreashold):
         replicaNum(replicanum), 
         minReplica(minreplica), 
         maxReplica(maxreplica), 
@@ -56,3 +56,46 @@ std::string consistentHash::Get(const std::string& key){
     }
     return hashToNode[*it];
 }
+
+std::vector<std::string> consistentHash::GetBatch(const std::vector<std::string>& keys){
+    constexpr size_t kLanes = 8;
+    std::vector<std::string> nodes(keys.size());
+    std::vector<uint32_t> hashes(keys.size());
+    batchhash::hashBatch(keys.data(), keys.size(), hashes.data());
+
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    if(hashRing.empty()){
+        std::cerr << "Hash ring is empty, no nodes available." << std::endl;
+        return nodes;
+    }
+    const int* ring = hashRing.data();
+    const size_t ringSize = hashRing.size();
+    for(size_t base = 0; base < keys.size(); base += kLanes){
+        size_t lanes = std::min(kLanes, keys.size() - base);
+        const int* pos[kLanes];
+        int target[kLanes];
+        for(size_t l = 0; l < lanes; l++){
+            pos[l] = ring;
+            target[l] = static_cast<int>(hashes[base + l]);
+        }
+        // Branchless lower_bound, one step for every lane per iteration.
+        size_t n = ringSize;
+        while(n > 1){
+            size_t half = n / 2;
+            for(size_t l = 0; l < lanes; l++){
+                __builtin_prefetch(pos[l] + half / 2);
+                __builtin_prefetch(pos[l] + half + half / 2);
+                pos[l] = (pos[l][half] < target[l]) ? pos[l] + half : pos[l];
+            }
+            n -= half;
+        }
+        for(size_t l = 0; l < lanes; l++){
+            size_t idx = static_cast<size_t>(pos[l] - ring) + (*pos[l] < target[l]);
+            if(idx == ringSize){
+                idx = 0;
+            }
+            nodes[base + l] = hashToNode[ring[idx]];
+        }
+    }
+    return nodes;
+}
@@ -0,0 +1,734 @@
+#include "include/corerouter.h"
+#include "include/cacheserver.h"
+#include "include/chunkstream.h"
+#include "include/groupregistry.h"
+#include "include/memorygovernor.h"
+#include "include/taskscheduler.h"
+#include "include/tracing.h"
+#include "include/wirecodec.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+/**
+ * @brief The value of a write in the form shards store it (as Get returns it).
+ */
+cache::GetResponse ShardValue(const cache::Request& request) {
+    cache::GetResponse value;
+    if (request.payload_case() == cache::Request::kData) {
+        value.set_data(request.data());
+    } else if (request.has_value()) {
+        *value.mutable_value() = request.value();
+    }
+    return value;
+}
+
+/**
+ * @brief A write of a shard value, for GroupWriter::Replicate().
+ */
+cache::Request WriteOf(const std::string& group, const std::string& key, const cache::GetResponse& value) {
+    cache::Request request;
+    request.set_group(group);
+    request.set_key(key);
+    if (value.payload_case() == cache::GetResponse::kData) {
+        request.set_data(value.data());
+    } else if (value.has_value()) {
+        *request.mutable_value() = value.value();
+    }
+    return request;
+}
+
+/**
+ * @brief Check a Set's lease and replicate it; the caller then stores its shard value.
+ */
+grpc::Status ReplicateSet(CacheGroupBase* group, const cache::Request& request) {
+    if (request.lease_token() != 0) {
+        if (!group->RedeemLease(request.key(), request.lease_token())) {
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Lease expired or invalidated");
+        }
+    } else {
+        group->InvalidateLease(request.key());
+    }
+    if (!group->Replicate(request, Sync::SET)) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Value does not match the group's type");
+    }
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief Approximate footprint of one shard entry: key, encoded value and bookkeeping.
+ */
+double ShardEntryBytes(double overhead, const std::string& key, const cache::GetResponse& value) {
+    return overhead + sizeof(cache::GetResponse) + key.size() + value.ByteSizeLong();
+}
+} // namespace
+
+/**
+ * @brief One in-flight unary RPC handled by a core loop.
+ *
+ * A call is requested on its origin core's completion queue. Once a request
+ * arrives it is routed to the core owning the key, executed there, and
+ * finished; the finish event comes back on the origin queue, which deletes it.
+ */
+class CoreRouter::Call {
+public:
+    enum class Method { GET, SET, DELETE, STATS, INVALIDATE, INCR, CAS };
+    enum class State { RECEIVING, FINISHING };
+
+    Call(CoreRouter* router, Core* origin, Method method)
+        : router(router), origin(origin), method(method),
+          getWriter(&ctx), setWriter(&ctx), deleteWriter(&ctx), statsWriter(&ctx), invalidateWriter(&ctx),
+          incrWriter(&ctx), casWriter(&ctx) {}
+
+    /**
+     * @brief Ask gRPC for the next incoming RPC of this call's method.
+     */
+    void Request() {
+        auto* cq = origin->cq.get();
+        switch (method) {
+            case Method::GET:
+                router->service_->RequestGet(&ctx, &request, &getWriter, cq, cq, this);
+                break;
+            case Method::SET:
+                router->service_->RequestSet(&ctx, &request, &setWriter, cq, cq, this);
+                break;
+            case Method::DELETE:
+                router->service_->RequestDelete(&ctx, &request, &deleteWriter, cq, cq, this);
+                break;
+            case Method::STATS:
+                router->service_->RequestStats(&ctx, &statsRequest, &statsWriter, cq, cq, this);
+                break;
+            case Method::INVALIDATE:
+                router->service_->RequestInvalidate(&ctx, &invalidateRequest, &invalidateWriter, cq, cq, this);
+                break;
+            case Method::INCR:
+                router->service_->RequestIncr(&ctx, &incrRequest, &incrWriter, cq, cq, this);
+                break;
+            case Method::CAS:
+                router->service_->RequestCompareAndSet(&ctx, &casRequest, &casWriter, cq, cq, this);
+                break;
+        }
+    }
+
+    /**
+     * @brief Send the response; the completion is delivered to the origin core.
+     */
+    void Finish(const grpc::Status& status) {
+        state = State::FINISHING;
+        switch (method) {
+            case Method::GET:
+                getWriter.Finish(getResponse, status, this);
+                break;
+            case Method::SET:
+                setWriter.Finish(setResponse, status, this);
+                break;
+            case Method::DELETE:
+                deleteWriter.Finish(deleteResponse, status, this);
+                break;
+            case Method::STATS:
+                statsWriter.Finish(statsResponse, status, this);
+                break;
+            case Method::INVALIDATE:
+                invalidateWriter.Finish(invalidateResponse, status, this);
+                break;
+            case Method::INCR:
+                incrWriter.Finish(incrResponse, status, this);
+                break;
+            case Method::CAS:
+                casWriter.Finish(casResponse, status, this);
+                break;
+        }
+    }
+
+    /**
+     * @brief Group of a keyed call.
+     */
+    const std::string& Group() const {
+        switch (method) {
+            case Method::INCR:
+                return incrRequest.group();
+            case Method::CAS:
+                return casRequest.request().group();
+            default:
+                return request.group();
+        }
+    }
+
+    /**
+     * @brief Key of a keyed call; picks the owning core.
+     */
+    const std::string& Key() const {
+        switch (method) {
+            case Method::INCR:
+                return incrRequest.key();
+            case Method::CAS:
+                return casRequest.request().key();
+            default:
+                return request.key();
+        }
+    }
+
+    CoreRouter* router;                ///< Owning router.
+    Core* origin;                      ///< Core whose completion queue the call lives on.
+    Method method;                     ///< RPC method.
+    State state = State::RECEIVING;    ///< Position in the state machine.
+    grpc::ServerContext ctx;           ///< Per-call server context.
+    cache::Request request;            ///< Incoming request.
+    cache::GetResponse getResponse;    ///< Response for GET.
+    cache::SetResponse setResponse;    ///< Response for SET.
+    cache::DeleteResponse deleteResponse; ///< Response for DELETE.
+    cache::StatsRequest statsRequest;  ///< Incoming request for STATS.
+    cache::StatsResponse statsResponse; ///< Response for STATS.
+    cache::InvalidateRequest invalidateRequest;   ///< Incoming request for INVALIDATE.
+    cache::InvalidateResponse invalidateResponse; ///< Response for INVALIDATE.
+    cache::IncrRequest incrRequest;    ///< Incoming request for INCR.
+    cache::IncrResponse incrResponse;  ///< Response for INCR.
+    cache::CompareAndSetRequest casRequest;   ///< Incoming request for CAS.
+    cache::CompareAndSetResponse casResponse; ///< Response for CAS.
+    grpc::ServerAsyncResponseWriter<cache::GetResponse> getWriter;       ///< Writer for GET.
+    grpc::ServerAsyncResponseWriter<cache::SetResponse> setWriter;       ///< Writer for SET.
+    grpc::ServerAsyncResponseWriter<cache::DeleteResponse> deleteWriter; ///< Writer for DELETE.
+    grpc::ServerAsyncResponseWriter<cache::StatsResponse> statsWriter;   ///< Writer for STATS.
+    grpc::ServerAsyncResponseWriter<cache::InvalidateResponse> invalidateWriter; ///< Writer for INVALIDATE.
+    grpc::ServerAsyncResponseWriter<cache::IncrResponse> incrWriter;     ///< Writer for INCR.
+    grpc::ServerAsyncResponseWriter<cache::CompareAndSetResponse> casWriter; ///< Writer for CAS.
+};
+
+CoreRouter::CoreRouter(CoreService* service, size_t cores, size_t shardCapacity)
+    : service_(service), shardCapacity_(shardCapacity) {
+    if (cores == 0) {
+        cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    cores_.reserve(cores);
+    for (size_t i = 0; i < cores; ++i) {
+        auto core = std::make_unique<Core>();
+        core->index = i;
+        for (size_t from = 0; from < cores; ++from) {
+            core->inbox.emplace_back(std::make_unique<SpscQueue<Call*>>(4096));
+        }
+        core->parked = std::vector<std::atomic<size_t>>(cores);
+        cores_.push_back(std::move(core));
+    }
+}
+
+CoreRouter::~CoreRouter() {
+    Stop();
+}
+
+void CoreRouter::Start(std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs) {
+    if (cqs.size() != cores_.size()) {
+        throw std::runtime_error("CoreRouter needs exactly one completion queue per core");
+    }
+    running_ = true;
+    for (size_t i = 0; i < cores_.size(); ++i) {
+        cores_[i]->cq = std::move(cqs[i]);
+    }
+    for (auto& core : cores_) {
+        Core* c = core.get();
+        core->thread = std::thread([this, c] { Loop(*c); });
+    }
+    MemoryGovernor::Instance().Register(this);
+    spdlog::info("CoreRouter started {} core loops", cores_.size());
+}
+
+void CoreRouter::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    MemoryGovernor::Instance().Unregister(this);
+    // Calls served off-core finish on the queues; let them land first.
+    while (offCore_.load(std::memory_order_acquire) != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (auto& core : cores_) {
+        core->cq->Shutdown();
+    }
+    for (auto& core : cores_) {
+        if (core->thread.joinable()) {
+            core->thread.join();
+        }
+    }
+    spdlog::info("CoreRouter stopped");
+}
+
+size_t CoreRouter::OwnerOf(const std::string& key) const {
+    return std::hash<std::string>{}(key) % cores_.size();
+}
+
+void CoreRouter::Loop(Core& core) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core.index % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    (new Call(this, &core, Call::Method::GET))->Request();
+    (new Call(this, &core, Call::Method::SET))->Request();
+    (new Call(this, &core, Call::Method::DELETE))->Request();
+    (new Call(this, &core, Call::Method::STATS))->Request();
+    (new Call(this, &core, Call::Method::INVALIDATE))->Request();
+    (new Call(this, &core, Call::Method::INCR))->Request();
+    (new Call(this, &core, Call::Method::CAS))->Request();
+
+    void* tag = nullptr;
+    bool ok = false;
+    while (true) {
+        // Poll without blocking while there is forwarded work; otherwise park
+        // on the completion queue for a short while.
+        bool busy = DrainInboxes(core);
+        auto deadline = std::chrono::system_clock::now() + (busy ? std::chrono::microseconds(0)
+                                                                 : std::chrono::microseconds(500));
+        auto status = core.cq->AsyncNext(&tag, &ok, deadline);
+        if (status == grpc::CompletionQueue::SHUTDOWN) {
+            break;
+        }
+        if (status == grpc::CompletionQueue::TIMEOUT) {
+            // Idle: report what the shards counted so far.
+            for (auto& [name, slot] : core.shards) {
+                ReportAccesses(slot);
+            }
+            continue;
+        }
+        auto* call = static_cast<Call*>(tag);
+        if (call->state == Call::State::FINISHING || !ok) {
+            delete call;
+            continue;
+        }
+        (new Call(this, &core, call->method))->Request();
+        Route(core, call);
+    }
+}
+
+void CoreRouter::Route(Core& core, Call* call) {
+    if (call->method == Call::Method::STATS) {
+        // Group-wide and thread-safe; no owning core.
+        call->Finish(CacheServer::FillStats(call->statsRequest.group(), &call->statsResponse));
+        return;
+    }
+    if (call->method == Call::Method::INVALIDATE) {
+        // Group-wide; every core drops its shard once it sees the new generation.
+        call->Finish(CacheServer::ApplyInvalidate(call->invalidateRequest));
+        return;
+    }
+    size_t owner = OwnerOf(call->Key());
+    if (owner == core.index) {
+        Execute(core, call);
+        return;
+    }
+    Core* target = cores_[owner].get();
+    // Once a call from this core is parked, later ones follow it through the
+    // parked queue until it has run, so none overtakes it via the inbox
+    // (which the owner drains first).
+    std::atomic<size_t>& parked = target->parked[core.index];
+    if (parked.load(std::memory_order_acquire) != 0 || !target->inbox[core.index]->push(call)) {
+        // The owner is backed up. Park the call on its mutex-guarded queue
+        // rather than wait for a slot, which would stall all of this core's
+        // own traffic behind one hot peer. Stop() waits for it like an
+        // off-core call.
+        BeginOffCore();
+        parked.fetch_add(1, std::memory_order_relaxed);
+        Post(*target, [this, target, call, &parked] {
+            Execute(*target, call);
+            parked.fetch_sub(1, std::memory_order_release);
+            EndOffCore();
+        });
+    }
+}
+
+bool CoreRouter::DrainInboxes(Core& core) {
+    bool worked = false;
+    Call* call = nullptr;
+    for (auto& queue : core.inbox) {
+        while (queue->pop(call)) {
+            Execute(core, call);
+            worked = true;
+        }
+    }
+    if (core.hasFills.load(std::memory_order_acquire)) {
+        std::vector<Fill> fills;
+        std::vector<std::function<void()>> peeks;
+        {
+            std::lock_guard<std::mutex> lock(core.fillMtx);
+            fills.swap(core.fills);
+            peeks.swap(core.peeks);
+            core.hasFills.store(false, std::memory_order_relaxed);
+        }
+        for (auto& fill : fills) {
+            // A fill loaded before an invalidation of its group is dropped.
+            ShardSlot* slot = SlotFor(core, fill.group);
+            if (slot && slot->generation == fill.generation) {
+                Store(core, *slot, fill.key, fill.value);
+            }
+        }
+        for (auto& peek : peeks) {
+            peek();
+        }
+        worked = worked || !fills.empty() || !peeks.empty();
+    }
+    return worked;
+}
+
+void CoreRouter::Peek(const std::string& group, const std::string& key,
+                      std::function<void(cache::GetResponse*)> done) {
+    Core* owner = cores_[OwnerOf(key)].get();
+    Post(*owner, [this, owner, group, key, done = std::move(done)] {
+        ShardSlot* slot = SlotFor(*owner, group);
+        cache::GetResponse value;
+        bool hit = slot && slot->shard->get(key, value);
+        if (slot) {
+            CountAccess(*slot, key, hit);
+        }
+        done(hit ? &value : nullptr);
+    });
+}
+
+void CoreRouter::Put(const std::string& group, const std::string& key, cache::GetResponse value) {
+    auto* g = GroupRegistry::Instance().Find(group);
+    if (!g) {
+        return;
+    }
+    Core* owner = cores_[OwnerOf(key)].get();
+    std::lock_guard<std::mutex> lock(owner->fillMtx);
+    owner->fills.push_back(Fill{group, key, std::move(value), g->Generation()});
+    owner->hasFills.store(true, std::memory_order_release);
+}
+
+grpc::Status CoreRouter::Write(const cache::Request& request) {
+    auto* group = GroupRegistry::Instance().Find(request.group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found");
+    }
+    grpc::Status status = ReplicateSet(group, request);
+    if (status.ok()) {
+        Put(request.group(), request.key(), ShardValue(request));
+    }
+    return status;
+}
+
+size_t CoreRouter::MemoryUsage() {
+    double bytes = 0;
+    for (auto& core : cores_) {
+        bytes += core->entries.load(std::memory_order_relaxed) * core->entryBytes.load(std::memory_order_relaxed);
+    }
+    return static_cast<size_t>(bytes);
+}
+
+size_t CoreRouter::Reclaim(size_t bytes) {
+    size_t usage = MemoryUsage();
+    if (usage == 0 || !running_.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    bytes = std::min(bytes, usage);
+    size_t asked = 0;
+    for (auto& core : cores_) {
+        double entry = core->entryBytes.load(std::memory_order_relaxed);
+        double held = core->entries.load(std::memory_order_relaxed) * entry;
+        auto entries = static_cast<size_t>(std::ceil(bytes * (held / usage) / entry));
+        if (entries == 0) {
+            continue;
+        }
+        Core* c = core.get();
+        Post(*c, [this, c, entries] { Evict(*c, entries); });
+        asked += static_cast<size_t>(entries * entry);
+    }
+    return std::min(asked, bytes);
+}
+
+void CoreRouter::Post(Core& core, std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(core.fillMtx);
+    core.peeks.push_back(std::move(fn));
+    core.hasFills.store(true, std::memory_order_release);
+}
+
+void CoreRouter::Store(Core& core, ShardSlot& slot, const std::string& key, const cache::GetResponse& value) {
+    size_t before = slot.shard->size();
+    slot.shard->put(key, value);
+    // A put never shrinks a shard: it adds the key, or evicts one to make room.
+    core.entries.fetch_add(slot.shard->size() - before, std::memory_order_relaxed);
+    double entry = core.entryBytes.load(std::memory_order_relaxed);
+    entry += (ShardEntryBytes(kEntryOverhead, key, value) - entry) * kEntryBytesWeight;
+    core.entryBytes.store(entry, std::memory_order_relaxed);
+    MemoryGovernor::Instance().OnGrowth(this);
+}
+
+void CoreRouter::Erase(Core& core, ShardSlot& slot, const std::string& key) {
+    if (slot.shard->remove(key)) {
+        core.entries.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void CoreRouter::Evict(Core& core, size_t entries) {
+    for (size_t evicted = 0; evicted < entries; ++evicted) {
+        ShardSlot* largest = nullptr;
+        for (auto& [name, slot] : core.shards) {
+            if (!largest || slot.shard->size() > largest->shard->size()) {
+                largest = &slot;
+            }
+        }
+        if (!largest || !largest->shard->evictOne()) {
+            return;
+        }
+        core.entries.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+grpc::ServerWriteReactor<cache::Chunk>* CoreService::GetStream(grpc::CallbackServerContext* context,
+                                                               const cache::Request* request) {
+    return new ChunkStreamWriter(context, request, router_);
+}
+
+grpc::ServerReadReactor<cache::Chunk>* CoreService::SetStream(grpc::CallbackServerContext* context,
+                                                              cache::SetResponse* response) {
+    return new ChunkStreamReader(context, response, router_);
+}
+
+grpc::ServerUnaryReactor* CoreService::MultiGet(grpc::CallbackServerContext* context,
+                                                const cache::MultiGetRequest* request,
+                                                cache::MultiGetResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    auto span = std::make_shared<Span>("server.multi_get", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span->SetAttribute("group", request->group());
+    span->SetAttribute("keys", std::to_string(request->keys_size()));
+    CacheServer::ServeMultiGet(*request, IsOwnerLoad(*context), router_, response,
+                               CacheServer::FinishWithSpan(reactor, span));
+    span->Detach();
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* CoreService::MultiSet(grpc::CallbackServerContext* context,
+                                                const cache::MultiSetRequest* request,
+                                                cache::MultiSetResponse* response) {
+    auto* reactor = context->DefaultReactor();
+    Span span("server.multi_set", Tracer::Instance().Continue(ExtractTraceContext(*context)));
+    span.SetAttribute("keys", std::to_string(request->entries_size()));
+    CacheServer::ApplyMultiSet(*request, router_, response);
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+CoreRouter::ShardSlot* CoreRouter::SlotFor(Core& core, const std::string& group) {
+    auto it = core.shards.find(group);
+    if (it == core.shards.end()) {
+        auto* g = GroupRegistry::Instance().Find(group);
+        if (!g) {
+            return nullptr;
+        }
+        ShardSlot slot;
+        slot.group = g;
+        slot.shard = std::make_unique<Shard>(shardCapacity_);
+        slot.generation = g->Generation();
+        it = core.shards.emplace(group, std::move(slot)).first;
+    }
+    ShardSlot& slot = it->second;
+    uint64_t generation = slot.group->Generation();
+    if (slot.generation != generation) {
+        core.entries.fetch_sub(slot.shard->size(), std::memory_order_relaxed);
+        std::shared_ptr<Shard> stale = std::move(slot.shard);
+        TaskScheduler::Instance().Submit([stale] {}, TaskPriority::BACKGROUND);
+        slot.shard = std::make_unique<Shard>(shardCapacity_);
+        slot.generation = generation;
+    }
+    return &slot;
+}
+
+void CoreRouter::CountAccess(ShardSlot& slot, const std::string& key, bool hit) {
+    ++(hit ? slot.hits : slot.misses);
+    if (slot.group->SamplesKey(key)) {
+        slot.sampled.push_back(key);
+    }
+    if (slot.hits + slot.misses >= kAccessBatch || slot.sampled.size() >= kSampledBatch) {
+        ReportAccesses(slot);
+    }
+}
+
+void CoreRouter::ReportAccesses(ShardSlot& slot) {
+    if (slot.hits + slot.misses == 0) {
+        return;
+    }
+    slot.group->RecordAccesses(slot.sampled, slot.hits, slot.misses);
+    slot.sampled.clear();
+    slot.hits = 0;
+    slot.misses = 0;
+}
+
+void CoreRouter::Execute(Core& core, Call* call) {
+    const auto& request = call->request;
+    const std::string& key = call->Key();
+    Span span("core.execute", Tracer::Instance().Continue(ExtractTraceContext(call->ctx)));
+    span.SetAttribute("group", call->Group());
+    span.SetAttribute("key", key);
+    ShardSlot* slot = SlotFor(core, call->Group());
+    if (!slot) {
+        call->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+        return;
+    }
+    CacheGroupBase* group = slot->group;
+    uint64_t generation = slot->generation;
+    Shard& shard = *slot->shard;
+    if ((call->method == Call::Method::INCR || call->method == Call::Method::CAS) &&
+        !IsOwnerLoad(call->ctx) && !group->OwnsKey(key)) {
+        // Another node owns the key: forward it with an async call that
+        // finishes this one, and drop this core's copy so reads go to the owner.
+        Erase(core, *slot, key);
+        BeginOffCore();
+        auto finish = [this, call](const grpc::Status& status) {
+            call->Finish(status);
+            EndOffCore();
+        };
+        if (call->method == Call::Method::INCR) {
+            group->ServeIncr(call->incrRequest, false, &call->incrResponse, finish);
+        } else {
+            group->ServeCompareAndSet(call->casRequest, false, &call->casResponse, finish);
+        }
+        return;
+    }
+    switch (call->method) {
+        case Call::Method::GET: {
+            bool hit = shard.get(request.key(), call->getResponse);
+            CountAccess(*slot, request.key(), hit);
+            if (hit) {
+                call->Finish(grpc::Status::OK);
+                return;
+            }
+            if (request.lease()) {
+                // Leases are kept per group, so a token from any core can be
+                // redeemed on any other.
+                group->ServeLease(request.key(), &call->getResponse);
+                call->Finish(grpc::Status::OK);
+                return;
+            }
+            // Miss: go through peers and the loader asynchronously, then
+            // hand the value back to this core so only it ever writes its
+            // shard. An owner error (e.g. DEADLINE_EXCEEDED) is passed on.
+            Core* owner = &core;
+            BeginOffCore();
+            group->LoadEncodedAsync(request.key(), IsOwnerLoad(call->ctx), &call->getResponse,
+                                    [this, call, owner, generation](const grpc::Status& status) {
+                if (status.ok()) {
+                    Fill fill{call->request.group(), call->request.key(), call->getResponse, generation};
+                    fill.value.clear_ttl_ms(); // Shards do not expire; the deadline is the caller's.
+                    std::lock_guard<std::mutex> lock(owner->fillMtx);
+                    owner->fills.push_back(std::move(fill));
+                    owner->hasFills.store(true, std::memory_order_release);
+                }
+                call->Finish(status);
+                EndOffCore();
+            });
+            return;
+        }
+        case Call::Method::SET: {
+            grpc::Status status = ReplicateSet(group, request);
+            if (!status.ok()) {
+                call->Finish(status);
+                return;
+            }
+            Store(core, *slot, request.key(), ShardValue(request));
+            call->setResponse.set_value(true);
+            call->Finish(grpc::Status::OK);
+            return;
+        }
+        case Call::Method::DELETE:
+            Erase(core, *slot, request.key());
+            group->InvalidateLease(request.key());
+            group->Replicate(request, Sync::DELETE);
+            call->deleteResponse.set_value(true);
+            call->Finish(grpc::Status::OK);
+            return;
+        case Call::Method::INCR:
+        case Call::Method::CAS: {
+            cache::GetResponse current;
+            if (shard.get(key, current)) {
+                ApplyUpdate(core, *slot, call, &current);
+                return;
+            }
+            LoadCurrent(core, group, call);
+            return;
+        }
+        case Call::Method::STATS:
+        case Call::Method::INVALIDATE:
+            // Answered by Route() on the receiving core.
+            return;
+    }
+}
+
+void CoreRouter::LoadCurrent(Core& core, CacheGroupBase* group, Call* call) {
+    // Shards are bounded and give entries up to the governor, so a miss
+    // does not make the key new: its pending write-behind value or the
+    // loader's is the one to update, and `initial` only applies without.
+    Core* owner = &core;
+    auto loaded = std::make_shared<cache::GetResponse>();
+    BeginOffCore();
+    group->LoadEncodedAsync(call->Key(), true, loaded.get(), [this, call, owner, loaded](const grpc::Status& status) {
+        if (!status.ok() && status.error_code() != grpc::StatusCode::NOT_FOUND) {
+            call->Finish(status);
+            EndOffCore();
+            return;
+        }
+        loaded->clear_ttl_ms();
+        Post(*owner, [this, call, owner, loaded, found = status.ok()] {
+            ShardSlot* slot = SlotFor(*owner, call->Group());
+            if (!slot) {
+                call->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Cache group not found"));
+            } else {
+                // A write of the key that reached the shard meanwhile is newer than the load.
+                cache::GetResponse current;
+                if (slot->shard->get(call->Key(), current)) {
+                    ApplyUpdate(*owner, *slot, call, &current);
+                } else {
+                    ApplyUpdate(*owner, *slot, call, found ? loaded.get() : nullptr);
+                }
+            }
+            EndOffCore();
+        });
+    });
+}
+
+void CoreRouter::ApplyUpdate(Core& core, ShardSlot& slot, Call* call, cache::GetResponse* current) {
+    CacheGroupBase* group = slot.group;
+    const std::string& key = call->Key();
+    if (call->method == Call::Method::INCR) {
+        // This core is the only writer of its shard, so the
+        // read-modify-write needs no lock. Shards do not expire entries,
+        // so `ttl_ms` is not applied here.
+        cache::GetResponse updated;
+        int64_t counter = 0;
+        grpc::Status status = group->IncrEncoded(current, call->incrRequest, &updated, &counter);
+        if (status.ok()) {
+            group->InvalidateLease(key);
+            group->Replicate(WriteOf(call->Group(), key, updated), Sync::SET);
+            Store(core, slot, key, updated);
+            call->incrResponse.set_value(counter);
+        }
+        call->Finish(status);
+        return;
+    }
+    const auto& cas = call->casRequest;
+    cache::GetResponse missing;
+    if (!current) {
+        current = &missing;
+    }
+    if (!SamePayload(*current, cas.expected())) {
+        call->casResponse.mutable_current()->Swap(current);
+        call->Finish(grpc::Status::OK);
+        return;
+    }
+    if (!group->Replicate(cas.request(), Sync::SET)) {
+        call->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Value does not match the group's type"));
+        return;
+    }
+    group->InvalidateLease(key);
+    Store(core, slot, key, ShardValue(cas.request()));
+    call->casResponse.set_swapped(true);
+    call->Finish(grpc::Status::OK);
+}
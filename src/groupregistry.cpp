@@ -0,0 +1,47 @@
+#include "include/groupregistry.h"
+
+#include <mutex>
+
+#include "include/memorygovernor.h"
+#include "include/taskscheduler.h"
+
+GroupRegistry& GroupRegistry::Instance() {
+    static GroupRegistry registry;
+    return registry;
+}
+
+GroupRegistry::GroupRegistry() {
+    // Statics are destroyed in reverse order of construction. Groups
+    // unregister from the governor and drain their queues onto the
+    // scheduler when the registry is destroyed at exit, so both are
+    // constructed first to outlive them; the scheduler comes after the
+    // governor, so reclaim passes it still runs find the governor alive.
+    MemoryGovernor::Instance();
+    TaskScheduler::Instance();
+}
+
+CacheGroupBase* GroupRegistry::Find(const std::string& name) {
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    auto it = groups_.find(name);
+    return it != groups_.end() ? it->second.get() : nullptr;
+}
+
+CacheGroupBase* GroupRegistry::Add(const std::string& name,
+                                   const std::function<std::unique_ptr<CacheGroupBase>()>& factory) {
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    auto it = groups_.find(name);
+    if (it == groups_.end()) {
+        it = groups_.emplace(name, factory()).first;
+    }
+    return it->second.get();
+}
+
+std::vector<std::string> GroupRegistry::Names() {
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    std::vector<std::string> names;
+    names.reserve(groups_.size());
+    for (const auto& [name, group] : groups_) {
+        names.push_back(name);
+    }
+    return names;
+}
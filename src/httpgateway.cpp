@@ -1,11 +1,23 @@
 #include "include/httpgateway.h"
+#include "include/localtransport.h"
 #include "cache.grpc.pb.h"
 #include <nlohmann/json.hpp>
 #include <etcd/Client.hpp>
 #include <grpcpp/grpcpp.h>
 
-HttpGateway::HttpGateway(int port, const std::string &etcd_endpoints, const std::string &service_name)
-    : port_(port), etcd_endpoints_(etcd_endpoints), service_name_(service_name) {
+namespace {
+/**
+ * @brief The `traceparent` to forward over shared memory, empty unless the span records.
+ */
+std::string TraceparentOf(const Span &span) {
+    return span.Recording() ? FormatTraceparent(span.Context()) : "";
+}
+} // namespace
+
+HttpGateway::HttpGateway(int port, const std::string &etcd_endpoints, const std::string &service_name,
+                         bool local_transport, bool shm)
+    : port_(port), etcd_endpoints_(etcd_endpoints), service_name_(service_name),
+      local_transport_(local_transport), shm_(shm) {
         etcd_client_ = std::make_shared<etcd::Client>(etcd_endpoints_);
         SetupRoute();
         StartDiscovery();
@@ -26,7 +38,7 @@ void HttpGateway::StartService() {
 void HttpGateway::SetupRoute() {
     http_server_.Get(R"(/([^/]+)/([^/]+))",
         [this](const httplib::Request& req, httplib::Response& res) { 
-        HandleGet(req, res); });
+        Get(req, res); });
 
     http_server_.Post(R"(/([^/]+)/([^/]+))",
         [this](const httplib::Request &req, httplib::Response &res) { 
@@ -36,55 +48,99 @@ void HttpGateway::SetupRoute() {
         [this](const httplib::Request &req, httplib::Response &res) { 
         Del(req, res); 
     });
+
+    http_server_.Post(R"(/([^/]+)/([^/]+)/incr)",
+        [this](const httplib::Request &req, httplib::Response &res) {
+        Incr(req, res);
+    });
+
+    http_server_.Delete(R"(/([^/]+))",
+        [this](const httplib::Request &req, httplib::Response &res) {
+        Invalidate(req, res);
+    });
 }
 
-auto HttpGateway::GetCacheClient(std::string &key){
+std::unique_ptr<cache::Cache::Stub> HttpGateway::GetCacheClient(const std::string &key){
     std::lock_guard<std::mutex> lock(mtx_);
     std::string target = consistent_hash_.Get(key);
     if (target.empty()){
         spdlog::error("No available cache nodes");
-        return "";
+        return nullptr;
+    }
+    auto it = targets_.find(target);
+    if (it != targets_.end()) {
+        target = it->second;
     }
     auto channel = grpc::CreateChannel(target, grpc::InsecureChannelCredentials());
-    return channel;
+    return cache::Cache::NewStub(channel);
+}
+
+std::shared_ptr<ShmClient> HttpGateway::GetShmClient(const std::string &key) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (shm_clients_.empty()) {
+        return nullptr;
+    }
+    auto it = shm_clients_.find(consistent_hash_.Get(key));
+    if (it == shm_clients_.end() || it->second->Closed()) {
+        return nullptr;
+    }
+    return it->second;
 }
 
 void HttpGateway::Get(const httplib::Request &req, httplib::Response &res) {
     std::string group = req.matches[1];
     std::string key = req.matches[2];
-
-    auto client = GetCacheClient(key);
-    if(!client) {
-        spdlog::error("Failed to get cache node for key: {}", key);
-        res.status = 500;
-        return;
+    Span span("gateway.get", Tracer::Instance().Continue(ParseTraceparent(req.get_header_value("traceparent"))));
+    span.SetAttribute("group", group);
+    span.SetAttribute("key", key);
+    if (span.Recording()) {
+        res.set_header("traceparent", FormatTraceparent(span.Context()));
     }
+
     cache::Request request;
     request.set_group(group);
     request.set_key(key);
 
     cache::GetResponse response;
-    grpc::ClientContext context;
-    grpc::Status status = client->Get(&context, request, &response);
+    grpc::Status status;
+    auto shm = GetShmClient(key);
+    if (!shm || !shm->Call(ShmMethod::GET, request, &response, &status, TraceparentOf(span))) {
+        auto client = GetCacheClient(key);
+        if (!client) {
+            spdlog::error("Failed to get cache node for key: {}", key);
+            span.SetError("no cache node");
+            res.status = 500;
+            return;
+        }
+        grpc::ClientContext context;
+        InjectTraceContext(context);
+        status = client->Get(&context, request, &response);
+    }
 
     if (!status.ok()) {
         spdlog::error("gRPC call failed: {}", status.error_message());
+        span.SetError(status.error_message());
         res.status = 404;
         return;
     }
-    nlohmann::json json_resp = {{"key", key}, {"value", response.value()}, {"group", group}};
+    if (response.payload_case() != cache::GetResponse::kData) {
+        // Any-typed group: no text form to put in JSON.
+        span.SetError("value is not bytes");
+        res.status = 415;
+        return;
+    }
+    nlohmann::json json_resp = {{"key", key}, {"value", response.data()}, {"group", group}};
     res.set_content(json_resp.dump(), "application/json");
 }
 
 void HttpGateway::Set(const httplib::Request &req, httplib::Response &res) {
     std::string group = req.matches[1];
     std::string key = req.matches[2];
-
-    auto client = GetCacheClient(key);
-    if (!client) {
-        spdlog::error("Failed to get cache node for key: {}", key);
-        res.status = 500;
-        return;
+    Span span("gateway.set", Tracer::Instance().Continue(ParseTraceparent(req.get_header_value("traceparent"))));
+    span.SetAttribute("group", group);
+    span.SetAttribute("key", key);
+    if (span.Recording()) {
+        res.set_header("traceparent", FormatTraceparent(span.Context()));
     }
 
     nlohmann::json body;
@@ -101,15 +157,27 @@ void HttpGateway::Set(const httplib::Request &req, httplib::Response &res) {
     cache::Request request;
     request.set_group(group);
     request.set_key(key);
-    request.set_value(value);
+    request.set_data(value);
 
     cache::SetResponse response;
-    grpc::ClientContext context;
-
-    grpc::Status status = client->Set(&context, request, &response);
+    grpc::Status status;
+    auto shm = GetShmClient(key);
+    if (!shm || !shm->Call(ShmMethod::SET, request, &response, &status, TraceparentOf(span))) {
+        auto client = GetCacheClient(key);
+        if (!client) {
+            spdlog::error("Failed to get cache node for key: {}", key);
+            span.SetError("no cache node");
+            res.status = 500;
+            return;
+        }
+        grpc::ClientContext context;
+        InjectTraceContext(context);
+        status = client->Set(&context, request, &response);
+    }
 
     if (!status.ok()) {
         spdlog::error("gRPC call failed: {}", status.error_message());
+        span.SetError(status.error_message());
         res.status = 404;
         return;
     }
@@ -120,28 +188,129 @@ void HttpGateway::Set(const httplib::Request &req, httplib::Response &res) {
 void HttpGateway::Del(const httplib::Request &req, httplib::Response &res) {
     std::string group = req.matches[1];
     std::string key = req.matches[2];
+    Span span("gateway.delete", Tracer::Instance().Continue(ParseTraceparent(req.get_header_value("traceparent"))));
+    span.SetAttribute("group", group);
+    span.SetAttribute("key", key);
+    if (span.Recording()) {
+        res.set_header("traceparent", FormatTraceparent(span.Context()));
+    }
+
+    cache::Request request;
+    request.set_group(group);
+    request.set_key(key);
+
+    cache::DeleteResponse response;
+    grpc::Status status;
+    auto shm = GetShmClient(key);
+    if (!shm || !shm->Call(ShmMethod::DELETE, request, &response, &status, TraceparentOf(span))) {
+        auto client = GetCacheClient(key);
+        if (!client) {
+            spdlog::error("Failed to get cache node for key: {}", key);
+            span.SetError("no cache node");
+            res.status = 500;
+            return;
+        }
+        grpc::ClientContext context;
+        InjectTraceContext(context);
+        status = client->Delete(&context, request, &response);
+    }
+
+    if (!status.ok()) {
+        spdlog::error("gRPC call failed: {}", status.error_message());
+        span.SetError(status.error_message());
+        res.status = 404;
+        return;
+    }
+    nlohmann::json json_resp = {{"key", key}, {"group", group}};
+    res.set_content(json_resp.dump(), "application/json");
+}
+
+void HttpGateway::Incr(const httplib::Request &req, httplib::Response &res) {
+    std::string group = req.matches[1];
+    std::string key = req.matches[2];
+    Span span("gateway.incr", Tracer::Instance().Continue(ParseTraceparent(req.get_header_value("traceparent"))));
+    span.SetAttribute("group", group);
+    span.SetAttribute("key", key);
+    if (span.Recording()) {
+        res.set_header("traceparent", FormatTraceparent(span.Context()));
+    }
 
     auto client = GetCacheClient(key);
     if (!client) {
         spdlog::error("Failed to get cache node for key: {}", key);
+        span.SetError("no cache node");
         res.status = 500;
         return;
     }
 
-    cache::Request request;
+    nlohmann::json body = nlohmann::json::object();
+    try {
+        if (!req.body.empty()) {
+            body = nlohmann::json::parse(req.body);
+        }
+    } catch (const std::exception &e) {
+        spdlog::error("Failed to parse JSON body: {}", e.what());
+        res.status = 400;
+        return;
+    }
+
+    cache::IncrRequest request;
     request.set_group(group);
     request.set_key(key);
+    request.set_delta(body.value("delta", int64_t{1}));
+    request.set_initial(body.value("initial", request.delta()));
+    request.set_ttl_ms(body.value("ttl_ms", uint64_t{0}));
+
+    cache::IncrResponse response;
+    grpc::ClientContext context;
+    InjectTraceContext(context);
+    grpc::Status status = client->Incr(&context, request, &response);
+
+    if (!status.ok()) {
+        spdlog::error("gRPC call failed: {}", status.error_message());
+        span.SetError(status.error_message());
+        res.status = status.error_code() == grpc::StatusCode::NOT_FOUND ? 404 : 409;
+        return;
+    }
+    nlohmann::json json_resp = {{"key", key}, {"value", response.value()}, {"group", group}};
+    res.set_content(json_resp.dump(), "application/json");
+}
+
+void HttpGateway::Invalidate(const httplib::Request &req, httplib::Response &res) {
+    std::string group = req.matches[1];
+    std::string prefix = req.get_param_value("prefix");
+    Span span("gateway.invalidate", Tracer::Instance().Continue(ParseTraceparent(req.get_header_value("traceparent"))));
+    span.SetAttribute("group", group);
+    span.SetAttribute("prefix", prefix);
+    if (span.Recording()) {
+        res.set_header("traceparent", FormatTraceparent(span.Context()));
+    }
+
+    // Any node will do: it applies the invalidation and sends it on to every peer.
+    auto client = GetCacheClient(prefix);
+    if (!client) {
+        spdlog::error("Failed to get cache node for prefix: {}", prefix);
+        span.SetError("no cache node");
+        res.status = 500;
+        return;
+    }
 
-    cache::DelResponse response;
+    cache::InvalidateRequest request;
+    request.set_group(group);
+    request.set_prefix(prefix);
+
+    cache::InvalidateResponse response;
     grpc::ClientContext context;
-    grpc::Status status = client->Del(&context, request, &response);
+    InjectTraceContext(context);
+    grpc::Status status = client->Invalidate(&context, request, &response);
 
     if (!status.ok()) {
         spdlog::error("gRPC call failed: {}", status.error_message());
+        span.SetError(status.error_message());
         res.status = 404;
         return;
     }
-    nlohmann::json json_resp = {{"key", key}, {"group", group}};
+    nlohmann::json json_resp = {{"group", group}, {"prefix", prefix}};
     res.set_content(json_resp.dump(), "application/json");
 }
 
@@ -152,17 +321,52 @@ void HttpGateway::StartDiscovery() {
             try {
                 auto respond = etcd_client_->ls(prefix).get();
                 if (respond.is_ok()) {
-                    std::lock_guard<std::mutex> lock(mtx_);
+                    std::vector<std::string> addrs;
                     for (const auto& key : respond.keys()) {
                         if (key.rfind(prefix,0) == 0){
-                            std::string addr = key.substr(prefix.length());
-                            consistent_hash_.Add(addr);
-                            spdlog::info("Added cache node: {}", addr);
+                            addrs.push_back(key.substr(prefix.length()));
                         }
                         else {
                             spdlog::warn("Key {} does not start with expected prefix {}", key, prefix);
                         }
                     }
+                    // Probe local endpoints outside the lock; a node may
+                    // start or stop offering them between rounds.
+                    std::unordered_map<std::string, std::string> targets;
+                    std::unordered_map<std::string, std::shared_ptr<ShmClient>> opened;
+                    for (const auto& addr : addrs) {
+                        if (local_transport_) {
+                            targets[addr] = LocalTarget(addr);
+                        }
+                        if (shm_ && IsLocalAddress(addr)) {
+                            std::shared_ptr<ShmClient> current;
+                            {
+                                std::lock_guard<std::mutex> lock(mtx_);
+                                auto it = shm_clients_.find(addr);
+                                if (it != shm_clients_.end() && !it->second->Closed()) {
+                                    current = it->second;
+                                }
+                            }
+                            opened[addr] = current ? current : std::shared_ptr<ShmClient>(ShmClient::Open(addr));
+                        }
+                    }
+                    std::lock_guard<std::mutex> lock(mtx_);
+                    for (const auto& addr : addrs) {
+                        consistent_hash_.Add(addr);
+                        spdlog::info("Added cache node: {}", addr);
+                        auto target = targets.find(addr);
+                        if (target != targets.end() && target->second != addr) {
+                            targets_[addr] = target->second;
+                        } else {
+                            targets_.erase(addr);
+                        }
+                        auto shm = opened.find(addr);
+                        if (shm != opened.end() && shm->second) {
+                            shm_clients_[addr] = shm->second;
+                        } else {
+                            shm_clients_.erase(addr);
+                        }
+                    }
                 }
             } catch (const std::exception& e) {
                 spdlog::error("Error occurred while fetching services: {}", e.what());
@@ -172,14 +376,16 @@ void HttpGateway::StartDiscovery() {
     });
 }
 
-int main(int argc, char* argv) {
+int main(int argc, char** argv) {
     gflags::ParseCommandLineFlags(&argc, &argv, true);
 
     spdlog::set_level(spdlog::level::debug);
     spdlog::set_pattern("[http-gateway][%^%l%$] %v");
+    ConfigureTracing(FLAGS_trace_sample_ratio, FLAGS_trace_file, FLAGS_trace_otlp_endpoint, "http-gateway");
 
     try {
-        HttpGateway gateway(FLAGS_http_port, FLAGS_etcd_endpoints, FLAGS_service_name);
+        HttpGateway gateway(FLAGS_http_port, FLAGS_etcd_endpoints, FLAGS_service_name,
+                            FLAGS_local_transport, FLAGS_shm);
         gateway.StartService();
     } catch (const std::exception &e) {
         spdlog::error("Failed to start HTTP Gateway: {}", e.what());
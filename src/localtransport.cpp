@@ -0,0 +1,94 @@
+#include "include/localtransport.h"
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstring>
+
+namespace {
+/**
+ * @brief The address with every character that is not safe in a file name replaced by '_'.
+ */
+std::string Sanitize(const std::string& addr) {
+    std::string name = addr;
+    for (char& c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '.') {
+            c = '_';
+        }
+    }
+    return name;
+}
+
+/**
+ * @brief Host part of `host:port` or `[v6]:port`; empty for a bare port.
+ */
+std::string HostOf(const std::string& addr) {
+    auto colon = addr.rfind(':');
+    if (colon == std::string::npos) {
+        return "";
+    }
+    std::string host = addr.substr(0, colon);
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    return host;
+}
+} // namespace
+
+std::string LocalSocketPath(const std::string& addr) {
+    return "/tmp/kcache-" + Sanitize(addr) + ".sock";
+}
+
+std::string ShmSegmentName(const std::string& addr) {
+    return "/kcache-" + Sanitize(addr);
+}
+
+bool IsLocalAddress(const std::string& addr) {
+    std::string host = HostOf(addr);
+    if (host.empty() || host == "localhost" || host == "0.0.0.0" || host == "::" || host == "::1" ||
+        host.rfind("127.", 0) == 0) {
+        return true;
+    }
+    char hostname[256] = {};
+    if (gethostname(hostname, sizeof(hostname) - 1) == 0 && host == hostname) {
+        return true;
+    }
+    struct ifaddrs* ifaddr = nullptr;
+    if (getifaddrs(&ifaddr) == -1) {
+        return false;
+    }
+    bool local = false;
+    for (auto* ifa = ifaddr; ifa && !local; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr) {
+            continue;
+        }
+        char ip[INET6_ADDRSTRLEN] = {};
+        if (ifa->ifa_addr->sa_family == AF_INET) {
+            inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(ifa->ifa_addr)->sin_addr, ip, sizeof(ip));
+        } else if (ifa->ifa_addr->sa_family == AF_INET6) {
+            inet_ntop(AF_INET6, &reinterpret_cast<sockaddr_in6*>(ifa->ifa_addr)->sin6_addr, ip, sizeof(ip));
+        } else {
+            continue;
+        }
+        local = host == ip;
+    }
+    freeifaddrs(ifaddr);
+    return local;
+}
+
+std::string LocalTarget(const std::string& addr) {
+    if (!IsLocalAddress(addr)) {
+        return addr;
+    }
+    std::string path = LocalSocketPath(addr);
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) {
+        return addr;
+    }
+    return "unix:" + path;
+}
@@ -0,0 +1,192 @@
+#include "include/memorygovernor.h"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "include/taskscheduler.h"
+
+MemoryGovernor& MemoryGovernor::Instance() {
+    static MemoryGovernor governor;
+    return governor;
+}
+
+void MemoryGovernor::Configure(size_t limitBytes, double highWatermark, double lowWatermark) {
+    highWatermark = std::min(1.0, std::max(0.0, highWatermark));
+    lowWatermark = std::min(highWatermark, std::max(0.0, lowWatermark));
+    highWatermark_.store(highWatermark, std::memory_order_relaxed);
+    lowWatermark_.store(lowWatermark, std::memory_order_relaxed);
+    limit_.store(limitBytes, std::memory_order_relaxed);
+    if (limitBytes > 0) {
+        spdlog::info("Memory governor: limit {} bytes, reclaim from {:.0f}% down to {:.0f}%", limitBytes,
+                     highWatermark * 100, lowWatermark * 100);
+    }
+}
+
+void MemoryGovernor::Register(MemoryTenant* tenant) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (std::find(tenants_.begin(), tenants_.end(), tenant) == tenants_.end()) {
+        tenants_.push_back(tenant);
+    }
+}
+
+void MemoryGovernor::Unregister(MemoryTenant* tenant) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    tenants_.erase(std::remove(tenants_.begin(), tenants_.end(), tenant), tenants_.end());
+}
+
+void MemoryGovernor::OnGrowth(MemoryTenant* tenant) {
+    size_t limit = limit_.load(std::memory_order_relaxed);
+    if (limit == 0 || growth_.fetch_add(1, std::memory_order_relaxed) % kCheckInterval != 0) {
+        return;
+    }
+    // A reclaim pass holds the lock while it runs; skip this check rather than wait.
+    std::unique_lock<std::mutex> lock(mtx_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    size_t total = 0;
+    size_t own = 0;
+    size_t index = tenants_.size();
+    for (size_t i = 0; i < tenants_.size(); ++i) {
+        size_t bytes = tenants_[i]->MemoryUsage();
+        total += bytes;
+        if (tenants_[i] == tenant) {
+            own = bytes;
+            index = i;
+        }
+    }
+    double high = highWatermark_.load(std::memory_order_relaxed);
+    if (total >= high * limit && !reclaiming_.exchange(true)) {
+        TaskScheduler::Instance().Submit([this] { ReclaimPass(); }, TaskPriority::BACKGROUND);
+    }
+    if (total <= limit || index == tenants_.size()) {
+        return;
+    }
+    size_t share = SharesLocked(limit)[index];
+    lock.unlock();
+    if (own > share) {
+        size_t freed = tenant->Reclaim(std::min(total - limit, own - share));
+        reclaimed_.fetch_add(freed, std::memory_order_relaxed);
+    }
+}
+
+size_t MemoryGovernor::FairShare(const MemoryTenant* tenant) {
+    size_t limit = limit_.load(std::memory_order_relaxed);
+    if (limit == 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto shares = SharesLocked(limit);
+    for (size_t i = 0; i < tenants_.size(); ++i) {
+        if (tenants_[i] == tenant) {
+            return shares[i];
+        }
+    }
+    return 0;
+}
+
+std::vector<TenantUsage> MemoryGovernor::Snapshot() {
+    size_t limit = limit_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto shares = SharesLocked(limit);
+    std::vector<TenantUsage> usage;
+    usage.reserve(tenants_.size());
+    for (size_t i = 0; i < tenants_.size(); ++i) {
+        usage.push_back(TenantUsage{tenants_[i]->TenantName(), tenants_[i]->MemoryUsage(), shares[i]});
+    }
+    return usage;
+}
+
+std::vector<size_t> MemoryGovernor::SharesLocked(size_t limit) const {
+    size_t reserved = 0;
+    size_t unquoted = 0;
+    for (const auto* tenant : tenants_) {
+        size_t soft = tenant->SoftQuota();
+        reserved += soft;
+        if (soft == 0) {
+            ++unquoted;
+        }
+    }
+    size_t rest = limit > reserved ? limit - reserved : 0;
+    std::vector<size_t> shares;
+    shares.reserve(tenants_.size());
+    for (const auto* tenant : tenants_) {
+        size_t soft = tenant->SoftQuota();
+        shares.push_back(soft > 0 ? soft : rest / std::max<size_t>(1, unquoted));
+    }
+    return shares;
+}
+
+void MemoryGovernor::ReclaimPass() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    size_t limit = limit_.load(std::memory_order_relaxed);
+    size_t target = static_cast<size_t>(lowWatermark_.load(std::memory_order_relaxed) * limit);
+    std::vector<size_t> usage;
+    size_t total = 0;
+    for (auto* tenant : tenants_) {
+        usage.push_back(tenant->MemoryUsage());
+        total += usage.back();
+    }
+    if (limit == 0 || total <= target) {
+        reclaiming_.store(false);
+        return;
+    }
+
+    size_t need = total - target;
+    // Shares of the target rather than of the limit, so their overage covers `need`.
+    auto shares = SharesLocked(target);
+    size_t freed = 0;
+    // From tenants above their share, in proportion to their overage. A
+    // tenant that frees less than asked (e.g. dirty or pinned entries) drops
+    // out, and the shortfall is split again among the others still above
+    // their share, never passed on to a tenant within it.
+    std::vector<bool> exhausted(tenants_.size(), false);
+    for (bool shortfall = true; shortfall && freed < need;) {
+        shortfall = false;
+        size_t over = 0;
+        for (size_t i = 0; i < tenants_.size(); ++i) {
+            over += !exhausted[i] && usage[i] > shares[i] ? usage[i] - shares[i] : 0;
+        }
+        if (over == 0) {
+            break;
+        }
+        size_t fromOver = std::min(need - freed, over);
+        for (size_t i = 0; i < tenants_.size(); ++i) {
+            if (exhausted[i] || usage[i] <= shares[i]) {
+                continue;
+            }
+            size_t excess = usage[i] - shares[i];
+            size_t bytes = std::min(static_cast<size_t>(static_cast<double>(fromOver) * excess / over), excess);
+            size_t got = tenants_[i]->Reclaim(bytes);
+            usage[i] -= std::min(usage[i], got);
+            freed += got;
+            if (got < bytes) {
+                exhausted[i] = true;
+                shortfall = true;
+            }
+        }
+    }
+    // Shares overcommitted by soft quotas: their sum exceeds the target, so
+    // even tenants within their share hold too much. Take what the shares
+    // overcommit from everyone, by size.
+    size_t committed = 0;
+    for (size_t share : shares) {
+        committed += share;
+    }
+    if (freed < need && committed > target) {
+        size_t remaining = std::min(need - freed, committed - target);
+        size_t left = 0;
+        for (size_t bytes : usage) {
+            left += bytes;
+        }
+        for (size_t i = 0; i < tenants_.size() && left > 0; ++i) {
+            size_t bytes = static_cast<size_t>(static_cast<double>(remaining) * usage[i] / left);
+            freed += tenants_[i]->Reclaim(bytes);
+        }
+    }
+    reclaimed_.fetch_add(freed, std::memory_order_relaxed);
+    spdlog::info("Memory governor reclaimed {} of {} bytes ({} tenants, limit {})", freed, total, tenants_.size(),
+                 limit);
+    reclaiming_.store(false);
+}
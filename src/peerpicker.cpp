@@ -1,5 +1,4 @@
 #include "include/peerpicker.h"
-#include "include/ConsistentHash.h"
 
 #include <cassert>
 #include <cstdio>
@@ -7,6 +6,7 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <fmt/core.h>
 #include <spdlog/spdlog.h>
@@ -16,7 +16,7 @@
 #include <etcd/Watcher.hpp>
 
 PeerPicker::PeerPicker(const std::string& service_name, const std::string& etcd_key, const std::string& etcd_endpoints)
-    : service_name_(service_name), etcd_key(etcd_key), hash_ring(50,10,200,0.25) {
+    : service_name_(service_name), etcd_key(etcd_key) {
     etcd_client = std::make_shared<etcd::Client>(etcd_endpoints);
     if(!StartDiscovery()) {
         spdlog::error("Failed to start discovery for PeerPicker with etcd endpoints: {}", etcd_endpoints);
@@ -31,7 +31,7 @@ PeerPicker::~PeerPicker() {
     }
 }
 
-Peer* PeerPicker::PickPeer(const std::string& key) {
+peer* PeerPicker::PickPeer(const std::string& key) {
     std::shared_lock lock(mtx);
     auto peer_name = hash_ring.Get(key);
     if(!peer_name.empty() && peer_name != etcd_key) {
@@ -41,6 +41,18 @@ Peer* PeerPicker::PickPeer(const std::string& key) {
     return nullptr;
 }
 
+std::vector<std::shared_ptr<peer>> PeerPicker::AllPeers() {
+    std::shared_lock lock(mtx);
+    std::vector<std::shared_ptr<peer>> all;
+    all.reserve(peers.size());
+    for (const auto& [name, p] : peers) {
+        if (name != etcd_key) {
+            all.push_back(p);
+        }
+    }
+    return all;
+}
+
 bool PeerPicker::StartDiscovery() {
     if(!FetchAllServices()) {
         spdlog::error("Failed to fetch all services for PeerPicker");
@@ -104,13 +116,13 @@ bool PeerPicker::FetchAllServices() {
 void PeerPicker::Set(const std::string& addr) {
     std::unique_lock lock(mtx);
     peers[addr] = std::make_shared<peer>(addr);
-    hash_ring.AddNode(addr);
+    hash_ring.Add(addr);
 }
 
 void PeerPicker::Remove(const std::string& addr) {
     std::unique_lock lock(mtx);
     peers.erase(addr);
-    hash_ring.RemoveNode(addr);
+    hash_ring.Remove(addr);
 }
 
 std::string PeerPicker::ParseAddrFromKey(const std::string& key) {
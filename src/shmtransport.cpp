@@ -0,0 +1,442 @@
+#include "include/shmtransport.h"
+#include "include/groupregistry.h"
+#include "include/localtransport.h"
+#include "include/tracing.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+#include "cache.pb.h"
+
+namespace {
+constexpr size_t kRequestHeader = 10;   ///< Request id (8), method (1), traceparent length (1).
+constexpr size_t kResponseHeader = 9;   ///< Request id (8), status code (1).
+constexpr int kServerSpinPasses = 64;   ///< Idle polling passes before the server parks.
+constexpr int kClientSpins = 2000;      ///< Empty polls before a client parks.
+constexpr auto kParkTimeout = std::chrono::milliseconds(10); ///< Longest park between checks.
+
+/**
+ * @brief Sleep while `*word == expected`, at most `timeout`. The futex is process-shared.
+ */
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::nanoseconds timeout) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+/**
+ * @brief Wake every process sleeping on `*word`.
+ */
+void FutexWake(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/**
+ * @brief Tell the server there is work.
+ */
+void RingDoorbell(ShmSegment& segment) {
+    segment.doorbell.fetch_add(1);
+    if (segment.sleeping.load()) {
+        FutexWake(&segment.doorbell);
+    }
+}
+
+void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+} // namespace
+
+ShmServer::ShmServer(const std::string& addr, size_t slots)
+    : name_(ShmSegmentName(addr)), bytes_(ShmSegment::Bytes(slots)), busy_(new std::atomic<bool>[slots]) {
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error(fmt::format("shm_open {} failed: {}", name_, std::strerror(errno)));
+    }
+    if (ftruncate(fd, static_cast<off_t>(bytes_)) != 0) {
+        int error = errno;
+        close(fd);
+        shm_unlink(name_.c_str());
+        throw std::runtime_error(fmt::format("ftruncate {} failed: {}", name_, std::strerror(error)));
+    }
+    void* memory = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        throw std::runtime_error(fmt::format("mmap {} failed: {}", name_, std::strerror(error)));
+    }
+    segment_ = new (memory) ShmSegment();
+    segment_->slots = static_cast<uint32_t>(slots);
+    for (size_t i = 0; i < slots; ++i) {
+        ShmSlot* slot = new (&segment_->Slot(i)) ShmSlot();
+        slot->requests.Init();
+        slot->responses.Init();
+        busy_[i].store(false, std::memory_order_relaxed);
+    }
+    // Clients only use a segment whose magic is set.
+    segment_->magic.store(ShmSegment::kMagic, std::memory_order_release);
+    spdlog::info("Shared-memory transport {} offers {} slots ({} bytes)", name_, slots, bytes_);
+}
+
+ShmServer::~ShmServer() {
+    Stop();
+    // Loads still running on the scheduler answer into the mapping.
+    for (size_t i = 0; i < segment_->slots; ++i) {
+        while (busy_[i].load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    munmap(segment_, bytes_);
+}
+
+void ShmServer::Start() {
+    running_ = true;
+    thread_ = std::thread([this] { Loop(); });
+}
+
+void ShmServer::Stop() {
+    bool wasRunning = running_.exchange(false);
+    if (wasRunning) {
+        RingDoorbell(*segment_);
+        thread_.join();
+    }
+    if (segment_->magic.exchange(0) == 0) {
+        return;
+    }
+    // Wake parked clients so they see the segment closed.
+    for (size_t i = 0; i < segment_->slots; ++i) {
+        segment_->Slot(i).responseSeq.fetch_add(1);
+        FutexWake(&segment_->Slot(i).responseSeq);
+    }
+    shm_unlink(name_.c_str());
+    spdlog::info("Shared-memory transport {} closed", name_);
+}
+
+void ShmServer::Loop() {
+    auto lastReclaim = std::chrono::steady_clock::now();
+    int idlePasses = 0;
+    while (running_.load(std::memory_order_acquire)) {
+        // Read the doorbell before polling: a request pushed after the poll
+        // changes it, and the park below returns at once.
+        uint32_t bell = segment_->doorbell.load();
+        bool worked = false;
+        for (size_t i = 0; i < segment_->slots; ++i) {
+            worked = Serve(i) || worked;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReclaim > std::chrono::seconds(1)) {
+            ReclaimDead();
+            lastReclaim = now;
+        }
+        if (worked) {
+            idlePasses = 0;
+            continue;
+        }
+        if (++idlePasses < kServerSpinPasses) {
+            CpuRelax();
+            continue;
+        }
+        segment_->sleeping.store(1);
+        FutexWait(&segment_->doorbell, bell, kParkTimeout);
+        segment_->sleeping.store(0);
+    }
+}
+
+bool ShmServer::Serve(size_t i) {
+    ShmSlot& slot = segment_->Slot(i);
+    if (slot.owner.load(std::memory_order_acquire) == 0 || busy_[i].load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::string message;
+    if (!slot.requests.Pop(message)) {
+        return false;
+    }
+    if (message.size() < kRequestHeader || message.size() < kRequestHeader + static_cast<uint8_t>(message[9])) {
+        spdlog::warn("Dropping malformed shared-memory request in slot {}", i);
+        return true;
+    }
+    uint64_t id = 0;
+    std::memcpy(&id, message.data(), sizeof(id));
+    auto method = static_cast<ShmMethod>(message[8]);
+    size_t traceLength = static_cast<uint8_t>(message[9]);
+    std::string traceparent = message.substr(kRequestHeader, traceLength);
+    size_t offset = kRequestHeader + traceLength;
+    cache::Request request;
+    if (!request.ParseFromArray(message.data() + offset, static_cast<int>(message.size() - offset))) {
+        Respond(i, id, grpc::StatusCode::INVALID_ARGUMENT, {"Malformed request"});
+        return true;
+    }
+
+    Span span("server.shm", Tracer::Instance().Continue(ParseTraceparent(traceparent)));
+    span.SetAttribute("group", request.group());
+    span.SetAttribute("key", request.key());
+    auto* group = GroupRegistry::Instance().Find(request.group());
+    if (!group) {
+        span.SetError("group not found");
+        Respond(i, id, grpc::StatusCode::NOT_FOUND, {"Cache group not found"});
+        return true;
+    }
+    switch (method) {
+        case ShmMethod::GET: {
+            grpc::ByteBuffer hit;
+            if (group->ServeLocal(request.key(), &hit)) {
+                // Copy the response slices straight into the ring.
+                std::vector<grpc::Slice> slices;
+                hit.Dump(&slices);
+                std::vector<std::string_view> parts;
+                for (const auto& slice : slices) {
+                    parts.emplace_back(reinterpret_cast<const char*>(slice.begin()), slice.size());
+                }
+                Respond(i, id, grpc::StatusCode::OK, parts);
+                return true;
+            }
+            if (request.lease()) {
+                cache::GetResponse leased;
+                group->ServeLease(request.key(), &leased);
+                Respond(i, id, grpc::StatusCode::OK, {leased.SerializeAsString()});
+                return true;
+            }
+            // Miss: load through peers and the loader without blocking this
+            // thread; the slot waits until the load answers it. An owner
+            // error (e.g. DEADLINE_EXCEEDED) is passed on, as over gRPC.
+            busy_[i].store(true, std::memory_order_relaxed);
+            Span load("server.load", span.Context());
+            auto loaded = std::make_shared<cache::GetResponse>();
+            group->LoadEncodedAsync(request.key(), false, loaded.get(),
+                                    [this, i, id, loaded](const grpc::Status& status) {
+                if (status.ok()) {
+                    Respond(i, id, grpc::StatusCode::OK, {loaded->SerializeAsString()});
+                } else {
+                    Respond(i, id, status.error_code(), {status.error_message()});
+                }
+                busy_[i].store(false, std::memory_order_release);
+                RingDoorbell(*segment_);
+            });
+            return true;
+        }
+        case ShmMethod::SET: {
+            grpc::Status status = group->ServeSet(request);
+            if (!status.ok()) {
+                span.SetError(status.error_message());
+                Respond(i, id, status.error_code(), {status.error_message()});
+                return true;
+            }
+            cache::SetResponse response;
+            response.set_value(true);
+            Respond(i, id, grpc::StatusCode::OK, {response.SerializeAsString()});
+            return true;
+        }
+        case ShmMethod::DELETE: {
+            group->ServeDelete(request.key());
+            cache::DeleteResponse response;
+            response.set_value(true);
+            Respond(i, id, grpc::StatusCode::OK, {response.SerializeAsString()});
+            return true;
+        }
+    }
+    Respond(i, id, grpc::StatusCode::UNIMPLEMENTED, {"Unknown method"});
+    return true;
+}
+
+void ShmServer::Respond(size_t i, uint64_t id, grpc::StatusCode code, const std::vector<std::string_view>& payload) {
+    ShmSlot& slot = segment_->Slot(i);
+    char header[kResponseHeader];
+    std::memcpy(header, &id, sizeof(id));
+    header[8] = static_cast<char>(code);
+    std::vector<std::string_view> parts;
+    parts.reserve(payload.size() + 1);
+    parts.emplace_back(header, sizeof(header));
+    parts.insert(parts.end(), payload.begin(), payload.end());
+    if (!slot.responses.Push(parts)) {
+        // Too large for the ring: the client retries over gRPC.
+        header[8] = static_cast<char>(grpc::StatusCode::RESOURCE_EXHAUSTED);
+        std::string_view tooLarge[] = {std::string_view(header, sizeof(header))};
+        if (!slot.responses.Push(tooLarge)) {
+            spdlog::warn("Shared-memory slot {} is not reading its responses; dropping one", i);
+            return;
+        }
+    }
+    slot.responseSeq.fetch_add(1);
+    if (slot.waiting.load()) {
+        FutexWake(&slot.responseSeq);
+    }
+}
+
+void ShmServer::ReclaimDead() {
+    for (size_t i = 0; i < segment_->slots; ++i) {
+        ShmSlot& slot = segment_->Slot(i);
+        uint32_t pid = slot.owner.load(std::memory_order_acquire);
+        if (pid == 0 || busy_[i].load(std::memory_order_acquire)) {
+            continue;
+        }
+        if (kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH) {
+            continue;
+        }
+        slot.requests.Init();
+        slot.responses.Init();
+        slot.waiting.store(0);
+        slot.owner.compare_exchange_strong(pid, 0, std::memory_order_release);
+        spdlog::info("Reclaimed shared-memory slot {} of exited process {}", i, pid);
+    }
+}
+
+std::unique_ptr<ShmClient> ShmClient::Open(const std::string& addr) {
+    std::string name = ShmSegmentName(addr);
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < ShmSegment::Bytes(0)) {
+        close(fd);
+        return nullptr;
+    }
+    auto bytes = static_cast<size_t>(st.st_size);
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    auto* segment = static_cast<ShmSegment*>(memory);
+    if (segment->magic.load(std::memory_order_acquire) != ShmSegment::kMagic ||
+        ShmSegment::Bytes(segment->slots) > bytes) {
+        munmap(memory, bytes);
+        return nullptr;
+    }
+    spdlog::info("Using shared-memory transport {} for {}", name, addr);
+    return std::unique_ptr<ShmClient>(new ShmClient(segment, bytes));
+}
+
+ShmClient::~ShmClient() {
+    for (int slot : claimed_) {
+        segment_->Slot(slot).owner.store(0, std::memory_order_release);
+    }
+    munmap(segment_, bytes_);
+}
+
+bool ShmClient::Closed() const {
+    return segment_->magic.load(std::memory_order_acquire) != ShmSegment::kMagic;
+}
+
+int ShmClient::AcquireSlot() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!idle_.empty()) {
+        int slot = idle_.back();
+        idle_.pop_back();
+        return slot;
+    }
+    auto pid = static_cast<uint32_t>(getpid());
+    for (uint32_t i = 0; i < segment_->slots; ++i) {
+        uint32_t free = 0;
+        if (segment_->Slot(i).owner.compare_exchange_strong(free, pid, std::memory_order_acquire)) {
+            claimed_.push_back(static_cast<int>(i));
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void ShmClient::ReleaseSlot(int slot) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    idle_.push_back(slot);
+}
+
+bool ShmClient::Call(ShmMethod method, const google::protobuf::Message& request, google::protobuf::Message* response,
+                     grpc::Status* status, const std::string& traceparent, std::chrono::milliseconds timeout) {
+    if (Closed()) {
+        return false;
+    }
+    std::string body = request.SerializeAsString();
+    // Ids carry the pid, so a response left over from another process or
+    // from a call that timed out is never taken for this one.
+    uint64_t id = (static_cast<uint64_t>(getpid()) << 32) | nextId_.fetch_add(1, std::memory_order_relaxed);
+    size_t traceLength = traceparent.size() <= UINT8_MAX ? traceparent.size() : 0;
+    char header[kRequestHeader];
+    std::memcpy(header, &id, sizeof(id));
+    header[8] = static_cast<char>(method);
+    header[9] = static_cast<char>(traceLength);
+    std::string_view parts[] = {std::string_view(header, sizeof(header)),
+                                std::string_view(traceparent.data(), traceLength), body};
+
+    int index = AcquireSlot();
+    if (index < 0) {
+        return false;
+    }
+    ShmSlot& slot = segment_->Slot(index);
+    if (!slot.requests.Push(parts)) {
+        ReleaseSlot(index);
+        return false;
+    }
+    RingDoorbell(*segment_);
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::string message;
+    int spins = 0;
+    while (true) {
+        uint32_t seq = slot.responseSeq.load();
+        if (slot.responses.Pop(message)) {
+            uint64_t responseId = 0;
+            if (message.size() >= kResponseHeader) {
+                std::memcpy(&responseId, message.data(), sizeof(responseId));
+            }
+            if (responseId == id) {
+                break;
+            }
+            continue;
+        }
+        if (Closed()) {
+            ReleaseSlot(index);
+            return false;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            ReleaseSlot(index);
+            *status = grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED, "Shared-memory call timed out");
+            return true;
+        }
+        if (++spins < kClientSpins) {
+            CpuRelax();
+            continue;
+        }
+        slot.waiting.store(1);
+        FutexWait(&slot.responseSeq, seq, std::min<std::chrono::nanoseconds>(deadline - now, kParkTimeout));
+        slot.waiting.store(0);
+    }
+    ReleaseSlot(index);
+
+    auto code = static_cast<grpc::StatusCode>(static_cast<uint8_t>(message[8]));
+    if (code == grpc::StatusCode::RESOURCE_EXHAUSTED) {
+        return false;
+    }
+    const char* payload = message.data() + kResponseHeader;
+    int size = static_cast<int>(message.size() - kResponseHeader);
+    if (code != grpc::StatusCode::OK) {
+        *status = grpc::Status(code, std::string(payload, size));
+    } else if (!response->ParseFromArray(payload, size)) {
+        *status = grpc::Status(grpc::StatusCode::INTERNAL, "Malformed shared-memory response");
+    } else {
+        *status = grpc::Status::OK;
+    }
+    return true;
+}
@@ -0,0 +1,221 @@
+#include "include/taskscheduler.h"
+
+#include <algorithm>
+#include <exception>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+thread_local const TaskScheduler* tlsScheduler = nullptr; ///< Scheduler owning the current thread, if any.
+thread_local size_t tlsWorker = 0;                        ///< Worker index of the current thread.
+}
+
+TaskScheduler::TaskScheduler(size_t workers) {
+    if (workers == 0) {
+        workers = std::thread::hardware_concurrency();
+    }
+    // One worker is kept for foreground work, so background work needs a second.
+    workers = std::max<size_t>(2, workers);
+    maxBackground_ = workers - 1;
+    for (auto& pending : pending_) {
+        pending.store(0);
+    }
+    workers_.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_[i]->thread = std::thread([this, i] { WorkerLoop(i); });
+    }
+    timerThread_ = std::thread([this] { TimerLoop(); });
+}
+
+TaskScheduler::~TaskScheduler() {
+    Shutdown();
+}
+
+TaskScheduler& TaskScheduler::Instance() {
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+void TaskScheduler::Submit(Task task, TaskPriority priority) {
+    size_t lane = static_cast<size_t>(priority);
+    size_t index = tlsScheduler == this ? tlsWorker : nextWorker_++ % workers_.size();
+    bool queued = false;
+    {
+        // Workers only exit under sleepMtx_ once stop_ is set and nothing is
+        // pending, so a task queued here before stop_ is always run.
+        std::lock_guard<std::mutex> lock(sleepMtx_);
+        if (!stop_) {
+            {
+                std::lock_guard<std::mutex> laneLock(workers_[index]->mtx);
+                workers_[index]->lanes[lane].push_back(std::move(task));
+            }
+            pending_[lane]++;
+            queued = true;
+        }
+    }
+    if (!queued) {
+        // Late submissions during shutdown run inline so futures never dangle.
+        task();
+        return;
+    }
+    sleepCv_.notify_one();
+}
+
+void TaskScheduler::ScheduleAfter(std::chrono::milliseconds delay, Task task, TaskPriority priority) {
+    {
+        std::lock_guard<std::mutex> lock(timerMtx_);
+        if (!timersDone_) {
+            timers_.push(TimedTask{std::chrono::steady_clock::now() + delay, priority, std::move(task)});
+            task = nullptr;
+        }
+    }
+    if (task) {
+        // Nothing moves timers any more; like a late Submit(), run it now.
+        task();
+        return;
+    }
+    timerCv_.notify_one();
+}
+
+bool TaskScheduler::OnWorkerThread() const {
+    return tlsScheduler == this;
+}
+
+void TaskScheduler::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMtx_);
+        if (stop_.exchange(true)) {
+            return;
+        }
+    }
+    sleepCv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(timerMtx_);
+    }
+    timerCv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    if (timerThread_.joinable()) {
+        timerThread_.join();
+    }
+}
+
+void TaskScheduler::WorkerLoop(size_t index) {
+    tlsScheduler = this;
+    tlsWorker = index;
+    const size_t fg = static_cast<size_t>(TaskPriority::FOREGROUND);
+    const size_t bg = static_cast<size_t>(TaskPriority::BACKGROUND);
+    while (true) {
+        Task task;
+        TaskPriority priority;
+        if (FindTask(index, task, priority)) {
+            try {
+                task();
+            } catch (const std::exception& e) {
+                spdlog::error("Task on worker {} threw: {}", index, e.what());
+            } catch (...) {
+                spdlog::error("Task on worker {} threw an unknown exception", index);
+            }
+            if (priority == TaskPriority::BACKGROUND) {
+                activeBackground_--;
+                if (pending_[bg] > 0) {
+                    sleepCv_.notify_one();
+                }
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMtx_);
+        if (stop_ && pending_[fg] == 0 && pending_[bg] == 0) {
+            return;
+        }
+        sleepCv_.wait_for(lock, std::chrono::milliseconds(10), [&] {
+            return stop_ || pending_[fg] > 0 || (pending_[bg] > 0 && activeBackground_ < maxBackground_);
+        });
+    }
+}
+
+void TaskScheduler::TimerLoop() {
+    std::unique_lock<std::mutex> lock(timerMtx_);
+    while (true) {
+        if (timers_.empty()) {
+            if (stop_) {
+                timersDone_ = true;
+                return;
+            }
+            timerCv_.wait(lock, [&] { return stop_ || !timers_.empty(); });
+            continue;
+        }
+        // Once stopping, timers run early rather than being dropped; the
+        // tasks they submit run inline here.
+        auto due = timers_.top().due;
+        if (!stop_ && std::chrono::steady_clock::now() < due) {
+            timerCv_.wait_until(lock, due);
+            continue;
+        }
+        TimedTask timed = std::move(const_cast<TimedTask&>(timers_.top()));
+        timers_.pop();
+        lock.unlock();
+        Submit(std::move(timed.task), timed.priority);
+        lock.lock();
+    }
+}
+
+bool TaskScheduler::FindTask(size_t index, Task& task, TaskPriority& priority) {
+    const size_t fg = static_cast<size_t>(TaskPriority::FOREGROUND);
+    const size_t bg = static_cast<size_t>(TaskPriority::BACKGROUND);
+    if (pending_[fg] > 0 && (PopLocal(index, fg, task) || Steal(index, fg, task))) {
+        priority = TaskPriority::FOREGROUND;
+        return true;
+    }
+    if (pending_[bg] == 0) {
+        return false;
+    }
+    // Reserve a background slot before taking the task so that at least one
+    // worker stays available for foreground work.
+    size_t active = activeBackground_.load();
+    do {
+        if (active >= maxBackground_) {
+            return false;
+        }
+    } while (!activeBackground_.compare_exchange_weak(active, active + 1));
+    if (PopLocal(index, bg, task) || Steal(index, bg, task)) {
+        priority = TaskPriority::BACKGROUND;
+        return true;
+    }
+    activeBackground_--;
+    return false;
+}
+
+bool TaskScheduler::PopLocal(size_t index, size_t lane, Task& task) {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mtx);
+    if (worker.lanes[lane].empty()) {
+        return false;
+    }
+    task = std::move(worker.lanes[lane].back());
+    worker.lanes[lane].pop_back();
+    pending_[lane]--;
+    return true;
+}
+
+bool TaskScheduler::Steal(size_t thief, size_t lane, Task& task) {
+    size_t n = workers_.size();
+    for (size_t i = 1; i < n; ++i) {
+        Worker& victim = *workers_[(thief + i) % n];
+        std::unique_lock<std::mutex> lock(victim.mtx, std::try_to_lock);
+        if (!lock.owns_lock() || victim.lanes[lane].empty()) {
+            continue;
+        }
+        task = std::move(victim.lanes[lane].front());
+        victim.lanes[lane].pop_front();
+        pending_[lane]--;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,112 @@
+// testArc.cpp
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include "../include/ArcLfu.h"
+#include "../include/ArcLru.h"
+
+/**
+ * @brief Counts the entries an ArcLru reports as removed, by cause.
+ */
+class CountingListener : public RemovalListener<std::string, int> {
+public:
+    int replaced = 0; ///< REPLACED notifications.
+    int evicted = 0;  ///< SIZE notifications.
+
+    void onRemoval(const std::string&, int&&, RemovalCause cause) override {
+        if (cause == RemovalCause::REPLACED) {
+            ++replaced;
+        } else if (cause == RemovalCause::SIZE) {
+            ++evicted;
+        }
+    }
+};
+
+/**
+ * @brief Check that updating a key keeps one node for it.
+ *
+ * Putting a key twice must update its node in place. A second node would
+ * outlive the key's map slot, count against the capacity, and on eviction
+ * erase the slot of the live node.
+ *
+ * @return True if every check passed.
+ */
+bool updateKeepsOneNode() {
+    bool ok = true;
+    bool promoted = false;
+    int value = 0;
+
+    // The second put must not take a second slot: with capacity 2, "b" fits beside "a".
+    ArcLru<std::string, int> small(2, 2);
+    small.put("a", 1, promoted);
+    small.put("a", 2, promoted);
+    small.put("b", 3, promoted);
+    bool kept = small.get("a", value, promoted) && value == 2;
+    std::cout << "put a twice, put b at capacity 2: a " << (kept ? "kept" : "lost") << " (value " << value << ")\n";
+    ok = ok && kept;
+
+    // Two evictions empty a list holding "a" and "b"; a stray node would leave one behind.
+    ArcLru<std::string, int> arc(4, 2);
+    CountingListener listener;
+    arc.setRemovalListener(&listener);
+    arc.put("a", 1, promoted);
+    arc.put("a", 2, promoted);
+    arc.put("b", 3, promoted);
+    bool evicted = arc.evict() && arc.evict();
+    size_t left = arc.size();
+    bool empty = !arc.evict();
+    std::cout << "put a twice, put b, evict twice: " << left << " entries left, " << listener.replaced
+              << " replaced, " << listener.evicted << " evicted\n";
+    ok = ok && evicted && left == 0 && empty && listener.replaced == 1 && listener.evicted == 2;
+    return ok;
+}
+
+/**
+ * @brief Check that an evicted entry leaves no value behind in the ghost list.
+ *
+ * Ghosts keep keys for adaptation only; if they kept values, evicting (as
+ * the memory governor does) would free nothing, and a ghost hit would
+ * bring a stale value back.
+ *
+ * @return True if every check passed.
+ */
+bool ghostsHoldNoValue() {
+    bool promoted = false;
+    std::shared_ptr<int> value;
+
+    ArcLru<std::string, std::shared_ptr<int>> lru(4, 2);
+    auto lruValue = std::make_shared<int>(1);
+    std::weak_ptr<int> lruHeld = lruValue;
+    lru.put("a", lruValue, promoted);
+    lruValue.reset();
+    bool lruEvicted = lru.evict();
+    bool lruFreed = lruHeld.expired();
+    bool lruMiss = !lru.get("a", value, promoted);
+
+    ArcLfu<std::string, std::shared_ptr<int>> lfu(4, 2);
+    auto lfuValue = std::make_shared<int>(1);
+    std::weak_ptr<int> lfuHeld = lfuValue;
+    lfu.put("a", lfuValue);
+    lfuValue.reset();
+    bool lfuEvicted = lfu.evict();
+    bool lfuFreed = lfuHeld.expired();
+    bool lfuMiss = !lfu.get("a", value);
+
+    std::cout << "evict into the ghost list: LRU value " << (lruFreed ? "freed" : "kept") << ", LFU value "
+              << (lfuFreed ? "freed" : "kept") << "; ghost hits " << (lruMiss && lfuMiss ? "miss" : "hit") << "\n";
+    return lruEvicted && lruFreed && lruMiss && lfuEvicted && lfuFreed && lfuMiss;
+}
+
+/**
+ * @brief Regression checks of the ARC building blocks.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testArc() {
+    std::cout << "=== ARC ===\n";
+    bool ok = updateKeepsOneNode();
+    ok = ghostsHoldNoValue() && ok;
+    std::cout << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+// testArena.cpp
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <google/protobuf/wrappers.pb.h>
+#include "cache.pb.h"
+#include "../include/arenaallocator.h"
+
+// Workload parameters
+const int ARENA_RPCS = 200000;
+const size_t ARENA_VALUE_SIZE = 256;
+
+// Every heap allocation in the process goes through here while this file is linked in.
+static std::atomic<size_t> heapAllocations{0};
+
+void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+/**
+ * @brief Wire bytes of the Get and Set requests a client would send.
+ */
+struct ArenaWire {
+    std::string getRequest;   ///< Serialized Get request.
+    std::string setRequest;   ///< Serialized Set request with a bytes value.
+    std::string anyRequest;   ///< Serialized Set request with an Any-wrapped value.
+};
+
+ArenaWire makeWire() {
+    ArenaWire wire;
+    cache::Request request;
+    request.set_group("sessions-eu-west");
+    request.set_key("user:000000000042:profile:settings");
+    request.SerializeToString(&wire.getRequest);
+    request.set_data(std::string(ARENA_VALUE_SIZE, 'v'));
+    request.SerializeToString(&wire.setRequest);
+    google::protobuf::StringValue wrapped;
+    wrapped.set_value(std::string(ARENA_VALUE_SIZE, 'v'));
+    request.mutable_value()->PackFrom(wrapped);
+    request.SerializeToString(&wire.anyRequest);
+    return wire;
+}
+
+/**
+ * @brief One unary call's message lifetime: parse the request, fill the response, free both.
+ *
+ * @param request The request message (heap- or arena-owned).
+ * @param response The response message.
+ * @param bytes The request's wire bytes.
+ */
+void serveCall(cache::Request* request, cache::GetResponse* response, const std::string& bytes) {
+    request->ParseFromString(bytes);
+    if (request->payload_case() == cache::Request::kValue) {
+        google::protobuf::StringValue wrapped;
+        request->value().UnpackTo(&wrapped);
+        response->set_data(wrapped.value());
+    } else {
+        response->set_data(std::string(ARENA_VALUE_SIZE, 'v'));
+    }
+}
+
+/**
+ * @brief Run calls with heap-allocated messages, as the sync service's default messages do.
+ *
+ * @return Heap allocations per call.
+ */
+double heapCalls(const std::string& bytes) {
+    size_t before = heapAllocations.load();
+    for (int i = 0; i < ARENA_RPCS; ++i) {
+        auto* request = new cache::Request();
+        auto* response = new cache::GetResponse();
+        serveCall(request, response, bytes);
+        delete request;
+        delete response;
+    }
+    return static_cast<double>(heapAllocations.load() - before) / ARENA_RPCS;
+}
+
+/**
+ * @brief Run calls with messages from ArenaMessageAllocator, as the callback service does.
+ *
+ * @return Heap allocations per call.
+ */
+double arenaCalls(const std::string& bytes) {
+    ArenaMessageAllocator<cache::Request, cache::GetResponse> allocator;
+    size_t before = heapAllocations.load();
+    for (int i = 0; i < ARENA_RPCS; ++i) {
+        auto* holder = allocator.AllocateMessages();
+        serveCall(const_cast<cache::Request*>(holder->request()), holder->response(), bytes);
+        holder->Release();
+    }
+    return static_cast<double>(heapAllocations.load() - before) / ARENA_RPCS;
+}
+
+/**
+ * @brief Compare heap allocations and time per RPC with and without per-call arenas.
+ *
+ * Covers a Get (small request, value in the response), a bytes Set and an
+ * Any-wrapped Set; the gRPC transport's own buffers are not included.
+ *
+ * @return 0 on successful completion, 1 if arenas did not reduce allocations.
+ */
+int testArena() {
+    std::cout << "=== Per-call Arena Messages (" << ARENA_RPCS << " calls, " << ARENA_VALUE_SIZE
+              << "-byte values) ===\n";
+    ArenaWire wire = makeWire();
+    int result = 0;
+    for (auto [name, bytes] : {std::make_pair("get", &wire.getRequest), std::make_pair("set bytes", &wire.setRequest),
+                               std::make_pair("set any", &wire.anyRequest)}) {
+        heapCalls(*bytes);  // warm up malloc and the arena blocks
+        arenaCalls(*bytes);
+        auto start = std::chrono::steady_clock::now();
+        double heap = heapCalls(*bytes);
+        auto mid = std::chrono::steady_clock::now();
+        double arena = arenaCalls(*bytes);
+        auto end = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::nano> heapTime = mid - start;
+        std::chrono::duration<double, std::nano> arenaTime = end - mid;
+        std::cout << name << ": heap " << heap << " allocs/call, " << heapTime.count() / ARENA_RPCS
+                  << " ns/call; arena " << arena << " allocs/call, " << arenaTime.count() / ARENA_RPCS
+                  << " ns/call\n";
+        if (arena >= heap) {
+            result = 1;
+        }
+    }
+    std::cout << "\n";
+    return result;
+}
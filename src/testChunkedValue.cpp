@@ -0,0 +1,151 @@
+// testChunkedValue.cpp
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../include/chunkedvalue.h"
+
+// Workload parameters
+const size_t CHUNK_LARGE_VALUE = 4 * ChunkedValue::kChunkSize + 4321; // value split for the stream checks
+
+/**
+ * @brief A payload whose bytes differ from chunk to chunk, so a swapped or lost chunk changes it.
+ */
+std::string pattern(size_t size) {
+    std::string bytes(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<char>((i * 131 + i / ChunkedValue::kChunkSize) & 0xff);
+    }
+    return bytes;
+}
+
+/**
+ * @brief The (offset, data) messages a GetStream or SetStream sender produces for a value.
+ */
+std::vector<std::pair<size_t, std::string>> toMessages(const ChunkedValue& value) {
+    std::vector<std::pair<size_t, std::string>> messages;
+    size_t offset = 0;
+    for (size_t i = 0; i < value.chunks(); ++i) {
+        messages.emplace_back(offset, std::string(value.chunk(i).view()));
+        offset += value.chunk(i).size();
+    }
+    return messages;
+}
+
+/**
+ * @brief Reassemble messages like a stream receiver.
+ *
+ * @param value Receives the value if every message continued it and the total matched.
+ * @return False if a message was missing, out of order or repeated.
+ */
+bool reassemble(std::vector<std::pair<size_t, std::string>> messages, size_t totalSize, ChunkedValue& value) {
+    ChunkedValue::Builder builder;
+    for (auto& [offset, data] : messages) {
+        if (!builder.AppendAt(offset, std::move(data))) {
+            return false;
+        }
+    }
+    if (builder.size() != totalSize) {
+        return false;
+    }
+    value = builder.Build();
+    return true;
+}
+
+/**
+ * @brief Check that values of sizes around the chunk boundary split into full chunks and read back unchanged.
+ *
+ * @return True if every size kept its bytes, and only the last chunk was short.
+ */
+bool splitsAtChunkSize() {
+    const size_t chunk = ChunkedValue::kChunkSize;
+    bool ok = true;
+    for (size_t size : {size_t{0}, size_t{1}, chunk - 1, chunk, chunk + 1, 3 * chunk, CHUNK_LARGE_VALUE}) {
+        std::string bytes = pattern(size);
+        ChunkedValue value(bytes);
+        bool full = true;
+        for (size_t i = 0; i + 1 < value.chunks(); ++i) {
+            full = full && value.chunk(i).size() == chunk;
+        }
+        bool same = value.size() == size && value.chunks() == (size + chunk - 1) / chunk && value.str() == bytes;
+        ok = ok && full && same;
+        if (!full || !same) {
+            std::cout << "Split of " << size << " bytes: " << value.chunks() << " chunks, "
+                      << (same ? "same bytes" : "different bytes") << "\n";
+        }
+    }
+
+    // Pieces of odd sizes, as a stream of another chunk size would deliver them.
+    std::string bytes = pattern(CHUNK_LARGE_VALUE);
+    ChunkedValue::Builder builder;
+    for (size_t at = 0; at < bytes.size(); at += 10007) {
+        builder.Append(std::string_view(bytes).substr(at, 10007));
+    }
+    ChunkedValue rebuilt = builder.Build();
+    ok = ok && rebuilt.str() == bytes && rebuilt.chunks() == ChunkedValue(bytes).chunks();
+
+    // Sharing a slice cuts it into sub-slices of the same bytes, without copying.
+    SliceValue slice(bytes);
+    ChunkedValue shared = ChunkedValue::Share(slice);
+    bool zeroCopy = shared.chunks() > 1 && shared.chunk(1).data() == slice.data() + chunk;
+    ok = ok && shared.str() == bytes && zeroCopy;
+
+    std::cout << "Split and rebuilt values around the " << chunk << "-byte chunk size: " << (ok ? "yes" : "no")
+              << ", Share() without copying: " << (zeroCopy ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that a receiver rebuilds a streamed value and rejects a stream that lost or reordered a chunk.
+ *
+ * @return True if the intact stream was rebuilt and every damaged stream was rejected.
+ */
+bool streamReassembly() {
+    std::string bytes = pattern(CHUNK_LARGE_VALUE);
+    ChunkedValue sent(bytes);
+    auto messages = toMessages(sent);
+    ChunkedValue received;
+
+    bool intact = reassemble(messages, sent.size(), received) && received.str() == bytes;
+
+    auto missing = messages;
+    missing.erase(missing.begin() + 2);
+    bool missingRejected = !reassemble(missing, sent.size(), received);
+
+    auto missingLast = messages;
+    missingLast.pop_back();
+    bool truncatedRejected = !reassemble(missingLast, sent.size(), received);
+
+    auto swapped = messages;
+    std::swap(swapped[1], swapped[2]);
+    bool swappedRejected = !reassemble(swapped, sent.size(), received);
+
+    auto repeated = messages;
+    repeated.insert(repeated.begin() + 3, repeated[2]);
+    bool repeatedRejected = !reassemble(repeated, sent.size(), received);
+
+    // An empty value is one empty message at offset 0.
+    bool empty = reassemble({{0, ""}}, 0, received) && received.empty();
+
+    std::cout << "Stream of " << messages.size() << " chunks rebuilt: " << (intact ? "yes" : "no")
+              << "; rejected with a chunk missing: " << (missingRejected ? "yes" : "no")
+              << ", the last chunk missing: " << (truncatedRejected ? "yes" : "no")
+              << ", two chunks swapped: " << (swappedRejected ? "yes" : "no")
+              << ", a chunk repeated: " << (repeatedRejected ? "yes" : "no") << "\n";
+    return intact && missingRejected && truncatedRejected && swappedRejected && repeatedRejected && empty;
+}
+
+/**
+ * @brief Check splitting of chunked values and their reassembly from stream messages.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testChunkedValue() {
+    std::cout << "=== Chunked Values ===\n";
+    bool ok = splitsAtChunkSize();
+    ok = streamReassembly() && ok;
+    std::cout << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+// testCounter.cpp
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include "cache.pb.h"
+#include "../include/countercodec.h"
+#include "../include/slicevalue.h"
+#include "../include/wirecodec.h"
+
+// Workload parameters
+const int64_t COUNTER_INITIAL = 100;   // `initial` of every increment
+const int64_t COUNTER_DELTA = 5;       // `delta` of every increment
+const int64_t COUNTER_STORED = 41;     // counter the loader knows for "known"
+
+/**
+ * @brief A loader like the node's: nullopt for keys the backing store lacks.
+ */
+template<typename Value>
+std::optional<Value> loadCounter(const std::string& key) {
+    if (key != "known") {
+        return std::nullopt;
+    }
+    Value value{};
+    CounterCodec<Value>::Write(COUNTER_STORED, value);
+    return value;
+}
+
+/**
+ * @brief Incr as the group does at the owner: the loader's answer is the current value.
+ *
+ * @return True if an unseen key starts at `initial` and a loaded one adds `delta`.
+ */
+template<typename Value>
+bool groupPath(const std::string& name) {
+    int64_t unseen = 0;
+    int64_t known = 0;
+    Value updated{};
+    std::optional<Value> current = loadCounter<Value>("unseen");
+    bool ok = IncrementCounter(current ? &*current : nullptr, COUNTER_DELTA, COUNTER_INITIAL, updated, unseen) ==
+              CounterStep::OK;
+    current = loadCounter<Value>("known");
+    ok = IncrementCounter(current ? &*current : nullptr, COUNTER_DELTA, COUNTER_INITIAL, updated, known) ==
+         CounterStep::OK && ok;
+    ok = ok && unseen == COUNTER_INITIAL && known == COUNTER_STORED + COUNTER_DELTA;
+    std::cout << "Group path (" << name << "): unseen key " << unseen << ", loaded key " << known
+              << (ok ? "" : " (wrong)") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Incr as a core does: an encoded load, absent when the loader answered NOT_FOUND.
+ *
+ * @return True if an unseen key starts at `initial` and a loaded one adds `delta`.
+ */
+template<typename Value>
+bool corePath(const std::string& name) {
+    int64_t unseen = 0;
+    int64_t known = 0;
+    cache::GetResponse updated;
+    cache::GetResponse loaded;
+    std::optional<Value> current = loadCounter<Value>("unseen");
+    bool ok = !current &&
+              IncrementEncoded<Value>(nullptr, COUNTER_DELTA, COUNTER_INITIAL, &updated, unseen) == CounterStep::OK;
+    Value value{};
+    ok = ok && WireCodec<Value>::Decode(updated, value) && CounterCodec<Value>::Read(value, unseen);
+    current = loadCounter<Value>("known");
+    WireCodec<Value>::Encode(*current, &loaded);
+    ok = IncrementEncoded<Value>(&loaded, COUNTER_DELTA, COUNTER_INITIAL, &updated, known) == CounterStep::OK && ok;
+    ok = ok && unseen == COUNTER_INITIAL && known == COUNTER_STORED + COUNTER_DELTA;
+    std::cout << "Core path (" << name << "): unseen key " << unseen << ", loaded key " << known
+              << (ok ? "" : " (wrong)") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that Incr on a key the loader does not know returns `initial`.
+ *
+ * A loader that answers an empty value for such keys made every new string
+ * counter fail as "not an integer"; the group and the per-core shards now
+ * start from nullptr instead, and only a stored empty value fails.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testCounter() {
+    std::cout << "=== Counter ===\n";
+    bool ok = groupPath<std::string>("string");
+    ok = groupPath<SliceValue>("slice") && ok;
+    ok = groupPath<int32_t>("int32") && ok;
+    ok = corePath<std::string>("string") && ok;
+    ok = corePath<SliceValue>("slice") && ok;
+    ok = corePath<int32_t>("int32") && ok;
+    SliceValue empty;
+    SliceValue updated;
+    int64_t counter = 0;
+    bool rejected = IncrementCounter(&empty, COUNTER_DELTA, COUNTER_INITIAL, updated, counter) ==
+                    CounterStep::NOT_INTEGER;
+    std::cout << "Stored empty value rejected: " << (rejected ? "yes" : "no") << "\n";
+    std::cout << "\n";
+    return ok && rejected ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// testGenerations.cpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/generations.h"
+
+// Workload parameters
+const int GEN_READERS = 4;
+const int GEN_LOOKUPS_PER_READER = 1000000;
+const int GEN_PREFIXES = 64;            // invalidated prefixes, of several lengths
+
+/**
+ * @brief Check which stamps survive group and prefix invalidations.
+ *
+ * @return True if only stamps older than an invalidation of a prefix of their key were rejected.
+ */
+bool staleStampsRejected() {
+    Generations generations;
+    bool ok = true;
+    uint64_t before = generations.Stamp();
+    ok = generations.Valid("tenant1:a", before) && ok;
+
+    generations.Bump("tenant1:");
+    uint64_t afterTenant = generations.Stamp();
+    ok = !generations.Valid("tenant1:a", before) && ok;          // stale under the prefix
+    ok = generations.Valid("tenant1:a", afterTenant) && ok;      // stamped after it
+    ok = generations.Valid("tenant2:a", before) && ok;           // other prefix
+    ok = generations.Valid("tenant1", before) && ok;             // shorter than the prefix
+    ok = generations.Valid("", before) && ok;
+
+    // A longer prefix under the first one: its floor applies only below it.
+    generations.Bump("tenant1:orders:");
+    ok = !generations.Valid("tenant1:orders:7", afterTenant) && ok;
+    ok = generations.Valid("tenant1:users:7", afterTenant) && ok;
+
+    // Bumping a prefix again raises its floor.
+    uint64_t beforeAgain = generations.Stamp();
+    generations.Bump("tenant1:");
+    ok = !generations.Valid("tenant1:users:7", beforeAgain) && ok;
+    ok = generations.Valid("tenant2:a", beforeAgain) && ok;
+
+    // The empty prefix covers every key.
+    uint64_t beforeAll = generations.Stamp();
+    generations.Bump("");
+    ok = !generations.Valid("tenant2:a", beforeAll) && ok;
+    ok = !generations.Valid("", beforeAll) && ok;
+    ok = generations.Valid("tenant2:a", generations.Stamp()) && ok;
+
+    std::cout << "Stale stamps rejected, fresh and unrelated stamps kept: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Measure Valid() for keys of a group whose prefixes have been invalidated.
+ *
+ * This is the cost every cache hit pays once any prefix was invalidated.
+ *
+ * @return True if the keys stamped after the invalidations stayed valid.
+ */
+bool lookupCost() {
+    Generations generations;
+    for (int i = 0; i < GEN_PREFIXES; ++i) {
+        generations.Bump((i % 2 ? "t" : "tenant") + std::to_string(i) + ":");
+    }
+    uint64_t stamp = generations.Stamp();
+    std::vector<std::string> keys;
+    for (int i = 0; i < GEN_PREFIXES; ++i) {
+        keys.push_back((i % 2 ? "t" : "tenant") + std::to_string(i) + ":user:" + std::to_string(i * 7919));
+    }
+    long valid = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < GEN_LOOKUPS_PER_READER; ++i) {
+        valid += generations.Valid(keys[i % keys.size()], stamp);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Valid() with " << GEN_PREFIXES << " prefix floors: " << elapsed.count() / GEN_LOOKUPS_PER_READER
+              << " ns per lookup\n";
+    return valid == GEN_LOOKUPS_PER_READER;
+}
+
+/**
+ * @brief Check Valid() against concurrent Bump() calls.
+ *
+ * Readers validate keys stamped at the start while a writer invalidates a
+ * prefix. Once the writer has bumped a key's prefix, no reader may
+ * accept the old stamp for that key again.
+ *
+ * @return True if no reader accepted a stamp after its prefix was invalidated.
+ */
+bool concurrentBumps() {
+    Generations generations;
+    for (int i = 0; i < GEN_PREFIXES; ++i) {
+        generations.Bump((i % 2 ? "t" : "tenant") + std::to_string(i) + ":");
+    }
+    uint64_t stamp = generations.Stamp();
+    const std::string victim = "victim:";
+    std::atomic<bool> bumped{false};
+    std::atomic<long> accepted{0};
+    std::atomic<long> wrong{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < GEN_READERS; ++r) {
+        readers.emplace_back([&, r] {
+            std::string key = "tenant" + std::to_string(r * 2) + ":key";
+            std::string victimKey = victim + std::to_string(r);
+            for (int i = 0; i < GEN_LOOKUPS_PER_READER; ++i) {
+                bool done = bumped.load(std::memory_order_acquire);
+                bool valid = generations.Valid(i % 2 ? key : victimKey, stamp);
+                if (i % 2 == 0 && done && valid) {
+                    ++wrong;
+                }
+                accepted += valid;
+            }
+        });
+    }
+    std::thread writer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        generations.Bump(victim);
+        bumped.store(true, std::memory_order_release);
+    });
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    // The tenant keys' prefixes were all bumped before the stamp was taken.
+    bool stillValid = generations.Valid("tenant0:key", stamp);
+    bool victimStale = !generations.Valid(victim + "0", stamp);
+    std::cout << GEN_READERS << " readers x " << GEN_LOOKUPS_PER_READER << " lookups racing a Bump(): accepted "
+              << accepted.load() << ", stale accepted after Bump(): " << wrong.load() << "\n";
+    return wrong.load() == 0 && stillValid && victimStale;
+}
+
+/**
+ * @brief Check group and prefix invalidation with Generations.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testGenerations() {
+    std::cout << "=== Invalidation Generations ===\n";
+    bool ok = staleStampsRejected();
+    ok = lookupCost() && ok;
+    ok = concurrentBumps() && ok;
+    std::cout << "\n";
+    return ok ? 0 : 1;
+}
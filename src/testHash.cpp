@@ -0,0 +1,140 @@
+// testHash.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "../include/BatchHash.h"
+#include "../include/consistentHash.h"
+#include "../include/Lru.h"
+
+// Workload parameters
+const int HASH_BATCH = 256;
+const int HASH_ROUNDS = 20000;
+const int RING_NODES = 16;
+
+/**
+ * @brief Build a batch of short random keys (8-24 bytes).
+ * 
+ * @return The key batch.
+ */
+std::vector<std::string> makeHashKeys() {
+    std::mt19937 gen(7);
+    std::vector<std::string> keys(HASH_BATCH);
+    for (auto& key : keys) {
+        int len = 8 + gen() % 17;
+        for (int i = 0; i < len; ++i) {
+            key.push_back(static_cast<char>('a' + gen() % 26));
+        }
+    }
+    return keys;
+}
+
+/**
+ * @brief Time a callable over HASH_ROUNDS rounds and return ns per key.
+ * 
+ * @tparam F Callable processing one whole batch.
+ * @param f The callable.
+ * @return Nanoseconds per key.
+ */
+template<typename F>
+double nsPerKey(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < HASH_ROUNDS; ++round) {
+        f();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed = end - start;
+    return elapsed.count() / (static_cast<double>(HASH_ROUNDS) * HASH_BATCH);
+}
+
+/**
+ * @brief Check that CacheClient and every node's PeerPicker pick the same owner for a key.
+ *
+ * Both build the cluster ring with consistentHash's defaults and learn the
+ * nodes from etcd in whatever order they arrive. Here one ring adds the
+ * nodes in order, the other in reverse with a node that joined and left
+ * again; PeerPicker::PickPeer() uses Get(), CacheClient's MultiGet uses
+ * GetBatch().
+ *
+ * @param keys Keys to place.
+ * @return True if both rings picked the same owner for every key, per key and batched.
+ */
+bool ownersAgree(const std::vector<std::string>& keys) {
+    consistentHash picker;
+    consistentHash client;
+    for (int i = 0; i < RING_NODES; ++i) {
+        picker.Add("10.0.0." + std::to_string(i) + ":8001");
+    }
+    client.Add("10.0.1.99:8001");
+    for (int i = RING_NODES - 1; i >= 0; --i) {
+        client.Add("10.0.0." + std::to_string(i) + ":8001");
+    }
+    client.Remove("10.0.1.99:8001");
+    auto batched = client.GetBatch(keys);
+    int differ = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        std::string owner = picker.Get(keys[i]);
+        differ += owner.empty() || owner != client.Get(keys[i]) || owner != batched[i];
+    }
+    std::cout << "Client and PeerPicker owners differ for " << differ << " of " << keys.size() << " keys\n";
+    return differ == 0;
+}
+
+/**
+ * @brief Compare per-key and batched hashing, ring lookup and shard selection.
+ * 
+ * Each row processes the same 256-key batch and reports nanoseconds per key;
+ * the batched paths are checked against the per-key results first.
+ * 
+ * @return 0 on success, 1 if a batched result differs from the per-key one or
+ *         client and PeerPicker rings disagree.
+ */
+int testHash() {
+    auto keys = makeHashKeys();
+    consistentHash ring;
+    for (int i = 0; i < RING_NODES; ++i) {
+        ring.Add("10.0.0." + std::to_string(i) + ":8001");
+    }
+    HashLruK<std::string, int> sharded(1 << 14, 16, 1 << 12, 2);
+
+    std::vector<uint32_t> scalar(HASH_BATCH), batched(HASH_BATCH);
+    batchhash::hashBatchScalar(keys.data(), keys.size(), scalar.data());
+    batchhash::hashBatch(keys.data(), keys.size(), batched.data());
+    auto nodes = ring.GetBatch(keys);
+    for (int i = 0; i < HASH_BATCH; ++i) {
+        if (scalar[i] != batched[i] || nodes[i] != ring.Get(keys[i])) {
+            std::cout << "Batched result mismatch at key " << keys[i] << std::endl;
+            return 1;
+        }
+    }
+
+    volatile uint32_t sink = 0;
+    std::cout << "=== Batch Hashing (" << HASH_BATCH << "-key batches, ns/key) ===\n";
+    std::cout << "hash32 per key:          " << nsPerKey([&] {
+        for (const auto& key : keys) sink = sink + batchhash::hash32(key);
+    }) << "\n";
+    std::cout << "hashBatch:               " << nsPerKey([&] {
+        batchhash::hashBatch(keys.data(), keys.size(), batched.data());
+        sink = sink + batched[0];
+    }) << "\n";
+    std::cout << "ring Get per key:        " << nsPerKey([&] {
+        for (const auto& key : keys) sink = sink + ring.Get(key).size();
+    }) << "\n";
+    std::cout << "ring GetBatch:           " << nsPerKey([&] {
+        sink = sink + ring.GetBatch(keys)[0].size();
+    }) << "\n";
+    std::vector<size_t> shards(HASH_BATCH);
+    std::cout << "shard select per key:    " << nsPerKey([&] {
+        for (int i = 0; i < HASH_BATCH; ++i) shards[i] = sharded.shardOf(keys[i]);
+        sink = sink + shards[0];
+    }) << "\n";
+    std::cout << "shard select batched:    " << nsPerKey([&] {
+        sharded.shardsOf(keys, shards);
+        sink = sink + shards[0];
+    }) << "\n";
+    bool agree = ownersAgree(keys);
+    std::cout << "\n";
+    return agree ? 0 : 1;
+}
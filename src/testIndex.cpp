@@ -0,0 +1,168 @@
+// testIndex.cpp
+
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "../include/SwissIndex.h"
+#include "../include/CacheEngine.h"
+
+// Workload parameters
+const size_t INDEX_SLOTS = 1 << 20;
+const size_t INDEX_KEYS = 943000; // ~90% of INDEX_SLOTS
+const size_t INDEX_LOOKUPS = 4000000;
+
+/**
+ * @brief Scalar open-addressing table with linear probing, for comparison.
+ *
+ * Same slot count and hash mixing as SwissIndex, but every probe compares
+ * full keys one slot at a time.
+ */
+class LinearProbeIndex {
+public:
+    explicit LinearProbeIndex(size_t slots) : keys(slots), values(slots), used(slots, 0), mask(slots - 1) {}
+
+    void insert(uint64_t key, uint32_t value) {
+        size_t i = mix(key) & mask;
+        while (used[i] && keys[i] != key) i = (i + 1) & mask;
+        used[i] = 1;
+        keys[i] = key;
+        values[i] = value;
+    }
+
+    uint32_t* find(uint64_t key) {
+        size_t i = mix(key) & mask;
+        while (used[i]) {
+            if (keys[i] == key) return &values[i];
+            i = (i + 1) & mask;
+        }
+        return nullptr;
+    }
+
+private:
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> values;
+    std::vector<uint8_t> used;
+    size_t mask;
+
+    static size_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+};
+
+/**
+ * @brief Time a lookup callable over a key sequence and return ns per lookup.
+ *
+ * @tparam F Callable returning true on a hit.
+ * @param probes The keys to look up.
+ * @param f The callable.
+ * @param hits Output parameter for the number of hits.
+ * @return Nanoseconds per lookup.
+ */
+template<typename F>
+double timeLookups(const std::vector<uint64_t>& probes, F&& f, size_t& hits) {
+    hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t key : probes) {
+        if (f(key)) ++hits;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed = end - start;
+    return elapsed.count() / probes.size();
+}
+
+/**
+ * @brief Compare SwissIndex with std::unordered_map and a scalar open-addressing table.
+ *
+ * All three map random 64-bit keys to 32-bit node-pool slot numbers, filled to
+ * ~90% of 2^20 slots. Lookups are half hits, half misses. Before timing,
+ * SwissIndex is cross-checked against std::unordered_map through a churn of
+ * inserts and erases (which exercises tombstones and in-place rehashing).
+ *
+ * @return 0 on successful completion, 1 if SwissIndex disagreed with std::unordered_map.
+ */
+int testIndex() {
+    std::cout << "=== Index Benchmark (" << INDEX_KEYS << " keys in " << INDEX_SLOTS << " slots) ===\n";
+    std::mt19937_64 gen(11);
+
+    // Correctness under churn.
+    {
+        SwissIndex<uint64_t, uint32_t> swiss;
+        std::unordered_map<uint64_t, uint32_t> reference;
+        std::mt19937_64 churn(3);
+        for (uint32_t i = 0; i < 2000000; ++i) {
+            uint64_t key = churn() % 50000;
+            if (churn() % 3 == 0) {
+                if (swiss.erase(key) != (reference.erase(key) == 1)) return 1;
+            } else {
+                swiss.insert(key, i);
+                reference[key] = i;
+            }
+        }
+        if (swiss.size() != reference.size()) return 1;
+        for (auto& [key, value] : reference) {
+            uint32_t* found = swiss.find(key);
+            if (!found || *found != value) return 1;
+        }
+        std::cout << "SwissIndex matches std::unordered_map after churn (" << swiss.size() << " keys)\n";
+    }
+
+    std::vector<uint64_t> keys(INDEX_KEYS);
+    for (auto& key : keys) key = gen();
+    std::vector<uint64_t> probes(INDEX_LOOKUPS);
+    for (size_t i = 0; i < probes.size(); ++i) {
+        probes[i] = (i & 1) ? keys[gen() % keys.size()] : gen();
+    }
+
+    std::unordered_map<uint64_t, uint32_t> stdMap;
+    stdMap.reserve(INDEX_KEYS);
+    LinearProbeIndex linear(INDEX_SLOTS);
+    SwissIndex<uint64_t, uint32_t> swiss;
+    swiss.reserve(INDEX_KEYS);
+    for (uint32_t i = 0; i < keys.size(); ++i) {
+        stdMap[keys[i]] = i;
+        linear.insert(keys[i], i);
+        swiss.insert(keys[i], i);
+    }
+
+    size_t hits = 0;
+    double stdTime = timeLookups(probes, [&](uint64_t key) { return stdMap.find(key) != stdMap.end(); }, hits);
+    std::cout << "std::unordered_map:      " << stdTime << " ns/lookup, hits " << hits << "\n";
+    double linearTime = timeLookups(probes, [&](uint64_t key) { return linear.find(key) != nullptr; }, hits);
+    std::cout << "scalar linear probing:   " << linearTime << " ns/lookup, hits " << hits << "\n";
+    double swissTime = timeLookups(probes, [&](uint64_t key) { return swiss.find(key) != nullptr; }, hits);
+    std::cout << "SwissIndex (load " << static_cast<double>(swiss.size()) / swiss.capacity() << "): "
+              << swissTime << " ns/lookup, hits " << hits << "\n";
+
+    // Engine-level effect: batched gets with bucket prefetching.
+    std::vector<int> engineKeys(INDEX_LOOKUPS / 4);
+    for (auto& key : engineKeys) key = static_cast<int>(gen() % 400000);
+    CacheEngine<int, int, HashIndex, LruEviction, AlwaysAdmit, NoExpiry, NoLock> hashEngine(200000);
+    CacheEngine<int, int, SwissHashIndex, LruEviction, AlwaysAdmit, NoExpiry, NoLock> swissEngine(200000);
+    for (int key = 0; key < 400000; key += 2) {
+        hashEngine.put(key, key);
+        swissEngine.put(key, key);
+    }
+    std::vector<int> values;
+    auto start = std::chrono::steady_clock::now();
+    size_t hashHits = hashEngine.getBatch(engineKeys, values);
+    auto mid = std::chrono::steady_clock::now();
+    size_t swissHits = swissEngine.getBatch(engineKeys, values);
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> hashElapsed = mid - start;
+    std::chrono::duration<double, std::nano> swissElapsed = end - mid;
+    std::cout << "CacheEngine getBatch, HashIndex:      " << hashElapsed.count() / engineKeys.size()
+              << " ns/key, hits " << hashHits << "\n";
+    std::cout << "CacheEngine getBatch, SwissHashIndex: " << swissElapsed.count() / engineKeys.size()
+              << " ns/key, hits " << swissHits << "\n";
+
+    std::cout << "\n--- Speedup of SwissIndex ---\n";
+    std::cout << "over std::unordered_map:    " << stdTime / swissTime << "x\n";
+    std::cout << "over scalar linear probing: " << linearTime / swissTime << "x\n\n";
+    return 0;
+}
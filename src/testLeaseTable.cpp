@@ -0,0 +1,149 @@
+// testLeaseTable.cpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/leasetable.h"
+
+// Workload parameters
+const int LT_THREADS = 8;              // callers missing on the same key at once
+const int LT_ROUNDS = 200;             // hot keys each missed by every caller
+const int LT_KEYS = 2000;              // leases ended by End() from another thread, and leases kept
+const auto LT_TTL = std::chrono::milliseconds(20);  // lease lifetime of the expiry check
+
+/**
+ * @brief Check that concurrent misses on one key hand out one token and hot misses to the rest.
+ *
+ * @return True if every round gave exactly one caller a non-zero token.
+ */
+bool oneTokenPerMiss() {
+    LeaseTable table(std::chrono::hours(1));
+    std::atomic<int> ready{0};
+    std::vector<std::atomic<int>> winners(LT_ROUNDS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < LT_THREADS; ++t) {
+        threads.emplace_back([&] {
+            ready.fetch_add(1);
+            while (ready.load() < LT_THREADS) {
+            }
+            for (int round = 0; round < LT_ROUNDS; ++round) {
+                if (table.Acquire("hot" + std::to_string(round)) != 0) {
+                    winners[round].fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    bool ok = true;
+    for (int round = 0; round < LT_ROUNDS; ++round) {
+        ok = winners[round].load() == 1 && table.Outstanding("hot" + std::to_string(round)) && ok;
+    }
+    std::cout << "One token per miss, hot misses for the rest: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that a lease is refused once the key was written, deleted by prefix, or the lease lapsed.
+ *
+ * @return True if only live, unredeemed leases could store.
+ */
+bool redeemRefusedAfterEnd() {
+    LeaseTable table(LT_TTL);
+    int stores = 0;
+    auto store = [&stores] { ++stores; };
+
+    uint64_t token = table.Acquire("k");
+    bool ok = token != 0 && table.Redeem("k", token, store) && stores == 1;
+    ok = !table.Redeem("k", token, store) && !table.Redeem("k", 0, store) && stores == 1 && ok;
+
+    token = table.Acquire("k");
+    bool updated = false;
+    table.Invalidate("k", [&updated] { updated = true; });
+    ok = updated && !table.Redeem("k", token, store) && ok;
+
+    uint64_t user = table.Acquire("user:1");
+    uint64_t item = table.Acquire("item:1");
+    table.InvalidatePrefix("user:");
+    ok = !table.Redeem("user:1", user, store) && table.Redeem("item:1", item, store) && stores == 2 && ok;
+
+    token = table.Acquire("slow");
+    std::this_thread::sleep_for(LT_TTL * 2);
+    ok = !table.Outstanding("slow") && !table.Redeem("slow", token, store) && stores == 2 && ok;
+    uint64_t retry = table.Acquire("slow");
+    ok = retry != 0 && retry != token && table.Redeem("slow", retry, store) && stores == 3 && ok;
+
+    std::cout << "Redeem refused after Invalidate, InvalidatePrefix and expiry: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that End() ends leases taken on another thread and skips only shards without leases.
+ *
+ * @return True if every ended lease was refused and the untouched leases could still be redeemed.
+ */
+bool endSkipsOnlyEmptyShards() {
+    LeaseTable table(std::chrono::hours(1));
+    // Nothing leased: End() skips the shard and a later miss still gets a token.
+    table.End("idle");
+    uint64_t idle = table.Acquire("idle");
+    bool ok = idle != 0 && table.Redeem("idle", idle, [] {});
+
+    // Each lease is the only one in the table when it is taken, so End() on the other
+    // thread must see its shard go from empty to leased rather than skip it.
+    std::atomic<int> acquired{-1}, ended{-1};
+    int refused = 0;
+    std::thread ender([&] {
+        for (int i = 0; i < LT_KEYS; ++i) {
+            while (acquired.load(std::memory_order_acquire) < i) {
+            }
+            table.End("ended" + std::to_string(i));
+            ended.store(i, std::memory_order_release);
+        }
+    });
+    for (int i = 0; i < LT_KEYS; ++i) {
+        std::string key = "ended" + std::to_string(i);
+        uint64_t token = table.Acquire(key);
+        acquired.store(i, std::memory_order_release);
+        while (ended.load(std::memory_order_acquire) < i) {
+        }
+        refused += token != 0 && !table.Redeem(key, token, [] {}) ? 1 : 0;
+    }
+    ender.join();
+
+    // With leases in every shard, End() of one key leaves the others redeemable.
+    std::vector<uint64_t> kept(LT_KEYS);
+    for (int i = 0; i < LT_KEYS; ++i) {
+        kept[i] = table.Acquire("kept" + std::to_string(i));
+    }
+    uint64_t gone = table.Acquire("gone");
+    table.End("gone");
+    int redeemed = 0;
+    for (int i = 0; i < LT_KEYS; ++i) {
+        redeemed += table.Redeem("kept" + std::to_string(i), kept[i], [] {}) ? 1 : 0;
+    }
+    ok = refused == LT_KEYS && redeemed == LT_KEYS && !table.Redeem("gone", gone, [] {}) && ok;
+    std::cout << "Leases ended from another thread refused: " << refused << "/" << LT_KEYS
+              << ", other leases redeemed: " << redeemed << "/" << LT_KEYS << "\n";
+    std::cout << "End() skips only shards without leases: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check lease hand-out, refusal after invalidation or expiry, and End() of the lease table.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testLeaseTable() {
+    std::cout << "=== Lease Table ===\n";
+    bool ok = oneTokenPerMiss();
+    ok = redeemRefusedAfterEnd() && ok;
+    ok = endSkipsOnlyEmptyShards() && ok;
+    std::cout << "\n";
+    return ok ? 0 : 1;
+}
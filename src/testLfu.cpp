@@ -0,0 +1,92 @@
+// testLfu.cpp
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "../include/Lfu.h"
+
+// Workload parameters
+const int AGING_CAPACITY = 1 << 16;
+const int AGING_KEY_RANGE = 1 << 19;
+const int AGING_OPS = 4000000;
+const int AGING_MAX_FREQ = 2;
+const uint64_t AGING_MAX_MOVES = 1;   // list insertions one access may do: the touched or inserted node
+
+/**
+ * @brief Zipf stream whose popular keys move to a different range halfway through.
+ *
+ * @return The key sequence.
+ */
+std::vector<int> makeShiftingKeys() {
+    std::vector<double> weights(AGING_KEY_RANGE);
+    for (int i = 0; i < AGING_KEY_RANGE; ++i) {
+        weights[i] = 1.0 / std::pow(i + 1, 0.8);
+    }
+    std::discrete_distribution<int> zipf(weights.begin(), weights.end());
+    std::mt19937 gen(9);
+    std::vector<int> keys(AGING_OPS);
+    for (int i = 0; i < AGING_OPS; ++i) {
+        int rank = zipf(gen);
+        keys[i] = i < AGING_OPS / 2 ? rank : AGING_KEY_RANGE + rank;
+    }
+    return keys;
+}
+
+/**
+ * @brief Serve a key stream read-through and record the most list moves one access cost.
+ *
+ * @tparam CacheType An Lfu variant.
+ * @param cache The cache to serve from.
+ * @param keys The key sequence.
+ * @param maxMoves Output parameter for the most frequency-list insertions of one access (get plus put on a miss).
+ * @return The hit ratio over the second half of the stream (after the shift).
+ */
+template<typename CacheType>
+double serveShifting(CacheType& cache, const std::vector<int>& keys, uint64_t& maxMoves) {
+    size_t hits = 0;
+    maxMoves = 0;
+    int value = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        uint64_t before = cache.listMoves();
+        bool hit = cache.get(keys[i], value);
+        if (!hit) {
+            cache.put(keys[i], keys[i]);
+        }
+        maxMoves = std::max(maxMoves, cache.listMoves() - before);
+        if (hit && i >= keys.size() / 2) {
+            ++hits;
+        }
+    }
+    return static_cast<double>(hits) / (keys.size() - keys.size() / 2);
+}
+
+/**
+ * @brief Check that AvgLfu ages stale frequencies without per-access stalls.
+ *
+ * Plain Lfu keeps the first half's popular keys forever; AvgLfu with a low
+ * aging bound must adapt to the shift. Aging is an O(1) offset bump, so no
+ * access may move more than the one node it touches, even the accesses
+ * that age every entry; a rescan would move the whole cache on those.
+ *
+ * @return 0 on successful completion, 1 if AvgLfu did not adapt better than Lfu or an access did O(n) work.
+ */
+int testLfu() {
+    std::cout << "=== LFU Aging (" << AGING_OPS << " accesses, popularity shift at half) ===\n";
+    auto keys = makeShiftingKeys();
+
+    uint64_t lfuMoves = 0;
+    Lfu<int, int, NoLock> lfu(AGING_CAPACITY);
+    double lfuRatio = serveShifting(lfu, keys, lfuMoves);
+    std::cout << "Lfu:    hit ratio after shift " << lfuRatio << ", most list moves per access " << lfuMoves << "\n";
+
+    uint64_t avgMoves = 0;
+    AvgLfu<int, int, NoLock> avgLfu(AGING_CAPACITY, AGING_MAX_FREQ);
+    double avgRatio = serveShifting(avgLfu, keys, avgMoves);
+    std::cout << "AvgLfu: hit ratio after shift " << avgRatio << ", most list moves per access " << avgMoves
+              << " (" << avgLfu.agings() << " agings of " << AGING_CAPACITY << " entries)\n\n";
+    return avgRatio > lfuRatio && avgLfu.agings() > 0 && avgMoves <= AGING_MAX_MOVES ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+// testMemoryGovernor.cpp
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../include/memorygovernor.h"
+
+// Workload parameters
+const size_t MG_LIMIT = 1000;           // node limit of every check, in bytes
+const double MG_HIGH_WATERMARK = 0.9;   // usage that starts a reclaim pass
+const double MG_LOW_WATERMARK = 0.8;    // usage a reclaim pass aims for
+
+/**
+ * @brief Tenant stand-in with a settable usage that records what it is asked to free.
+ *
+ * Bytes up to `pinned` cannot be freed, like dirty or pinned entries.
+ */
+class FakeTenant : public MemoryTenant {
+public:
+    FakeTenant(std::string name, size_t usage, size_t softQuota = 0, size_t pinned = 0)
+        : name_(std::move(name)), usage_(usage), softQuota_(softQuota), pinned_(pinned) {}
+
+    const std::string& TenantName() const override { return name_; }
+
+    size_t MemoryUsage() override { return usage_.load(); }
+
+    size_t SoftQuota() const override { return softQuota_; }
+
+    size_t Reclaim(size_t bytes) override {
+        size_t usage = usage_.load();
+        size_t freed = std::min(bytes, usage > pinned_ ? usage - pinned_ : 0);
+        usage_ -= freed;
+        reclaimed_ += freed;
+        return freed;
+    }
+
+    size_t Reclaimed() const { return reclaimed_.load(); }
+
+private:
+    std::string name_;
+    std::atomic<size_t> usage_;
+    size_t softQuota_;
+    size_t pinned_;
+    std::atomic<size_t> reclaimed_{0};
+};
+
+/**
+ * @brief Register tenants with the governor for the lifetime of a check.
+ */
+class Registration {
+public:
+    explicit Registration(std::vector<FakeTenant*> tenants) : tenants_(std::move(tenants)) {
+        MemoryGovernor::Instance().Configure(MG_LIMIT, MG_HIGH_WATERMARK, MG_LOW_WATERMARK);
+        for (auto* tenant : tenants_) {
+            MemoryGovernor::Instance().Register(tenant);
+        }
+    }
+
+    ~Registration() {
+        for (auto* tenant : tenants_) {
+            MemoryGovernor::Instance().Unregister(tenant);
+        }
+        MemoryGovernor::Instance().Configure(0);
+    }
+
+private:
+    std::vector<FakeTenant*> tenants_;
+};
+
+/**
+ * @brief Report growth until the governor has checked usage once, then wait for its reclaim pass.
+ *
+ * @return True if a reclaim pass finished within a second.
+ */
+bool runReclaimPass(FakeTenant& grower) {
+    uint64_t before = MemoryGovernor::Instance().Reclaimed();
+    // One in every 64 growth events sums usage; 64 events contain exactly one.
+    for (int i = 0; i < 64; ++i) {
+        MemoryGovernor::Instance().OnGrowth(&grower);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (MemoryGovernor::Instance().Reclaimed() == before) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/**
+ * @brief Check that soft quotas are fair shares and unquoted tenants split the rest equally.
+ *
+ * @return True if the shares match, including an unquoted tenant getting nothing under overcommitted quotas.
+ */
+bool sharesFollowQuotas() {
+    bool ok;
+    {
+        FakeTenant quoted("quoted", 0, 400), first("first", 0), second("second", 0);
+        Registration registration({&quoted, &first, &second});
+        auto& governor = MemoryGovernor::Instance();
+        ok = governor.FairShare(&quoted) == 400 && governor.FairShare(&first) == 300 &&
+             governor.FairShare(&second) == 300;
+        auto snapshot = governor.Snapshot();
+        ok = snapshot.size() == 3 && snapshot[0].name == "quoted" && snapshot[0].share == 400 &&
+             snapshot[2].share == 300 && ok;
+    }
+    {
+        FakeTenant big("big", 0, 700), bigger("bigger", 0, 600), unquoted("unquoted", 0);
+        Registration registration({&big, &bigger, &unquoted});
+        ok = MemoryGovernor::Instance().FairShare(&bigger) == 600 &&
+             MemoryGovernor::Instance().FairShare(&unquoted) == 0 && ok;
+    }
+    ok = MemoryGovernor::Instance().FairShare(nullptr) == 0 && ok;
+    std::cout << "Soft quotas reserved, the rest split equally: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that a reclaim pass frees bytes only from tenants above their share, by overage.
+ *
+ * @return True if the pass freed down to the low watermark, split by overage, and spared the tenant within its share.
+ */
+bool reclaimFollowsOverage() {
+    // Shares of the 800-byte target are 266 each; overages are 234, 34 and 0.
+    FakeTenant bursty("bursty", 500), steady("steady", 300), small("small", 150);
+    bool ok;
+    {
+        Registration registration({&bursty, &steady, &small});
+        ok = runReclaimPass(bursty);
+    }
+    size_t target = static_cast<size_t>(MG_LOW_WATERMARK * MG_LIMIT);
+    size_t need = 950 - target;
+    size_t share = target / 3;
+    size_t over = (500 - share) + (300 - share);
+    size_t expectBursty = static_cast<size_t>(static_cast<double>(need) * (500 - share) / over);
+    size_t expectSteady = static_cast<size_t>(static_cast<double>(need) * (300 - share) / over);
+    std::cout << "Reclaimed from bursty: " << bursty.Reclaimed() << ", steady: " << steady.Reclaimed()
+              << ", small: " << small.Reclaimed() << " (need " << need << ")\n";
+    ok = bursty.Reclaimed() == expectBursty && steady.Reclaimed() == expectSteady && small.Reclaimed() == 0 && ok;
+    ok = need - (bursty.Reclaimed() + steady.Reclaimed()) <= 2 && ok;
+    std::cout << "Reclaim proportional to overage: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that what an over-share tenant cannot free is taken from the other over-share tenants only.
+ *
+ * @return True if the other over-share tenant gave up its whole overage and the tenant within its share nothing.
+ */
+bool reclaimShortfallStaysOverShare() {
+    // Shares of the 800-byte target are 266 each; "pinned" is asked for 130
+    // but can free only 20, "steady" covers that up to its own overage of 34.
+    FakeTenant pinned("pinned", 500, 0, 480), steady("steady", 300), small("small", 150);
+    bool ok;
+    {
+        Registration registration({&pinned, &steady, &small});
+        ok = runReclaimPass(steady);
+    }
+    size_t share = static_cast<size_t>(MG_LOW_WATERMARK * MG_LIMIT) / 3;
+    std::cout << "Reclaimed from pinned: " << pinned.Reclaimed() << ", steady: " << steady.Reclaimed()
+              << ", small: " << small.Reclaimed() << "\n";
+    ok = pinned.Reclaimed() == 20 && steady.Reclaimed() == 300 - share && small.Reclaimed() == 0 && ok;
+    std::cout << "Shortfall split among over-share tenants only: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that with no tenant above its share, a reclaim pass takes from everyone by size.
+ *
+ * @return True if both tenants within their (overcommitted) quotas gave up bytes in proportion to usage.
+ */
+bool reclaimFallsBackBySize() {
+    // Quotas of 600 each exceed the 800-byte target, so neither tenant is above its share.
+    FakeTenant larger("larger", 560, 600), smaller("smaller", 380, 600);
+    bool ok;
+    {
+        Registration registration({&larger, &smaller});
+        ok = runReclaimPass(smaller);
+    }
+    size_t need = 940 - static_cast<size_t>(MG_LOW_WATERMARK * MG_LIMIT);
+    size_t expectLarger = static_cast<size_t>(static_cast<double>(need) * 560 / 940);
+    size_t expectSmaller = static_cast<size_t>(static_cast<double>(need) * 380 / 940);
+    std::cout << "Reclaimed from larger: " << larger.Reclaimed() << ", smaller: " << smaller.Reclaimed()
+              << " (need " << need << ")\n";
+    ok = larger.Reclaimed() == expectLarger && smaller.Reclaimed() == expectSmaller && ok;
+    std::cout << "Overcommitted quotas reclaimed by size: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check fair shares and reclaim passes of the memory governor.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testMemoryGovernor() {
+    std::cout << "=== Memory Governor ===\n";
+    bool ok = sharesFollowQuotas();
+    ok = reclaimFollowsOverage() && ok;
+    ok = reclaimShortfallStaysOverShare() && ok;
+    ok = reclaimFallsBackBySize() && ok;
+    std::cout << "\n";
+    return ok ? 0 : 1;
+}
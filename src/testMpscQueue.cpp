@@ -0,0 +1,109 @@
+// testMpscQueue.cpp
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../include/MpscQueue.h"
+
+// Workload parameters
+const int MPSC_PRODUCERS = 8;
+const int MPSC_ITEMS_PER_PRODUCER = 200000;
+
+/**
+ * @brief Check that concurrent producers lose nothing and keep their own order.
+ *
+ * Each producer pushes (producer, sequence) pairs while one consumer pops
+ * concurrently. Across producers the order is arbitrary, but each
+ * producer's elements must come out in the order it pushed them, each
+ * exactly once.
+ *
+ * @return True if every element arrived once, in per-producer order.
+ */
+bool producersKeepOrder() {
+    MpscQueue<std::pair<int, int64_t>> queue;
+    std::vector<int64_t> next(MPSC_PRODUCERS, 0);
+    const int64_t expected = static_cast<int64_t>(MPSC_PRODUCERS) * MPSC_ITEMS_PER_PRODUCER;
+    int64_t popped = 0;
+    int64_t outOfOrder = 0;
+    int64_t emptyPolls = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (int p = 0; p < MPSC_PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int64_t i = 0; i < MPSC_ITEMS_PER_PRODUCER; ++i) {
+                queue.push({p, i});
+            }
+        });
+    }
+    // A push that is half done hides the pushes behind it for a moment, so
+    // an empty pop() only means "not yet".
+    std::pair<int, int64_t> item;
+    while (popped < expected) {
+        if (!queue.pop(item)) {
+            ++emptyPolls;
+            std::this_thread::yield();
+            continue;
+        }
+        ++popped;
+        if (item.first < 0 || item.first >= MPSC_PRODUCERS || item.second != next[item.first]) {
+            ++outOfOrder;
+            continue;
+        }
+        ++next[item.first];
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    bool drained = !queue.pop(item);
+
+    std::cout << MPSC_PRODUCERS << " producers x " << MPSC_ITEMS_PER_PRODUCER << " pushes: popped " << popped
+              << ", out of order " << outOfOrder << ", empty polls " << emptyPolls << ", "
+              << elapsed.count() << " ms (" << static_cast<double>(popped) / elapsed.count() / 1000.0
+              << " M items/s)\n";
+    bool complete = drained && outOfOrder == 0;
+    for (int p = 0; p < MPSC_PRODUCERS; ++p) {
+        complete = complete && next[p] == MPSC_ITEMS_PER_PRODUCER;
+    }
+    return complete;
+}
+
+/**
+ * @brief Check that pop() hands out elements in push order on a single thread, and the destructor frees what is left.
+ *
+ * @return True if the elements came out in order.
+ */
+bool singleThreadFifo() {
+    bool ok = true;
+    int value = -1;
+    {
+        MpscQueue<int> queue;
+        ok = !queue.pop(value);
+        for (int i = 0; i < 100; ++i) {
+            queue.push(i);
+        }
+        for (int i = 0; i < 50; ++i) {
+            ok = queue.pop(value) && value == i && ok;
+        }
+        // 50 elements left for the destructor.
+    }
+    std::cout << "Single-thread FIFO: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check the ordering and completeness guarantees of MpscQueue.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testMpscQueue() {
+    std::cout << "=== MPSC Queue ===\n";
+    bool ok = singleThreadFifo();
+    ok = producersKeepOrder() && ok;
+    std::cout << "\n";
+    return ok ? 0 : 1;
+}
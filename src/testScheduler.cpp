@@ -0,0 +1,212 @@
+// testScheduler.cpp
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/keyedqueue.h"
+#include "../include/taskscheduler.h"
+
+// Workload parameters
+const int SCHED_SUBMITTERS = 4;
+const int SCHED_TASKS_PER_SUBMITTER = 50000;
+const int SCHED_KEYS = 16;               // keys written by the keyed-order check
+const int SCHED_WRITES_PER_KEY = 2000;   // writes of each key, submitted from a worker
+const auto SCHED_TIMER_DELAY = std::chrono::seconds(30);  // delay of the timers pending at shutdown
+
+/**
+ * @brief Check that a foreground task runs while background work holds every slot it may take.
+ *
+ * Even a scheduler asked for one worker keeps a worker free of background
+ * work, so a loader call is never stuck behind refreshes.
+ *
+ * @return True if the foreground task ran while the background tasks were blocked.
+ */
+bool foregroundNotStarved() {
+    TaskScheduler scheduler(1);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    for (size_t i = 0; i < scheduler.WorkerCount(); ++i) {
+        scheduler.Submit([released] { released.wait(); }, TaskPriority::BACKGROUND);
+    }
+    auto foreground = scheduler.Async([] { return 1; });
+    bool ran = foreground.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+    release.set_value();
+    std::cout << "Workers for a request of 1: " << scheduler.WorkerCount()
+              << ", foreground ran behind blocked background work: " << (ran ? "yes" : "no") << "\n";
+    return scheduler.WorkerCount() >= 2 && ran;
+}
+
+/**
+ * @brief Check that no task is lost when submissions race with Shutdown().
+ *
+ * @return True if every submitted task ran exactly once.
+ */
+bool noTaskLostAtShutdown() {
+    std::atomic<long> ran{0};
+    auto scheduler = std::make_unique<TaskScheduler>(4);
+    std::vector<std::thread> submitters;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < SCHED_SUBMITTERS; ++t) {
+        submitters.emplace_back([&scheduler, &ran, t] {
+            for (int i = 0; i < SCHED_TASKS_PER_SUBMITTER; ++i) {
+                scheduler->Submit([&ran] { ran++; },
+                                  i % 2 == t % 2 ? TaskPriority::FOREGROUND : TaskPriority::BACKGROUND);
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    scheduler->Shutdown();
+    for (auto& submitter : submitters) {
+        submitter.join();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    long expected = static_cast<long>(SCHED_SUBMITTERS) * SCHED_TASKS_PER_SUBMITTER;
+    std::cout << "Tasks submitted across Shutdown(): " << expected << ", ran: " << ran.load() << " ("
+              << elapsed.count() << " ms)\n";
+    return ran.load() == expected;
+}
+
+/**
+ * @brief Count, per key, tasks that ran before a task of the same key submitted earlier.
+ *
+ * Writes are submitted from inside a worker, where plain Submit() goes to
+ * the worker's own deque and is popped LIFO, like the replications a
+ * request handler running on a worker queues.
+ *
+ * @param keyed Submit through a KeyedQueue instead of straight to the scheduler.
+ * @return Tasks that ran out of order.
+ */
+long writesOutOfOrder(bool keyed) {
+    TaskScheduler scheduler(4);
+    long outOfOrder = 0;
+    {
+        KeyedQueue queue(scheduler);
+        std::mutex mtx;
+        std::vector<int> last(SCHED_KEYS, -1);
+        std::atomic<long> ran{0};
+        auto apply = [&](int key, int seq) {
+            std::lock_guard<std::mutex> lock(mtx);
+            outOfOrder += seq < last[key];
+            last[key] = std::max(last[key], seq);
+            ran++;
+        };
+        scheduler.Async([&] {
+            for (int seq = 0; seq < SCHED_WRITES_PER_KEY; ++seq) {
+                for (int key = 0; key < SCHED_KEYS; ++key) {
+                    if (keyed) {
+                        queue.Submit("key" + std::to_string(key), [&apply, key, seq] { apply(key, seq); });
+                    } else {
+                        scheduler.Submit([&apply, key, seq] { apply(key, seq); }, TaskPriority::BACKGROUND);
+                    }
+                }
+            }
+        }).get();
+        while (ran.load() < static_cast<long>(SCHED_KEYS) * SCHED_WRITES_PER_KEY) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    scheduler.Shutdown();
+    return outOfOrder;
+}
+
+/**
+ * @brief Check that a KeyedQueue runs each key's tasks in submission order.
+ *
+ * @return True if no keyed task ran before an earlier task of its key.
+ */
+bool keyedTasksInOrder() {
+    long plain = writesOutOfOrder(false);
+    long keyed = writesOutOfOrder(true);
+    std::cout << SCHED_KEYS << " keys x " << SCHED_WRITES_PER_KEY << " writes submitted from a worker, out of order: "
+              << plain << " through Submit(), " << keyed << " through KeyedQueue\n";
+    return keyed == 0;
+}
+
+/**
+ * @brief Check that a KeyedQueue task finishing on a timer holds its key's lane but no worker.
+ *
+ * A scheduler of two workers runs one background task at a time, so a
+ * waiting task that parked its worker would hold up every other key.
+ *
+ * @return True if another key ran while the task waited, and its own key's next task only after it.
+ */
+bool suspendedTaskHoldsNoWorker() {
+    TaskScheduler scheduler(2);
+    std::atomic<bool> finished{false};
+    std::atomic<bool> nextAfter{false};
+    std::promise<void> otherRan;
+    std::promise<void> nextRan;
+    {
+        KeyedQueue queue(scheduler);
+        queue.SubmitAsync("a", [&scheduler, &finished](KeyedQueue::Task done) {
+            scheduler.ScheduleAfter(std::chrono::milliseconds(300), [&finished, done] {
+                finished = true;
+                done();
+            });
+        });
+        queue.Submit("a", [&finished, &nextAfter, &nextRan] {
+            nextAfter = finished.load();
+            nextRan.set_value();
+        });
+        auto start = std::chrono::steady_clock::now();
+        queue.Submit("b", [&otherRan] { otherRan.set_value(); });
+        bool other = otherRan.get_future().wait_for(std::chrono::milliseconds(200)) == std::future_status::ready;
+        std::chrono::duration<double, std::milli> waited = std::chrono::steady_clock::now() - start;
+        bool next = nextRan.get_future().wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+        std::cout << "Other key ran while a keyed task waited 300 ms: " << (other ? "yes" : "no") << " ("
+                  << waited.count() << " ms), same key ran after it: " << (next && nextAfter ? "yes" : "no")
+                  << "\n";
+        if (!other || !next || !nextAfter) {
+            return false;
+        }
+    }
+    scheduler.Shutdown();
+    return true;
+}
+
+/**
+ * @brief Check that timers pending at Shutdown(), and their follow-ups, run instead of being dropped.
+ *
+ * A tracked task stands for a replication retry: its object waits for it,
+ * and the retry it schedules after shutdown still runs.
+ *
+ * @return True if both timers ran early, Shutdown() did not wait for them to be due, and the tracker drained.
+ */
+bool timersRunAtShutdown() {
+    TaskScheduler scheduler(2);
+    TaskTracker tracker;
+    std::atomic<int> ran{0};
+    scheduler.ScheduleAfter(SCHED_TIMER_DELAY, [&scheduler, &ran, token = tracker.Hold()] {
+        ran++;
+        scheduler.ScheduleAfter(SCHED_TIMER_DELAY, [&ran, token] { ran++; });
+    });
+    auto start = std::chrono::steady_clock::now();
+    scheduler.Shutdown();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    tracker.Wait();
+    bool ok = ran.load() == 2 && elapsed < SCHED_TIMER_DELAY;
+    std::cout << "Timers pending at shutdown that ran: " << ran.load() << "/2 (" << elapsed.count() << " ms)\n";
+    return ok;
+}
+
+/**
+ * @brief Check the TaskScheduler's foreground guarantee and shutdown behaviour.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testScheduler() {
+    std::cout << "=== Task Scheduler ===\n";
+    bool ok = foregroundNotStarved();
+    ok = noTaskLostAtShutdown() && ok;
+    ok = keyedTasksInOrder() && ok;
+    ok = suspendedTaskHoldsNoWorker() && ok;
+    ok = timersRunAtShutdown() && ok;
+    std::cout << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// testShards.cpp
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include "../include/Lru.h"
+#include "../include/ShardsSampler.h"
+
+// Workload parameters
+const int SHARDS_KEY_RANGE = 100000;
+const int SHARDS_OPS = 2000000;
+const double SHARDS_ZIPF_S = 0.9;
+const int SHARDS_CAPACITY = 5000;
+
+/**
+ * @brief Build a Zipf-distributed stream of string keys.
+ *
+ * @return The key sequence.
+ */
+std::vector<std::string> makeZipfKeys() {
+    std::vector<double> weights(SHARDS_KEY_RANGE);
+    for (int i = 0; i < SHARDS_KEY_RANGE; ++i) {
+        weights[i] = 1.0 / std::pow(i + 1, SHARDS_ZIPF_S);
+    }
+    std::discrete_distribution<int> zipf(weights.begin(), weights.end());
+    std::mt19937 gen(5);
+    std::vector<std::string> keys(SHARDS_OPS);
+    for (auto& key : keys) {
+        key = "key" + std::to_string(zipf(gen));
+    }
+    return keys;
+}
+
+/**
+ * @brief Exact LRU miss ratio of a stream at a given capacity.
+ *
+ * @param keys The key sequence.
+ * @param capacity The cache capacity.
+ * @return The miss ratio.
+ */
+double exactMissRatio(const std::vector<std::string>& keys, int capacity) {
+    Lru<std::string, int, NoLock> lru(capacity);
+    int misses = 0;
+    for (const auto& key : keys) {
+        if (lru.get(key) == 0) {
+            ++misses;
+            lru.put(key, 1);
+        }
+    }
+    return static_cast<double>(misses) / keys.size();
+}
+
+/**
+ * @brief Compare the SHARDS miss-ratio curve with exact LRU simulation.
+ *
+ * The sampler sees the whole stream at a 1% rate capped at 8192 tracked keys;
+ * its curve around SHARDS_CAPACITY is checked against full Lru runs at the
+ * same capacities.
+ *
+ * @return 0 on successful completion, 1 if an estimate is off by more than 0.08.
+ */
+int testShards() {
+    std::cout << "=== SHARDS Miss-Ratio Curve (" << SHARDS_OPS << " Zipf accesses) ===\n";
+    auto keys = makeZipfKeys();
+
+    ShardsSampler sampler(0.01, 8192, SHARDS_OPS);
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& key : keys) {
+        sampler.access(key);
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed = end - start;
+    std::cout << "sampling cost: " << elapsed.count() / keys.size() << " ns/access, rate " << sampler.rate()
+              << ", working set ~" << sampler.workingSetSize() << " keys\n";
+
+    int result = 0;
+    for (const auto& point : sampler.missRatioCurve(SHARDS_CAPACITY)) {
+        if (point.capacity == 0) continue;
+        double exact = exactMissRatio(keys, static_cast<int>(point.capacity));
+        std::cout << "capacity " << point.capacity << ": estimated " << point.missRatio << ", exact " << exact << "\n";
+        if (std::abs(point.missRatio - exact) > 0.08) {
+            result = 1;
+        }
+    }
+    std::cout << "\n";
+    return result;
+}
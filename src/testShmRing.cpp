@@ -0,0 +1,165 @@
+// testShmRing.cpp
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "../include/shmring.h"
+
+// Workload parameters
+const uint64_t SHMRING_MESSAGES = 500000;   // messages streamed between two threads
+const size_t SHMRING_MAX_SIZE = 3000;       // largest streamed message
+
+/**
+ * @brief The bytes of message `seq`, of a size that varies with it.
+ */
+std::string ringMessage(uint64_t seq, size_t size) {
+    std::string bytes(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<char>((seq * 31 + i) & 0xff);
+    }
+    return bytes;
+}
+
+/**
+ * @brief A ring on the heap, initialized as the segment creator does.
+ */
+std::unique_ptr<ShmRing> newRing() {
+    auto ring = std::make_unique<ShmRing>();
+    ring->Init();
+    return ring;
+}
+
+/**
+ * @brief Check messages whose length prefix or payload wraps around the end of the buffer.
+ *
+ * @return True if every message came back unchanged and a full ring refused a push.
+ */
+bool wrapsAroundTheEnd() {
+    auto ring = newRing();
+    std::string out;
+    bool ok = true;
+
+    // Leave 2 bytes before the end, so the next length prefix is split.
+    std::string filler(ShmRing::kBytes - sizeof(uint32_t) - 2, 'f');
+    std::string_view parts[] = {filler};
+    ok = ring->Push(parts) && ring->Pop(out) && out == filler && ok;
+    std::string split = ringMessage(1, 100);
+    std::string_view splitParts[] = {std::string_view(split).substr(0, 40), std::string_view(split).substr(40)};
+    ok = ring->Push(splitParts) && ring->Pop(out) && out == split && ok;
+
+    // Now a payload that starts just before the end and continues at the front.
+    uint64_t offset = ring->tail.load() & (ShmRing::kBytes - 1);
+    std::string pad(ShmRing::kBytes - offset - sizeof(uint32_t) - 10, 'p');
+    std::string_view padParts[] = {pad};
+    ok = ring->Push(padParts) && ring->Pop(out) && out == pad && ok;
+    std::string across = ringMessage(2, 5000);
+    std::string_view acrossParts[] = {across};
+    ok = ring->Push(acrossParts) && ring->Pop(out) && out == across && ok;
+
+    // A full ring refuses a push until the consumer frees room; the largest message fits an empty one.
+    std::string largest = ringMessage(3, ShmRing::kMaxMessage);
+    std::string_view largestParts[] = {largest};
+    ok = ring->Push(largestParts) && ok;
+    std::string small = "x";
+    std::string_view smallParts[] = {small};
+    bool refused = !ring->Push(smallParts);
+    ok = refused && ring->Pop(out) && out == largest && ok;
+    ok = ring->Push(smallParts) && ring->Pop(out) && out == small && !ring->Pop(out) && ok;
+    std::string tooLarge(ShmRing::kMaxMessage + 1, 'x');
+    std::string_view tooLargeParts[] = {tooLarge};
+    ok = !ring->Push(tooLargeParts) && ok;
+
+    std::cout << "Split length prefix, wrapped payload and full ring: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that a length prefix overrunning what the producer wrote is rejected and its slot dropped.
+ *
+ * @return True if corrupt lengths popped nothing, emptied the ring, and the ring worked afterwards.
+ */
+bool rejectsCorruptLength() {
+    auto ring = newRing();
+    std::string out = "untouched";
+    std::string body = ringMessage(4, 64);
+    std::string_view parts[] = {body};
+    bool ok = true;
+    // Lengths past the bytes produced, and past the largest message, as a misbehaving client might write.
+    for (uint32_t length : {static_cast<uint32_t>(body.size() + 1), static_cast<uint32_t>(ShmRing::kMaxMessage + 1),
+                            UINT32_MAX}) {
+        uint64_t start = ring->tail.load();
+        ok = ring->Push(parts) && ok;
+        std::memcpy(ring->data + (start & (ShmRing::kBytes - 1)), &length, sizeof(length));
+        ok = !ring->Pop(out) && out == "untouched" && ring->head.load() == ring->tail.load() && ok;
+    }
+    // A tail that stops inside the length prefix.
+    ring->tail.store(ring->tail.load() + 2);
+    ok = !ring->Pop(out) && ring->head.load() == ring->tail.load() && ok;
+    ok = ring->Push(parts) && ring->Pop(out) && out == body && ok;
+    std::cout << "Corrupt length prefixes rejected and dropped: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Stream messages of varying sizes between a producer and a consumer thread through many wraparounds.
+ *
+ * @return True if every message arrived once, in order and unchanged.
+ */
+bool streamsThroughWraparounds() {
+    auto ring = newRing();
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&ring] {
+        for (uint64_t seq = 0; seq < SHMRING_MESSAGES; ++seq) {
+            std::string header(reinterpret_cast<const char*>(&seq), sizeof(seq));
+            std::string body = ringMessage(seq, seq * 7919 % SHMRING_MAX_SIZE);
+            std::string_view parts[] = {header, body};
+            while (!ring->Push(parts)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint64_t received = 0;
+    uint64_t corrupt = 0;
+    std::string message;
+    while (received < SHMRING_MESSAGES) {
+        if (!ring->Pop(message)) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t seq = 0;
+        if (message.size() >= sizeof(seq)) {
+            std::memcpy(&seq, message.data(), sizeof(seq));
+        }
+        if (message.size() < sizeof(seq) || seq != received ||
+            message.compare(sizeof(seq), std::string::npos, ringMessage(seq, seq * 7919 % SHMRING_MAX_SIZE)) != 0) {
+            ++corrupt;
+        }
+        ++received;
+    }
+    producer.join();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t wraps = ring->tail.load() / ShmRing::kBytes;
+    bool drained = !ring->Pop(message);
+    std::cout << SHMRING_MESSAGES << " messages through " << wraps << " wraparounds: " << corrupt
+              << " out of order or corrupt, " << elapsed.count() << " ms\n";
+    return corrupt == 0 && drained && wraps > 10;
+}
+
+/**
+ * @brief Check the shared-memory ring across the end of its buffer.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testShmRing() {
+    std::cout << "=== Shared-Memory Ring ===\n";
+    bool ok = wrapsAroundTheEnd();
+    ok = rejectsCorruptLength() && ok;
+    ok = streamsThroughWraparounds() && ok;
+    std::cout << "\n";
+    return ok ? 0 : 1;
+}
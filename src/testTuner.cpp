@@ -0,0 +1,161 @@
+// testTuner.cpp
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "../include/CachePolicy.h"
+#include "../include/readsections.h"
+#include "../include/taskscheduler.h"
+
+// Workload parameters
+const int TUNER_CAPACITY = 20000;
+const int TUNER_HOT_KEYS = 15000;
+const int TUNER_SCAN_KEYS = 200000;
+const int TUNER_OPS = 4000000;
+const double TUNER_MAX_OVERHEAD = 5;   // request-path time over the static chosen policy, in percent
+const int TUNER_RUNS = 3;              // runs per timed configuration; the fastest counts
+
+/**
+ * @brief Hot set interleaved with long one-off scans.
+ *
+ * Half of the accesses go to a hot set that fits the cache, the other half
+ * walk a key range ten times the cache size. Scans flush an LRU cache, while
+ * policies that require repeated accesses (LRU-K, LFU, ARC) keep the hot set.
+ *
+ * @return The key sequence.
+ */
+std::vector<std::string> makeScanKeys() {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> hot(0, TUNER_HOT_KEYS - 1);
+    std::vector<std::string> keys(TUNER_OPS);
+    int scan = 0;
+    for (int i = 0; i < TUNER_OPS; ++i) {
+        if (i % 2 == 0) {
+            keys[i] = "hot" + std::to_string(hot(gen));
+        } else {
+            keys[i] = "scan" + std::to_string(scan++ % TUNER_SCAN_KEYS);
+        }
+    }
+    return keys;
+}
+
+/**
+ * @brief CPU time of the calling thread in ms, which background drains on a shared core do not add to.
+ */
+double threadCpuMs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Serve a key stream from a cache, optionally letting a tuner switch its policy.
+ *
+ * The request path is CacheGroup's: the live cache is published as a raw
+ * pointer read inside a ReadSections section, requests only record()
+ * accesses, and drains, switches and the freeing of a replaced cache run on
+ * a scheduler's background lane. A switch starts the new policy empty (minus
+ * CacheGroup's migration of entries from the previous cache).
+ *
+ * @param keys The key sequence.
+ * @param initial The starting policy.
+ * @param tune Whether to follow the tuner's recommendations.
+ * @param final Output parameter for the policy live at the end.
+ * @param elapsed Output parameter for the request thread's CPU time, in ms.
+ * @return The hit ratio over the whole stream.
+ */
+double serve(const std::vector<std::string>& keys, const PolicySpec& initial, bool tune, PolicySpec& final,
+             double& elapsed) {
+    TaskScheduler scheduler(2);
+    ReadSections reads;
+    std::atomic<Cache<std::string, int>*> live{makeCache<std::string, int>(initial).release()};
+    PolicyTuner tuner(initial);
+    std::mutex policyMutex;
+    final = initial;
+    auto drain = [&] {
+        PolicySpec next;
+        if (!tuner.drain() || !tuner.recommendation(next)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(policyMutex);
+        std::cout << "  switch " << final.name() << " -> " << next.name() << "\n";
+        Cache<std::string, int>* replaced = live.exchange(makeCache<std::string, int>(next).release());
+        tuner.switched(next);
+        final = next;
+        reads.Synchronize();
+        delete replaced;
+    };
+    size_t hits = 0;
+    int value = 0;
+    double start = threadCpuMs();
+    for (const auto& key : keys) {
+        {
+            auto reading = reads.Enter();
+            Cache<std::string, int>* cache = live.load();
+            if (cache->get(key, value)) {
+                ++hits;
+            } else {
+                cache->put(key, 1);
+            }
+        }
+        if (tune && tuner.record(key)) {
+            scheduler.Submit(drain, TaskPriority::BACKGROUND);
+        }
+    }
+    elapsed = threadCpuMs() - start;
+    scheduler.Shutdown();
+    delete live.load();
+    return static_cast<double>(hits) / keys.size();
+}
+
+/**
+ * @brief Check that the tuner moves a scan-polluted LRU cache to a scan-resistant policy.
+ *
+ * The same stream is served by a static LRU cache, by one that follows
+ * the tuner, and by a static cache of the policy the tuner ended on. Tuning
+ * overhead is the difference in request-path CPU time between the last two,
+ * each the fastest of TUNER_RUNS runs; it includes the tuned run's time on
+ * LRU before the switch.
+ *
+ * @return 0 on successful completion, 1 if the tuner kept LRU, lost hit ratio or slowed requests down.
+ */
+int testTuner() {
+    std::cout << "=== Policy Auto-Tuning (" << TUNER_OPS << " accesses, hot set + scans) ===\n";
+    auto keys = makeScanKeys();
+    PolicySpec lru;
+    lru.capacity = TUNER_CAPACITY;
+
+    PolicySpec final;
+    double staticTime = 0;
+    double staticRatio = serve(keys, lru, false, final, staticTime);
+    double tunedTime = 0;
+    double tunedRatio = serve(keys, lru, true, final, tunedTime);
+    PolicySpec chosen;
+    double chosenTime = 0;
+    double chosenRatio = serve(keys, final, false, chosen, chosenTime);
+    for (int run = 1; run < TUNER_RUNS; ++run) {
+        double time = 0;
+        PolicySpec ignored;
+        serve(keys, lru, true, ignored, time);
+        tunedTime = std::min(tunedTime, time);
+        serve(keys, final, false, ignored, time);
+        chosenTime = std::min(chosenTime, time);
+    }
+    double overhead = (tunedTime / chosenTime - 1) * 100;
+
+    std::cout << "static lru: hit ratio " << staticRatio << ", " << staticTime << " ms\n";
+    std::cout << "auto-tuned: hit ratio " << tunedRatio << ", " << tunedTime << " ms, ended on "
+              << final.name() << "\n";
+    std::cout << "static " << chosen.name() << ": hit ratio " << chosenRatio << ", " << chosenTime
+              << " ms (tuning overhead on the request path " << overhead << "%)\n\n";
+    if (final.kind == PolicyKind::LRU || tunedRatio <= staticRatio || overhead > TUNER_MAX_OVERHEAD) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,283 @@
+// testWriteBehind.cpp
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/leasetable.h"
+#include "../include/writebehind.h"
+
+// Workload parameters
+const int WB_HOT_WRITES = 10000;        // writes of the same key before one flush
+const int WB_BATCH_SIZE = 4;            // batch size of the size-triggered flush check
+const int WB_RACERS = 4;                // threads setting the same key at once
+const int WB_RACE_ROUNDS = 500;         // rounds of racing sets
+
+/**
+ * @brief Backing store stand-in that records every batch it is handed.
+ */
+struct RecordingStore {
+    std::mutex mtx;
+    std::vector<WriteBehind<int>::Batch> batches;
+    std::map<std::string, std::optional<int>> rows;
+
+    bool Write(const WriteBehind<int>::Batch& batch) {
+        std::lock_guard<std::mutex> lock(mtx);
+        batches.push_back(batch);
+        for (auto& [key, value] : batch) {
+            rows[key] = value;
+        }
+        return true;
+    }
+
+    size_t BatchCount() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return batches.size();
+    }
+};
+
+/**
+ * @brief Wait up to a second for a condition.
+ */
+template<typename Predicate>
+bool waitFor(Predicate done) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/**
+ * @brief Check that repeated writes of a key cost one store write, with the latest value.
+ *
+ * @return True if the flush wrote each key once with its last write, deletions included.
+ */
+bool writesCoalesce() {
+    TaskScheduler scheduler(2);
+    RecordingStore store;
+    WriteBehindOptions options;
+    options.interval = std::chrono::hours(1);
+    options.batchSize = 1000;
+    bool ok;
+    {
+        WriteBehind<int> buffer([&store](const auto& batch) { return store.Write(batch); }, options, scheduler);
+        for (int i = 0; i < WB_HOT_WRITES; ++i) {
+            buffer.Mark("hot", i);
+        }
+        buffer.Mark("gone", 1);
+        buffer.Mark("gone", std::nullopt);
+        std::optional<int> pending;
+        ok = buffer.Pending("hot", pending) && pending == WB_HOT_WRITES - 1;
+        ok = buffer.Pending("gone", pending) && !pending && ok;
+        ok = buffer.Flush() && ok;
+        WriteBehindStats stats = buffer.GetStats();
+        std::cout << "Writes: " << stats.writes << ", keys flushed: " << stats.flushedKeys << ", batches: "
+                  << stats.batches << ", write amplification: "
+                  << static_cast<double>(stats.flushedKeys) / static_cast<double>(stats.writes) << "\n";
+        ok = stats.writes == WB_HOT_WRITES + 2 && stats.flushedKeys == 2 && stats.batches == 1 &&
+             stats.dirtyKeys == 0 && ok;
+        ok = store.batches.size() == 1 && store.rows["hot"] == WB_HOT_WRITES - 1 && !store.rows["gone"] && ok;
+        ok = !buffer.Pending("hot", pending) && ok;
+        scheduler.Shutdown();
+    }
+    std::cout << "Repeated writes coalesced into one store write each: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that a full buffer and the interval both flush without an explicit Flush().
+ *
+ * @return True if batchSize dirty keys were flushed in one batch, and a lone write by the timer.
+ */
+bool flushTriggers() {
+    TaskScheduler scheduler(2);
+    RecordingStore store;
+    WriteBehindOptions options;
+    options.interval = std::chrono::milliseconds(200);
+    options.batchSize = WB_BATCH_SIZE;
+    bool full, timed;
+    {
+        WriteBehind<int> buffer([&store](const auto& batch) { return store.Write(batch); }, options, scheduler);
+        for (int i = 0; i < WB_BATCH_SIZE; ++i) {
+            buffer.Mark("key" + std::to_string(i), i);
+        }
+        full = waitFor([&] { return store.BatchCount() >= 1; });
+        {
+            std::lock_guard<std::mutex> lock(store.mtx);
+            full = full && store.batches[0].size() == WB_BATCH_SIZE;
+        }
+        buffer.Mark("lone", 1);
+        timed = waitFor([&] { return buffer.GetStats().dirtyKeys == 0; });
+        {
+            std::lock_guard<std::mutex> lock(store.mtx);
+            timed = timed && store.rows.count("lone") == 1;
+        }
+        scheduler.Shutdown();
+    }
+    std::cout << "Flushed when " << WB_BATCH_SIZE << " keys were dirty: " << (full ? "yes" : "no")
+              << ", flushed a lone write after the interval: " << (timed ? "yes" : "no") << "\n";
+    return full && timed;
+}
+
+/**
+ * @brief Check that a failed batch is retried without overwriting a newer write of its keys.
+ *
+ * The writer fails its first call after the key was written again, as a
+ * client write racing with a flush would.
+ *
+ * @return True if the in-flight value stayed visible to Pending() and the retry wrote the newer value.
+ */
+bool failedBatchRequeued() {
+    TaskScheduler scheduler(2);
+    RecordingStore store;
+    WriteBehindOptions options;
+    options.interval = std::chrono::hours(1);
+    WriteBehind<int>* self = nullptr;
+    bool sawInflight = false;
+    int calls = 0;
+    bool ok;
+    {
+        WriteBehind<int> buffer([&](const auto& batch) {
+            if (calls++ > 0) {
+                return store.Write(batch);
+            }
+            std::optional<int> pending;
+            sawInflight = self->Pending("k", pending) && pending == 1;
+            self->Mark("k", 2);
+            return false;
+        }, options, scheduler);
+        self = &buffer;
+        buffer.Mark("k", 1);
+        bool first = buffer.Flush();
+        std::optional<int> pending;
+        ok = !first && buffer.Pending("k", pending) && pending == 2;
+        ok = buffer.Flush() && ok;
+        WriteBehindStats stats = buffer.GetStats();
+        ok = stats.failedBatches == 1 && stats.batches == 1 && stats.dirtyKeys == 0 && ok;
+        ok = store.rows["k"] == 2 && sawInflight && ok;
+        scheduler.Shutdown();
+    }
+    std::cout << "Failed batch retried with the newer write: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Race Sets of one key as CacheGroup does and count rounds whose pending write is not the cached value.
+ *
+ * Each Set stores the value under the key's lease lock; `underLock` also
+ * marks it dirty there, as CacheGroup::Set() does, instead of after the lock.
+ *
+ * @param underLock Mark inside the lease callback rather than after it.
+ * @return Rounds that left the buffer holding a different value than the cache.
+ */
+long racingSetsDiverged(bool underLock) {
+    TaskScheduler scheduler(2);
+    WriteBehindOptions options;
+    options.interval = std::chrono::hours(1);
+    options.batchSize = 1000;
+    LeaseTable leases;
+    long diverged = 0;
+    {
+        WriteBehind<int> buffer([](const auto&) { return true; }, options, scheduler);
+        int cached = -1;
+        for (int round = 0; round < WB_RACE_ROUNDS; ++round) {
+            std::atomic<int> ready{0};
+            std::vector<std::thread> racers;
+            for (int t = 0; t < WB_RACERS; ++t) {
+                racers.emplace_back([&, t] {
+                    int value = round * WB_RACERS + t;
+                    ready.fetch_add(1);
+                    while (ready.load() < WB_RACERS) {
+                    }
+                    // Each yield widens the gap between the cache write and the mark.
+                    leases.Invalidate("k", [&] {
+                        cached = value;
+                        if (underLock) {
+                            std::this_thread::yield();
+                            buffer.Mark("k", value);
+                        }
+                    });
+                    if (!underLock) {
+                        std::this_thread::yield();
+                        buffer.Mark("k", value);
+                    }
+                });
+            }
+            for (auto& racer : racers) {
+                racer.join();
+            }
+            std::optional<int> pending;
+            if (!buffer.Pending("k", pending) || pending != cached) {
+                ++diverged;
+            }
+        }
+        scheduler.Shutdown();
+    }
+    return diverged;
+}
+
+/**
+ * @brief Check that racing Sets of one key leave the buffer with the value the cache kept.
+ *
+ * @return True if no round diverged with the write marked under the lease lock.
+ */
+bool racingSetsMarkedInOrder() {
+    long after = racingSetsDiverged(false);
+    long under = racingSetsDiverged(true);
+    std::cout << "Rounds of " << WB_RACERS << " racing sets with buffer and cache disagreeing, marked after the lock: "
+              << after << ", marked under it: " << under << "\n";
+    bool ok = under == 0;
+    std::cout << "Racing sets marked in cache order: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check that destroying a buffer writes its dirty keys and cancels its timer.
+ *
+ * @return True if the destructor flushed and the timer did not fire on the destroyed buffer.
+ */
+bool destructorFlushes() {
+    TaskScheduler scheduler(2);
+    RecordingStore store;
+    WriteBehindOptions options;
+    options.interval = std::chrono::milliseconds(10);
+    options.batchSize = 1000;
+    {
+        WriteBehind<int> buffer([&store](const auto& batch) { return store.Write(batch); }, options, scheduler);
+        buffer.Mark("left", 1);
+        buffer.Mark("gone", std::nullopt);
+    }
+    size_t batches = store.BatchCount();
+    bool ok = batches >= 1 && store.rows["left"] == 1 && store.rows.count("gone") == 1 && !store.rows["gone"];
+    // The timer armed by the buffer comes due after it is gone.
+    std::this_thread::sleep_for(options.interval * 5);
+    ok = store.BatchCount() == batches && ok;
+    scheduler.Shutdown();
+    std::cout << "Destroyed buffer flushed, its timer cancelled: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Check write coalescing, the flush triggers, retries, write order and destruction of the write-behind buffer.
+ *
+ * @return 0 on successful completion, 1 if a check failed.
+ */
+int testWriteBehind() {
+    std::cout << "=== Write-Behind Buffer ===\n";
+    bool ok = writesCoalesce();
+    ok = flushTriggers() && ok;
+    ok = failedBatchRequeued() && ok;
+    ok = racingSetsMarkedInOrder() && ok;
+    ok = destructorFlushes() && ok;
+    std::cout << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+// testXFetch.cpp
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "../include/cacheentry.h"
+
+// Workload parameters (simulated time, 1 ms steps)
+const int XFETCH_NODES = 16;            // nodes each caching the hot key
+const int XFETCH_READS_PER_MS = 5;      // reads of the key per node per ms
+const int64_t XFETCH_TTL_MS = 10000;    // entry time-to-live
+const int64_t XFETCH_LOAD_MS = 200;     // time the loader takes (delta)
+const int64_t XFETCH_RUN_MS = 120000;   // simulated duration
+
+/**
+ * @brief Outcome of one simulated run.
+ */
+struct XFetchRun {
+    int64_t misses = 0;      ///< Reads that found the key expired.
+    int64_t triggers = 0;    ///< Reads that drew an early refresh.
+    int64_t refreshes = 0;   ///< Early refreshes RefreshSet let through.
+    int64_t loads = 0;       ///< Loader calls across all nodes.
+    int peakLoads = 0;       ///< Most loader calls running at once.
+};
+
+/**
+ * @brief Simulate nodes reading one hot key, each with its own copy.
+ *
+ * Each node runs reads through the same steps as CacheGroup::Lookup():
+ * an expired read joins the node's SingleFlight, and an early refresh goes
+ * through the node's RefreshSet before it joins. All copies start loaded
+ * at t=0, so without early refreshes they expire together, as after a
+ * cold start or a cluster-wide Set.
+ *
+ * @param beta XFetch eagerness (0 = refresh only after expiry).
+ */
+XFetchRun simulate(double beta) {
+    const int64_t ms = 1000000;
+    const std::string key = "hot";
+    struct Node {
+        int64_t expiry;
+        int64_t loadDone = -1;   // completion time of the SingleFlight load, or -1
+        bool refreshing = false; // this node's RefreshSet holds the key
+        RefreshSet refreshSet;
+    };
+    std::vector<Node> nodes(XFETCH_NODES);
+    for (auto& node : nodes) {
+        node.expiry = XFETCH_TTL_MS * ms;
+    }
+    XFetchRun run;
+    for (int64_t now = 0; now < XFETCH_RUN_MS * ms; now += ms) {
+        int running = 0;
+        for (auto& node : nodes) {
+            if (node.loadDone >= 0 && now >= node.loadDone) {
+                node.expiry = now + XFETCH_TTL_MS * ms;
+                node.loadDone = -1;
+                if (node.refreshing) {
+                    node.refreshSet.End(key);
+                    node.refreshing = false;
+                }
+            }
+            for (int r = 0; r < XFETCH_READS_PER_MS; ++r) {
+                bool load = false;
+                if (now >= node.expiry) {
+                    ++run.misses;
+                    load = true;
+                } else if (XFetch::RefreshEarly(node.expiry, static_cast<float>(XFETCH_LOAD_MS * ms), beta, now)) {
+                    ++run.triggers;
+                    if (node.refreshSet.Begin(key)) {
+                        node.refreshing = true;
+                        ++run.refreshes;
+                        load = true;
+                    }
+                }
+                if (load && node.loadDone < 0) {
+                    node.loadDone = now + XFETCH_LOAD_MS * ms;
+                    ++run.loads;
+                }
+            }
+            running += node.loadDone >= 0;
+        }
+        run.peakLoads = std::max(run.peakLoads, running);
+    }
+    return run;
+}
+
+/**
+ * @brief Check that RefreshSet lets exactly one of many racing refreshes of a key through.
+ *
+ * @return True if one thread per round won Begin(), and the key could be claimed again after End().
+ */
+bool refreshSetClaimsOnce() {
+    const int threads = 8;
+    const int rounds = 1000;
+    RefreshSet refreshSet;
+    bool ok = true;
+    for (int round = 0; round < rounds && ok; ++round) {
+        std::atomic<int> won{0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < threads; ++t) {
+            readers.emplace_back([&refreshSet, &won] { won += refreshSet.Begin("hot"); });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        ok = won.load() == 1 && !refreshSet.Begin("hot") && refreshSet.Begin("other");
+        refreshSet.End("hot");
+        refreshSet.End("other");
+    }
+    std::cout << "RefreshSet: one refresh per key out of " << threads << " racing readers over " << rounds
+              << " rounds: " << (ok ? "yes" : "no") << "\n";
+    return ok;
+}
+
+/**
+ * @brief Compare misses and loader concurrency with and without probabilistic early expiration.
+ *
+ * @return 0 on successful completion, 1 if early refreshes did not remove the expiry misses.
+ */
+int testXFetch() {
+    std::cout << "=== Probabilistic Early Expiration (" << XFETCH_NODES << " nodes, TTL " << XFETCH_TTL_MS
+              << " ms, load " << XFETCH_LOAD_MS << " ms) ===\n";
+    int result = refreshSetClaimsOnce() ? 0 : 1;
+    XFetchRun baseline = simulate(0);
+    for (double beta : {0.0, 0.5, 1.0, 2.0}) {
+        XFetchRun run = beta == 0 ? baseline : simulate(beta);
+        std::cout << "beta " << beta << ": misses " << run.misses << ", early refreshes drawn " << run.triggers
+                  << ", let through " << run.refreshes << ", loads " << run.loads << ", peak concurrent loads "
+                  << run.peakLoads << "\n";
+        if (beta >= 1.0 && run.misses * 10 > baseline.misses) {
+            result = 1;
+        }
+    }
+    std::cout << "\n";
+    return result;
+}
@@ -0,0 +1,342 @@
+#include "include/tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace {
+thread_local SpanContext tlsContext; ///< Context of the span active on this thread.
+
+/**
+ * @brief Per-thread random source for ids and sampling decisions.
+ */
+uint64_t Random64() {
+    thread_local std::mt19937_64 gen(std::random_device{}());
+    return gen();
+}
+
+template<size_t N>
+void FillRandom(std::array<uint8_t, N>& bytes) {
+    for (size_t i = 0; i < N; i += 8) {
+        uint64_t r = Random64();
+        for (size_t j = 0; j < 8 && i + j < N; ++j) {
+            bytes[i + j] = static_cast<uint8_t>(r >> (8 * j));
+        }
+    }
+}
+
+template<size_t N>
+std::string ToHex(const std::array<uint8_t, N>& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(N * 2, '0');
+    for (size_t i = 0; i < N; ++i) {
+        out[2 * i] = digits[bytes[i] >> 4];
+        out[2 * i + 1] = digits[bytes[i] & 0xF];
+    }
+    return out;
+}
+
+int HexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+template<size_t N>
+bool FromHex(const std::string& s, size_t pos, std::array<uint8_t, N>& bytes) {
+    for (size_t i = 0; i < N; ++i) {
+        int hi = HexDigit(s[pos + 2 * i]);
+        int lo = HexDigit(s[pos + 2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        bytes[i] = static_cast<uint8_t>(hi << 4 | lo);
+    }
+    return true;
+}
+
+template<size_t N>
+bool IsZero(const std::array<uint8_t, N>& bytes) {
+    for (uint8_t b : bytes) {
+        if (b != 0) return false;
+    }
+    return true;
+}
+
+nlohmann::json AttributesToJson(const SpanRecord& span) {
+    nlohmann::json attrs = nlohmann::json::object();
+    for (const auto& [key, value] : span.attributes) {
+        attrs[key] = value;
+    }
+    return attrs;
+}
+}
+
+bool SpanContext::IsValid() const {
+    return !IsZero(trace_id);
+}
+
+std::string FormatTraceparent(const SpanContext& ctx) {
+    return "00-" + ToHex(ctx.trace_id) + "-" + ToHex(ctx.span_id) + (ctx.sampled ? "-01" : "-00");
+}
+
+SpanContext ParseTraceparent(const std::string& header) {
+    // version(2) '-' trace-id(32) '-' parent-id(16) '-' flags(2)
+    SpanContext ctx;
+    if (header.size() < 55 || header[2] != '-' || header[35] != '-' || header[52] != '-' ||
+        header.compare(0, 2, "ff") == 0) {
+        return SpanContext{};
+    }
+    std::array<uint8_t, 1> flags{};
+    if (!FromHex(header, 3, ctx.trace_id) || !FromHex(header, 36, ctx.span_id) || !FromHex(header, 53, flags) ||
+        IsZero(ctx.trace_id) || IsZero(ctx.span_id)) {
+        return SpanContext{};
+    }
+    ctx.sampled = (flags[0] & 0x01) != 0;
+    return ctx;
+}
+
+FileSpanExporter::FileSpanExporter(const std::string& path) : path_(path) {}
+
+void FileSpanExporter::Export(const std::vector<SpanRecord>& spans) {
+    std::ofstream out(path_, std::ios::app);
+    if (!out) {
+        spdlog::warn("Cannot open trace file {}", path_);
+        return;
+    }
+    for (const auto& span : spans) {
+        nlohmann::json line = {
+            {"trace_id", ToHex(span.trace_id)},
+            {"span_id", ToHex(span.span_id)},
+            {"parent_span_id", IsZero(span.parent_span_id) ? "" : ToHex(span.parent_span_id)},
+            {"name", span.name},
+            {"start_unix_nano", span.start_unix_ns},
+            {"duration_nano", span.duration_ns},
+            {"error", span.error},
+            {"attributes", AttributesToJson(span)},
+        };
+        out << line.dump() << '\n';
+    }
+}
+
+OtlpHttpSpanExporter::OtlpHttpSpanExporter(const std::string& endpoint, const std::string& service_name)
+    : endpoint_(endpoint), service_name_(service_name) {}
+
+void OtlpHttpSpanExporter::Export(const std::vector<SpanRecord>& spans) {
+    nlohmann::json otlpSpans = nlohmann::json::array();
+    for (const auto& span : spans) {
+        nlohmann::json attrs = nlohmann::json::array();
+        for (const auto& [key, value] : span.attributes) {
+            attrs.push_back({{"key", key}, {"value", {{"stringValue", value}}}});
+        }
+        otlpSpans.push_back({
+            {"traceId", ToHex(span.trace_id)},
+            {"spanId", ToHex(span.span_id)},
+            {"parentSpanId", IsZero(span.parent_span_id) ? "" : ToHex(span.parent_span_id)},
+            {"name", span.name},
+            {"startTimeUnixNano", std::to_string(span.start_unix_ns)},
+            {"endTimeUnixNano", std::to_string(span.start_unix_ns + span.duration_ns)},
+            {"attributes", attrs},
+            {"status", {{"code", span.error ? 2 : 1}}},
+        });
+    }
+    nlohmann::json body = {
+        {"resourceSpans", nlohmann::json::array({{
+            {"resource", {{"attributes", nlohmann::json::array({
+                {{"key", "service.name"}, {"value", {{"stringValue", service_name_}}}}})}}},
+            {"scopeSpans", nlohmann::json::array({{
+                {"scope", {{"name", "kcache"}}},
+                {"spans", otlpSpans}}})},
+        }})},
+    };
+    httplib::Client client(endpoint_);
+    client.set_connection_timeout(std::chrono::seconds(1));
+    client.set_read_timeout(std::chrono::seconds(2));
+    auto res = client.Post("/v1/traces", body.dump(), "application/json");
+    if (!res || res->status / 100 != 2) {
+        spdlog::warn("Failed to export {} spans to {}", spans.size(), endpoint_);
+    }
+}
+
+Tracer& Tracer::Instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::~Tracer() {
+    Shutdown();
+}
+
+void Tracer::Configure(TracerOptions options) {
+    Shutdown();
+    double ratio = std::min(1.0, std::max(0.0, options.sample_ratio));
+    uint64_t threshold = ratio >= 1.0 ? UINT64_MAX : static_cast<uint64_t>(std::ldexp(ratio, 64));
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        capacity_ = std::max<size_t>(1, options.buffer_capacity);
+        buffer_.clear();
+        buffer_.reserve(capacity_);
+        flush_interval_ = options.flush_interval;
+        exporter_ = std::move(options.exporter);
+        stop_ = false;
+    }
+    sample_threshold_.store(threshold, std::memory_order_relaxed);
+    bool enabled = ratio > 0.0 && exporter_ != nullptr;
+    if (enabled) {
+        flush_thread_ = std::thread([this] { FlushLoop(); });
+    }
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::Shutdown() {
+    enabled_.store(false, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
+    }
+}
+
+SpanContext Tracer::Continue(const SpanContext& remote) {
+    if (!Enabled()) {
+        return SpanContext{};
+    }
+    if (remote.IsValid()) {
+        return remote;
+    }
+    SpanContext root;
+    root.sampled = Random64() < sample_threshold_.load(std::memory_order_relaxed);
+    if (root.sampled) {
+        FillRandom(root.trace_id);
+    }
+    return root;
+}
+
+const SpanContext& Tracer::Current() {
+    return tlsContext;
+}
+
+void Tracer::Record(SpanRecord&& span) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (stop_ || buffer_.size() >= capacity_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer_.push_back(std::move(span));
+        wake = buffer_.size() == std::max<size_t>(1, capacity_ / 2);
+    }
+    if (wake) {
+        cv_.notify_one();
+    }
+}
+
+void Tracer::FlushLoop() {
+    std::vector<SpanRecord> batch;
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+        cv_.wait_for(lock, flush_interval_, [this] { return stop_ || buffer_.size() >= std::max<size_t>(1, capacity_ / 2); });
+        batch.swap(buffer_);
+        buffer_.reserve(capacity_);
+        auto exporter = exporter_;
+        bool stopping = stop_;
+        lock.unlock();
+        if (!batch.empty() && exporter) {
+            try {
+                exporter->Export(batch);
+            } catch (const std::exception& e) {
+                spdlog::warn("Span export failed: {}", e.what());
+            }
+        }
+        batch.clear();
+        if (stopping) {
+            return;
+        }
+        lock.lock();
+    }
+}
+
+Span::Span(const char* name, const SpanContext& parent) {
+    if (!parent.sampled) {
+        return;
+    }
+    record_ = std::make_unique<SpanRecord>();
+    record_->name = name;
+    record_->trace_id = parent.trace_id;
+    record_->parent_span_id = parent.span_id;
+    FillRandom(record_->span_id);
+    record_->start_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    start_ = std::chrono::steady_clock::now();
+    previous_ = tlsContext;
+    tlsContext = Context();
+    attached_ = true;
+}
+
+Span::~Span() {
+    if (!record_) {
+        return;
+    }
+    record_->duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_).count();
+    Detach();
+    Tracer::Instance().Record(std::move(*record_));
+}
+
+void Span::Detach() {
+    if (attached_) {
+        tlsContext = previous_;
+        attached_ = false;
+    }
+}
+
+SpanContext Span::Context() const {
+    SpanContext ctx;
+    if (record_) {
+        ctx.trace_id = record_->trace_id;
+        ctx.span_id = record_->span_id;
+        ctx.sampled = true;
+    }
+    return ctx;
+}
+
+void ConfigureTracing(double sample_ratio, const std::string& file, const std::string& otlp_endpoint,
+                      const std::string& service_name) {
+    TracerOptions options;
+    options.sample_ratio = sample_ratio;
+    if (!file.empty()) {
+        options.exporter = std::make_unique<FileSpanExporter>(file);
+    } else if (!otlp_endpoint.empty()) {
+        options.exporter = std::make_unique<OtlpHttpSpanExporter>(otlp_endpoint, service_name);
+    }
+    if (sample_ratio > 0.0 && !options.exporter) {
+        spdlog::warn("Tracing sample ratio {} ignored: no trace file or OTLP endpoint set", sample_ratio);
+    }
+    Tracer::Instance().Configure(std::move(options));
+    if (Tracer::Instance().Enabled()) {
+        spdlog::info("Tracing {} with sample ratio {}", service_name, sample_ratio);
+    }
+}
+
+void InjectTraceContext(grpc::ClientContext& context) {
+    const SpanContext& ctx = tlsContext;
+    if (ctx.sampled) {
+        context.AddMetadata("traceparent", FormatTraceparent(ctx));
+    }
+}
+
+SpanContext ExtractTraceContext(const grpc::ServerContextBase& context) {
+    const auto& metadata = context.client_metadata();
+    auto it = metadata.find("traceparent");
+    if (it == metadata.end()) {
+        return SpanContext{};
+    }
+    return ParseTraceparent(std::string(it->second.data(), it->second.size()));
+}